@@ -0,0 +1,84 @@
+"""Reader for the columnar files written by ns3::ColumnarTraceWriter.
+
+Used for the traces of the simulations (traces.cols) and for the results of
+simulations/vcp-sweep. The file is memory mapped and every column is
+returned as a numpy array viewing the mapped blocks (concatenated when the
+series spans several blocks).
+"""
+
+import mmap
+import struct
+
+import numpy as np
+
+_TYPES = {ord(c): np.dtype(c) for c in 'dqQI'}
+
+
+def read(path):
+    """Return (metadata dict, {series name: {column name: numpy array}})."""
+    with open(path, 'rb') as f:
+        buf = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+
+    assert buf[:8] == b'NS3COLS\0', f'{path} is not a columnar file'
+    version, meta_len = struct.unpack_from('<II', buf, 8)
+    assert version == 1, f'unsupported version {version}'
+    off = 16
+    meta = {}
+    for line in buf[off:off + meta_len].decode().splitlines():
+        if '=' in line:
+            key, value = line.split('=', 1)
+            meta[key] = value
+    off += meta_len
+
+    schemas = {}
+    chunks = {}
+    while off < len(buf):
+        record = buf[off:off + 1]
+        off += 1
+        if record == b'S':
+            series_id, name_len = struct.unpack_from('<HB', buf, off)
+            off += 3
+            name = buf[off:off + name_len].decode()
+            off += name_len
+            n_columns, = struct.unpack_from('<H', buf, off)
+            off += 2
+            columns = []
+            for _ in range(n_columns):
+                col_type, col_len = struct.unpack_from('<BB', buf, off)
+                off += 2
+                columns.append((buf[off:off + col_len].decode(), _TYPES[col_type]))
+                off += col_len
+            schemas[series_id] = (name, columns)
+            chunks[name] = {col: [] for col, _ in columns}
+        elif record == b'B':
+            if off + 6 > len(buf):
+                break
+            series_id, n_rows = struct.unpack_from('<HI', buf, off)
+            off += 6
+            name, columns = schemas[series_id]
+            size = sum(n_rows * dtype.itemsize for _, dtype in columns)
+            if off + size > len(buf):
+                # Block cut short by an interrupted writer
+                break
+            for col, dtype in columns:
+                chunks[name][col].append(np.frombuffer(buf, dtype, n_rows, off))
+                off += n_rows * dtype.itemsize
+        else:
+            raise ValueError(f'{path}: bad record type {record!r}')
+
+    series = {}
+    for name, columns in schemas.values():
+        series[name] = {col: np.concatenate(chunks[name][col]) if chunks[name][col]
+                        else np.empty(0, dtype)
+                        for col, dtype in columns}
+    return meta, series
+
+
+def read_columns(path, series=None):
+    """Return (metadata dict, {column name: numpy array}) of one series,
+    by default the only series of the file."""
+    meta, all_series = read(path)
+    if series is None:
+        assert len(all_series) == 1, f'{path} holds {list(all_series)}'
+        series, = all_series
+    return meta, all_series[series]
@@ -5,25 +5,28 @@ import sys
 import numpy as np
 from matplotlib import pyplot as plt
 
-assert len(sys.argv) == 4, sys.argv
+from columnar import read
 
-fpaths = sys.argv[1:3]
-output_path = sys.argv[3]
+assert len(sys.argv) == 3, sys.argv
 
-throughputs = []
-for fpath in fpaths:
-    with open(fpath, 'r') as f:
-        rxbytes = f.readlines()
-        
-    rxbytes = list([int(x.strip()) for x in rxbytes])
-    rxbytes = (np.array(rxbytes) * 8) / 1000000
-    shifted = np.roll(rxbytes, 1)
-    shifted[0] = 0
-    throughput = (rxbytes - shifted) / 0.5 # interval per sample in seconds
-    throughputs.append(throughput)
+traces_path = sys.argv[1]
+output_path = sys.argv[2]
 
+_, series = read(traces_path)
+flows = series['flows']
+throughputs = []
+for flow_id in (1, 3):
+    # rows of the intervals in which the flow changed, 0.5 s apart
+    rows = flows['flowId'] == flow_id
+    time = flows['time'][rows]
+    rxbytes = (flows['rxBytes'][rows] * 8) / 1000000
+    interval = np.diff(time, prepend=time[:1] - 0.5)
+    throughput = np.diff(rxbytes, prepend=0) / interval
+    throughputs.append((time, throughput))
 
 def plot_figure_1(throughput1, throughput2):
+    time1, throughput1 = throughput1
+    time2, throughput2 = throughput2
     fig = plt.figure(figsize=(12.8, 4))
     plt.plot(
         list(range(41)) + list(range(40, 81)) + list(range(80, 181)) + list(range(180, 221)) + list(range(220, 260)),
@@ -33,14 +36,14 @@ def plot_figure_1(throughput1, throughput2):
     )
     
     plt.plot(
-        np.arange(0, len(throughput1) // 2,  0.5),
+        time1,
         throughput1,
         'b-', linewidth=0.9,
         label='1st flow'
     )
     
     plt.plot(
-        np.arange(120, 120 + len(throughput2) // 2,  0.5),
+        time2,
         throughput2,
         'r--', linewidth=0.9,
         label='2nd flow'
@@ -1,12 +1,10 @@
 import glob
 import os
-from os import listdir
-from os.path import isfile, join
-import re
 
 from matplotlib import pyplot as plt
 import numpy as np
 
+from columnar import read, read_columns
 
 import sys
 
@@ -14,72 +12,48 @@ assert len(sys.argv) == 2, sys.argv
 
 input_dir = sys.argv[1]
 
-img_prefix = input_dir.split('/')[-1].replace('-', '_')
-
-util_trace_files = glob.glob(os.path.join(input_dir + '*', 'bytesSent.tr'))
-q_trace_files = glob.glob(os.path.join(input_dir + '*', 'q.tr'))
-drop_trace_files = glob.glob(os.path.join(input_dir + '*', 'drops.tr'))
+img_prefix = os.path.splitext(input_dir.rstrip('/').split('/')[-1])[0].replace('-', '_')
 
+utils = []
+q_avgs = []
+drops = []
 bottleneck_capacity_util = []
 bottleneck_capacity_q = []
 bottleneck_capacity_drop = []
 
-utils = []
-q_avgs = []
-drops = []
-for filename in util_trace_files:
-    try:
-        m = re.search(r'bw(\d+)', filename)
-        bwBottleneck = float(m.group(1))
-        bytesSentFile = open(filename)
-        lines = bytesSentFile.readlines()
-        early_bytes_sent = int(lines[0].split()[1])
-        final_bytes_sent = int(lines[1].split()[1])
-        late_bytes_sent = final_bytes_sent - early_bytes_sent;
-        bits_per_sec = (late_bytes_sent * 8) / (0.8 * 120)
-        util = float(bits_per_sec) / (bwBottleneck * 1000)
-
-        utils.append(util)
-        bottleneck_capacity_util.append(bwBottleneck)
-    except:
-        pass
-
-for filename in q_trace_files:
-    try:
-        m = re.search(r'bw(\d+)', filename)
-        bwBottleneck = float(m.group(1))
-        if bwBottleneck not in bottleneck_capacity_util:
-            continue
-
-        qTrFile = open(filename)
-        lines = qTrFile.readlines()
-        avgs_sum = 0.0
-        for line in lines:
-            avgs_sum += float(line.split()[1])
-        q_avg = avgs_sum / len(lines)
-
-        q_avgs.append(q_avg * 100)
-        bottleneck_capacity_q.append(float(bwBottleneck))
-    except:
-        pass
-
-for filename in drop_trace_files:
-    try:
-        m = re.search(r'bw(\d+)', filename)
-        bwBottleneck = float(m.group(1))
-        if bwBottleneck not in bottleneck_capacity_util:
-            continue
-
-        dropTrFile = open(filename)
-        lines = dropTrFile.readlines()
-        packet_drops = int(lines[0].split()[1])
-        total_sent= int(lines[1].split()[1])
-        drop_pct = float(packet_drops) / float(total_sent)
-
-        drops.append(drop_pct * 100)
-        bottleneck_capacity_drop.append(float(bwBottleneck))
-    except:
-        pass
+if os.path.isfile(input_dir):
+    # Result file of simulations/vcp-sweep, averaged over seeds
+    _, cols = read_columns(input_dir)
+    ok = cols['status'] == 0
+    for bw in np.unique(cols['bw'][ok]):
+        rows = ok & (cols['bw'] == bw)
+        utils.append(np.nanmean(cols['util'][rows]))
+        q_avgs.append(np.nanmean(cols['avgQueue'][rows]) * 100)
+        drops.append(np.nanmean(cols['dropRate'][rows]) * 100)
+    bottleneck_capacity_util = list(np.unique(cols['bw'][ok]))
+    bottleneck_capacity_q = list(bottleneck_capacity_util)
+    bottleneck_capacity_drop = list(bottleneck_capacity_util)
+else:
+    # One traces.cols per single-bottleneck-datapoint run
+    for filename in glob.glob(os.path.join(input_dir + '*', 'traces.cols')):
+        try:
+            meta, series = read(filename)
+            bwBottleneck = float(meta['bwBottleneck'])
+
+            time = series['bytesSent']['time']
+            bytes_sent = series['bytesSent']['bytes']
+            bits_per_sec = float(bytes_sent[1] - bytes_sent[0]) * 8 / (time[1] - time[0])
+            utils.append(bits_per_sec / (bwBottleneck * 1000))
+            bottleneck_capacity_util.append(bwBottleneck)
+
+            q_avgs.append(np.mean(series['queue']['occupancy']) * 100)
+            bottleneck_capacity_q.append(bwBottleneck)
+
+            drop_pct = float(series['drops']['drops'][0]) / float(series['drops']['total'][0])
+            drops.append(drop_pct * 100)
+            bottleneck_capacity_drop.append(bwBottleneck)
+        except (KeyError, IndexError, ZeroDivisionError):
+            pass
 
 print(len(utils), len(q_avgs), len(drops))
 bottleneck_capacity_util = np.array(bottleneck_capacity_util) / 1000
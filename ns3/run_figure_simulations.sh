@@ -3,6 +3,10 @@
 # Whether to run the simulations sequentially or launch all in background
 sequential=0
 
+# Whether to run figure 3 with the fluid model instead of packet-level
+# simulation (fast enough for the full set of datapoints)
+fluid=0
+
 # Bandwidth values up to 10Mpbs
 datapoints=(100 200 500 600 800 1000 1200 1500 3000 5000 8000 10000)
 
@@ -14,21 +18,36 @@ datapoints=(100 200 500 600 800 1000 1200 1500 3000 5000 8000 10000)
 #             125000 150000 200000  250000  350000 
 #             500000 750000 1000000 2000000 5000000)
 
+if [ ${fluid} -eq 1 ]; then
+    datapoints=(100    200    500     600     800
+                1000   1200   1500    3000    5000
+                8000   10000  16000   25000   32000
+                35000  40000  50000   75000   100000
+                125000 150000 200000  250000  350000
+                500000 750000 1000000 2000000 5000000)
+fi
+
 ./waf build
 
-for bw in ${datapoints[@]}; do
-    dir="outputs/figure3-default-bw${bw}/"
-    mkdir -p ${dir}
-    if [ ${sequential} -eq 0 ]; then
-        ./waf --run "simulations/single-bottleneck-datapoint \
-                     --bwBottleneck=${bw} \
-                     --dir=${dir}" &
-    else
-        ./waf --run "simulations/single-bottleneck-datapoint \
-                     --bwBottleneck=${bw} \
-                     --dir=${dir}"
-    fi
-done
+# Figure 3 datapoints run through the sweep driver, which bounds the number of
+# concurrent runs and collects the results into a single columnar file
+bws=$(IFS=,; echo "${datapoints[*]}")
+mkdir -p outputs
+if [ ${sequential} -eq 0 ]; then
+    ./waf --run "simulations/vcp-sweep \
+                 --program=single-bottleneck-datapoint \
+                 --bw=${bws} \
+                 --jobs=$(nproc) \
+                 --args=--fluid=${fluid} \
+                 --out=outputs/figure3-default.cols" &
+else
+    ./waf --run "simulations/vcp-sweep \
+                 --program=single-bottleneck-datapoint \
+                 --bw=${bws} \
+                 --jobs=1 \
+                 --args=--fluid=${fluid} \
+                 --out=outputs/figure3-default.cols"
+fi
 
 dir="outputs/figure1-default/"
 mkdir -p ${dir}
@@ -54,8 +73,7 @@ fi
 wait
 
 # Plot results
-dir="outputs/figure3-default"
-python3 plotting/plot_fig3.py "${dir}"
+python3 plotting/plot_fig3.py outputs/figure3-default.cols
 
 dir="outputs/figure1-default"
-python3 plotting/plot_fig1.py "${dir}/throughput.tr" "${dir}/throughput2.tr" "figure1_cwndscaling.png"
+python3 plotting/plot_fig1.py "${dir}/traces.cols" "figure1_cwndscaling.png"
@@ -41,6 +41,7 @@
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
 #include "ns3/flow-monitor-helper.h"
+#include "ns3/columnar-trace.h"
 
 using namespace ns3;
 
@@ -61,48 +62,45 @@ static double TRACE_START_TIME = 0.05;
  */
 
 static void
-QueueOccupancyTracer (Ptr<OutputStreamWrapper> stream,
+QueueOccupancyTracer (Ptr<ColumnarTraceWriter> traces, uint16_t series,
                      uint32_t oldval, uint32_t newval)
 {
   NS_LOG_INFO (Simulator::Now ().GetSeconds () <<
                " Queue Disc size from " << oldval << " to " << newval);
 
-  *stream->GetStream () << Simulator::Now ().GetSeconds () << " "
-                        << newval << std::endl;
+  traces->Append (series, Simulator::Now ().GetSeconds (), newval);
 }
 
 static void
-CwndTracer (Ptr<OutputStreamWrapper> stream,
+CwndTracer (Ptr<ColumnarTraceWriter> traces, uint16_t series,
             uint32_t oldval, uint32_t newval)
 {
   NS_LOG_INFO (Simulator::Now ().GetSeconds () <<
                " Cwnd size from " << oldval << " to " << newval);
 
-  *stream->GetStream () << Simulator::Now ().GetSeconds () << " "
-                        << newval << std::endl;
+  traces->Append (series, Simulator::Now ().GetSeconds (), newval);
 }
 
 static void
-TraceCwnd (Ptr<OutputStreamWrapper> cwndStream)
+TraceCwnd (Ptr<ColumnarTraceWriter> traces, uint16_t series)
 {
   Config::ConnectWithoutContext ("/NodeList/0/$ns3::TcpL4Protocol/SocketList/0/CongestionWindow",
-                                 MakeBoundCallback (&CwndTracer, cwndStream));
+                                 MakeBoundCallback (&CwndTracer, traces, series));
 }
 
 static void
-RttTracer (Ptr<OutputStreamWrapper> stream,
+RttTracer (Ptr<ColumnarTraceWriter> traces, uint16_t series,
            Time oldval, Time newval)
 {
   NS_LOG_INFO (Simulator::Now ().GetSeconds () <<
                " Rtt from " << oldval.GetMilliSeconds () <<
                " to " << newval.GetMilliSeconds ());
 
-  *stream->GetStream () << Simulator::Now ().GetSeconds () << " "
-                        << newval.GetMilliSeconds () << std::endl;
+  traces->Append (series, Simulator::Now ().GetSeconds (), newval.GetMilliSeconds ());
 }
 
 static void
-TraceRtt (Ptr<OutputStreamWrapper> rttStream)
+TraceRtt (Ptr<ColumnarTraceWriter> traces, uint16_t series)
 {
   // DONE: In the TraceCwnd function above, you learned how to trace congestion
   //       window size of a TCP socket. Take a look at the documentation for
@@ -116,25 +114,7 @@ TraceRtt (Ptr<OutputStreamWrapper> rttStream)
    * simulation
    */
   Config::ConnectWithoutContext ("/NodeList/0/$ns3::TcpL4Protocol/SocketList/0/RTT",
-                                 MakeBoundCallback (&RttTracer, rttStream));
-}
-
-static void
-TraceThroughput1 (Ptr<FlowMonitor> flowMonitor, Ptr<OutputStreamWrapper> stream)
-{
-  FlowMonitor::FlowStatsContainer stats = flowMonitor->GetFlowStats();
-  *stream->GetStream() << stats[1].rxBytes << std::endl;
-
-  Simulator::Schedule(Seconds(0.5), &TraceThroughput1, flowMonitor, stream);
-}
-
-static void
-TraceThroughput2 (Ptr<FlowMonitor> flowMonitor, Ptr<OutputStreamWrapper> stream)
-{
-  FlowMonitor::FlowStatsContainer stats = flowMonitor->GetFlowStats();
-  *stream->GetStream() << stats[3].rxBytes << std::endl;
-
-  Simulator::Schedule(Seconds(0.5), &TraceThroughput2, flowMonitor, stream);
+                                 MakeBoundCallback (&RttTracer, traces, series));
 }
 
 static void
@@ -154,8 +134,6 @@ DowngradeLinkCapacity (Ptr<NetDevice> dev, Ptr<QueueDisc> qdisc)
 int
 main (int argc, char *argv[])
 {
-  AsciiTraceHelper asciiTraceHelper;
-
   /* Start by setting default variables. Feel free to play with the input
    * arguments below to see what happens.
    */
@@ -172,6 +150,7 @@ main (int argc, char *argv[])
   double maxCwndInc = 1 + xi;
   std::string transport_prot = "Vcp";
   std::string dir = "outputs/figure1/";
+  bool metadata = true;
 
   CommandLine cmd (__FILE__);
   cmd.AddValue ("bwHost", "Bandwidth of host links (Mb/s)", bwHost);
@@ -191,6 +170,7 @@ main (int argc, char *argv[])
   cmd.AddValue ("xiBound", "Upper bound on scaled MI factor", xiBound);
   cmd.AddValue ("maxCwndInc", "Maximum fraction by which cwnd can increase per RTT", maxCwndInc);
   cmd.AddValue ("dir", "The directory to write outputs to", dir);
+  cmd.AddValue ("metadata", "Record packet metadata, to print and check packets", metadata);
   cmd.Parse (argc, argv);
 
   /* NS-3 is great when it comes to logging. It allows logging in different
@@ -200,8 +180,11 @@ main (int argc, char *argv[])
   LogComponentEnable("Figure1", LOG_LEVEL_DEBUG);
 
   // (VCP): lets packets be printed
-  Packet::EnablePrinting();
-  Packet::EnableChecking();
+  if (metadata)
+    {
+      Packet::EnablePrinting();
+      Packet::EnableChecking();
+    }
 
   std::string bwHostStr = std::to_string(bwHost) + "Mbps";
   std::string bwNetStr = std::to_string(bwNet) + "Mbps";
@@ -218,25 +201,16 @@ main (int argc, char *argv[])
   /* Traces will be written on these files for postprocessing. */
   // std::string dir = "outputs/bb-q" + std::to_string(maxQ) + "/";
 
-  std::string qStreamName = dir + "q.tr";
-  Ptr<OutputStreamWrapper> qStream;
-  qStream = asciiTraceHelper.CreateFileStream (qStreamName);
-
-  std::string cwndStreamName = dir + "cwnd.tr";
-  Ptr<OutputStreamWrapper> cwndStream;
-  cwndStream = asciiTraceHelper.CreateFileStream (cwndStreamName);
-
-  std::string rttStreamName = dir + "rtt.tr";
-  Ptr<OutputStreamWrapper> rttStream;
-  rttStream = asciiTraceHelper.CreateFileStream (rttStreamName);
-
-  std::string throughputStreamName = dir + "throughput.tr";
-  Ptr<OutputStreamWrapper> throughputStream;
-  throughputStream = asciiTraceHelper.CreateFileStream(throughputStreamName);
+  Ptr<ColumnarTraceWriter> traces = Create<ColumnarTraceWriter> (
+    dir + "traces.cols",
+    "program=figure-1-1\nbwNet=" + std::to_string (bwNet) + "\ntime=" + std::to_string (time) + "\n");
 
-  std::string throughputStreamName2 = dir + "throughput2.tr";
-  Ptr<OutputStreamWrapper> throughputStream2;
-  throughputStream2 = asciiTraceHelper.CreateFileStream(throughputStreamName2);
+  uint16_t qSeries = traces->AddSeries ("queue", {{"time", ColumnarTraceWriter::DOUBLE},
+                                                  {"packets", ColumnarTraceWriter::UINT32}});
+  uint16_t cwndSeries = traces->AddSeries ("cwnd", {{"time", ColumnarTraceWriter::DOUBLE},
+                                                    {"cwnd", ColumnarTraceWriter::UINT32}});
+  uint16_t rttSeries = traces->AddSeries ("rtt", {{"time", ColumnarTraceWriter::DOUBLE},
+                                                  {"rttMs", ColumnarTraceWriter::INT64}});
 
 
   /* In order to run simulations in NS-3, you need to set up your network all
@@ -270,17 +244,17 @@ main (int argc, char *argv[])
   PointToPointHelper host1Link;
   host1Link.SetDeviceAttribute ("DataRate", StringValue (bwHostStr));
   host1Link.SetChannelAttribute ("Delay", StringValue (delayStr));
-  host1Link.SetQueue ("ns3::DropTailQueue", "MaxSize", StringValue ("1p"));
+  host1Link.SetQueue ("ns3::RingQueue", "MaxSize", StringValue ("1p"));
 
   PointToPointHelper host2Link;
   host2Link.SetDeviceAttribute("DataRate", StringValue(bwHostStr));
   host2Link.SetChannelAttribute("Delay", StringValue(delayStr));
-  host2Link.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("1p"));
+  host2Link.SetQueue("ns3::RingQueue", "MaxSize", StringValue("1p"));
 
   PointToPointHelper bottleneckLink;
   bottleneckLink.SetDeviceAttribute ("DataRate", StringValue (bwNetStr));
   bottleneckLink.SetChannelAttribute ("Delay", StringValue (delayStr));
-  bottleneckLink.SetQueue ("ns3::DropTailQueue",
+  bottleneckLink.SetQueue ("ns3::RingQueue",
                            "MaxSize", StringValue ("1p"));
 
   /******** Create NetDevices ********/
@@ -354,24 +328,28 @@ main (int argc, char *argv[])
   // DONE: Read documentation for PfifoFastQueueDisc and use the correct
   //       attribute name to set the size of the bottleneck queue.
   TrafficControlHelper tchPfifo;
-  tchPfifo.SetRootQueueDisc ("ns3::VcpQueueDisc",
-                             "MaxSize", StringValue(maxQStr),
-                             "LinkBandwidth", StringValue(bwHostStr),
-                             "TimeInterval", TimeValue(MilliSeconds(estInterval)));
+  uint16_t handle = tchPfifo.SetRootQueueDisc ("ns3::VcpQueueDisc",
+                                               "MaxSize", StringValue(maxQStr),
+                                               "LinkBandwidth", StringValue(bwHostStr),
+                                               "TimeInterval", TimeValue(MilliSeconds(estInterval)));
+  /* Keep the packets of the queue disc in a circular array */
+  tchPfifo.AddInternalQueues (handle, 1, "ns3::RingQueue", "MaxSize", StringValue (maxQStr));
 
   tchPfifo.Install(h1s0_NetDevices);
   tchPfifo.Install(h2s0_NetDevices);
 
   TrafficControlHelper tchPfifo2;
-  tchPfifo2.SetRootQueueDisc ("ns3::VcpQueueDisc",
-                             "MaxSize", StringValue(maxQStr),
-                             "LinkBandwidth", StringValue(bwNetStr),
-                             "TimeInterval", TimeValue(MilliSeconds(estInterval)));
+  uint16_t handle2 = tchPfifo2.SetRootQueueDisc ("ns3::VcpQueueDisc",
+                                                "MaxSize", StringValue(maxQStr),
+                                                "LinkBandwidth", StringValue(bwNetStr),
+                                                "TimeInterval", TimeValue(MilliSeconds(estInterval)));
+  /* Keep the packets of the queue disc in a circular array */
+  tchPfifo2.AddInternalQueues (handle2, 1, "ns3::RingQueue", "MaxSize", StringValue (maxQStr));
 
   QueueDiscContainer s0h3_QueueDiscs = tchPfifo2.Install (s0h3_NetDevices);
   /* Trace Bottleneck Queue Occupancy */
   s0h3_QueueDiscs.Get(0)->TraceConnectWithoutContext ("PacketsInQueue",
-                            MakeBoundCallback (&QueueOccupancyTracer, qStream));
+                            MakeBoundCallback (&QueueOccupancyTracer, traces, qSeries));
 
   /* Set IP addresses of the nodes in the network */
   Ipv4AddressHelper address;
@@ -419,18 +397,19 @@ main (int argc, char *argv[])
   sourceApp2.Stop (Seconds ((double)time));
 
   /* Start tracing cwnd of the connection after the connection is established */
-  Simulator::Schedule (Seconds (TRACE_START_TIME), &TraceCwnd, cwndStream);
+  Simulator::Schedule (Seconds (TRACE_START_TIME), &TraceCwnd, traces, cwndSeries);
 
   /* Start tracing the RTT after the connection is established */
-  Simulator::Schedule (Seconds (TRACE_START_TIME), &TraceRtt, rttStream);
+  Simulator::Schedule (Seconds (TRACE_START_TIME), &TraceRtt, traces, rttSeries);
 
   // Flow tracing
   Ptr<FlowMonitor> flowMonitor;
   FlowMonitorHelper flowHelper;
   flowMonitor = flowHelper.InstallAll();
 
-  Simulator::Schedule (Seconds (TRACE_START_TIME), &TraceThroughput1, flowMonitor, throughputStream);
-  Simulator::Schedule (Seconds (120), &TraceThroughput2, flowMonitor, throughputStream2);
+  /* The "flows" series holds the cumulative stats of the flows that
+   * changed in every 0.5 s interval, the throughputs are their rxBytes. */
+  flowMonitor->EnableDeltaExport (traces, Seconds (0.5));
 
   Simulator::Schedule (Seconds (40), &UpgradeLinkCapacity, s0h3_NetDevices.Get(0), s0h3_QueueDiscs.Get (0));
   Simulator::Schedule (Seconds (80), &DowngradeLinkCapacity, s0h3_NetDevices.Get(0), s0h3_QueueDiscs.Get(0));
@@ -41,6 +41,7 @@
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
 #include "ns3/flow-monitor-helper.h"
+#include "ns3/columnar-trace.h"
 
 using namespace ns3;
 
@@ -65,81 +66,41 @@ static int last_bytes_sent = 0;
  */
 
 static void
-QueueOccupancyTracer (Ptr<OutputStreamWrapper> stream,
+QueueOccupancyTracer (Ptr<ColumnarTraceWriter> traces, uint16_t series,
                       Ptr<QueueDisc> q)
 {
- *stream->GetStream() << Simulator::Now().GetSeconds () << " "
-                      << (double) q->GetCurrentSize().GetValue () << std::endl;
+  traces->Append (series, Simulator::Now ().GetSeconds (),
+                  q->GetCurrentSize ().GetValue ());
   Simulator::Schedule (MilliSeconds(QUEUE_TRACE_INTERVAL_MS), 
                        &QueueOccupancyTracer,
-                       stream,
+                       traces,
+                       series,
                        q);
 }
 
 static void
-TraceThroughput1 (Ptr<FlowMonitor> flowMonitor, Ptr<OutputStreamWrapper> stream)
+TraceThroughput (Ptr<FlowMonitor> flowMonitor, Ptr<ColumnarTraceWriter> traces,
+                 uint16_t series, FlowId flowId)
 {
-  FlowMonitor::FlowStatsContainer stats = flowMonitor->GetFlowStats();
-  *stream->GetStream() << stats[1].rxBytes << std::endl;
+  /* Look the flow up in place rather than copy the stats of every flow */
+  const FlowMonitor::FlowStatsContainer &stats = flowMonitor->GetFlowStats ();
+  FlowMonitor::FlowStatsContainerCI flow = stats.find (flowId);
+  uint64_t rxBytes = (flow == stats.end ()) ? 0 : flow->second.rxBytes;
+  traces->Append (series, Simulator::Now ().GetSeconds (), rxBytes);
 
-  Simulator::Schedule(Seconds(0.5), &TraceThroughput1, flowMonitor, stream);
+  Simulator::Schedule(Seconds(0.5), &TraceThroughput, flowMonitor, traces, series, flowId);
 }
 
 static void
-TraceThroughput2 (Ptr<FlowMonitor> flowMonitor, Ptr<OutputStreamWrapper> stream)
-{
-  FlowMonitor::FlowStatsContainer stats = flowMonitor->GetFlowStats();
-  *stream->GetStream() << stats[3].rxBytes << std::endl;
-
-  Simulator::Schedule(Seconds(0.5), &TraceThroughput2, flowMonitor, stream);
-}
-
-static void
-TraceThroughput3 (Ptr<FlowMonitor> flowMonitor, Ptr<OutputStreamWrapper> stream)
-{
-  FlowMonitor::FlowStatsContainer stats = flowMonitor->GetFlowStats();
-  *stream->GetStream() << stats[5].rxBytes << std::endl;
-
-  Simulator::Schedule(Seconds(0.5), &TraceThroughput3, flowMonitor, stream);
-}
-
-static void
-TraceThroughput4 (Ptr<FlowMonitor> flowMonitor, Ptr<OutputStreamWrapper> stream)
-{
-  FlowMonitor::FlowStatsContainer stats = flowMonitor->GetFlowStats();
-  *stream->GetStream() << stats[7].rxBytes << std::endl;
-
-  Simulator::Schedule(Seconds(0.5), &TraceThroughput4, flowMonitor, stream);
-}
-
-static void
-TraceThroughput5 (Ptr<FlowMonitor> flowMonitor, Ptr<OutputStreamWrapper> stream)
-{
-  FlowMonitor::FlowStatsContainer stats = flowMonitor->GetFlowStats();
-  *stream->GetStream() << stats[9].rxBytes << std::endl;
-
-  Simulator::Schedule(Seconds(0.5), &TraceThroughput5, flowMonitor, stream);
-}
-
-static void
-TraceThroughput6 (Ptr<FlowMonitor> flowMonitor, Ptr<OutputStreamWrapper> stream)
-{
-  FlowMonitor::FlowStatsContainer stats = flowMonitor->GetFlowStats();
-  *stream->GetStream() << stats[11].rxBytes << std::endl;
-
-  Simulator::Schedule(Seconds(0.5), &TraceThroughput6, flowMonitor, stream);
-}
-
-static void
-TraceUtil (Ptr<OutputStreamWrapper> stream, Ptr<QueueDisc> q)
+TraceUtil (Ptr<ColumnarTraceWriter> traces, uint16_t series, Ptr<QueueDisc> q)
 {
   QueueDisc::Stats stats = q->GetStats();
-  *stream->GetStream () << Simulator::Now ().GetSeconds () << " "
-                        << stats.nTotalSentBytes << std::endl;
+  traces->Append (series, Simulator::Now ().GetSeconds (), stats.nTotalSentBytes);
   last_bytes_sent = stats.nTotalSentBytes;
   Simulator::Schedule(MilliSeconds(UTIL_TRACE_INTERVAL_MS),
                       &TraceUtil,
-                      stream,
+                      traces,
+                      series,
                       q);
 } 
 
@@ -153,8 +114,6 @@ GetMaxQ(int delay, int bw, int numFlows) {
 int
 main (int argc, char *argv[])
 {
-  AsciiTraceHelper asciiTraceHelper;
-
   /* Start by setting default variables. Feel free to play with the input
    * arguments below to see what happens.
    */
@@ -170,6 +129,9 @@ main (int argc, char *argv[])
   double xiBound = 1.0;
   double maxCwndInc = 1 + xi;
   std::string transport_prot = "Vcp";
+  std::string dir;
+  uint32_t threads = 1;
+  bool metadata = true;
 
   CommandLine cmd (__FILE__);
   cmd.AddValue ("bwHost", "Bandwidth of host links (Mb/s)", bwHost);
@@ -188,8 +150,20 @@ main (int argc, char *argv[])
   cmd.AddValue ("beta", "MD factor", beta);
   cmd.AddValue ("xiBound", "Upper bound on scaled MI factor", xiBound);
   cmd.AddValue ("maxCwndInc", "Maximum fraction by which cwnd can increase per RTT", maxCwndInc);
+  cmd.AddValue ("dir", "The directory to write outputs to (default outputs/bb-q<maxQ>/)", dir);
+  cmd.AddValue ("threads", "Run the simulation on this many threads (needs --enable-mtp)", threads);
+  cmd.AddValue ("metadata", "Record packet metadata, to print and check packets", metadata);
   cmd.Parse (argc, argv);
 
+  if (threads > 1)
+    {
+      TypeId tid;
+      NS_ABORT_MSG_UNLESS (TypeId::LookupByNameFailSafe ("ns3::MultithreadedSimulatorImpl", &tid),
+                           "--threads needs ./waf configure --enable-mtp");
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::MultithreadedSimulatorImpl"));
+      Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MaxThreads", UintegerValue (threads));
+    }
+
   maxQ = GetMaxQ(delay, bwNet, 6);
 
   /* NS-3 is great when it comes to logging. It allows logging in different
@@ -199,8 +173,11 @@ main (int argc, char *argv[])
   LogComponentEnable("Figure1", LOG_LEVEL_DEBUG);
 
   // (VCP): lets packets be printed
-  Packet::EnablePrinting();
-  Packet::EnableChecking();
+  if (metadata)
+    {
+      Packet::EnablePrinting();
+      Packet::EnableChecking();
+    }
 
   std::string bwHostStr = std::to_string(bwHost) + "Mbps";
   std::string bwNetStr = std::to_string(bwNet) + "Mbps";
@@ -215,49 +192,30 @@ main (int argc, char *argv[])
 
   /******** Declare output files ********/
   /* Traces will be written on these files for postprocessing. */
-  std::string dir = "outputs/bb-q" + std::to_string(maxQ) + "/";
-
-  std::string qStreamName = dir + "q.tr";
-  Ptr<OutputStreamWrapper> qStream;
-  qStream = asciiTraceHelper.CreateFileStream (qStreamName);
-
-  std::string cwndStreamName = dir + "cwnd.tr";
-  Ptr<OutputStreamWrapper> cwndStream;
-  cwndStream = asciiTraceHelper.CreateFileStream (cwndStreamName);
-
-  std::string rttStreamName = dir + "rtt.tr";
-  Ptr<OutputStreamWrapper> rttStream;
-  rttStream = asciiTraceHelper.CreateFileStream (rttStreamName);
-
-  std::string throughputStreamName = dir + "throughput.tr";
-  Ptr<OutputStreamWrapper> throughputStream;
-  throughputStream = asciiTraceHelper.CreateFileStream(throughputStreamName);
-
-  std::string throughputStreamName2 = dir + "throughput2.tr";
-  Ptr<OutputStreamWrapper> throughputStream2;
-  throughputStream2 = asciiTraceHelper.CreateFileStream(throughputStreamName2);
-
-  std::string throughputStreamName3 = dir + "throughput3.tr";
-  Ptr<OutputStreamWrapper> throughputStream3;
-  throughputStream3 = asciiTraceHelper.CreateFileStream(throughputStreamName3);
-
-  std::string throughputStreamName4 = dir + "throughput4.tr";
-  Ptr<OutputStreamWrapper> throughputStream4;
-  throughputStream4 = asciiTraceHelper.CreateFileStream(throughputStreamName4);
+  if (dir.empty ())
+    {
+      dir = "outputs/bb-q" + std::to_string(maxQ) + "/";
+    }
 
-  std::string throughputStreamName5 = dir + "throughput5.tr";
-  Ptr<OutputStreamWrapper> throughputStream5;
-  throughputStream5 = asciiTraceHelper.CreateFileStream(throughputStreamName5);
+  Ptr<ColumnarTraceWriter> traces = Create<ColumnarTraceWriter> (
+    dir + "traces.cols",
+    "program=figure-9\nbwNet=" + std::to_string (bwNet) + "\ntime=" + std::to_string (time) + "\n");
 
-  std::string throughputStreamName6 = dir + "throughput6.tr";
-  Ptr<OutputStreamWrapper> throughputStream6;
-  throughputStream6 = asciiTraceHelper.CreateFileStream(throughputStreamName6);
+  uint16_t qSeries = traces->AddSeries ("queue", {{"time", ColumnarTraceWriter::DOUBLE},
+                                                  {"packets", ColumnarTraceWriter::UINT32}});
 
-  std::string utilStreamName = dir + "util.tr";
-  Ptr<OutputStreamWrapper> utilStream;
-  utilStream = asciiTraceHelper.CreateFileStream(utilStreamName);
+  /* One series per flow with its cumulative received bytes. */
+  uint16_t throughputSeries[6];
+  for (int i = 0; i < 6; i++)
+    {
+      throughputSeries[i] = traces->AddSeries ("throughput" + std::to_string (i + 1),
+                                               {{"time", ColumnarTraceWriter::DOUBLE},
+                                                {"rxBytes", ColumnarTraceWriter::UINT64}});
+    }
 
-  *utilStream->GetStream () << "0 0" << std::endl;
+  uint16_t utilSeries = traces->AddSeries ("util", {{"time", ColumnarTraceWriter::DOUBLE},
+                                                    {"bytesSent", ColumnarTraceWriter::UINT64}});
+  traces->Append (utilSeries, 0.0, 0);
 
 
   /* In order to run simulations in NS-3, you need to set up your network all
@@ -295,37 +253,37 @@ main (int argc, char *argv[])
   PointToPointHelper host1Link;
   host1Link.SetDeviceAttribute ("DataRate", StringValue (bwHostStr));
   host1Link.SetChannelAttribute ("Delay", StringValue (delayStr));
-  host1Link.SetQueue ("ns3::DropTailQueue", "MaxSize", StringValue ("1p"));
+  host1Link.SetQueue ("ns3::RingQueue", "MaxSize", StringValue ("1p"));
 
   PointToPointHelper host2Link;
   host2Link.SetDeviceAttribute("DataRate", StringValue(bwHostStr));
   host2Link.SetChannelAttribute("Delay", StringValue(delayStr));
-  host2Link.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("1p"));
+  host2Link.SetQueue("ns3::RingQueue", "MaxSize", StringValue("1p"));
 
   PointToPointHelper host3Link;
   host2Link.SetDeviceAttribute("DataRate", StringValue(bwHostStr));
   host2Link.SetChannelAttribute("Delay", StringValue(delayStr));
-  host2Link.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("1p"));
+  host2Link.SetQueue("ns3::RingQueue", "MaxSize", StringValue("1p"));
 
   PointToPointHelper host4Link;
   host2Link.SetDeviceAttribute("DataRate", StringValue(bwHostStr));
   host2Link.SetChannelAttribute("Delay", StringValue(delayStr));
-  host2Link.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("1p"));
+  host2Link.SetQueue("ns3::RingQueue", "MaxSize", StringValue("1p"));
 
   PointToPointHelper host5Link;
   host2Link.SetDeviceAttribute("DataRate", StringValue(bwHostStr));
   host2Link.SetChannelAttribute("Delay", StringValue(delayStr));
-  host2Link.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("1p"));
+  host2Link.SetQueue("ns3::RingQueue", "MaxSize", StringValue("1p"));
 
   PointToPointHelper host6Link;
   host2Link.SetDeviceAttribute("DataRate", StringValue(bwHostStr));
   host2Link.SetChannelAttribute("Delay", StringValue(delayStr));
-  host2Link.SetQueue("ns3::DropTailQueue", "MaxSize", StringValue("1p"));
+  host2Link.SetQueue("ns3::RingQueue", "MaxSize", StringValue("1p"));
 
   PointToPointHelper bottleneckLink;
   bottleneckLink.SetDeviceAttribute ("DataRate", StringValue (bwNetStr));
   bottleneckLink.SetChannelAttribute ("Delay", StringValue (delayStr));
-  bottleneckLink.SetQueue ("ns3::DropTailQueue",
+  bottleneckLink.SetQueue ("ns3::RingQueue",
                            "MaxSize", StringValue ("1p"));
 
   /******** Create NetDevices ********/
@@ -403,10 +361,12 @@ main (int argc, char *argv[])
   // DONE: Read documentation for PfifoFastQueueDisc and use the correct
   //       attribute name to set the size of the bottleneck queue.
   TrafficControlHelper tchPfifo;
-  tchPfifo.SetRootQueueDisc ("ns3::VcpQueueDisc",
-                             "MaxSize", StringValue(maxQStr),
-                             "LinkBandwidth", StringValue(bwHostStr),
-                             "TimeInterval", TimeValue(MilliSeconds(estInterval)));
+  uint16_t handle = tchPfifo.SetRootQueueDisc ("ns3::VcpQueueDisc",
+                                               "MaxSize", StringValue(maxQStr),
+                                               "LinkBandwidth", StringValue(bwHostStr),
+                                               "TimeInterval", TimeValue(MilliSeconds(estInterval)));
+  /* Keep the packets of the queue disc in a circular array */
+  tchPfifo.AddInternalQueues (handle, 1, "ns3::RingQueue", "MaxSize", StringValue (maxQStr));
 
   tchPfifo.Install(h1s0_NetDevices);
   tchPfifo.Install(h2s0_NetDevices);
@@ -416,10 +376,12 @@ main (int argc, char *argv[])
   tchPfifo.Install(h6s0_NetDevices);
 
   TrafficControlHelper tchPfifo2;
-  tchPfifo2.SetRootQueueDisc ("ns3::VcpQueueDisc",
-                             "MaxSize", StringValue(maxQStr),
-                             "LinkBandwidth", StringValue(bwNetStr),
-                             "TimeInterval", TimeValue(MilliSeconds(estInterval)));
+  uint16_t handle2 = tchPfifo2.SetRootQueueDisc ("ns3::VcpQueueDisc",
+                                                "MaxSize", StringValue(maxQStr),
+                                                "LinkBandwidth", StringValue(bwNetStr),
+                                                "TimeInterval", TimeValue(MilliSeconds(estInterval)));
+  /* Keep the packets of the queue disc in a circular array */
+  tchPfifo2.AddInternalQueues (handle2, 1, "ns3::RingQueue", "MaxSize", StringValue (maxQStr));
 
   QueueDiscContainer s0h7_QueueDiscs = tchPfifo2.Install (s0h7_NetDevices);
   /* Trace Bottleneck Queue Occupancy */
@@ -498,14 +460,14 @@ main (int argc, char *argv[])
   FlowMonitorHelper flowHelper;
   flowMonitor = flowHelper.InstallAll();
 
-  Simulator::Schedule(MilliSeconds(UTIL_TRACE_INTERVAL_MS), &TraceUtil, utilStream, s0h7_QueueDiscs.Get(0)) ;
-  Simulator::Schedule(MilliSeconds(QUEUE_TRACE_INTERVAL_MS), &QueueOccupancyTracer, qStream, s0h7_QueueDiscs.Get(0)); 
-  Simulator::Schedule (Seconds (TRACE_START_TIME), &TraceThroughput1, flowMonitor, throughputStream);
-  Simulator::Schedule (Seconds (100), &TraceThroughput2, flowMonitor, throughputStream2);
-  Simulator::Schedule (Seconds (200), &TraceThroughput3, flowMonitor, throughputStream3);
-  Simulator::Schedule (Seconds (300), &TraceThroughput4, flowMonitor, throughputStream4);
-  Simulator::Schedule (Seconds (400), &TraceThroughput5, flowMonitor, throughputStream5);
-  Simulator::Schedule (Seconds (500), &TraceThroughput6, flowMonitor, throughputStream6);
+  Simulator::Schedule(MilliSeconds(UTIL_TRACE_INTERVAL_MS), &TraceUtil, traces, utilSeries, s0h7_QueueDiscs.Get(0)) ;
+  Simulator::Schedule(MilliSeconds(QUEUE_TRACE_INTERVAL_MS), &QueueOccupancyTracer, traces, qSeries, s0h7_QueueDiscs.Get(0)); 
+  Simulator::Schedule (Seconds (TRACE_START_TIME), &TraceThroughput, flowMonitor, traces, throughputSeries[0], 1);
+  Simulator::Schedule (Seconds (100), &TraceThroughput, flowMonitor, traces, throughputSeries[1], 3);
+  Simulator::Schedule (Seconds (200), &TraceThroughput, flowMonitor, traces, throughputSeries[2], 5);
+  Simulator::Schedule (Seconds (300), &TraceThroughput, flowMonitor, traces, throughputSeries[3], 7);
+  Simulator::Schedule (Seconds (400), &TraceThroughput, flowMonitor, traces, throughputSeries[4], 9);
+  Simulator::Schedule (Seconds (500), &TraceThroughput, flowMonitor, traces, throughputSeries[5], 11);
   
   /******** Run the Actual Simulation ********/
   NS_LOG_DEBUG("Running the Simulation...");
@@ -42,6 +42,7 @@
 #include "ns3/ipv4-global-routing-helper.h"
 #include "ns3/traffic-control-module.h"
 #include "ns3/flow-monitor-helper.h"
+#include "ns3/columnar-trace.h"
 
 using namespace ns3;
 
@@ -70,35 +71,133 @@ QueueOccupancyTracer (Ptr<OutputStreamWrapper> stream,
                         << newval << std::endl;
 } */
 
+/* The tracers below are templated on the bottleneck so that they work both
+ * for the packet-level VcpQueueDisc and for the VcpFluidModel (--fluid).
+ */
+template <class Q>
 static void
-QueueOccupancyTracer (Ptr<OutputStreamWrapper> stream,
-                      Ptr<QueueDisc> q)
+QueueOccupancyTracer (Ptr<ColumnarTraceWriter> traces, uint16_t series,
+                      Ptr<Q> q)
 {
- *stream->GetStream() << Simulator::Now().GetSeconds () << " "
-                      << (double) q->GetCurrentSize().GetValue () / q->GetMaxSize().GetValue() << std::endl;
+  traces->Append (series, Simulator::Now ().GetSeconds (),
+                  (double) q->GetCurrentSize().GetValue () / q->GetMaxSize().GetValue());
   Simulator::Schedule (MilliSeconds(QUEUE_TRACE_INTERVAL_MS), 
-                       &QueueOccupancyTracer,
-                       stream,
+                       &QueueOccupancyTracer<Q>,
+                       traces,
+                       series,
                        q);
 }
 
+template <class Q>
 static void
-BytesSentTracer (Ptr<OutputStreamWrapper> stream, Ptr<QueueDisc> q)
+BytesSentTracer (Ptr<ColumnarTraceWriter> traces, uint16_t series, Ptr<Q> q)
 {
-  QueueDisc::Stats stats = q->GetStats();
-  *stream->GetStream () << Simulator::Now ().GetSeconds () << " "
-                       << stats.nTotalSentBytes << std::endl;
+  typename Q::Stats stats = q->GetStats();
+  traces->Append (series, Simulator::Now ().GetSeconds (), stats.nTotalSentBytes);
 }
 
+template <class Q>
 static void
-PacketDropsTracer (Ptr<OutputStreamWrapper> stream, Ptr<QueueDisc> q)
+PacketDropsTracer (Ptr<ColumnarTraceWriter> traces, uint16_t series, Ptr<Q> q)
 {
-  QueueDisc::Stats stats = q->GetStats();
-  *stream->GetStream () << Simulator::Now ().GetSeconds () << " "
-                       << stats.nTotalDroppedPackets << " drops" << std::endl;
-  *stream->GetStream () << Simulator::Now ().GetSeconds () << " "
-                       << stats.nTotalDroppedPackets + stats.nTotalSentPackets
-                       << " total" << std::endl;
+  typename Q::Stats stats = q->GetStats();
+  traces->Append (series, Simulator::Now ().GetSeconds (), stats.nTotalDroppedPackets,
+                  (uint64_t) stats.nTotalDroppedPackets + stats.nTotalSentPackets);
+}
+
+/* Scheduler that forwards to a MapScheduler and records every operation
+ * in the "ops" series of a columnar file (--schedulerTrace), so that the
+ * event mix of this simulation can be replayed against the other
+ * schedulers by utils/bench-vcp-scheduler.cc.
+ */
+class RecordingScheduler : public Scheduler
+{
+public:
+  /// Recorded operations, as stored in the "op" column
+  enum Op
+  {
+    INSERT = 0,
+    REMOVE_NEXT = 1,
+    REMOVE = 2
+  };
+
+  static TypeId GetTypeId (void);
+
+  RecordingScheduler ()
+    : m_scheduler (CreateObject<MapScheduler> ())
+  {
+  }
+
+  virtual void
+  Insert (const Event &ev)
+  {
+    Record (INSERT, ev);
+    m_scheduler->Insert (ev);
+  }
+
+  virtual bool
+  IsEmpty (void) const
+  {
+    return m_scheduler->IsEmpty ();
+  }
+
+  virtual Event
+  PeekNext (void) const
+  {
+    return m_scheduler->PeekNext ();
+  }
+
+  virtual Event
+  RemoveNext (void)
+  {
+    Event ev = m_scheduler->RemoveNext ();
+    Record (REMOVE_NEXT, ev);
+    return ev;
+  }
+
+  virtual void
+  Remove (const Event &ev)
+  {
+    Record (REMOVE, ev);
+    m_scheduler->Remove (ev);
+  }
+
+private:
+  void
+  SetFilename (std::string filename)
+  {
+    m_trace = Create<ColumnarTraceWriter> (filename, "program=single-bottleneck-datapoint\n");
+    m_series = m_trace->AddSeries ("ops", {{"op", ColumnarTraceWriter::UINT32},
+                                           {"ts", ColumnarTraceWriter::UINT64},
+                                           {"uid", ColumnarTraceWriter::UINT32}});
+  }
+
+  void
+  Record (Op op, const Event &ev) const
+  {
+    if (m_trace)
+      {
+        m_trace->Append (m_series, op, ev.key.m_ts, ev.key.m_uid);
+      }
+  }
+
+  Ptr<Scheduler> m_scheduler;
+  Ptr<ColumnarTraceWriter> m_trace;
+  uint16_t m_series {0};
+};
+
+TypeId
+RecordingScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("RecordingScheduler")
+    .SetParent<Scheduler> ()
+    .AddConstructor<RecordingScheduler> ()
+    .AddAttribute ("Filename", "File to record the scheduler operations to",
+                   StringValue (""),
+                   MakeStringAccessor (&RecordingScheduler::SetFilename),
+                   MakeStringChecker ())
+    ;
+  return tid;
 }
 
 // bw in Kb/s
@@ -110,8 +209,6 @@ GetMaxQ(int delay, int bw, int numFlows) {
 int
 main (int argc, char *argv[])
 {
-  AsciiTraceHelper asciiTraceHelper;
-
   /* Start by setting default variables. Feel free to play with the input
    * arguments below to see what happens.
    */
@@ -129,6 +226,13 @@ main (int argc, char *argv[])
   double kappa = 0.5;
   std::string transport_prot = "Vcp";
   std::string dir = "outputs/single-bottle/";
+  bool fluid = false;
+  bool useEcn = false;
+  bool timeWeightedQueue = false;
+  bool batched = false;
+  std::string schedulerTrace = "";
+  uint32_t threads = 1;
+  bool metadata = true;
 
   CommandLine cmd (__FILE__);
   // varied in each of Figure 3, 4, 5:
@@ -152,8 +256,33 @@ main (int argc, char *argv[])
   cmd.AddValue ("dir", "The directory to write outputs to", dir);
   cmd.AddValue ("maxQCoeff", "", maxQCoeff);
   cmd.AddValue ("kappa", "", kappa);
+  cmd.AddValue ("fluid", "Use the fluid model instead of packet-level simulation", fluid);
+  cmd.AddValue ("useEcn", "Carry VCP load bits in the IP ECN field instead of a packet tag", useEcn);
+  cmd.AddValue ("timeWeightedQueue", "Use the exact time-weighted average queue size instead of periodic samples", timeWeightedQueue);
+  cmd.AddValue ("batched", "Update the VCP cwnd once per RTT instead of on every ACK", batched);
+  cmd.AddValue ("schedulerTrace", "Record the scheduler operations to this file (see utils/bench-vcp-scheduler.cc)", schedulerTrace);
+  cmd.AddValue ("threads", "Run the simulation on this many threads (needs --enable-mtp)", threads);
+  cmd.AddValue ("metadata", "Record packet metadata, to print and check packets", metadata);
   cmd.Parse (argc, argv);
 
+  if (threads > 1)
+    {
+      TypeId tid;
+      NS_ABORT_MSG_UNLESS (TypeId::LookupByNameFailSafe ("ns3::MultithreadedSimulatorImpl", &tid),
+                           "--threads needs ./waf configure --enable-mtp");
+      NS_ABORT_MSG_IF (schedulerTrace != "", "--schedulerTrace needs a single thread");
+      GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::MultithreadedSimulatorImpl"));
+      Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MaxThreads", UintegerValue (threads));
+    }
+
+  if (schedulerTrace != "")
+    {
+      ObjectFactory factory;
+      factory.SetTypeId (RecordingScheduler::GetTypeId ());
+      factory.Set ("Filename", StringValue (schedulerTrace));
+      Simulator::SetScheduler (factory);
+    }
+
   // calculate max queue size according to formula from paper: 
   int maxQ = GetMaxQ(delay, bwBottleneck, numFlows) * maxQCoeff; // packets
 
@@ -166,8 +295,11 @@ main (int argc, char *argv[])
   LogComponentEnable("SingleBottleneckDatapoint", LOG_LEVEL_DEBUG);
 
   // (VCP): lets packets be printed
-  Packet::EnablePrinting();
-  Packet::EnableChecking();
+  if (metadata)
+    {
+      Packet::EnablePrinting();
+      Packet::EnableChecking();
+    }
 
   std::string bwBottleneckStr = std::to_string(bwBottleneck) + "Kbps";
   std::string delayStr = std::to_string(delay) + "ns";
@@ -186,17 +318,19 @@ main (int argc, char *argv[])
   /* Traces will be written on these files for postprocessing. */
   //std::string dir = "outputs/single-bottle/"; //TODO what is the right name here
 
-  std::string qStreamName = dir + "q.tr";
-  Ptr<OutputStreamWrapper> qStream;
-  qStream = asciiTraceHelper.CreateFileStream (qStreamName);
-
-  std::string bytesSentStreamName = dir + "bytesSent.tr";
-  Ptr<OutputStreamWrapper> bytesSentStream;
-  bytesSentStream = asciiTraceHelper.CreateFileStream(bytesSentStreamName);
+  Ptr<ColumnarTraceWriter> traces = Create<ColumnarTraceWriter> (
+    dir + "traces.cols",
+    "program=single-bottleneck-datapoint\nbwBottleneck=" + std::to_string (bwBottleneck)
+    + "\ntime=" + std::to_string (time) + "\n");
 
-  std::string packetDropsStreamName = dir + "drops.tr";
-  Ptr<OutputStreamWrapper> packetDropsStream;
-  packetDropsStream = asciiTraceHelper.CreateFileStream(packetDropsStreamName);
+  /* Bottleneck occupancy as a fraction of its buffer */
+  uint16_t qSeries = traces->AddSeries ("queue", {{"time", ColumnarTraceWriter::DOUBLE},
+                                                  {"occupancy", ColumnarTraceWriter::DOUBLE}});
+  uint16_t bytesSentSeries = traces->AddSeries ("bytesSent", {{"time", ColumnarTraceWriter::DOUBLE},
+                                                              {"bytes", ColumnarTraceWriter::UINT64}});
+  uint16_t dropsSeries = traces->AddSeries ("drops", {{"time", ColumnarTraceWriter::DOUBLE},
+                                                      {"drops", ColumnarTraceWriter::UINT64},
+                                                      {"total", ColumnarTraceWriter::UINT64}});
 
   /* In order to run simulations in NS-3, you need to set up your network all
    * the way from the physical layer to the application layer. But don't worry!
@@ -231,7 +365,7 @@ main (int argc, char *argv[])
     PointToPointHelper hostLink;
     hostLink.SetDeviceAttribute ("DataRate", StringValue (bwNonBottleneckStr));
     hostLink.SetChannelAttribute ("Delay", StringValue (delayStr));
-    hostLink.SetQueue ("ns3::DropTailQueue", "MaxSize", StringValue ("1p"));
+    hostLink.SetQueue ("ns3::RingQueue", "MaxSize", StringValue ("1p"));
 
     if (i % 2 == 1) {
       NetDeviceContainer h1s0_NetDevices = hostLink.Install(h1, s0);
@@ -255,7 +389,7 @@ main (int argc, char *argv[])
   PointToPointHelper bottleneckLink;
   bottleneckLink.SetDeviceAttribute ("DataRate", StringValue (bwBottleneckStr));
   bottleneckLink.SetChannelAttribute ("Delay", StringValue (delayStr));
-  bottleneckLink.SetQueue ("ns3::DropTailQueue",
+  bottleneckLink.SetQueue ("ns3::RingQueue",
                            "MaxSize", StringValue ("1p"));
 
   /******** Create NetDevices ********/
@@ -311,6 +445,53 @@ main (int argc, char *argv[])
                       DoubleValue(maxCwndInc));
   Config::SetDefault ("ns3::Vcp::SegSize",
                       UintegerValue(tcpSegmentSize));
+  Config::SetDefault ("ns3::Vcp::Batched",
+                      BooleanValue(batched));
+
+  /******** Fluid model ********/
+  /* Steps the Vcp flows and the bottleneck once per sample interval instead of
+   * per packet, and writes the same trace files. Only the forward flows
+   * through the traced bottleneck queue (s0 -> s1) are modeled.
+   */
+  if (fluid)
+    {
+      NS_LOG_DEBUG("Running the Fluid Model...");
+
+      Ipv4Header ipv4h;
+      TcpHeader tcph;
+
+      Ptr<VcpFluidModel> model = CreateObject<VcpFluidModel> ();
+      model->SetAttribute ("MaxSize", StringValue (maxQStr));
+      model->SetAttribute ("LinkBandwidth", StringValue (bwBottleneckStr));
+      model->SetAttribute ("TimeInterval", TimeValue (MilliSeconds (estInterval)));
+      model->SetAttribute ("K_q", DoubleValue (kappa));
+      model->SetAttribute ("PacketSize",
+                           UintegerValue (tcpSegmentSize
+                                          + ipv4h.GetSerializedSize ()
+                                          + tcph.GetSerializedSize ()));
+
+      // Same start times as the forward BulkSend applications below;
+      // each path crosses three links in each direction
+      for (int i = 2; i < numFlows * 2 + 2; i += 2) {
+        model->AddFlow (Seconds ((double) (delay * 4 / 1000) * ((i - 2) / numFlows)),
+                        NanoSeconds ((int64_t) delay * 6));
+      }
+      model->Start ();
+
+      Simulator::Schedule (Seconds (time / 5), &BytesSentTracer<VcpFluidModel>, traces, bytesSentSeries, model);
+      Simulator::Schedule (Seconds (time), &BytesSentTracer<VcpFluidModel>, traces, bytesSentSeries, model);
+      Simulator::Schedule (Seconds (time), &PacketDropsTracer<VcpFluidModel>, traces, dropsSeries, model);
+      Simulator::Schedule (MilliSeconds(QUEUE_TRACE_INTERVAL_MS),
+                           &QueueOccupancyTracer<VcpFluidModel>,
+                           traces,
+                           qSeries,
+                           model);
+
+      Simulator::Stop (Seconds ((double)time));
+      Simulator::Run ();
+      Simulator::Destroy ();
+      return 0;
+    }
 
   /******** Install Internet Stack ********/
   NS_LOG_DEBUG("Installing Internet Stack...");
@@ -325,11 +506,15 @@ main (int argc, char *argv[])
     // DONE: Read documentation for PfifoFastQueueDisc and use the correct
     //       attribute name to set the size of the bottleneck queue.
     TrafficControlHelper tchPfifo;
-    tchPfifo.SetRootQueueDisc ("ns3::VcpQueueDisc",
-                               "MaxSize", StringValue(maxQStr),
-                               "LinkBandwidth", StringValue(bwNonBottleneckStr),
-                               "TimeInterval", TimeValue(MilliSeconds(estInterval)),
-                               "K_q", DoubleValue(kappa));
+    uint16_t handle = tchPfifo.SetRootQueueDisc ("ns3::VcpQueueDisc",
+                                                 "MaxSize", StringValue(maxQStr),
+                                                 "LinkBandwidth", StringValue(bwNonBottleneckStr),
+                                                 "TimeInterval", TimeValue(MilliSeconds(estInterval)),
+                                                 "K_q", DoubleValue(kappa),
+                                                 "UseEcn", BooleanValue(useEcn),
+                                                 "TimeWeightedQueue", BooleanValue(timeWeightedQueue));
+    /* Keep the packets of the queue disc in a circular array */
+    tchPfifo.AddInternalQueues (handle, 1, "ns3::RingQueue", "MaxSize", StringValue (maxQStr));
     tchPfifo.Install(netDevices[i]);
 
     Ipv4InterfaceContainer h1s0_interfaces = address.Assign (netDevices[i - 2]);
@@ -339,11 +524,15 @@ main (int argc, char *argv[])
 
 
   TrafficControlHelper tchPfifo2;
-  tchPfifo2.SetRootQueueDisc ("ns3::VcpQueueDisc",
-                             "MaxSize", StringValue(maxQStr),
-                             "LinkBandwidth", StringValue(bwBottleneckStr),
-                             "TimeInterval", TimeValue(MilliSeconds(estInterval)),
-                             "K_q", DoubleValue(kappa));
+  uint16_t handle2 = tchPfifo2.SetRootQueueDisc ("ns3::VcpQueueDisc",
+                                                "MaxSize", StringValue(maxQStr),
+                                                "LinkBandwidth", StringValue(bwBottleneckStr),
+                                                "TimeInterval", TimeValue(MilliSeconds(estInterval)),
+                                                "K_q", DoubleValue(kappa),
+                                                "UseEcn", BooleanValue(useEcn),
+                                                "TimeWeightedQueue", BooleanValue(timeWeightedQueue));
+  /* Keep the packets of the queue disc in a circular array */
+  tchPfifo2.AddInternalQueues (handle2, 1, "ns3::RingQueue", "MaxSize", StringValue (maxQStr));
 
   QueueDiscContainer s0h2_QueueDiscs = tchPfifo2.Install (s0h2_NetDevices);
   /* Trace Bottleneck Queue Occupancy */
@@ -418,12 +607,13 @@ main (int argc, char *argv[])
     sourceApp.Stop (Seconds ((double)time));
   } 
 
-  Simulator::Schedule (Seconds (time / 5), &BytesSentTracer, bytesSentStream, s0h2_QueueDiscs.Get(0));
-  Simulator::Schedule (Seconds (time), &BytesSentTracer, bytesSentStream, s0h2_QueueDiscs.Get(0));
-  Simulator::Schedule (Seconds (time), &PacketDropsTracer, packetDropsStream, s0h2_QueueDiscs.Get(0));
+  Simulator::Schedule (Seconds (time / 5), &BytesSentTracer<QueueDisc>, traces, bytesSentSeries, s0h2_QueueDiscs.Get(0));
+  Simulator::Schedule (Seconds (time), &BytesSentTracer<QueueDisc>, traces, bytesSentSeries, s0h2_QueueDiscs.Get(0));
+  Simulator::Schedule (Seconds (time), &PacketDropsTracer<QueueDisc>, traces, dropsSeries, s0h2_QueueDiscs.Get(0));
   Simulator::Schedule (MilliSeconds(QUEUE_TRACE_INTERVAL_MS), 
-                       &QueueOccupancyTracer,
-                       qStream,
+                       &QueueOccupancyTracer<QueueDisc>,
+                       traces,
+                       qSeries,
                        s0h2_QueueDiscs.Get(0));
 
 
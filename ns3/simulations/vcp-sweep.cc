@@ -0,0 +1,461 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Parameter sweep driver for the VCP simulations
+ *
+ * Runs single-bottleneck-datapoint, figure-1-1 or figure-9 over the
+ * cartesian product of the given parameter lists, every point in its own
+ * process with at most --jobs running at once, and appends one row of
+ * summary results per point to the "results" series of a columnar file
+ * (see ColumnarTraceWriter and plotting/columnar.py).
+ *
+ *  Usage (e.g.):
+ *    ./waf --run 'vcp-sweep --program=single-bottleneck-datapoint
+ *                 --bw=100,1000,10000 --seeds=1,2,3 --jobs=4
+ *                 --out=outputs/figure3.cols'
+ *
+ *  Grid units: bw in Kb/s, delay in ms. Parameters a program has no option
+ *  for can only be left unset; unset parameters use the program default and
+ *  are stored as NaN.
+ *
+ *  The points run with --metadata=0, without the packet metadata the
+ *  programs otherwise record for printing packets.
+ */
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ns3/core-module.h"
+#include "ns3/system-path.h"
+#include "ns3/columnar-trace.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("VcpSweep");
+
+/* Grid parameters, in the order of their result columns. */
+static const char *GRID_KEYS[] = { "bw", "delay", "numFlows", "xi", "beta", "kappa" };
+static const size_t N_GRID_KEYS = sizeof (GRID_KEYS) / sizeof (GRID_KEYS[0]);
+static_assert (N_GRID_KEYS == 6, "Update the result row in main () with the grid keys");
+
+/* One point of the grid; NaN means the program default. */
+struct SweepPoint
+{
+  uint32_t index;
+  uint32_t seed;
+  double params[N_GRID_KEYS];
+};
+
+/* Summary results of a finished point; NaN when not produced by the program. */
+struct SweepResult
+{
+  double util {std::numeric_limits<double>::quiet_NaN ()};
+  double avgQueue {std::numeric_limits<double>::quiet_NaN ()};
+  double dropRate {std::numeric_limits<double>::quiet_NaN ()};
+};
+
+struct RunningPoint
+{
+  SweepPoint point;
+  std::string dir;
+  std::chrono::steady_clock::time_point start;
+};
+
+static std::vector<double>
+ParseList (const std::string &key, const std::string &list)
+{
+  std::vector<double> values;
+  std::stringstream ss (list);
+  std::string item;
+  while (std::getline (ss, item, ','))
+    {
+      char *end;
+      double v = std::strtod (item.c_str (), &end);
+      NS_ABORT_MSG_IF (item.empty () || *end != '\0',
+                       "Bad value '" << item << "' for --" << key);
+      values.push_back (v);
+    }
+  return values;
+}
+
+static std::string
+FormatNumber (double v)
+{
+  if (v == std::floor (v) && std::fabs (v) < 1e15)
+    {
+      return std::to_string (static_cast<int64_t> (v));
+    }
+  std::ostringstream oss;
+  oss << std::setprecision (17) << v;
+  return oss.str ();
+}
+
+/* Command line option of the program for a grid parameter, empty if the
+ * program has none. */
+static std::string
+FormatArgument (const std::string &program, const std::string &key, double value)
+{
+  if (program == "single-bottleneck-datapoint")
+    {
+      if (key == "bw")
+        {
+          return "--bwBottleneck=" + FormatNumber (std::round (value));
+        }
+      if (key == "delay")
+        {
+          // delay is in nanoseconds there
+          return "--delay=" + FormatNumber (std::round (value * 1e6));
+        }
+      if (key == "numFlows" || key == "xi" || key == "beta" || key == "kappa")
+        {
+          return "--" + key + "=" + FormatNumber (value);
+        }
+      return "";
+    }
+
+  // figure-1-1 and figure-9
+  if (key == "bw")
+    {
+      NS_ABORT_MSG_IF (std::fmod (value, 1000) != 0,
+                       program << " only takes whole Mb/s bandwidths");
+      return "--bwNet=" + FormatNumber (value / 1000);
+    }
+  if (key == "delay")
+    {
+      return "--delay=" + FormatNumber (std::round (value));
+    }
+  if (key == "xi" || key == "beta")
+    {
+      return "--" + key + "=" + FormatNumber (value);
+    }
+  return "";
+}
+
+/* Fork and exec one point, with its output redirected to dir/log.txt. */
+static pid_t
+LaunchPoint (const std::string &binary, const std::string &program,
+             const SweepPoint &point, const std::string &dir,
+             const std::vector<std::string> &extraArgs)
+{
+  std::vector<std::string> args;
+  args.push_back (binary);
+  for (size_t k = 0; k < N_GRID_KEYS; k++)
+    {
+      if (!std::isnan (point.params[k]))
+        {
+          args.push_back (FormatArgument (program, GRID_KEYS[k], point.params[k]));
+        }
+    }
+  args.push_back ("--RngRun=" + std::to_string (point.seed));
+  args.push_back ("--dir=" + dir);
+  // Sweeps print no packets; --args=--metadata=1 records them again
+  args.push_back ("--metadata=0");
+  args.insert (args.end (), extraArgs.begin (), extraArgs.end ());
+
+  pid_t pid = fork ();
+  NS_ABORT_MSG_IF (pid < 0, "fork failed: " << std::strerror (errno));
+  if (pid == 0)
+    {
+      std::string log = dir + "log.txt";
+      int fd = open (log.c_str (), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+      if (fd >= 0)
+        {
+          dup2 (fd, STDOUT_FILENO);
+          dup2 (fd, STDERR_FILENO);
+          close (fd);
+        }
+      std::vector<char *> argv;
+      for (auto &arg : args)
+        {
+          argv.push_back (&arg[0]);
+        }
+      argv.push_back (nullptr);
+      execv (binary.c_str (), argv.data ());
+      std::perror ("execv");
+      _exit (127);
+    }
+  return pid;
+}
+
+static double
+MeanValue (const std::vector<double> &values)
+{
+  if (values.empty ())
+    {
+      return std::numeric_limits<double>::quiet_NaN ();
+    }
+  double sum = 0;
+  for (double v : values)
+    {
+      sum += v;
+    }
+  return sum / values.size ();
+}
+
+/* Same metrics as plotting/plot_fig3.py for single-bottleneck-datapoint,
+ * average queue and bottleneck utilization for the figure programs. */
+static SweepResult
+CollectResult (const std::string &program, const SweepPoint &point,
+               const std::string &dir)
+{
+  SweepResult result;
+  ColumnarTraceReader traces (dir + "traces.cols");
+
+  if (program == "single-bottleneck-datapoint")
+    {
+      result.avgQueue = MeanValue (traces.GetColumn ("queue", "occupancy"));
+      std::vector<double> time = traces.GetColumn ("bytesSent", "time");
+      std::vector<double> bytes = traces.GetColumn ("bytesSent", "bytes");
+      if (bytes.size () >= 2 && !std::isnan (point.params[0]))
+        {
+          double bits = (bytes[1] - bytes[0]) * 8;
+          result.util = bits / (time[1] - time[0]) / (point.params[0] * 1000);
+        }
+      std::vector<double> drops = traces.GetColumn ("drops", "drops");
+      std::vector<double> total = traces.GetColumn ("drops", "total");
+      if (!total.empty () && total[0] > 0)
+        {
+          result.dropRate = drops[0] / total[0];
+        }
+    }
+  else
+    {
+      result.avgQueue = MeanValue (traces.GetColumn ("queue", "packets"));
+    }
+
+  if (program == "figure-9")
+    {
+      std::vector<double> time = traces.GetColumn ("util", "time");
+      std::vector<double> bytes = traces.GetColumn ("util", "bytesSent");
+      if (bytes.size () >= 2 && !std::isnan (point.params[0]))
+        {
+          double bits = (bytes.back () - bytes.front ()) * 8;
+          result.util = bits / (time.back () - time.front ()) / (point.params[0] * 1000);
+        }
+    }
+  return result;
+}
+
+static void
+RemoveDirectory (const std::string &dir)
+{
+  static const char *FILES[] = { "traces.cols", "flow_stats.xml", "log.txt" };
+  for (const char *file : FILES)
+    {
+      std::remove ((dir + file).c_str ());
+    }
+  rmdir (dir.c_str ());
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string program = "single-bottleneck-datapoint";
+  std::string gridValues[N_GRID_KEYS];
+  std::string seeds = "1";
+  uint32_t jobs = 1;
+  std::string out = "outputs/sweep.cols";
+  std::string workDir = "outputs/sweep-work/";
+  std::string extra;
+  bool keepTraces = false;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("program", "Program to sweep: single-bottleneck-datapoint, "
+                "figure-1-1 or figure-9", program);
+  cmd.AddValue ("bw", "Comma separated bottleneck bandwidths (Kb/s)", gridValues[0]);
+  cmd.AddValue ("delay", "Comma separated link propagation delays (ms)", gridValues[1]);
+  cmd.AddValue ("numFlows", "Comma separated numbers of flows", gridValues[2]);
+  cmd.AddValue ("xi", "Comma separated MI factors", gridValues[3]);
+  cmd.AddValue ("beta", "Comma separated MD factors", gridValues[4]);
+  cmd.AddValue ("kappa", "Comma separated K_q factors", gridValues[5]);
+  cmd.AddValue ("seeds", "Comma separated RngRun values", seeds);
+  cmd.AddValue ("jobs", "Maximum number of points run at once", jobs);
+  cmd.AddValue ("out", "Columnar result file", out);
+  cmd.AddValue ("workDir", "Directory for the per-point outputs", workDir);
+  cmd.AddValue ("args", "Space separated extra arguments for every point", extra);
+  cmd.AddValue ("keepTraces", "Keep the per-point trace files", keepTraces);
+  cmd.Parse (argc, argv);
+
+  NS_ABORT_MSG_UNLESS (program == "single-bottleneck-datapoint"
+                       || program == "figure-1-1" || program == "figure-9",
+                       "Unknown program " << program);
+  NS_ABORT_MSG_IF (jobs == 0, "--jobs must be positive");
+  if (workDir.back () != '/')
+    {
+      workDir += '/';
+    }
+
+  // The programs are built next to this one, with the same prefix and suffix
+  std::string self = argv[0];
+  size_t pos = self.rfind ("vcp-sweep");
+  NS_ABORT_MSG_IF (pos == std::string::npos, "Cannot locate programs from " << self);
+  std::string binary = self.substr (0, pos) + program + self.substr (pos + std::strlen ("vcp-sweep"));
+  NS_ABORT_MSG_IF (access (binary.c_str (), X_OK) != 0, "Cannot execute " << binary);
+
+  std::vector<std::string> extraArgs;
+  std::istringstream es (extra);
+  std::string arg;
+  while (es >> arg)
+    {
+      extraArgs.push_back (arg);
+    }
+
+  // Expand the grid
+  std::vector<std::vector<double> > axes;
+  for (size_t k = 0; k < N_GRID_KEYS; k++)
+    {
+      if (gridValues[k].empty ())
+        {
+          axes.push_back ({ std::numeric_limits<double>::quiet_NaN () });
+          continue;
+        }
+      NS_ABORT_MSG_IF (FormatArgument (program, GRID_KEYS[k], 1000).empty (),
+                       program << " has no option for --" << GRID_KEYS[k]);
+      axes.push_back (ParseList (GRID_KEYS[k], gridValues[k]));
+    }
+  std::vector<double> seedValues = ParseList ("seeds", seeds);
+
+  std::vector<SweepPoint> points;
+  std::vector<size_t> counter (N_GRID_KEYS, 0);
+  bool done = false;
+  while (!done)
+    {
+      for (double seed : seedValues)
+        {
+          SweepPoint point;
+          point.index = points.size ();
+          point.seed = static_cast<uint32_t> (seed);
+          for (size_t k = 0; k < N_GRID_KEYS; k++)
+            {
+              point.params[k] = axes[k][counter[k]];
+            }
+          points.push_back (point);
+        }
+      // Odometer over the axes, last key fastest
+      done = true;
+      for (size_t k = N_GRID_KEYS; k-- > 0; )
+        {
+          if (++counter[k] < axes[k].size ())
+            {
+              done = false;
+              break;
+            }
+          counter[k] = 0;
+        }
+    }
+
+  ColumnarTraceWriter::Columns columns;
+  columns.emplace_back ("point", ColumnarTraceWriter::INT64);
+  columns.emplace_back ("seed", ColumnarTraceWriter::INT64);
+  for (size_t k = 0; k < N_GRID_KEYS; k++)
+    {
+      columns.emplace_back (GRID_KEYS[k], ColumnarTraceWriter::DOUBLE);
+    }
+  columns.emplace_back ("status", ColumnarTraceWriter::INT64);
+  columns.emplace_back ("wallTime", ColumnarTraceWriter::DOUBLE);
+  columns.emplace_back ("util", ColumnarTraceWriter::DOUBLE);
+  columns.emplace_back ("avgQueue", ColumnarTraceWriter::DOUBLE);
+  columns.emplace_back ("dropRate", ColumnarTraceWriter::DOUBLE);
+  ColumnarTraceWriter writer (out, "program=" + program + "\nargs=" + extra + "\n");
+  uint16_t results = writer.AddSeries ("results", columns);
+
+  SystemPath::MakeDirectories (workDir);
+  std::cout << "Running " << points.size () << " points of " << program
+            << " with " << jobs << " jobs" << std::endl;
+
+  std::map<pid_t, RunningPoint> running;
+  size_t next = 0;
+  uint32_t failed = 0;
+  while (next < points.size () || !running.empty ())
+    {
+      while (next < points.size () && running.size () < jobs)
+        {
+          RunningPoint rp;
+          rp.point = points[next++];
+          rp.dir = workDir + program + "-" + std::to_string (rp.point.index) + "/";
+          SystemPath::MakeDirectories (rp.dir);
+          rp.start = std::chrono::steady_clock::now ();
+          pid_t pid = LaunchPoint (binary, program, rp.point, rp.dir, extraArgs);
+          running[pid] = rp;
+        }
+
+      int wstatus;
+      pid_t pid = waitpid (-1, &wstatus, 0);
+      if (pid < 0)
+        {
+          NS_ABORT_MSG_IF (errno != EINTR, "waitpid failed: " << std::strerror (errno));
+          continue;
+        }
+      auto it = running.find (pid);
+      if (it == running.end ())
+        {
+          continue;
+        }
+      RunningPoint rp = it->second;
+      running.erase (it);
+
+      double wallTime = std::chrono::duration<double> (std::chrono::steady_clock::now () - rp.start).count ();
+      int status = WIFEXITED (wstatus) ? WEXITSTATUS (wstatus) : 128 + WTERMSIG (wstatus);
+      SweepResult result;
+      if (status == 0)
+        {
+          result = CollectResult (program, rp.point, rp.dir);
+        }
+      else
+        {
+          failed++;
+          std::cerr << "Point " << rp.point.index << " failed with status " << status
+                    << ", see " << rp.dir << "log.txt" << std::endl;
+        }
+
+      writer.Append (results, rp.point.index, rp.point.seed,
+                     rp.point.params[0], rp.point.params[1], rp.point.params[2],
+                     rp.point.params[3], rp.point.params[4], rp.point.params[5],
+                     status, wallTime, result.util, result.avgQueue, result.dropRate);
+      // Keep the rows of finished points if the sweep is interrupted
+      writer.Flush ();
+
+      if (status == 0 && !keepTraces)
+        {
+          RemoveDirectory (rp.dir);
+        }
+      std::cout << "Point " << rp.point.index << " done in " << wallTime << "s" << std::endl;
+    }
+
+  if (!keepTraces)
+    {
+      rmdir (workDir.c_str ());
+    }
+  std::cout << points.size () - failed << "/" << points.size ()
+            << " points written to " << out << std::endl;
+  return failed == 0 ? 0 : 1;
+}
@@ -29,6 +29,7 @@
 #include "log.h"
 
 #include <cmath>
+#include <thread>
 
 
 /**
@@ -58,6 +59,7 @@ DefaultSimulatorImpl::GetTypeId (void)
 }
 
 DefaultSimulatorImpl::DefaultSimulatorImpl ()
+  : m_eventsWithContextRing (EVENTS_WITH_CONTEXT_RING_SIZE)
 {
   NS_LOG_FUNCTION (this);
   m_stop = false;
@@ -72,6 +74,12 @@ DefaultSimulatorImpl::DefaultSimulatorImpl ()
   m_currentContext = Simulator::NO_CONTEXT;
   m_unscheduledEvents = 0;
   m_eventCount = 0;
+  for (uint32_t i = 0; i < EVENTS_WITH_CONTEXT_RING_SIZE; i++)
+    {
+      m_eventsWithContextRing[i].sequence = i;
+    }
+  m_eventsWithContextTail = 0;
+  m_eventsWithContextHead = 0;
   m_eventsWithContextEmpty = true;
   m_main = SystemThread::Self ();
 }
@@ -160,10 +168,48 @@ DefaultSimulatorImpl::IsFinished (void) const
   return m_events->IsEmpty () || m_stop;
 }
 
+void
+DefaultSimulatorImpl::InsertEventWithContext (const EventWithContext &event)
+{
+  Scheduler::Event ev;
+  ev.impl = event.event;
+  ev.key.m_ts = m_currentTs + event.timestamp;
+  ev.key.m_context = event.context;
+  ev.key.m_uid = m_uid;
+  m_uid++;
+  m_unscheduledEvents++;
+  m_events->Insert (ev);
+}
+
+void
+DefaultSimulatorImpl::DrainEventsWithContextRing (bool wait)
+{
+  uint64_t tail = wait ? m_eventsWithContextTail.load (std::memory_order_acquire) : 0;
+  while (true)
+    {
+      EventWithContextSlot &slot = m_eventsWithContextRing[m_eventsWithContextHead % EVENTS_WITH_CONTEXT_RING_SIZE];
+      if (slot.sequence.load (std::memory_order_acquire) != m_eventsWithContextHead + 1)
+        {
+          if (m_eventsWithContextHead >= tail)
+            {
+              break;
+            }
+          // a producer is filling in the slot
+          std::this_thread::yield ();
+          continue;
+        }
+      InsertEventWithContext (slot.event);
+      slot.sequence.store (m_eventsWithContextHead + EVENTS_WITH_CONTEXT_RING_SIZE, std::memory_order_release);
+      m_eventsWithContextHead++;
+    }
+}
+
 void
 DefaultSimulatorImpl::ProcessEventsWithContext (void)
 {
-  if (m_eventsWithContextEmpty)
+  DrainEventsWithContextRing (false);
+
+  if (m_eventsWithContextEmpty.load (std::memory_order_acquire))
     {
       return;
     }
@@ -172,21 +218,17 @@ DefaultSimulatorImpl::ProcessEventsWithContext (void)
   EventsWithContext eventsWithContext;
   {
     CriticalSection cs (m_eventsWithContextMutex);
+    // The events a producer put in the ring before switching to the list
+    // may have been filled in after the ring was drained above, or be
+    // stuck behind a slot another producer is filling in
+    DrainEventsWithContextRing (true);
     m_eventsWithContext.swap (eventsWithContext);
     m_eventsWithContextEmpty = true;
   }
   while (!eventsWithContext.empty ())
     {
-      EventWithContext event = eventsWithContext.front ();
+      InsertEventWithContext (eventsWithContext.front ());
       eventsWithContext.pop_front ();
-      Scheduler::Event ev;
-      ev.impl = event.event;
-      ev.key.m_ts = m_currentTs + event.timestamp;
-      ev.key.m_context = event.context;
-      ev.key.m_uid = m_uid;
-      m_uid++;
-      m_unscheduledEvents++;
-      m_events->Insert (ev);
     }
 }
 
@@ -270,6 +312,36 @@ DefaultSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &delay,
       // Current time added in ProcessEventsWithContext()
       ev.timestamp = delay.GetTimeStep ();
       ev.event = event;
+
+      // Once an event went to the list, the next ones follow it there
+      // until the list is drained, to keep them in order
+      if (m_eventsWithContextEmpty.load (std::memory_order_acquire))
+        {
+          uint64_t pos = m_eventsWithContextTail.load (std::memory_order_relaxed);
+          while (true)
+            {
+              EventWithContextSlot &slot = m_eventsWithContextRing[pos % EVENTS_WITH_CONTEXT_RING_SIZE];
+              uint64_t sequence = slot.sequence.load (std::memory_order_acquire);
+              if (sequence == pos)
+                {
+                  if (m_eventsWithContextTail.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+                    {
+                      slot.event = ev;
+                      slot.sequence.store (pos + 1, std::memory_order_release);
+                      return;
+                    }
+                }
+              else if (sequence < pos)
+                {
+                  // the ring is full
+                  break;
+                }
+              else
+                {
+                  pos = m_eventsWithContextTail.load (std::memory_order_relaxed);
+                }
+            }
+        }
       {
         CriticalSection cs (m_eventsWithContextMutex);
         m_eventsWithContext.push_back (ev);
@@ -29,7 +29,9 @@
 
 #include "ptr.h"
 
+#include <atomic>
 #include <list>
+#include <vector>
 
 /**
  * \file
@@ -43,6 +45,14 @@ namespace ns3 {
  * \ingroup simulator
  *
  * The default single process simulator implementation.
+ *
+ * Events scheduled with Simulator::ScheduleWithContext from another
+ * thread than the main one (by fd-net-device, tap-bridge or any other
+ * producer thread) go through a bounded lock-free ring, drained in a
+ * batch by the main thread after each event. A producer finding the ring
+ * full falls back to a list guarded by a mutex, and keeps using it until
+ * the main thread has drained the list, so the events of each producer
+ * are inserted in the order they were scheduled.
  */
 class DefaultSimulatorImpl : public SimulatorImpl
 {
@@ -97,15 +107,49 @@ private:
     /** The event implementation. */
     EventImpl *event;
   };
+  /**
+   * Insert an event from a different context in the main event queue.
+   *
+   * \param [in] event The event, its timestamp relative to the current time.
+   */
+  void InsertEventWithContext (const EventWithContext &event);
+  /**
+   * Move the events of the ring to the main event queue.
+   *
+   * \param [in] wait Whether to wait for the slots claimed by the
+   *             producers to be filled in, rather than stop at the first one.
+   */
+  void DrainEventsWithContextRing (bool wait);
+
+  /** Number of slots of the ring of events from a different context. */
+  static const uint32_t EVENTS_WITH_CONTEXT_RING_SIZE = 1024;
+  /** A slot of the ring of events from a different context. */
+  struct EventWithContextSlot
+  {
+    /**
+     * Sequence number of the slot: equal to the producer position when
+     * the slot is free, to that position plus one when the event is ready.
+     */
+    std::atomic<uint64_t> sequence;
+    /** The event. */
+    EventWithContext event;
+  };
+  /** The ring of events from a different context. */
+  std::vector<EventWithContextSlot> m_eventsWithContextRing;
+  /** Next position to fill, shared by the producer threads. */
+  std::atomic<uint64_t> m_eventsWithContextTail;
+  /** Next position to drain, only used by the main thread. */
+  uint64_t m_eventsWithContextHead;
+
   /** Container type for the events from a different context. */
   typedef std::list<struct EventWithContext> EventsWithContext;
-  /** The container of events from a different context. */
+  /** The events from a different context which did not fit in the ring. */
   EventsWithContext m_eventsWithContext;
   /**
-   * Flag \c true if all events with context have been moved to the
-   * primary event queue.
+   * Flag \c true if all the events of m_eventsWithContext have been
+   * moved to the primary event queue.
    */
-  bool m_eventsWithContextEmpty;
+  std::atomic<bool> m_eventsWithContextEmpty;
   /** Mutex to control access to the list of events with context. */
   SystemMutex m_eventsWithContextMutex;
 
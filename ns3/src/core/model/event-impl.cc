@@ -20,6 +20,7 @@
 
 #include "event-impl.h"
 #include "log.h"
+#include <new>
 
 /**
  * \file
@@ -31,6 +32,118 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("EventImpl");
 
+namespace {
+
+/** Size class granularity of the event pool, in bytes. */
+const std::size_t EVENT_POOL_GRANULARITY = 16;
+/** Number of size classes of the event pool; larger events are not pooled. */
+const std::size_t EVENT_POOL_CLASSES = 8;
+/**
+ * Maximum number of free blocks kept per size class, so that a thread
+ * freeing the events allocated by another one does not hoard them.
+ */
+const uint32_t EVENT_POOL_MAX_FREE = 4096;
+
+/** A free block of the event pool. */
+struct EventPoolBlock
+{
+  EventPoolBlock *next; //!< Next free block of the same size class
+};
+
+/**
+ * Free lists of a thread.
+ *
+ * Trivially destructible, so that it stays usable while the thread (or
+ * the program) exits and events are released by other destructors.
+ */
+struct EventPool
+{
+  EventPoolBlock *free[EVENT_POOL_CLASSES]; //!< Free blocks, by size class
+  uint32_t length[EVENT_POOL_CLASSES];      //!< Number of free blocks, by size class
+  bool registered;                          //!< Whether the closer is set up
+  bool closed;                              //!< Whether the thread is exiting
+};
+
+/** Event pool of the current thread. */
+thread_local EventPool g_eventPool;
+
+/** Whether freed events are kept for reuse. */
+bool g_eventPooling = true;
+
+/** Releases the free blocks of a thread when it exits. */
+struct EventPoolCloser
+{
+  /** Does nothing: calling it odr-uses the thread_local closer, so that its destructor runs at thread exit. */
+  void Register (void)
+  {
+  }
+  ~EventPoolCloser ()
+  {
+    for (std::size_t c = 0; c < EVENT_POOL_CLASSES; c++)
+      {
+        while (g_eventPool.free[c] != 0)
+          {
+            EventPoolBlock *block = g_eventPool.free[c];
+            g_eventPool.free[c] = block->next;
+            ::operator delete (block);
+          }
+      }
+    g_eventPool.closed = true;
+  }
+};
+
+/** Closer of the event pool of the current thread. */
+thread_local EventPoolCloser g_eventPoolCloser;
+
+} // unnamed namespace
+
+void *
+EventImpl::operator new (std::size_t size)
+{
+  std::size_t c = (size - 1) / EVENT_POOL_GRANULARITY;
+  if (c >= EVENT_POOL_CLASSES)
+    {
+      return ::operator new (size);
+    }
+  EventPoolBlock *block = g_eventPool.free[c];
+  if (block != 0)
+    {
+      g_eventPool.free[c] = block->next;
+      g_eventPool.length[c]--;
+      return block;
+    }
+  // Allocate the whole class so that the block can serve any event of it
+  return ::operator new ((c + 1) * EVENT_POOL_GRANULARITY);
+}
+
+void
+EventImpl::operator delete (void *p, std::size_t size)
+{
+  std::size_t c = (size - 1) / EVENT_POOL_GRANULARITY;
+  if (c >= EVENT_POOL_CLASSES || !g_eventPooling || g_eventPool.closed
+      || g_eventPool.length[c] == EVENT_POOL_MAX_FREE)
+    {
+      ::operator delete (p);
+      return;
+    }
+  if (!g_eventPool.registered)
+    {
+      g_eventPool.registered = true;
+      g_eventPoolCloser.Register ();
+    }
+  EventPoolBlock *block = static_cast<EventPoolBlock *> (p);
+  block->next = g_eventPool.free[c];
+  g_eventPool.free[c] = block;
+  g_eventPool.length[c]++;
+}
+
+void
+EventImpl::SetPooling (bool pooling)
+{
+  NS_LOG_FUNCTION (pooling);
+  g_eventPooling = pooling;
+}
+
 EventImpl::~EventImpl ()
 {
   NS_LOG_FUNCTION (this);
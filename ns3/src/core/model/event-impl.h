@@ -21,6 +21,7 @@
 #define EVENT_IMPL_H
 
 #include <stdint.h>
+#include <cstddef>
 #include "simple-ref-count.h"
 
 /**
@@ -40,6 +41,13 @@ namespace ns3 {
  * when it reaches the time associated to this event. Most subclasses
  * are usually created by one of the many Simulator::Schedule
  * methods.
+ *
+ * Events are allocated and freed at a very high rate, so the memory of
+ * every subclass comes from per-thread free lists, one per 16 byte size
+ * class up to 128 bytes: the memory of a freed event (once its last
+ * reference is gone) is kept for the next event of the same class
+ * allocated by that thread, and malloc is only called when a free list
+ * is empty.
  */
 class EventImpl : public SimpleRefCount<EventImpl>
 {
@@ -66,6 +74,32 @@ public:
    */
   bool IsCancelled (void);
 
+  /**
+   * Allocate memory for an event, from the free list of its size class
+   * if possible.
+   *
+   * \param [in] size The size of the event.
+   * \returns The memory for the event.
+   */
+  static void *operator new (std::size_t size);
+  /**
+   * Release the memory of an event to the free list of its size class.
+   *
+   * \param [in] p The memory of the event.
+   * \param [in] size The size of the event.
+   */
+  static void operator delete (void *p, std::size_t size);
+  /**
+   * Enable or disable the reuse of the memory of freed events.
+   *
+   * Pooling is enabled by default; disabling it makes every event
+   * allocation go to the global operator new, e.g. for comparison
+   * (bench-simulator --nopool) or for memory checkers.
+   *
+   * \param [in] pooling Whether to reuse the memory of freed events.
+   */
+  static void SetPooling (bool pooling);
+
 protected:
   /**
    * Implementation for Invoke().
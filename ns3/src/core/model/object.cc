@@ -169,10 +169,14 @@ Object::DoGetObject (TypeId tid) const
           // that the aggregate array is sorted by the number of accesses
           // to each object.
 
+#ifndef NS3_MTP
+          // (Skipped in a multithreaded simulation, where another thread
+          // may be looking up an aggregate of the same node.)
           // first, increment the access count
           current->m_getObjectCount++;
           // then, update the sort
           UpdateSortedArray (m_aggregates, i);
+#endif
           // finally, return the match
           return const_cast<Object *> (current);
         }
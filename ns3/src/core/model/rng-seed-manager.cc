@@ -23,6 +23,9 @@
 #include "uinteger.h"
 #include "config.h"
 #include "log.h"
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 
 /**
  * \file
@@ -39,7 +42,11 @@ NS_LOG_COMPONENT_DEFINE ("RngSeedManager");
  * The next random number generator stream number to use
  * for automatic assignment.
  */
+#ifdef NS3_MTP
+static std::atomic<uint64_t> g_nextStreamIndex (0);
+#else
 static uint64_t g_nextStreamIndex = 0;
+#endif
 /**
  * \relates RngSeedManager
  * \anchor GlobalValueRngSeed
@@ -102,9 +109,7 @@ uint64_t RngSeedManager::GetRun ()
 uint64_t RngSeedManager::GetNextStreamIndex (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
-  uint64_t next = g_nextStreamIndex;
-  g_nextStreamIndex++;
-  return next;
+  return g_nextStreamIndex++;
 }
 
 } // namespace ns3
@@ -0,0 +1,287 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "timing-wheel-scheduler.h"
+#include "event-impl.h"
+#include "type-id.h"
+#include "assert.h"
+#include "log.h"
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * ns3::TimingWheelScheduler implementation.
+ */
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("TimingWheelScheduler");
+
+NS_OBJECT_ENSURE_REGISTERED (TimingWheelScheduler);
+
+TypeId
+TimingWheelScheduler::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TimingWheelScheduler")
+    .SetParent<Scheduler> ()
+    .SetGroupName ("Core")
+    .AddConstructor<TimingWheelScheduler> ()
+    .AddAttribute ("SlotWidth",
+                   "Time span of the finest wheel slots, rounded down "
+                   "to a power of two time steps",
+                   TypeId::ATTR_CONSTRUCT,
+                   TimeValue (NanoSeconds (1024)),
+                   MakeTimeAccessor (&TimingWheelScheduler::SetSlotWidth),
+                   MakeTimeChecker ())
+  ;
+  return tid;
+}
+
+TimingWheelScheduler::TimingWheelScheduler ()
+  : m_shift (0),
+    m_current (0),
+    m_count (0)
+{
+  NS_LOG_FUNCTION (this);
+  std::memset (m_occupied, 0, sizeof (m_occupied));
+}
+
+TimingWheelScheduler::~TimingWheelScheduler ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+TimingWheelScheduler::SetSlotWidth (Time width)
+{
+  NS_LOG_FUNCTION (this << width);
+  NS_ASSERT_MSG (m_count == 0, "The slot width cannot change once events are scheduled");
+  int64_t steps = width.GetTimeStep ();
+  m_shift = 0;
+  while (steps > 1)
+    {
+      steps >>= 1;
+      m_shift++;
+    }
+}
+
+void
+TimingWheelScheduler::SetOccupied (uint32_t level, uint32_t index, bool occupied)
+{
+  uint64_t bit = (uint64_t) 1 << (index % 64);
+  if (occupied)
+    {
+      m_occupied[level][index / 64] |= bit;
+    }
+  else
+    {
+      m_occupied[level][index / 64] &= ~bit;
+    }
+}
+
+uint32_t
+TimingWheelScheduler::NextBucket (uint32_t level, uint32_t index) const
+{
+  uint32_t start = index + 1;
+  if (start >= BUCKETS)
+    {
+      return BUCKETS;
+    }
+  uint64_t word = m_occupied[level][start / 64] & (~(uint64_t) 0 << (start % 64));
+  for (uint32_t w = start / 64; ; )
+    {
+      if (word != 0)
+        {
+          return w * 64 + __builtin_ctzll (word);
+        }
+      if (++w == BUCKETS / 64)
+        {
+          return BUCKETS;
+        }
+      word = m_occupied[level][w];
+    }
+}
+
+void
+TimingWheelScheduler::Place (const Scheduler::Event &ev)
+{
+  uint64_t slot = ev.key.m_ts >> m_shift;
+  if (slot <= m_current)
+    {
+      m_heap.push_back (ev);
+      std::push_heap (m_heap.begin (), m_heap.end (), std::greater<Scheduler::Event> ());
+      return;
+    }
+  // The level is given by the highest digit that differs from the current slot
+  uint32_t level = (63 - __builtin_clzll (slot ^ m_current)) / LEVEL_BITS;
+  if (level >= LEVELS)
+    {
+      m_overflow.insert (std::make_pair (ev.key, ev.impl));
+      return;
+    }
+  uint32_t index = (slot >> (level * LEVEL_BITS)) & (BUCKETS - 1);
+  m_wheel[level][index].push_back (ev);
+  SetOccupied (level, index, true);
+}
+
+void
+TimingWheelScheduler::Advance (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_heap.empty ());
+
+  while (m_heap.empty ())
+    {
+      uint32_t level;
+      uint32_t index = BUCKETS;
+      for (level = 0; level < LEVELS; level++)
+        {
+          index = NextBucket (level, (m_current >> (level * LEVEL_BITS)) & (BUCKETS - 1));
+          if (index < BUCKETS)
+            {
+              break;
+            }
+        }
+
+      if (level == LEVELS)
+        {
+          // The wheel is empty: move to the earliest overflow event and
+          // bring in all those now within the range of the wheel.
+          NS_ASSERT (!m_overflow.empty ());
+          m_current = m_overflow.begin ()->first.m_ts >> m_shift;
+          uint64_t top = m_current >> (LEVELS * LEVEL_BITS);
+          auto it = m_overflow.begin ();
+          while (it != m_overflow.end () && (it->first.m_ts >> m_shift >> (LEVELS * LEVEL_BITS)) == top)
+            {
+              Scheduler::Event ev;
+              ev.key = it->first;
+              ev.impl = it->second;
+              Place (ev);
+              it = m_overflow.erase (it);
+            }
+          continue;
+        }
+
+      // Keep the digits above the level, set the level digit to the
+      // bucket index and clear the digits below.
+      uint32_t shift = level * LEVEL_BITS;
+      m_current = ((m_current >> shift >> LEVEL_BITS) << LEVEL_BITS | index) << shift;
+      Bucket bucket;
+      bucket.swap (m_wheel[level][index]);
+      SetOccupied (level, index, false);
+      if (level == 0)
+        {
+          m_heap.swap (bucket);
+          std::make_heap (m_heap.begin (), m_heap.end (), std::greater<Scheduler::Event> ());
+        }
+      else
+        {
+          for (const Scheduler::Event &ev : bucket)
+            {
+              Place (ev);
+            }
+        }
+    }
+}
+
+void
+TimingWheelScheduler::Insert (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  Place (ev);
+  m_count++;
+}
+
+bool
+TimingWheelScheduler::IsEmpty (void) const
+{
+  NS_LOG_FUNCTION (this);
+  return m_count == 0;
+}
+
+Scheduler::Event
+TimingWheelScheduler::PeekNext (void) const
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_count > 0);
+  if (m_heap.empty ())
+    {
+      // Advancing does not change the set of events, only where they are kept
+      const_cast<TimingWheelScheduler *> (this)->Advance ();
+    }
+  return m_heap.front ();
+}
+
+Scheduler::Event
+TimingWheelScheduler::RemoveNext (void)
+{
+  NS_LOG_FUNCTION (this);
+  NS_ASSERT (m_count > 0);
+  if (m_heap.empty ())
+    {
+      Advance ();
+    }
+  std::pop_heap (m_heap.begin (), m_heap.end (), std::greater<Scheduler::Event> ());
+  Scheduler::Event ev = m_heap.back ();
+  m_heap.pop_back ();
+  m_count--;
+  NS_LOG_DEBUG (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  return ev;
+}
+
+void
+TimingWheelScheduler::Remove (const Event &ev)
+{
+  NS_LOG_FUNCTION (this << ev.impl << ev.key.m_ts << ev.key.m_uid);
+  NS_ASSERT (m_count > 0);
+  m_count--;
+
+  // Every event is kept where Place would put it given the current slot
+  uint64_t slot = ev.key.m_ts >> m_shift;
+  if (slot <= m_current)
+    {
+      auto it = std::find (m_heap.begin (), m_heap.end (), ev);
+      NS_ASSERT (it != m_heap.end () && it->impl == ev.impl);
+      m_heap.erase (it);
+      std::make_heap (m_heap.begin (), m_heap.end (), std::greater<Scheduler::Event> ());
+      return;
+    }
+  uint32_t level = (63 - __builtin_clzll (slot ^ m_current)) / LEVEL_BITS;
+  if (level >= LEVELS)
+    {
+      auto it = m_overflow.find (ev.key);
+      NS_ASSERT (it != m_overflow.end () && it->second == ev.impl);
+      m_overflow.erase (it);
+      return;
+    }
+  uint32_t index = (slot >> (level * LEVEL_BITS)) & (BUCKETS - 1);
+  Bucket &bucket = m_wheel[level][index];
+  auto it = std::find (bucket.begin (), bucket.end (), ev);
+  NS_ASSERT (it != bucket.end () && it->impl == ev.impl);
+  *it = bucket.back ();
+  bucket.pop_back ();
+  if (bucket.empty ())
+    {
+      SetOccupied (level, index, false);
+    }
+}
+
+} // namespace ns3
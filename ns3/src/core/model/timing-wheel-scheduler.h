@@ -0,0 +1,165 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef TIMING_WHEEL_SCHEDULER_H
+#define TIMING_WHEEL_SCHEDULER_H
+
+#include "scheduler.h"
+#include "nstime.h"
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup scheduler
+ * ns3::TimingWheelScheduler declaration.
+ */
+
+namespace ns3 {
+
+class EventImpl;
+
+/**
+ * \ingroup scheduler
+ * \brief a hierarchical timing wheel event scheduler
+ *
+ * Time is divided in slots of SlotWidth (rounded down to a power of two
+ * time steps), and slot numbers are split in 8-bit digits. Wheel level
+ * \c l has 256 buckets, indexed by digit \c l, and holds the events whose
+ * slot shares all digits above \c l with the current slot but differs at
+ * digit \c l. Events scheduled past the range of the four levels (2^32
+ * slots) are kept in a \c std::map.
+ *
+ * The events of the current slot are kept in a binary heap, so events
+ * are run in exactly the same (timestamp, uid) order as with the other
+ * schedulers. Once the heap is empty, the next non empty bucket is found
+ * with a per level occupancy bitmap: a level 0 bucket simply becomes the
+ * new heap, a bucket of a higher level is first redistributed to the
+ * lower levels.
+ *
+ * Every event is thus moved at most once per level, whatever its delay,
+ * which suits the periodic timers, transmit completions and protocol
+ * timers that dominate network simulations: they are scheduled a short,
+ * bounded time ahead and land in level 0 or 1.
+ *
+ * \par Time Complexity
+ *
+ * Operation    | Amortized %Time | Reason
+ * :----------- | :-------------- | :-----
+ * Insert()     | ~Constant       | Append to a bucket, or push on the (small) current heap
+ * IsEmpty()    | Constant        | Explicit event count
+ * PeekNext()   | ~Constant       | Top of the current heap, refilled if empty
+ * Remove()     | Linear in bucket| Search within the bucket or heap
+ * RemoveNext() | ~Constant       | Pop from the heap, at most one cascade per level
+ *
+ * \par Memory Complexity
+ *
+ * Category  | Memory                           | Reason
+ * :-------- | :------------------------------- | :-----
+ * Overhead  | 4 x 256 x `std::vector`<br/>(~24 kB) | Wheel buckets
+ * Per Event | 0                                | Events are stored by value
+ */
+class TimingWheelScheduler : public Scheduler
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /** Constructor. */
+  TimingWheelScheduler ();
+  /** Destructor. */
+  virtual ~TimingWheelScheduler ();
+
+  // Inherited
+  virtual void Insert (const Scheduler::Event &ev);
+  virtual bool IsEmpty (void) const;
+  virtual Scheduler::Event PeekNext (void) const;
+  virtual Scheduler::Event RemoveNext (void);
+  virtual void Remove (const Scheduler::Event &ev);
+
+private:
+  /** Number of wheel levels. */
+  static const uint32_t LEVELS = 4;
+  /** Number of bits of a slot number per level. */
+  static const uint32_t LEVEL_BITS = 8;
+  /** Number of buckets per level. */
+  static const uint32_t BUCKETS = 1 << LEVEL_BITS;
+
+  /** Wheel bucket type: unordered events. */
+  typedef std::vector<Scheduler::Event> Bucket;
+
+  /**
+   * Set the slot width.
+   *
+   * This can only be used at construction, as invoked by the
+   * Attribute SlotWidth.
+   *
+   * \param [in] width The slot width, rounded down to a power of two time steps.
+   */
+  void SetSlotWidth (Time width);
+  /**
+   * Store an event in the current heap, a wheel bucket or the overflow
+   * map, according to its slot.
+   *
+   * \param [in] ev The event.
+   */
+  void Place (const Scheduler::Event &ev);
+  /**
+   * Refill the empty current heap from the next non empty bucket, if any.
+   */
+  void Advance (void);
+  /**
+   * Find the first non empty bucket of a level after a given index.
+   *
+   * \param [in] level The wheel level.
+   * \param [in] index The index to start after.
+   * \returns The bucket index, or BUCKETS if there is none.
+   */
+  uint32_t NextBucket (uint32_t level, uint32_t index) const;
+  /**
+   * Mark a bucket as empty or not.
+   *
+   * \param [in] level The wheel level.
+   * \param [in] index The bucket index.
+   * \param [in] occupied Whether the bucket holds events.
+   */
+  void SetOccupied (uint32_t level, uint32_t index, bool occupied);
+
+  /** log2 of the slot width, in time steps. */
+  uint32_t m_shift;
+  /** Slot of the events in the current heap. */
+  uint64_t m_current;
+  /** Events of the current slot (and earlier), as a min-heap; refilled lazily. */
+  std::vector<Scheduler::Event> m_heap;
+  /** The wheel buckets, by level. */
+  Bucket m_wheel[LEVELS][BUCKETS];
+  /** Bitmap of the non empty buckets, by level. */
+  uint64_t m_occupied[LEVELS][BUCKETS / 64];
+  /** Events beyond the range of the wheel. */
+  std::map<Scheduler::EventKey, EventImpl *> m_overflow;
+  /** Number of events in the scheduler. */
+  uint32_t m_count;
+};
+
+} // namespace ns3
+
+#endif /* TIMING_WHEEL_SCHEDULER_H */
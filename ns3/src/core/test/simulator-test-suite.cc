@@ -24,6 +24,7 @@
 #include "ns3/map-scheduler.h"
 #include "ns3/calendar-scheduler.h"
 #include "ns3/priority-queue-scheduler.h"
+#include "ns3/timing-wheel-scheduler.h"
 
 using namespace ns3;
 
@@ -483,5 +484,7 @@ public:
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
     factory.SetTypeId (PriorityQueueScheduler::GetTypeId ());
     AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
+    factory.SetTypeId (TimingWheelScheduler::GetTypeId ());
+    AddTestCase (new SimulatorEventsTestCase (factory), TestCase::QUICK);
   }
 } g_simulatorTestSuite;
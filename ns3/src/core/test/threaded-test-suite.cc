@@ -32,6 +32,7 @@
 #include <list>
 #include <thread>  // sleep_for
 #include <utility>
+#include <vector>
 
 using namespace ns3;
 
@@ -225,6 +226,101 @@ ThreadedSimulatorEventsTestCase::DoRun (void)
   NS_TEST_EXPECT_MSG_EQ (m_a, m_d, "Bad scheduling");
 }
 
+class ThreadedInjectionStressTestCase : public TestCase
+{
+public:
+  ThreadedInjectionStressTestCase (unsigned int threads, uint32_t events);
+  void Receive (unsigned int threadno, uint32_t seq);
+  void KeepAlive (void);
+  static void InjectingThread (std::pair<ThreadedInjectionStressTestCase *, unsigned int> context);
+  unsigned int m_threads;
+  uint32_t m_events;
+  std::vector<uint32_t> m_next;
+  uint64_t m_received;
+  std::string m_error;
+
+private:
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+};
+
+ThreadedInjectionStressTestCase::ThreadedInjectionStressTestCase (unsigned int threads, uint32_t events)
+  : TestCase ("Check the order and delivery of " + std::to_string (events) +
+              " events injected by each of " + std::to_string (threads) + " threads"),
+    m_threads (threads),
+    m_events (events),
+    m_received (0)
+{}
+
+void
+ThreadedInjectionStressTestCase::InjectingThread (std::pair<ThreadedInjectionStressTestCase *, unsigned int> context)
+{
+  ThreadedInjectionStressTestCase *me = context.first;
+  unsigned int threadno = context.second;
+
+  for (uint32_t seq = 0; seq < me->m_events; seq++)
+    {
+      Simulator::ScheduleWithContext (threadno, Seconds (0),
+                                      &ThreadedInjectionStressTestCase::Receive, me, threadno, seq);
+    }
+}
+void
+ThreadedInjectionStressTestCase::Receive (unsigned int threadno, uint32_t seq)
+{
+  if (seq != m_next[threadno] && m_error.empty ())
+    {
+      m_error = "Event " + std::to_string (seq) + " of thread " + std::to_string (threadno) +
+        " run instead of " + std::to_string (m_next[threadno]);
+    }
+  m_next[threadno] = seq + 1;
+  m_received++;
+}
+void
+ThreadedInjectionStressTestCase::KeepAlive (void)
+{
+  if (m_received < (uint64_t) m_threads * m_events)
+    {
+      Simulator::Schedule (MicroSeconds (1), &ThreadedInjectionStressTestCase::KeepAlive, this);
+    }
+}
+void
+ThreadedInjectionStressTestCase::DoTeardown (void)
+{
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+void
+ThreadedInjectionStressTestCase::DoRun (void)
+{
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+  m_next.assign (m_threads, 0);
+  m_received = 0;
+  m_error = "";
+
+  std::list<Ptr<SystemThread> > threads;
+  for (unsigned int i = 0; i < m_threads; ++i)
+    {
+      threads.push_back (
+        Create<SystemThread> (MakeBoundCallback (
+                                &ThreadedInjectionStressTestCase::InjectingThread,
+                                std::pair<ThreadedInjectionStressTestCase *, unsigned int> (this, i) )) );
+    }
+  Simulator::Schedule (MicroSeconds (1), &ThreadedInjectionStressTestCase::KeepAlive, this);
+
+  for (std::list<Ptr<SystemThread> >::iterator it = threads.begin (); it != threads.end (); ++it)
+    {
+      (*it)->Start ();
+    }
+  Simulator::Run ();
+  for (std::list<Ptr<SystemThread> >::iterator it = threads.begin (); it != threads.end (); ++it)
+    {
+      (*it)->Join ();
+    }
+  Simulator::Destroy ();
+
+  NS_TEST_EXPECT_MSG_EQ (m_error.empty (), true, m_error);
+  NS_TEST_EXPECT_MSG_EQ (m_received, (uint64_t) m_threads * m_events, "Events lost");
+}
+
 class ThreadedSimulatorTestSuite : public TestSuite
 {
 public:
@@ -241,7 +337,8 @@ public:
       "ns3::ListScheduler",
       "ns3::HeapScheduler",
       "ns3::MapScheduler",
-      "ns3::CalendarScheduler"
+      "ns3::CalendarScheduler",
+      "ns3::TimingWheelScheduler"
     };
     unsigned int threadcounts[] = {
       0,
@@ -262,5 +359,9 @@ public:
               }
           }
       }
+    // Enough events to overflow the ring of DefaultSimulatorImpl
+    AddTestCase (new ThreadedInjectionStressTestCase (1, 100000), TestCase::QUICK);
+    AddTestCase (new ThreadedInjectionStressTestCase (4, 50000), TestCase::QUICK);
+    AddTestCase (new ThreadedInjectionStressTestCase (16, 10000), TestCase::QUICK);
   }
 } g_threadedSimulatorTestSuite;
@@ -0,0 +1,201 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/nstime.h"
+#include "ns3/object-factory.h"
+#include "ns3/event-impl.h"
+#include "ns3/map-scheduler.h"
+#include "ns3/timing-wheel-scheduler.h"
+
+#include <random>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup scheduler-tests
+ * TimingWheelScheduler test suite.
+ */
+
+using namespace ns3;
+
+/**
+ * \ingroup scheduler-tests
+ *
+ * \brief Feed the same operations to a TimingWheelScheduler and a
+ * MapScheduler and check that they hand out the same events in the
+ * same order.
+ *
+ * The operations mimic a network simulation: periodic timers, events a
+ * few microseconds ahead (transmit completions), timers a few hundred
+ * milliseconds ahead that are often removed, events at the current time
+ * and rare events hours ahead (beyond the range of the wheel), with many
+ * timestamp ties.
+ */
+class TimingWheelOrderTestCase : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param slotWidth the SlotWidth of the TimingWheelScheduler
+   */
+  TimingWheelOrderTestCase (Time slotWidth);
+
+private:
+  virtual void DoRun (void);
+
+  /// The events are never invoked, they only need distinct impl pointers.
+  class NullEvent : public EventImpl
+  {
+  protected:
+    virtual void Notify (void)
+    {
+    }
+  };
+
+  Time m_slotWidth; //!< SlotWidth of the scheduler under test
+};
+
+TimingWheelOrderTestCase::TimingWheelOrderTestCase (Time slotWidth)
+  : TestCase ("Check that TimingWheelScheduler with SlotWidth " + std::to_string (slotWidth.GetTimeStep ())
+              + " orders events like MapScheduler"),
+    m_slotWidth (slotWidth)
+{
+}
+
+void
+TimingWheelOrderTestCase::DoRun (void)
+{
+  Ptr<TimingWheelScheduler> wheel = CreateObjectWithAttributes<TimingWheelScheduler> ("SlotWidth", TimeValue (m_slotWidth));
+  Ptr<MapScheduler> map = CreateObject<MapScheduler> ();
+
+  std::mt19937 rng (1);
+  const uint32_t nEvents = 20000;
+  std::vector<Ptr<NullEvent> > impls;
+  std::vector<Scheduler::Event> pending;
+  std::vector<bool> done (nEvents + 2, false); // run or removed, by uid
+  uint64_t now = 0;
+  uint32_t uid = 0;
+  uint32_t nRun = 0;
+
+  auto insert = [&] (uint64_t delay) {
+      Scheduler::Event ev;
+      impls.push_back (Create<NullEvent> ());
+      ev.impl = PeekPointer (impls.back ());
+      ev.key.m_ts = now + delay;
+      ev.key.m_uid = uid++;
+      ev.key.m_context = 0;
+      wheel->Insert (ev);
+      map->Insert (ev);
+      pending.push_back (ev);
+    };
+
+  // Periodic timers with a 10 ms and a 200 ms period, started together
+  for (uint32_t i = 0; i < 8; i++)
+    {
+      insert (10000000);
+      insert (200000000);
+    }
+
+  while (!map->IsEmpty ())
+    {
+      NS_TEST_ASSERT_MSG_EQ (wheel->IsEmpty (), false, "Wheel empty before the map");
+      Scheduler::Event peek = wheel->PeekNext ();
+      Scheduler::Event expected = map->RemoveNext ();
+      Scheduler::Event next = wheel->RemoveNext ();
+      NS_TEST_ASSERT_MSG_EQ (peek.key.m_uid, expected.key.m_uid, "PeekNext mismatch after " << nRun << " events");
+      NS_TEST_ASSERT_MSG_EQ (next.key.m_uid, expected.key.m_uid, "RemoveNext mismatch after " << nRun << " events");
+      NS_TEST_ASSERT_MSG_EQ (next.key.m_ts, expected.key.m_ts, "Timestamp mismatch after " << nRun << " events");
+      NS_TEST_ASSERT_MSG_EQ (next.impl, expected.impl, "Event mismatch after " << nRun << " events");
+      NS_TEST_ASSERT_MSG_GT_OR_EQ (next.key.m_ts, now, "Time went backwards");
+      now = next.key.m_ts;
+      done[next.key.m_uid] = true;
+      nRun++;
+
+      if (uid >= nEvents)
+        {
+          continue;
+        }
+      uint32_t kind = rng () % 100;
+      if (kind < 30)
+        {
+          // Keep the periodic timers going
+          insert (next.key.m_uid % 2 == 0 ? 10000000 : 200000000);
+        }
+      else if (kind < 70)
+        {
+          insert (1000 + rng () % 20000);
+        }
+      else if (kind < 85)
+        {
+          insert (rng () % 300000000);
+        }
+      else if (kind < 92)
+        {
+          insert (0);
+          insert (0);
+        }
+      else if (kind < 93)
+        {
+          insert ((uint64_t) 3600000000000ULL * (1 + rng () % 4));
+        }
+      else
+        {
+          insert (rng () % 1000);
+        }
+
+      // Remove a random pending event once in a while, as Simulator::Remove does
+      if (rng () % 8 == 0)
+        {
+          size_t i = rng () % pending.size ();
+          Scheduler::Event victim = pending[i];
+          if (!done[victim.key.m_uid])
+            {
+              wheel->Remove (victim);
+              map->Remove (victim);
+              done[victim.key.m_uid] = true;
+            }
+          pending[i] = pending.back ();
+          pending.pop_back ();
+        }
+    }
+  NS_TEST_ASSERT_MSG_EQ (wheel->IsEmpty (), true, "Wheel not empty after the map");
+  NS_TEST_ASSERT_MSG_GT (nRun, nEvents / 2, "Too few events run");
+}
+
+/**
+ * \ingroup scheduler-tests
+ *
+ * \brief TimingWheelScheduler TestSuite
+ */
+class TimingWheelSchedulerTestSuite : public TestSuite
+{
+public:
+  TimingWheelSchedulerTestSuite ();
+};
+
+TimingWheelSchedulerTestSuite::TimingWheelSchedulerTestSuite ()
+  : TestSuite ("timing-wheel-scheduler", UNIT)
+{
+  AddTestCase (new TimingWheelOrderTestCase (NanoSeconds (1024)), TestCase::QUICK);
+  // One step slots: every event beyond 2^32 ns goes through the overflow map
+  AddTestCase (new TimingWheelOrderTestCase (NanoSeconds (1)), TestCase::QUICK);
+  AddTestCase (new TimingWheelOrderTestCase (MilliSeconds (1)), TestCase::QUICK);
+}
+
+static TimingWheelSchedulerTestSuite g_timingWheelSchedulerTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+//
+// Copyright (c) 2021 Stanford University
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License version 2 as
+// published by the Free Software Foundation;
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+#ifndef FLOW_HASH_TABLE_H
+#define FLOW_HASH_TABLE_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace ns3 {
+
+/// \ingroup flow-monitor
+/// Open addressing hash table that maps the key of a flow to the index
+/// of the flow in a vector kept by the user.
+///
+/// Flows are looked up for every packet and never forgotten, so the
+/// table probes linearly in a power of two array of slots, kept at most
+/// half full, and does not support removal.
+///
+/// \tparam KEY the key of a flow, compared with operator==
+/// \tparam HASH a function object hashing a KEY to a uint32_t
+template <typename KEY, typename HASH>
+class FlowHashTable
+{
+public:
+  /// Index returned by Find for a key that is not in the table
+  static const uint32_t NOT_FOUND = 0xffffffff;
+
+  FlowHashTable ();
+
+  /// Find the index of a flow
+  /// \param key the key of the flow
+  /// \returns the index of the flow, or NOT_FOUND
+  uint32_t Find (const KEY &key) const;
+  /// Add a flow to the table
+  /// \param key the key of the flow, which must not be in the table
+  /// \param index the index of the flow
+  void Insert (const KEY &key, uint32_t index);
+  /// \returns the number of flows in the table
+  uint32_t GetSize (void) const;
+
+private:
+  /// A slot of the table
+  struct Slot
+  {
+    KEY key;        //!< Key of the flow
+    uint32_t index; //!< Index of the flow, NOT_FOUND if the slot is free
+  };
+
+  /// Double the number of slots and insert the flows again
+  void Grow (void);
+
+  std::vector<Slot> m_slots; //!< Slots, a power of two of them
+  uint32_t m_size;           //!< Number of flows in the table
+};
+
+} // namespace ns3
+
+/********************************************************************
+ *  Implementation of the templates declared above.
+ ********************************************************************/
+
+namespace ns3 {
+
+template <typename KEY, typename HASH>
+FlowHashTable<KEY, HASH>::FlowHashTable ()
+  : m_size (0)
+{
+}
+
+template <typename KEY, typename HASH>
+uint32_t
+FlowHashTable<KEY, HASH>::Find (const KEY &key) const
+{
+  if (m_slots.empty ())
+    {
+      return NOT_FOUND;
+    }
+  uint32_t mask = m_slots.size () - 1;
+  for (uint32_t i = HASH () (key) & mask; ; i = (i + 1) & mask)
+    {
+      const Slot &slot = m_slots[i];
+      if (slot.index == NOT_FOUND || slot.key == key)
+        {
+          return slot.index;
+        }
+    }
+}
+
+template <typename KEY, typename HASH>
+void
+FlowHashTable<KEY, HASH>::Insert (const KEY &key, uint32_t index)
+{
+  if (2 * (m_size + 1) > m_slots.size ())
+    {
+      Grow ();
+    }
+  uint32_t mask = m_slots.size () - 1;
+  uint32_t i = HASH () (key) & mask;
+  while (m_slots[i].index != NOT_FOUND)
+    {
+      i = (i + 1) & mask;
+    }
+  m_slots[i].key = key;
+  m_slots[i].index = index;
+  m_size++;
+}
+
+template <typename KEY, typename HASH>
+uint32_t
+FlowHashTable<KEY, HASH>::GetSize (void) const
+{
+  return m_size;
+}
+
+template <typename KEY, typename HASH>
+void
+FlowHashTable<KEY, HASH>::Grow (void)
+{
+  std::vector<Slot> slots (m_slots.empty () ? 16 : 2 * m_slots.size ());
+  for (Slot &slot : slots)
+    {
+      slot.index = NOT_FOUND;
+    }
+  slots.swap (m_slots);
+  m_size = 0;
+  for (const Slot &slot : slots)
+    {
+      if (slot.index != NOT_FOUND)
+        {
+          Insert (slot.key, slot.index);
+        }
+    }
+}
+
+} // namespace ns3
+
+#endif /* FLOW_HASH_TABLE_H */
@@ -22,11 +22,18 @@
 #include "ns3/simulator.h"
 #include "ns3/log.h"
 #include "ns3/double.h"
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 
 #define PERIODIC_CHECK_INTERVAL (Seconds (1))
 
+#ifdef NS3_MTP
+#define FLOW_MONITOR_LOCK CriticalSection cs (m_lock)
+#else
+#define FLOW_MONITOR_LOCK
+#endif
+
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("FlowMonitor");
@@ -80,7 +87,8 @@ FlowMonitor::GetInstanceTypeId (void) const
 }
 
 FlowMonitor::FlowMonitor ()
-  : m_enabled (false)
+  : m_enabled (false),
+    m_deltaSeries (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -91,6 +99,8 @@ FlowMonitor::DoDispose (void)
   NS_LOG_FUNCTION (this);
   Simulator::Cancel (m_startEvent);
   Simulator::Cancel (m_stopEvent);
+  Simulator::Cancel (m_deltaEvent);
+  m_deltaWriter = 0;
   for (std::list<Ptr<FlowClassifier> >::iterator iter = m_classifiers.begin ();
       iter != m_classifiers.end ();
       iter ++)
@@ -105,36 +115,231 @@ FlowMonitor::DoDispose (void)
   Object::DoDispose ();
 }
 
-inline FlowMonitor::FlowStats&
-FlowMonitor::GetStatsForFlow (FlowId flowId)
+FlowMonitor::TrackedFlow*
+FlowMonitor::FindTrackedFlow (FlowId flowId)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t index = m_flowTable.Find (flowId);
+  if (index == m_flowTable.NOT_FOUND)
+    {
+      return 0;
+    }
+  return &m_trackedFlows[index];
+}
+
+FlowMonitor::TrackedFlow&
+FlowMonitor::GetTrackedFlow (FlowId flowId)
 {
   NS_LOG_FUNCTION (this);
-  FlowStatsContainerI iter;
-  iter = m_flowStats.find (flowId);
-  if (iter == m_flowStats.end ())
-    {
-      FlowMonitor::FlowStats &ref = m_flowStats[flowId];
-      ref.delaySum = Seconds (0);
-      ref.jitterSum = Seconds (0);
-      ref.lastDelay = Seconds (0);
-      ref.txBytes = 0;
-      ref.rxBytes = 0;
-      ref.txPackets = 0;
-      ref.rxPackets = 0;
-      ref.lostPackets = 0;
-      ref.timesForwarded = 0;
-      ref.delayHistogram.SetDefaultBinWidth (m_delayBinWidth);
-      ref.jitterHistogram.SetDefaultBinWidth (m_jitterBinWidth);
-      ref.packetSizeHistogram.SetDefaultBinWidth (m_packetSizeBinWidth);
-      ref.flowInterruptionsHistogram.SetDefaultBinWidth (m_flowInterruptionsBinWidth);
-      return ref;
+  TrackedFlow *found = FindTrackedFlow (flowId);
+  if (found != 0)
+    {
+      return *found;
+    }
+
+  FlowMonitor::FlowStats &ref = m_flowStats[flowId];
+  ref.delaySum = Seconds (0);
+  ref.jitterSum = Seconds (0);
+  ref.lastDelay = Seconds (0);
+  ref.txBytes = 0;
+  ref.rxBytes = 0;
+  ref.txPackets = 0;
+  ref.rxPackets = 0;
+  ref.lostPackets = 0;
+  ref.timesForwarded = 0;
+  ref.delayHistogram.SetDefaultBinWidth (m_delayBinWidth);
+  ref.jitterHistogram.SetDefaultBinWidth (m_jitterBinWidth);
+  ref.packetSizeHistogram.SetDefaultBinWidth (m_packetSizeBinWidth);
+  ref.flowInterruptionsHistogram.SetDefaultBinWidth (m_flowInterruptionsBinWidth);
+
+  m_flowTable.Insert (flowId, m_trackedFlows.size ());
+  m_trackedFlows.push_back (TrackedFlow ());
+  TrackedFlow &flow = m_trackedFlows.back ();
+  flow.flowId = flowId;
+  flow.stats = &ref;
+  flow.firstPacketId = 0;
+  flow.head = 0;
+  flow.nSlots = 0;
+  flow.nTracked = 0;
+  flow.maxSlots = 0;
+  flow.changed = false;
+  return flow;
+}
+
+void
+FlowMonitor::MarkChanged (TrackedFlow &flow)
+{
+  if (m_deltaWriter != 0 && !flow.changed)
+    {
+      flow.changed = true;
+      m_changedFlows.push_back (&flow - m_trackedFlows.data ());
+    }
+}
+
+FlowMonitor::TrackedPacket*
+FlowMonitor::FindTrackedPacket (TrackedFlow &flow, FlowPacketId packetId)
+{
+  // packets older than the window wrap to large offsets
+  uint32_t offset = packetId - flow.firstPacketId;
+  if (offset < flow.nSlots)
+    {
+      TrackedPacket &packet = flow.packets[(flow.head + offset) & (flow.packets.size () - 1)];
+      if (packet.tracked)
+        {
+          return &packet;
+        }
+    }
+  if (!flow.stragglers.empty ())
+    {
+      std::map<FlowPacketId, TrackedPacket>::iterator i = flow.stragglers.find (packetId);
+      if (i != flow.stragglers.end ())
+        {
+          return &i->second;
+        }
+    }
+  return 0;
+}
+
+FlowMonitor::TrackedPacket&
+FlowMonitor::TrackPacket (TrackedFlow &flow, FlowPacketId packetId)
+{
+  if (!flow.stragglers.empty ())
+    {
+      std::map<FlowPacketId, TrackedPacket>::iterator i = flow.stragglers.find (packetId);
+      if (i != flow.stragglers.end ())
+        {
+          return i->second;
+        }
+    }
+  uint32_t size = flow.packets.size ();
+  if (flow.nSlots > 0 && packetId - flow.firstPacketId < 0x80000000
+      && packetId - flow.firstPacketId >= size && 2 * flow.nTracked <= size)
+    {
+      // the window outgrows a ring that is at most half used: keep the
+      // newest half of the window and move the older packets out
+      EvictPackets (flow, packetId - size / 2 + 1);
+    }
+  if (flow.nSlots == 0)
+    {
+      flow.firstPacketId = packetId;
+    }
+  // extend the window to the packet, in either direction
+  uint32_t before = 0;
+  uint32_t after = 0;
+  if (packetId - flow.firstPacketId < 0x80000000)
+    {
+      after = std::max (flow.nSlots, packetId - flow.firstPacketId + 1) - flow.nSlots;
+    }
+  else
+    {
+      before = flow.firstPacketId - packetId;
+    }
+  uint32_t nSlots = flow.nSlots + before + after;
+  if (nSlots > flow.packets.size ())
+    {
+      // the slots out of the window are never tracked
+      size = flow.packets.empty () ? 16 : flow.packets.size ();
+      while (size < nSlots)
+        {
+          size *= 2;
+        }
+      std::vector<TrackedPacket> packets (size);
+      for (uint32_t i = 0; i < flow.nSlots; i++)
+        {
+          packets[i] = flow.packets[(flow.head + i) & (flow.packets.size () - 1)];
+        }
+      for (uint32_t i = flow.nSlots; i < size; i++)
+        {
+          packets[i].tracked = false;
+        }
+      flow.packets.swap (packets);
+      flow.head = 0;
+    }
+  uint32_t mask = flow.packets.size () - 1;
+  flow.head = (flow.head - before) & mask;
+  flow.firstPacketId -= before;
+  flow.nSlots = nSlots;
+  flow.maxSlots = std::max (flow.maxSlots, nSlots);
+
+  TrackedPacket &packet = flow.packets[(flow.head + packetId - flow.firstPacketId) & mask];
+  if (!packet.tracked)
+    {
+      packet.tracked = true;
+      flow.nTracked++;
+    }
+  return packet;
+}
+
+void
+FlowMonitor::UntrackPacket (TrackedFlow &flow, FlowPacketId packetId, TrackedPacket *packet)
+{
+  uint32_t offset = packetId - flow.firstPacketId;
+  if (offset < flow.nSlots
+      && packet == &flow.packets[(flow.head + offset) & (flow.packets.size () - 1)])
+    {
+      packet->tracked = false;
+      flow.nTracked--;
+      AdvanceHead (flow);
     }
   else
     {
-      return iter->second;
+      flow.stragglers.erase (packetId);
     }
 }
 
+void
+FlowMonitor::EvictPackets (TrackedFlow &flow, FlowPacketId packetId)
+{
+  uint32_t mask = flow.packets.size () - 1;
+  uint32_t n = std::min (flow.nSlots, packetId - flow.firstPacketId);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      TrackedPacket &packet = flow.packets[flow.head];
+      if (packet.tracked)
+        {
+          flow.stragglers[flow.firstPacketId] = packet;
+          packet.tracked = false;
+          flow.nTracked--;
+        }
+      flow.head = (flow.head + 1) & mask;
+      flow.firstPacketId++;
+      flow.nSlots--;
+    }
+  AdvanceHead (flow);
+}
+
+void
+FlowMonitor::AdvanceHead (TrackedFlow &flow)
+{
+  uint32_t mask = flow.packets.size () - 1;
+  while (flow.nSlots > 0 && !flow.packets[flow.head].tracked)
+    {
+      flow.head = (flow.head + 1) & mask;
+      flow.firstPacketId++;
+      flow.nSlots--;
+    }
+  if (flow.nSlots == 0 && !flow.packets.empty ())
+    {
+      // shrink the ring to the largest window it held since it last
+      // drained, if that is much smaller
+      uint32_t size = 16;
+      while (size < flow.maxSlots)
+        {
+          size *= 2;
+        }
+      if (4 * size <= flow.packets.size ())
+        {
+          std::vector<TrackedPacket> packets (size);
+          for (uint32_t i = 0; i < size; i++)
+            {
+              packets[i].tracked = false;
+            }
+          flow.packets.swap (packets);
+        }
+      flow.head = 0;
+      flow.maxSlots = 0;
+    }
+}
 
 void
 FlowMonitor::ReportFirstTx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packetId, uint32_t packetSize)
@@ -145,8 +350,10 @@ FlowMonitor::ReportFirstTx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t pack
       NS_LOG_DEBUG ("FlowMonitor not enabled; returning");
       return;
     }
+  FLOW_MONITOR_LOCK;
   Time now = Simulator::Now ();
-  TrackedPacket &tracked = m_trackedPackets[std::make_pair (flowId, packetId)];
+  TrackedFlow &flow = GetTrackedFlow (flowId);
+  TrackedPacket &tracked = TrackPacket (flow, packetId);
   tracked.firstSeenTime = now;
   tracked.lastSeenTime = tracked.firstSeenTime;
   tracked.timesForwarded = 0;
@@ -155,7 +362,7 @@ FlowMonitor::ReportFirstTx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t pack
 
   probe->AddPacketStats (flowId, packetSize, Seconds (0));
 
-  FlowStats &stats = GetStatsForFlow (flowId);
+  FlowStats &stats = *flow.stats;
   stats.txBytes += packetSize;
   stats.txPackets++;
   if (stats.txPackets == 1)
@@ -163,6 +370,7 @@ FlowMonitor::ReportFirstTx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t pack
       stats.timeFirstTxPacket = now;
     }
   stats.timeLastTxPacket = now;
+  MarkChanged (flow);
 }
 
 
@@ -175,19 +383,20 @@ FlowMonitor::ReportForwarding (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t p
       NS_LOG_DEBUG ("FlowMonitor not enabled; returning");
       return;
     }
-  std::pair<FlowId, FlowPacketId> key (flowId, packetId);
-  TrackedPacketMap::iterator tracked = m_trackedPackets.find (key);
-  if (tracked == m_trackedPackets.end ())
+  FLOW_MONITOR_LOCK;
+  TrackedFlow *flow = FindTrackedFlow (flowId);
+  TrackedPacket *tracked = flow == 0 ? 0 : FindTrackedPacket (*flow, packetId);
+  if (tracked == 0)
     {
       NS_LOG_WARN ("Received packet forward report (flowId=" << flowId << ", packetId=" << packetId
                                                              << ") but not known to be transmitted.");
       return;
     }
 
-  tracked->second.timesForwarded++;
-  tracked->second.lastSeenTime = Simulator::Now ();
+  tracked->timesForwarded++;
+  tracked->lastSeenTime = Simulator::Now ();
 
-  Time delay = (Simulator::Now () - tracked->second.firstSeenTime);
+  Time delay = (Simulator::Now () - tracked->firstSeenTime);
   probe->AddPacketStats (flowId, packetSize, delay);
 }
 
@@ -201,19 +410,22 @@ FlowMonitor::ReportLastRx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packe
       NS_LOG_DEBUG ("FlowMonitor not enabled; returning");
       return;
     }
-  TrackedPacketMap::iterator tracked = m_trackedPackets.find (std::make_pair (flowId, packetId));
-  if (tracked == m_trackedPackets.end ())
+  FLOW_MONITOR_LOCK;
+  TrackedFlow *found = FindTrackedFlow (flowId);
+  TrackedPacket *tracked = found == 0 ? 0 : FindTrackedPacket (*found, packetId);
+  if (tracked == 0)
     {
       NS_LOG_WARN ("Received packet last-tx report (flowId=" << flowId << ", packetId=" << packetId
                                                              << ") but not known to be transmitted.");
       return;
     }
 
+  TrackedFlow &flow = *found;
   Time now = Simulator::Now ();
-  Time delay = (now - tracked->second.firstSeenTime);
+  Time delay = (now - tracked->firstSeenTime);
   probe->AddPacketStats (flowId, packetSize, delay);
 
-  FlowStats &stats = GetStatsForFlow (flowId);
+  FlowStats &stats = *flow.stats;
   stats.delaySum += delay;
   stats.delayHistogram.AddValue (delay.GetSeconds ());
   if (stats.rxPackets > 0 )
@@ -249,12 +461,13 @@ FlowMonitor::ReportLastRx (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packe
         }
     }
   stats.timeLastRxPacket = now;
-  stats.timesForwarded += tracked->second.timesForwarded;
+  stats.timesForwarded += tracked->timesForwarded;
+  MarkChanged (flow);
 
   NS_LOG_DEBUG ("ReportLastTx: removing tracked packet (flowId="
                 << flowId << ", packetId=" << packetId << ").");
 
-  m_trackedPackets.erase (tracked); // we don't need to track this packet anymore
+  UntrackPacket (flow, packetId, tracked); // we don't need to track this packet anymore
 }
 
 void
@@ -267,10 +480,19 @@ FlowMonitor::ReportDrop (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packetI
       NS_LOG_DEBUG ("FlowMonitor not enabled; returning");
       return;
     }
+  FLOW_MONITOR_LOCK;
 
   probe->AddPacketDropStats (flowId, packetSize, reasonCode);
 
-  FlowStats &stats = GetStatsForFlow (flowId);
+  TrackedFlow *found = FindTrackedFlow (flowId);
+  if (found == 0)
+    {
+      NS_LOG_WARN ("Received packet drop report (flowId=" << flowId << ", packetId=" << packetId
+                                                          << ") but the flow is not known to transmit.");
+      return;
+    }
+  TrackedFlow &flow = *found;
+  FlowStats &stats = *flow.stats;
   stats.lostPackets++;
   if (stats.packetsDropped.size () < reasonCode + 1)
     {
@@ -279,16 +501,17 @@ FlowMonitor::ReportDrop (Ptr<FlowProbe> probe, uint32_t flowId, uint32_t packetI
     }
   ++stats.packetsDropped[reasonCode];
   stats.bytesDropped[reasonCode] += packetSize;
+  MarkChanged (flow);
   NS_LOG_DEBUG ("++stats.packetsDropped[" << reasonCode<< "]; // becomes: " << stats.packetsDropped[reasonCode]);
 
-  TrackedPacketMap::iterator tracked = m_trackedPackets.find (std::make_pair (flowId, packetId));
-  if (tracked != m_trackedPackets.end ())
+  TrackedPacket *tracked = FindTrackedPacket (flow, packetId);
+  if (tracked != 0)
     {
       // we don't need to track this packet anymore
       // FIXME: this will not necessarily be true with broadcast/multicast
       NS_LOG_DEBUG ("ReportDrop: removing tracked packet (flowId="
                     << flowId << ", packetId=" << packetId << ").");
-      m_trackedPackets.erase (tracked);
+      UntrackPacket (flow, packetId, tracked);
     }
 }
 
@@ -303,24 +526,41 @@ void
 FlowMonitor::CheckForLostPackets (Time maxDelay)
 {
   NS_LOG_FUNCTION (this << maxDelay.As (Time::S));
+  FLOW_MONITOR_LOCK;
   Time now = Simulator::Now ();
 
-  for (TrackedPacketMap::iterator iter = m_trackedPackets.begin ();
-       iter != m_trackedPackets.end (); )
+  // the rings hold about the packets in flight, the stragglers the
+  // packets that are late or lost
+  for (TrackedFlow &flow : m_trackedFlows)
     {
-      if (now - iter->second.lastSeenTime >= maxDelay)
+      for (uint32_t i = 0; i < flow.nSlots; i++)
         {
-          // packet is considered lost, add it to the loss statistics
-          FlowStatsContainerI flow = m_flowStats.find (iter->first.first);
-          NS_ASSERT (flow != m_flowStats.end ());
-          flow->second.lostPackets++;
-
-          // we won't track it anymore
-          m_trackedPackets.erase (iter++);
+          TrackedPacket &packet = flow.packets[(flow.head + i) & (flow.packets.size () - 1)];
+          if (packet.tracked && now - packet.lastSeenTime >= maxDelay)
+            {
+              // packet is considered lost, add it to the loss statistics
+              flow.stats->lostPackets++;
+              MarkChanged (flow);
+
+              // we won't track it anymore
+              packet.tracked = false;
+              flow.nTracked--;
+            }
         }
-      else
+      AdvanceHead (flow);
+      for (std::map<FlowPacketId, TrackedPacket>::iterator i = flow.stragglers.begin ();
+           i != flow.stragglers.end (); )
         {
-          iter++;
+          if (now - i->second.lastSeenTime >= maxDelay)
+            {
+              flow.stats->lostPackets++;
+              MarkChanged (flow);
+              flow.stragglers.erase (i++);
+            }
+          else
+            {
+              i++;
+            }
         }
     }
 }
@@ -338,6 +578,48 @@ FlowMonitor::PeriodicCheckForLostPackets ()
   Simulator::Schedule (PERIODIC_CHECK_INTERVAL, &FlowMonitor::PeriodicCheckForLostPackets, this);
 }
 
+void
+FlowMonitor::EnableDeltaExport (Ptr<ColumnarTraceWriter> writer, Time interval)
+{
+  NS_LOG_FUNCTION (this << writer << interval.As (Time::S));
+  NS_ABORT_MSG_IF (m_deltaWriter != 0, "FlowMonitor delta export already enabled");
+  NS_ABORT_MSG_UNLESS (interval.IsStrictlyPositive (), "Delta export interval must be positive");
+  m_deltaWriter = writer;
+  m_deltaSeries = writer->AddSeries ("flows", {{"time", ColumnarTraceWriter::DOUBLE},
+                                               {"flowId", ColumnarTraceWriter::UINT32},
+                                               {"txBytes", ColumnarTraceWriter::UINT64},
+                                               {"rxBytes", ColumnarTraceWriter::UINT64},
+                                               {"txPackets", ColumnarTraceWriter::UINT32},
+                                               {"rxPackets", ColumnarTraceWriter::UINT32},
+                                               {"lostPackets", ColumnarTraceWriter::UINT32},
+                                               {"delaySum", ColumnarTraceWriter::DOUBLE},
+                                               {"jitterSum", ColumnarTraceWriter::DOUBLE}});
+  m_deltaInterval = interval;
+  m_deltaEvent = Simulator::Schedule (interval, &FlowMonitor::PeriodicDeltaExport, this);
+}
+
+void
+FlowMonitor::PeriodicDeltaExport ()
+{
+  NS_LOG_FUNCTION (this);
+  {
+    FLOW_MONITOR_LOCK;
+    double now = Simulator::Now ().GetSeconds ();
+    // the flows are written in the order in which they changed first
+    for (uint32_t index : m_changedFlows)
+      {
+        TrackedFlow &flow = m_trackedFlows[index];
+        const FlowStats &stats = *flow.stats;
+        m_deltaWriter->Append (m_deltaSeries, now, flow.flowId, stats.txBytes, stats.rxBytes,
+                               stats.txPackets, stats.rxPackets, stats.lostPackets,
+                               stats.delaySum.GetSeconds (), stats.jitterSum.GetSeconds ());
+        flow.changed = false;
+      }
+    m_changedFlows.clear ();
+  }
+  m_deltaEvent = Simulator::Schedule (m_deltaInterval, &FlowMonitor::PeriodicDeltaExport, this);
+}
+
 void
 FlowMonitor::NotifyConstructionCompleted ()
 {
@@ -28,9 +28,14 @@
 #include "ns3/object.h"
 #include "ns3/flow-probe.h"
 #include "ns3/flow-classifier.h"
+#include "ns3/flow-hash-table.h"
 #include "ns3/histogram.h"
 #include "ns3/nstime.h"
 #include "ns3/event-id.h"
+#include "ns3/columnar-trace.h"
+#ifdef NS3_MTP
+#include "ns3/system-mutex.h"
+#endif
 
 namespace ns3 {
 
@@ -258,6 +263,17 @@ public:
   /// \param enableProbes if true, include also the per-probe/flow pair statistics in the output
   void SerializeToXmlFile (std::string fileName, bool enableHistograms, bool enableProbes);
 
+  /// Periodically write the statistics of the flows that changed since
+  /// the previous interval to a ColumnarTraceWriter, in a series named
+  /// "flows" with one row per changed flow: time, flowId, and the current
+  /// txBytes, rxBytes, txPackets, rxPackets, lostPackets, delaySum and
+  /// jitterSum (in seconds) of the flow.  The cost of an interval is
+  /// proportional to the number of flows that changed in it.
+  /// \param writer the writer of the series
+  /// \param interval time between two exports, the first one being an
+  /// interval from now
+  void EnableDeltaExport (Ptr<ColumnarTraceWriter> writer, Time interval);
+
 
 protected:
 
@@ -272,14 +288,53 @@ private:
     Time firstSeenTime; //!< absolute time when the packet was first seen by a probe
     Time lastSeenTime; //!< absolute time when the packet was last seen by a probe
     uint32_t timesForwarded; //!< number of times the packet was reportedly forwarded
+    bool tracked; //!< false if the slot holds no packet
+  };
+
+  /// Structure to represent a flow and its tracked packets
+  ///
+  /// The classifiers number the packets of a flow in sequence, so the
+  /// packets in flight are kept in a ring indexed by packet id: the
+  /// window of the ring starts at the oldest packet still tracked and
+  /// ends at the newest one.
+  ///
+  /// A packet lost without a drop report stays tracked until it expires,
+  /// and would keep the window open behind it.  So when the window
+  /// outgrows a ring that is at most half used, the oldest packets are
+  /// moved to the stragglers instead, and the ring keeps the size of the
+  /// packets in flight.  The ring is shrunk when it drains.
+  struct TrackedFlow
+  {
+    FlowId flowId; //!< flow identification
+    FlowStats *stats; //!< statistics of the flow, in m_flowStats
+    FlowPacketId firstPacketId; //!< packet id of the first slot of the window
+    uint32_t head; //!< index in packets of the first slot of the window
+    uint32_t nSlots; //!< number of slots of the window
+    uint32_t nTracked; //!< number of packets tracked in the ring
+    uint32_t maxSlots; //!< largest window since the ring last drained
+    bool changed; //!< true if the flow is in m_changedFlows
+    std::vector<TrackedPacket> packets; //!< ring of packets, a power of two of them
+    std::map<FlowPacketId, TrackedPacket> stragglers; //!< tracked packets older than the window
+  };
+
+  /// Hash of a FlowId, for the FlowHashTable
+  struct FlowIdHash
+  {
+    /// \param flowId the FlowId
+    /// \returns the hash of the FlowId
+    uint32_t operator() (FlowId flowId) const
+    {
+      return flowId * 0x9e3779b1;
+    }
   };
 
   /// FlowId --> FlowStats
   FlowStatsContainer m_flowStats;
 
-  /// (FlowId,PacketId) --> TrackedPacket
-  typedef std::map< std::pair<FlowId, FlowPacketId>, TrackedPacket> TrackedPacketMap;
-  TrackedPacketMap m_trackedPackets; //!< Tracked packets
+  /// Flows, with their tracked packets
+  std::vector<TrackedFlow> m_trackedFlows;
+  /// FlowId --> index in m_trackedFlows
+  FlowHashTable<FlowId, FlowIdHash> m_flowTable;
   Time m_maxPerHopDelay; //!< Minimum per-hop delay
   FlowProbeContainer m_flowProbes; //!< all the FlowProbes
 
@@ -295,10 +350,54 @@ private:
   double m_flowInterruptionsBinWidth; //!< Flow interruptions bin width (for histograms)
   Time m_flowInterruptionsMinTime; //!< Flow interruptions minimum time
 
-  /// Get the stats for a given flow
+  Ptr<ColumnarTraceWriter> m_deltaWriter; //!< Writer of the delta export, 0 if disabled
+  uint16_t m_deltaSeries;   //!< Series of the delta export
+  Time m_deltaInterval;     //!< Interval of the delta export
+  EventId m_deltaEvent;     //!< Next delta export
+  /// Indexes in m_trackedFlows of the flows changed since the last delta export
+  std::vector<uint32_t> m_changedFlows;
+#ifdef NS3_MTP
+  /// The probes of a multithreaded simulation report from all the threads
+  SystemMutex m_lock;
+#endif
+
+  /// Find a flow without creating it
+  /// \param flowId the Flow identification
+  /// \returns the flow, or 0 if no packet of the flow was transmitted
+  TrackedFlow* FindTrackedFlow (FlowId flowId);
+  /// Get a flow and its stats, and create them if the flow was unknown
   /// \param flowId the Flow identification
-  /// \returns the stats of the flow
-  FlowStats& GetStatsForFlow (FlowId flowId);
+  /// \returns the flow
+  TrackedFlow& GetTrackedFlow (FlowId flowId);
+  /// Find a tracked packet of a flow
+  /// \param flow the flow
+  /// \param packetId the packet id
+  /// \returns the packet, or 0 if it is not tracked
+  static TrackedPacket* FindTrackedPacket (TrackedFlow &flow, FlowPacketId packetId);
+  /// Start tracking a packet of a flow, or restart if it was tracked
+  /// \param flow the flow
+  /// \param packetId the packet id
+  /// \returns the packet
+  static TrackedPacket& TrackPacket (TrackedFlow &flow, FlowPacketId packetId);
+  /// Stop tracking a packet of a flow
+  /// \param flow the flow
+  /// \param packetId the packet id
+  /// \param packet the packet, from FindTrackedPacket or TrackPacket
+  static void UntrackPacket (TrackedFlow &flow, FlowPacketId packetId, TrackedPacket *packet);
+  /// Move the packets of the window older than a packet id to the stragglers
+  /// \param flow the flow
+  /// \param packetId the packet id of the new first slot of the window
+  static void EvictPackets (TrackedFlow &flow, FlowPacketId packetId);
+  /// Shrink the window to the oldest packet still tracked, and release
+  /// the ring if it drains
+  /// \param flow the flow
+  static void AdvanceHead (TrackedFlow &flow);
+
+  /// Remember that the stats of a flow changed, for the delta export
+  /// \param flow the flow
+  void MarkChanged (TrackedFlow &flow);
+  /// Periodic function to write the flows changed since the last interval
+  void PeriodicDeltaExport ();
 
   /// Periodic function to check for lost packets and prune statistics
   void PeriodicCheckForLostPackets ();
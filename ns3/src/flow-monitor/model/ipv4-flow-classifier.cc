@@ -147,36 +147,45 @@ Ipv4FlowClassifier::Classify (const Ipv4Header &ipHeader, Ptr<const Packet> ipPa
   tuple.sourcePort = srcPort;
   tuple.destinationPort = dstPort;
 
-  // try to insert the tuple, but check if it already exists
-  std::pair<std::map<FiveTuple, FlowId>::iterator, bool> insert
-    = m_flowMap.insert (std::pair<FiveTuple, FlowId> (tuple, 0));
-
-  // if the insertion succeeded, we need to assign this tuple a new flow identifier
-  if (insert.second)
+#ifdef NS3_MTP
+  CriticalSection cs (m_lock);
+#endif
+  // find the flow of the tuple, or assign it a new flow identifier
+  uint32_t index = m_flowTable.Find (tuple);
+  if (index == m_flowTable.NOT_FOUND)
     {
       FlowId newFlowId = GetNewFlowId ();
-      insert.first->second = newFlowId;
-      m_flowPktIdMap[newFlowId] = 0;
-      m_flowDscpMap[newFlowId];
+      index = m_flows.size ();
+      NS_ASSERT (newFlowId == index + 1);
+      m_flowTable.Insert (tuple, index);
+      m_flows.push_back (Flow ());
+      m_flows.back ().tuple = tuple;
+      m_flows.back ().lastPacketId = 0;
     }
   else
     {
-      m_flowPktIdMap[insert.first->second] ++;
+      m_flows[index].lastPacketId++;
     }
+  Flow &flow = m_flows[index];
 
   // increment the counter of packets with the same DSCP value
   Ipv4Header::DscpType dscp = ipHeader.GetDscp ();
-  std::pair<std::map<Ipv4Header::DscpType, uint32_t>::iterator, bool> dscpInserter
-    = m_flowDscpMap[insert.first->second].insert (std::pair<Ipv4Header::DscpType, uint32_t> (dscp, 1));
-
-  // if the insertion did not succeed, we need to increment the counter
-  if (!dscpInserter.second)
+  std::vector<std::pair<Ipv4Header::DscpType, uint32_t> >::iterator dscpCount = flow.dscpCounts.begin ();
+  while (dscpCount != flow.dscpCounts.end () && dscpCount->first < dscp)
     {
-      m_flowDscpMap[insert.first->second][dscp] ++;
+      dscpCount++;
+    }
+  if (dscpCount != flow.dscpCounts.end () && dscpCount->first == dscp)
+    {
+      dscpCount->second++;
+    }
+  else
+    {
+      flow.dscpCounts.insert (dscpCount, std::make_pair (dscp, 1));
     }
 
-  *out_flowId = insert.first->second;
-  *out_packetId = m_flowPktIdMap[*out_flowId];
+  *out_flowId = index + 1;
+  *out_packetId = flow.lastPacketId;
 
   return true;
 }
@@ -185,17 +194,25 @@ Ipv4FlowClassifier::Classify (const Ipv4Header &ipHeader, Ptr<const Packet> ipPa
 Ipv4FlowClassifier::FiveTuple
 Ipv4FlowClassifier::FindFlow (FlowId flowId) const
 {
-  for (std::map<FiveTuple, FlowId>::const_iterator
-       iter = m_flowMap.begin (); iter != m_flowMap.end (); iter++)
+  if (flowId == 0 || flowId > m_flows.size ())
     {
-      if (iter->second == flowId)
-        {
-          return iter->first;
-        }
+      NS_FATAL_ERROR ("Could not find the flow with ID " << flowId);
     }
-  NS_FATAL_ERROR ("Could not find the flow with ID " << flowId);
-  FiveTuple retval = { Ipv4Address::GetZero (), Ipv4Address::GetZero (), 0, 0, 0 };
-  return retval;
+  return m_flows[flowId - 1].tuple;
+}
+
+uint32_t
+Ipv4FlowClassifier::FiveTupleHash::operator() (const FiveTuple &tuple) const
+{
+  uint32_t hash = tuple.sourceAddress.Get ();
+  hash = hash * 0x9e3779b1 ^ tuple.destinationAddress.Get ();
+  hash = hash * 0x9e3779b1 ^ ((uint32_t (tuple.sourcePort) << 16) | tuple.destinationPort);
+  hash = hash * 0x9e3779b1 ^ tuple.protocol;
+  // the table uses the low bits: mix the high ones into them
+  hash ^= hash >> 15;
+  hash *= 0x2c1b3c6d;
+  hash ^= hash >> 12;
+  return hash;
 }
 
 bool
@@ -208,15 +225,12 @@ Ipv4FlowClassifier::SortByCount::operator() (std::pair<Ipv4Header::DscpType, uin
 std::vector<std::pair<Ipv4Header::DscpType, uint32_t> >
 Ipv4FlowClassifier::GetDscpCounts (FlowId flowId) const
 {
-  std::map<FlowId, std::map<Ipv4Header::DscpType, uint32_t> >::const_iterator flow
-    = m_flowDscpMap.find (flowId);
-
-  if (flow == m_flowDscpMap.end ())
+  if (flowId == 0 || flowId > m_flows.size ())
     {
       NS_FATAL_ERROR ("Could not find the flow with ID " << flowId);
     }
 
-  std::vector<std::pair<Ipv4Header::DscpType, uint32_t> > v (flow->second.begin (), flow->second.end ());
+  std::vector<std::pair<Ipv4Header::DscpType, uint32_t> > v = m_flows[flowId - 1].dscpCounts;
   std::sort (v.begin (), v.end (), SortByCount ());
   return v;
 }
@@ -226,9 +240,17 @@ Ipv4FlowClassifier::SerializeToXmlStream (std::ostream &os, uint16_t indent) con
 {
   Indent (os, indent); os << "<Ipv4FlowClassifier>\n";
 
+  // list the flows in the order of their FiveTuples
+  std::vector<std::pair<FiveTuple, FlowId> > flows;
+  for (uint32_t i = 0; i < m_flows.size (); i++)
+    {
+      flows.push_back (std::make_pair (m_flows[i].tuple, i + 1));
+    }
+  std::sort (flows.begin (), flows.end ());
+
   indent += 2;
-  for (std::map<FiveTuple, FlowId>::const_iterator
-       iter = m_flowMap.begin (); iter != m_flowMap.end (); iter++)
+  for (std::vector<std::pair<FiveTuple, FlowId> >::const_iterator
+       iter = flows.begin (); iter != flows.end (); iter++)
     {
       Indent (os, indent);
       os << "<Flow flowId=\"" << iter->second << "\""
@@ -239,17 +261,12 @@ Ipv4FlowClassifier::SerializeToXmlStream (std::ostream &os, uint16_t indent) con
          << " destinationPort=\"" << iter->first.destinationPort << "\">\n";
 
       indent += 2;
-      std::map<FlowId, std::map<Ipv4Header::DscpType, uint32_t> >::const_iterator flow
-        = m_flowDscpMap.find (iter->second);
-
-      if (flow != m_flowDscpMap.end ())
+      const Flow &flow = m_flows[iter->second - 1];
+      for (std::vector<std::pair<Ipv4Header::DscpType, uint32_t> >::const_iterator i = flow.dscpCounts.begin (); i != flow.dscpCounts.end (); i++)
         {
-          for (std::map<Ipv4Header::DscpType, uint32_t>::const_iterator i = flow->second.begin (); i != flow->second.end (); i++)
-            {
-              Indent (os, indent);
-              os << "<Dscp value=\"0x" << std::hex << static_cast<uint32_t> (i->first) << "\""
-                 << " packets=\"" << std::dec << i->second << "\" />\n";
-            }
+          Indent (os, indent);
+          os << "<Dscp value=\"0x" << std::hex << static_cast<uint32_t> (i->first) << "\""
+             << " packets=\"" << std::dec << i->second << "\" />\n";
         }
 
       indent -= 2;
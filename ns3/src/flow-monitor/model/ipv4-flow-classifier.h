@@ -22,10 +22,14 @@
 #define IPV4_FLOW_CLASSIFIER_H
 
 #include <stdint.h>
-#include <map>
+#include <vector>
 
 #include "ns3/ipv4-header.h"
 #include "ns3/flow-classifier.h"
+#include "ns3/flow-hash-table.h"
+#ifdef NS3_MTP
+#include "ns3/system-mutex.h"
+#endif
 
 namespace ns3 {
 
@@ -92,12 +96,31 @@ public:
 
 private:
 
-  /// Map to Flows Identifiers to FlowIds
-  std::map<FiveTuple, FlowId> m_flowMap;
-  /// Map to FlowIds to FlowPacketId
-  std::map<FlowId, FlowPacketId> m_flowPktIdMap;
-  /// Map FlowIds to (DSCP value, packet count) pairs
-  std::map<FlowId, std::map<Ipv4Header::DscpType, uint32_t> > m_flowDscpMap;
+  /// Hash of a FiveTuple, for the FlowHashTable
+  struct FiveTupleHash
+  {
+    /// \param tuple the FiveTuple
+    /// \returns the hash of the tuple
+    uint32_t operator() (const FiveTuple &tuple) const;
+  };
+
+  /// A flow and the packets seen so far
+  struct Flow
+  {
+    FiveTuple tuple;             //!< Five tuple of the flow
+    FlowPacketId lastPacketId;   //!< Identifier of the last packet of the flow
+    /// (DSCP value, packet count) pairs, sorted by DSCP value
+    std::vector<std::pair<Ipv4Header::DscpType, uint32_t> > dscpCounts;
+  };
+
+  /// Flows, by FlowId - 1
+  std::vector<Flow> m_flows;
+  /// Map the FiveTuples of the flows to their index in m_flows
+  FlowHashTable<FiveTuple, FiveTupleHash> m_flowTable;
+#ifdef NS3_MTP
+  /// Serializes the classification of the packets of all the simulation threads
+  SystemMutex m_lock;
+#endif
 
 };
 
@@ -148,6 +148,9 @@ Ipv6FlowClassifier::Classify (const Ipv6Header &ipHeader, Ptr<const Packet> ipPa
   tuple.sourcePort = srcPort;
   tuple.destinationPort = dstPort;
 
+#ifdef NS3_MTP
+  CriticalSection cs (m_lock);
+#endif
   // try to insert the tuple, but check if it already exists
   std::pair<std::map<FiveTuple, FlowId>::iterator, bool> insert
     = m_flowMap.insert (std::pair<FiveTuple, FlowId> (tuple, 0));
@@ -27,6 +27,9 @@
 
 #include "ns3/ipv6-header.h"
 #include "ns3/flow-classifier.h"
+#ifdef NS3_MTP
+#include "ns3/system-mutex.h"
+#endif
 
 namespace ns3 {
 
@@ -99,6 +102,10 @@ private:
   std::map<FlowId, FlowPacketId> m_flowPktIdMap;
   /// Map FlowIds to (DSCP value, packet count) pairs
   std::map<FlowId, std::map<Ipv6Header::DscpType, uint32_t> > m_flowDscpMap;
+#ifdef NS3_MTP
+  /// Serializes the classification of the packets of all the simulation threads
+  SystemMutex m_lock;
+#endif
 
 };
 
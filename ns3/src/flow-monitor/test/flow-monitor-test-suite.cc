@@ -0,0 +1,458 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/flow-monitor.h"
+#include "ns3/flow-probe.h"
+#include "ns3/flow-hash-table.h"
+#include "ns3/columnar-trace.h"
+#include <cstdio>
+
+/**
+ * \file
+ * \ingroup flow-monitor-tests
+ * FlowMonitor test suite.
+ */
+
+/**
+ * \ingroup flow-monitor
+ * \defgroup flow-monitor-tests FlowMonitor tests
+ */
+
+using namespace ns3;
+
+/**
+ * \ingroup flow-monitor-tests
+ *
+ * \brief A hash that sends the keys to a few slots, so that they collide.
+ */
+struct CollidingHash
+{
+  /**
+   * \param key the key
+   * \returns the hash of the key
+   */
+  uint32_t operator() (uint32_t key) const
+  {
+    return key % 3;
+  }
+};
+
+/**
+ * \ingroup flow-monitor-tests
+ *
+ * \brief Check that FlowHashTable finds the flows it holds, through
+ * collisions and growth.
+ */
+class FlowHashTableTestCase : public TestCase
+{
+public:
+  FlowHashTableTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FlowHashTableTestCase::FlowHashTableTestCase ()
+  : TestCase ("Check that FlowHashTable finds the flows it holds")
+{
+}
+
+void
+FlowHashTableTestCase::DoRun (void)
+{
+  typedef FlowHashTable<uint32_t, CollidingHash> Table;
+  Table table;
+  NS_TEST_EXPECT_MSG_EQ (table.Find (7), Table::NOT_FOUND, "Flow found in an empty table");
+
+  // Keys far apart, and an index unrelated to the key
+  const uint32_t n = 1000;
+  for (uint32_t i = 0; i < n; i++)
+    {
+      table.Insert (i * 1000003, n - i);
+      NS_TEST_ASSERT_MSG_EQ (table.GetSize (), i + 1, "Wrong size after inserting flow " << i);
+    }
+  for (uint32_t i = 0; i < n; i++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (table.Find (i * 1000003), n - i, "Wrong index of flow " << i);
+    }
+  NS_TEST_EXPECT_MSG_EQ (table.Find (1), Table::NOT_FOUND, "Unknown flow found");
+  NS_TEST_EXPECT_MSG_EQ (table.Find (n * 1000003), Table::NOT_FOUND, "Unknown flow found");
+}
+
+/**
+ * \ingroup flow-monitor-tests
+ *
+ * \brief A probe that only forwards the reports of the test.
+ */
+class TestFlowProbe : public FlowProbe
+{
+public:
+  /**
+   * Constructor
+   * \param monitor the FlowMonitor
+   */
+  TestFlowProbe (Ptr<FlowMonitor> monitor)
+    : FlowProbe (monitor)
+  {
+  }
+};
+
+/**
+ * \ingroup flow-monitor-tests
+ *
+ * \brief Check that FlowMonitor finds the packets of a flow whatever the
+ * order in which they come, and counts those that expire as lost.
+ *
+ * Each flow exercises a case of the ring of tracked packets: wrap-around
+ * of the ring and of the packet ids, growth before and after the window,
+ * a window full of packets in flight, and stragglers that the window
+ * leaves behind, received late or lost.
+ */
+class FlowMonitorTrackingTestCase : public TestCase
+{
+public:
+  FlowMonitorTrackingTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /// Send the packets, and receive most of them, at 0 s
+  void Send (void);
+  /// Receive a straggler at 0.5 s
+  void ReceiveLate (void);
+  /// Check the losses at 1 s
+  void CheckLosses (void);
+  /**
+   * Get the stats of a flow
+   * \param flowId the flow
+   * \returns the stats
+   */
+  FlowMonitor::FlowStats GetStats (FlowId flowId) const;
+
+  Ptr<FlowMonitor> m_monitor; //!< The FlowMonitor
+  Ptr<FlowProbe> m_probe;     //!< The probe reporting the packets
+};
+
+FlowMonitorTrackingTestCase::FlowMonitorTrackingTestCase ()
+  : TestCase ("Check that FlowMonitor tracks the packets of a flow in any order")
+{
+}
+
+FlowMonitor::FlowStats
+FlowMonitorTrackingTestCase::GetStats (FlowId flowId) const
+{
+  FlowMonitor::FlowStatsContainerCI i = m_monitor->GetFlowStats ().find (flowId);
+  NS_ASSERT (i != m_monitor->GetFlowStats ().end ());
+  return i->second;
+}
+
+void
+FlowMonitorTrackingTestCase::Send (void)
+{
+  // Flow 1: ten packets in flight, through many turns of the ring
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      m_monitor->ReportFirstTx (m_probe, 1, i, 100);
+      if (i >= 10)
+        {
+          m_monitor->ReportLastRx (m_probe, 1, i - 10, 100);
+        }
+    }
+  for (uint32_t i = 990; i < 1000; i++)
+    {
+      m_monitor->ReportLastRx (m_probe, 1, i, 100);
+    }
+
+  // Flow 2: the packet ids wrap around
+  for (uint32_t i = 0; i < 64; i++)
+    {
+      m_monitor->ReportFirstTx (m_probe, 2, 0xffffffe0 + i, 100);
+      if (i >= 3)
+        {
+          m_monitor->ReportLastRx (m_probe, 2, 0xffffffe0 + i - 3, 100);
+        }
+    }
+  for (uint32_t i = 61; i < 64; i++)
+    {
+      m_monitor->ReportLastRx (m_probe, 2, 0xffffffe0 + i, 100);
+    }
+
+  // Flow 3: the ring grows for the packets sent after the window, then
+  // before it, then after it again
+  for (uint32_t i = 100; i < 140; i++)
+    {
+      m_monitor->ReportFirstTx (m_probe, 3, i, 100);
+    }
+  for (uint32_t i = 100; i > 60; i--)
+    {
+      m_monitor->ReportFirstTx (m_probe, 3, i - 1, 100);
+    }
+  for (uint32_t i = 140; i < 200; i++)
+    {
+      m_monitor->ReportFirstTx (m_probe, 3, i, 100);
+    }
+  for (uint32_t i = 60; i < 200; i += 2)
+    {
+      m_monitor->ReportLastRx (m_probe, 3, i, 100);
+    }
+  for (uint32_t i = 61; i < 200; i += 2)
+    {
+      m_monitor->ReportLastRx (m_probe, 3, i, 100);
+    }
+  m_monitor->ReportLastRx (m_probe, 3, 100, 100);
+
+  // Flow 4: a window full of packets in flight, received in reverse,
+  // then one packet in flight at a time, after which the ring shrinks, and a
+  // full window again
+  for (uint32_t i = 0; i < 1000; i++)
+    {
+      m_monitor->ReportFirstTx (m_probe, 4, i, 100);
+    }
+  for (uint32_t i = 1000; i > 0; i--)
+    {
+      m_monitor->ReportLastRx (m_probe, 4, i - 1, 100);
+    }
+  for (uint32_t i = 1000; i < 1100; i++)
+    {
+      m_monitor->ReportFirstTx (m_probe, 4, i, 100);
+      m_monitor->ReportLastRx (m_probe, 4, i, 100);
+    }
+  for (uint32_t i = 1100; i < 1200; i++)
+    {
+      m_monitor->ReportFirstTx (m_probe, 4, i, 100);
+    }
+  for (uint32_t i = 1100; i < 1200; i++)
+    {
+      m_monitor->ReportLastRx (m_probe, 4, i, 100);
+    }
+
+  // Flow 5: two stragglers, then packets received as they are sent;
+  // a third one is dropped after the window moved on
+  m_monitor->ReportFirstTx (m_probe, 5, 0, 100);
+  m_monitor->ReportFirstTx (m_probe, 5, 1, 100);
+  m_monitor->ReportFirstTx (m_probe, 5, 2, 100);
+  for (uint32_t i = 3; i < 2000; i++)
+    {
+      m_monitor->ReportFirstTx (m_probe, 5, i, 100);
+      m_monitor->ReportLastRx (m_probe, 5, i, 100);
+    }
+  m_monitor->ReportDrop (m_probe, 5, 2, 100, 0);
+  m_monitor->ReportLastRx (m_probe, 5, 2, 100);
+}
+
+void
+FlowMonitorTrackingTestCase::ReceiveLate (void)
+{
+  m_monitor->ReportLastRx (m_probe, 5, 1, 100);
+}
+
+void
+FlowMonitorTrackingTestCase::CheckLosses (void)
+{
+  m_monitor->CheckForLostPackets (MilliSeconds (500));
+  // Packet 0 of flow 5 is lost now, and not found later
+  m_monitor->ReportLastRx (m_probe, 5, 0, 100);
+}
+
+void
+FlowMonitorTrackingTestCase::DoRun (void)
+{
+  m_monitor = CreateObject<FlowMonitor> ();
+  m_probe = CreateObject<TestFlowProbe> (m_monitor);
+  m_monitor->StartRightNow ();
+
+  Simulator::Schedule (Seconds (0), &FlowMonitorTrackingTestCase::Send, this);
+  Simulator::Schedule (MilliSeconds (500), &FlowMonitorTrackingTestCase::ReceiveLate, this);
+  Simulator::Schedule (Seconds (1), &FlowMonitorTrackingTestCase::CheckLosses, this);
+  Simulator::Stop (Seconds (2));
+  Simulator::Run ();
+
+  FlowMonitor::FlowStats stats = GetStats (1);
+  NS_TEST_EXPECT_MSG_EQ (stats.txPackets, 1000, "Flow 1 sent the wrong number of packets");
+  NS_TEST_EXPECT_MSG_EQ (stats.rxPackets, 1000, "Flow 1 packets not found");
+  NS_TEST_EXPECT_MSG_EQ (stats.lostPackets, 0, "Flow 1 packets lost");
+
+  stats = GetStats (2);
+  NS_TEST_EXPECT_MSG_EQ (stats.rxPackets, 64, "Flow 2 packets not found across the id wrap-around");
+  NS_TEST_EXPECT_MSG_EQ (stats.lostPackets, 0, "Flow 2 packets lost");
+
+  stats = GetStats (3);
+  NS_TEST_EXPECT_MSG_EQ (stats.rxPackets, 140, "Flow 3 packets not found, or found twice");
+  NS_TEST_EXPECT_MSG_EQ (stats.lostPackets, 0, "Flow 3 packets lost");
+
+  stats = GetStats (4);
+  NS_TEST_EXPECT_MSG_EQ (stats.rxPackets, 1200, "Flow 4 packets not found");
+  NS_TEST_EXPECT_MSG_EQ (stats.lostPackets, 0, "Flow 4 packets lost");
+
+  stats = GetStats (5);
+  NS_TEST_EXPECT_MSG_EQ (stats.txPackets, 2000, "Flow 5 sent the wrong number of packets");
+  NS_TEST_EXPECT_MSG_EQ (stats.rxPackets, 1998, "Flow 5 late packet not found, or lost one found");
+  NS_TEST_EXPECT_MSG_EQ (stats.lostPackets, 2, "Flow 5 should have one drop and one expired packet");
+  NS_TEST_EXPECT_MSG_EQ (stats.delaySum, MilliSeconds (500), "Flow 5 late packet has the wrong delay");
+
+  Simulator::Destroy ();
+  m_probe = 0;
+  m_monitor->Dispose ();
+  m_monitor = 0;
+}
+
+/**
+ * \ingroup flow-monitor-tests
+ *
+ * \brief Check that the delta export writes, at the end of each interval,
+ * one row for each flow that changed in it, in the order they first
+ * changed.
+ *
+ * In the first second, flow 1 sends two packets and receives one, and
+ * flow 2 sends one. In the next second, flow 2 receives its packet and
+ * then flow 1 drops its other one. Nothing changes in the third second.
+ */
+class FlowMonitorDeltaExportTestCase : public TestCase
+{
+public:
+  FlowMonitorDeltaExportTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FlowMonitorDeltaExportTestCase::FlowMonitorDeltaExportTestCase ()
+  : TestCase ("Check that FlowMonitor exports the flows changed in each interval")
+{
+}
+
+void
+FlowMonitorDeltaExportTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("flow-monitor-delta-test.cols");
+  Ptr<ColumnarTraceWriter> writer = Create<ColumnarTraceWriter> (filename);
+
+  Ptr<FlowMonitor> monitor = CreateObject<FlowMonitor> ();
+  Ptr<FlowProbe> probe = CreateObject<TestFlowProbe> (monitor);
+  monitor->StartRightNow ();
+  monitor->EnableDeltaExport (writer, Seconds (1));
+
+  Simulator::Schedule (MilliSeconds (100), &FlowMonitor::ReportFirstTx, monitor, probe, 1, 0, 100);
+  Simulator::Schedule (MilliSeconds (100), &FlowMonitor::ReportFirstTx, monitor, probe, 1, 1, 200);
+  Simulator::Schedule (MilliSeconds (300), &FlowMonitor::ReportFirstTx, monitor, probe, 2, 0, 300);
+  Simulator::Schedule (MilliSeconds (400), &FlowMonitor::ReportLastRx, monitor, probe, 1, 0, 100);
+  Simulator::Schedule (MilliSeconds (1500), &FlowMonitor::ReportLastRx, monitor, probe, 2, 0, 300);
+  Simulator::Schedule (MilliSeconds (1700), &FlowMonitor::ReportDrop, monitor, probe, 1, 1, 200, 0);
+  Simulator::Stop (MilliSeconds (3500));
+  Simulator::Run ();
+  Simulator::Destroy ();
+
+  // The remaining rows are written when the last reference goes away
+  probe = 0;
+  monitor->Dispose ();
+  monitor = 0;
+  writer = 0;
+
+  ColumnarTraceReader reader (filename);
+  NS_TEST_ASSERT_MSG_EQ (reader.HasSeries ("flows"), true, "Missing series");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetNRows ("flows"), 4, "Wrong number of rows");
+
+  // One expected row per line, in the order of the columns
+  const char *columns[] = { "time", "flowId", "txBytes", "rxBytes", "txPackets",
+                            "rxPackets", "lostPackets", "delaySum", "jitterSum" };
+  double expected[4][9] = {
+    { 1, 1, 300, 100, 2, 1, 0, 0.3, 0 },
+    { 1, 2, 300, 0, 1, 0, 0, 0, 0 },
+    { 2, 2, 300, 300, 1, 1, 0, 1.2, 0 },
+    { 2, 1, 300, 100, 2, 1, 1, 0.3, 0 },
+  };
+  for (uint32_t c = 0; c < 9; c++)
+    {
+      std::vector<double> column = reader.GetColumn ("flows", columns[c]);
+      for (uint32_t r = 0; r < 4; r++)
+        {
+          NS_TEST_EXPECT_MSG_EQ_TOL (column[r], expected[r][c], 1e-9,
+                                     "Wrong " << columns[c] << " in row " << r);
+        }
+    }
+
+  std::remove (filename.c_str ());
+}
+
+/**
+ * \ingroup flow-monitor-tests
+ *
+ * \brief Check that the reports of a flow that was never transmitted, as
+ * seen by a monitor installed only on the receivers or started while the
+ * packets were in flight, do not add the flow to the stats.
+ */
+class FlowMonitorUnknownFlowTestCase : public TestCase
+{
+public:
+  FlowMonitorUnknownFlowTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+FlowMonitorUnknownFlowTestCase::FlowMonitorUnknownFlowTestCase ()
+  : TestCase ("Check that FlowMonitor ignores the reports of unknown flows")
+{
+}
+
+void
+FlowMonitorUnknownFlowTestCase::DoRun (void)
+{
+  Ptr<FlowMonitor> monitor = CreateObject<FlowMonitor> ();
+  Ptr<FlowProbe> probe = CreateObject<TestFlowProbe> (monitor);
+  monitor->StartRightNow ();
+
+  Simulator::Schedule (MilliSeconds (100), &FlowMonitor::ReportForwarding, monitor, probe, 1, 0, 100);
+  Simulator::Schedule (MilliSeconds (200), &FlowMonitor::ReportLastRx, monitor, probe, 2, 0, 100);
+  Simulator::Schedule (MilliSeconds (300), &FlowMonitor::ReportDrop, monitor, probe, 3, 0, 100, 0);
+  Simulator::Stop (Seconds (1));
+  Simulator::Run ();
+
+  NS_TEST_EXPECT_MSG_EQ (monitor->GetFlowStats ().size (), 0, "The reports of unknown flows created stats");
+  monitor->CheckForLostPackets ();
+  NS_TEST_EXPECT_MSG_EQ (monitor->GetFlowStats ().size (), 0, "The loss check created stats");
+
+  Simulator::Destroy ();
+  probe = 0;
+  monitor->Dispose ();
+  monitor = 0;
+}
+
+/**
+ * \ingroup flow-monitor-tests
+ *
+ * \brief FlowMonitor TestSuite
+ */
+class FlowMonitorTestSuite : public TestSuite
+{
+public:
+  FlowMonitorTestSuite ();
+};
+
+FlowMonitorTestSuite::FlowMonitorTestSuite ()
+  : TestSuite ("flow-monitor", UNIT)
+{
+  AddTestCase (new FlowHashTableTestCase, TestCase::QUICK);
+  AddTestCase (new FlowMonitorTrackingTestCase, TestCase::QUICK);
+  AddTestCase (new FlowMonitorDeltaExportTestCase, TestCase::QUICK);
+  AddTestCase (new FlowMonitorUnknownFlowTestCase, TestCase::QUICK);
+}
+
+static FlowMonitorTestSuite g_flowMonitorTestSuite; //!< Static variable for test initialization
@@ -29,7 +29,7 @@ namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("Ipv4EndPointDemux");
 
 Ipv4EndPointDemux::Ipv4EndPointDemux ()
-  : m_ephemeral (49152), m_portLast (65535), m_portFirst (49152)
+  : m_ephemeral (49152), m_portLast (65535), m_portFirst (49152), m_nEndPoints (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -37,41 +37,126 @@ Ipv4EndPointDemux::Ipv4EndPointDemux ()
 Ipv4EndPointDemux::~Ipv4EndPointDemux ()
 {
   NS_LOG_FUNCTION (this);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  EndPoints endPoints = GetAllEndPoints ();
+  m_ports.clear ();
+  m_nEndPoints = 0;
+  for (EndPointsI i = endPoints.begin (); i != endPoints.end (); i++) 
     {
       Ipv4EndPoint *endPoint = *i;
+      endPoint->m_demux = 0;
       delete endPoint;
     }
-  m_endPoints.clear ();
+}
+
+uint64_t
+Ipv4EndPointDemux::PeerKey (Ipv4Address address, uint16_t port)
+{
+  return (static_cast<uint64_t> (address.Get ()) << 16) | port;
 }
 
 bool
-Ipv4EndPointDemux::LookupPortLocal (uint16_t port)
+Ipv4EndPointDemux::HasPeer (Ipv4Address address, uint16_t port)
 {
-  NS_LOG_FUNCTION (this << port);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  return port != 0 && address != Ipv4Address::GetAny ();
+}
+
+void
+Ipv4EndPointDemux::Link (Ipv4EndPoint *endPoint)
+{
+  NS_LOG_FUNCTION (this << endPoint);
+  PortEndPoints &port = m_ports[endPoint->GetLocalPort ()];
+  if (HasPeer (endPoint->GetPeerAddress (), endPoint->GetPeerPort ()))
+    {
+      uint64_t key = PeerKey (endPoint->GetPeerAddress (), endPoint->GetPeerPort ());
+      port.m_connected.insert (std::make_pair (key, endPoint));
+    }
+  else
+    {
+      port.m_wildcard.push_back (endPoint);
+    }
+  endPoint->m_demux = this;
+  m_nEndPoints++;
+}
+
+bool
+Ipv4EndPointDemux::Unlink (Ipv4EndPoint *endPoint)
+{
+  NS_LOG_FUNCTION (this << endPoint);
+  PortMap::iterator port = m_ports.find (endPoint->GetLocalPort ());
+  if (port == m_ports.end ())
+    {
+      return false;
+    }
+  bool found = false;
+  if (HasPeer (endPoint->GetPeerAddress (), endPoint->GetPeerPort ()))
     {
-      if ((*i)->GetLocalPort  () == port) 
+      uint64_t key = PeerKey (endPoint->GetPeerAddress (), endPoint->GetPeerPort ());
+      auto range = port->second.m_connected.equal_range (key);
+      for (auto i = range.first; i != range.second; i++)
         {
-          return true;
+          if (i->second == endPoint)
+            {
+              port->second.m_connected.erase (i);
+              found = true;
+              break;
+            }
         }
     }
-  return false;
+  else
+    {
+      for (EndPointsI i = port->second.m_wildcard.begin (); i != port->second.m_wildcard.end (); i++)
+        {
+          if (*i == endPoint)
+            {
+              port->second.m_wildcard.erase (i);
+              found = true;
+              break;
+            }
+        }
+    }
+  if (port->second.m_wildcard.empty () && port->second.m_connected.empty ())
+    {
+      m_ports.erase (port);
+    }
+  if (found)
+    {
+      m_nEndPoints--;
+    }
+  return found;
+}
+
+bool
+Ipv4EndPointDemux::LookupPortLocal (uint16_t port)
+{
+  NS_LOG_FUNCTION (this << port);
+  return m_ports.find (port) != m_ports.end ();
 }
 
 bool
 Ipv4EndPointDemux::LookupLocal (Ptr<NetDevice> boundNetDevice, Ipv4Address addr, uint16_t port)
 {
   NS_LOG_FUNCTION (this << addr << port);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  PortMap::iterator portEndPoints = m_ports.find (port);
+  if (portEndPoints == m_ports.end ())
     {
-      if ((*i)->GetLocalPort () == port &&
-          (*i)->GetLocalAddress () == addr &&
+      return false;
+    }
+  for (EndPointsI i = portEndPoints->second.m_wildcard.begin (); i != portEndPoints->second.m_wildcard.end (); i++) 
+    {
+      if ((*i)->GetLocalAddress () == addr &&
           (*i)->GetBoundNetDevice () == boundNetDevice)
         {
           return true;
         }
     }
+  for (auto i = portEndPoints->second.m_connected.begin (); i != portEndPoints->second.m_connected.end (); i++) 
+    {
+      if (i->second->GetLocalAddress () == addr &&
+          i->second->GetBoundNetDevice () == boundNetDevice)
+        {
+          return true;
+        }
+    }
   return false;
 }
 
@@ -86,8 +171,8 @@ Ipv4EndPointDemux::Allocate (void)
       return 0;
     }
   Ipv4EndPoint *endPoint = new Ipv4EndPoint (Ipv4Address::GetAny (), port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
+  Link (endPoint);
+  NS_LOG_DEBUG ("Now have >>" << m_nEndPoints << "<< endpoints.");
   return endPoint;
 }
 
@@ -102,8 +187,8 @@ Ipv4EndPointDemux::Allocate (Ipv4Address address)
       return 0;
     }
   Ipv4EndPoint *endPoint = new Ipv4EndPoint (address, port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
+  Link (endPoint);
+  NS_LOG_DEBUG ("Now have >>" << m_nEndPoints << "<< endpoints.");
   return endPoint;
 }
 
@@ -125,8 +210,8 @@ Ipv4EndPointDemux::Allocate (Ptr<NetDevice> boundNetDevice, Ipv4Address address,
       return 0;
     }
   Ipv4EndPoint *endPoint = new Ipv4EndPoint (address, port);
-  m_endPoints.push_back (endPoint);
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
+  Link (endPoint);
+  NS_LOG_DEBUG ("Now have >>" << m_nEndPoints << "<< endpoints.");
   return endPoint;
 }
 
@@ -136,13 +221,34 @@ Ipv4EndPointDemux::Allocate (Ptr<NetDevice> boundNetDevice,
                              Ipv4Address peerAddress, uint16_t peerPort)
 {
   NS_LOG_FUNCTION (this << localAddress << localPort << peerAddress << peerPort << boundNetDevice);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  PortMap::iterator port = m_ports.find (localPort);
+  if (port != m_ports.end ())
     {
-      if ((*i)->GetLocalPort () == localPort &&
-          (*i)->GetLocalAddress () == localAddress &&
-          (*i)->GetPeerPort () == peerPort &&
-          (*i)->GetPeerAddress () == peerAddress &&
-          ((*i)->GetBoundNetDevice () == boundNetDevice || (*i)->GetBoundNetDevice () == 0))
+      auto duplicate = [&] (Ipv4EndPoint *endP)
+        {
+          return endP->GetLocalAddress () == localAddress &&
+                 endP->GetPeerPort () == peerPort &&
+                 endP->GetPeerAddress () == peerAddress &&
+                 (endP->GetBoundNetDevice () == boundNetDevice || endP->GetBoundNetDevice () == 0);
+        };
+      // A duplicate has the same peer, so it is in the same container
+      bool found = false;
+      if (HasPeer (peerAddress, peerPort))
+        {
+          auto range = port->second.m_connected.equal_range (PeerKey (peerAddress, peerPort));
+          for (auto i = range.first; i != range.second && !found; i++)
+            {
+              found = duplicate (i->second);
+            }
+        }
+      else
+        {
+          for (EndPointsI i = port->second.m_wildcard.begin (); i != port->second.m_wildcard.end () && !found; i++)
+            {
+              found = duplicate (*i);
+            }
+        }
+      if (found)
         {
           NS_LOG_WARN ("Duplicated endpoint.");
           return 0;
@@ -150,9 +256,9 @@ Ipv4EndPointDemux::Allocate (Ptr<NetDevice> boundNetDevice,
     }
   Ipv4EndPoint *endPoint = new Ipv4EndPoint (localAddress, localPort);
   endPoint->SetPeer (peerAddress, peerPort);
-  m_endPoints.push_back (endPoint);
+  Link (endPoint);
 
-  NS_LOG_DEBUG ("Now have >>" << m_endPoints.size () << "<< endpoints.");
+  NS_LOG_DEBUG ("Now have >>" << m_nEndPoints << "<< endpoints.");
 
   return endPoint;
 }
@@ -161,14 +267,10 @@ void
 Ipv4EndPointDemux::DeAllocate (Ipv4EndPoint *endPoint)
 {
   NS_LOG_FUNCTION (this << endPoint);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  if (Unlink (endPoint))
     {
-      if (*i == endPoint)
-        {
-          delete endPoint;
-          m_endPoints.erase (i);
-          break;
-        }
+      endPoint->m_demux = 0;
+      delete endPoint;
     }
 }
 
@@ -181,10 +283,13 @@ Ipv4EndPointDemux::GetAllEndPoints (void)
   NS_LOG_FUNCTION (this);
   EndPoints ret;
 
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++)
+  for (PortMap::iterator port = m_ports.begin (); port != m_ports.end (); port++)
     {
-      Ipv4EndPoint* endP = *i;
-      ret.push_back (endP);
+      ret.insert (ret.end (), port->second.m_wildcard.begin (), port->second.m_wildcard.end ());
+      for (auto i = port->second.m_connected.begin (); i != port->second.m_connected.end (); i++)
+        {
+          ret.push_back (i->second);
+        }
     }
   return ret;
 }
@@ -201,138 +306,150 @@ Ipv4EndPointDemux::Lookup (Ipv4Address daddr, uint16_t dport,
                            Ptr<Ipv4Interface> incomingInterface)
 {
   NS_LOG_FUNCTION (this << daddr << dport << saddr << sport << incomingInterface);
-  
-  EndPoints retval1; // Matches exact on local port, wildcards on others
-  EndPoints retval2; // Matches exact on local port/adder, wildcards on others
-  EndPoints retval3; // Matches all but local address
-  EndPoints retval4; // Exact match on all 4
+
+  // retval[0]: Matches exact on local port, wildcards on others
+  // retval[1]: Matches exact on local port/adder, wildcards on others
+  // retval[2]: Matches all but local address
+  // retval[3]: Exact match on all 4
+  EndPoints retval[4];
 
   NS_LOG_DEBUG ("Looking up endpoint for destination address " << daddr << ":" << dport);
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  PortMap::iterator port = m_ports.find (dport);
+  if (port != m_ports.end ())
     {
-      Ipv4EndPoint* endP = *i;
-
-      NS_LOG_DEBUG ("Looking at endpoint dport=" << endP->GetLocalPort ()
-                                                 << " daddr=" << endP->GetLocalAddress ()
-                                                 << " sport=" << endP->GetPeerPort ()
-                                                 << " saddr=" << endP->GetPeerAddress ());
-
-      if (!endP->IsRxEnabled ())
-        {
-          NS_LOG_LOGIC ("Skipping endpoint " << &endP
-                        << " because endpoint can not receive packets");
-          continue;
-        }
-
-      if (endP->GetLocalPort () != dport) 
+      for (EndPointsI i = port->second.m_wildcard.begin (); i != port->second.m_wildcard.end (); i++)
         {
-          NS_LOG_LOGIC ("Skipping endpoint " << &endP
-                                             << " because endpoint dport "
-                                             << endP->GetLocalPort ()
-                                             << " does not match packet dport " << dport);
-          continue;
+          Match (*i, daddr, saddr, sport, incomingInterface, retval);
         }
-      if (endP->GetBoundNetDevice ())
+      // The endpoints with a peer can only match the packets that it sends
+      auto range = port->second.m_connected.equal_range (PeerKey (saddr, sport));
+      for (auto i = range.first; i != range.second; i++)
         {
-          if (endP->GetBoundNetDevice () != incomingInterface->GetDevice ())
-            {
-              NS_LOG_LOGIC ("Skipping endpoint " << &endP
-                                                 << " because endpoint is bound to specific device and"
-                                                 << endP->GetBoundNetDevice ()
-                                                 << " does not match packet device " << incomingInterface->GetDevice ());
-              continue;
-            }
+          Match (i->second, daddr, saddr, sport, incomingInterface, retval);
         }
+    }
+  else
+    {
+      NS_LOG_LOGIC ("No endpoint with local port " << dport);
+    }
 
-      bool localAddressMatchesExact = false;
-      bool localAddressIsAny = false;
-      bool localAddressIsSubnetAny = false;
+  // Here we find the most exact match
+  EndPoints result;
+  if (!retval[3].empty ()) result = retval[3];
+  else if (!retval[2].empty ()) result = retval[2];
+  else if (!retval[1].empty ()) result = retval[1];
+  else result = retval[0];
+
+  NS_ABORT_MSG_IF (result.size () > 1, "Too many endpoints - perhaps you created too many sockets without binding them to different NetDevices.");
+  return result;  // might be empty if no matches
+}
 
-      // We have 3 cases:
-      // 1) Exact local / destination address match
-      // 2) Local endpoint bound to Any -> matches anything
-      // 3) Local endpoint bound to x.y.z.0 -> matches Subnet-directed broadcast packet (e.g., x.y.z.255 in a /24 net) and direct destination match.
+void
+Ipv4EndPointDemux::Match (Ipv4EndPoint *endP, Ipv4Address daddr, Ipv4Address saddr, uint16_t sport,
+                          Ptr<Ipv4Interface> incomingInterface, EndPoints retval[4])
+{
+  NS_LOG_DEBUG ("Looking at endpoint dport=" << endP->GetLocalPort ()
+                                             << " daddr=" << endP->GetLocalAddress ()
+                                             << " sport=" << endP->GetPeerPort ()
+                                             << " saddr=" << endP->GetPeerAddress ());
 
-      if (endP->GetLocalAddress () == daddr)
-        {
-          // Case 1:
-          localAddressMatchesExact = true;
-        }
-      else if (endP->GetLocalAddress () == Ipv4Address::GetAny ())
+  if (!endP->IsRxEnabled ())
+    {
+      NS_LOG_LOGIC ("Skipping endpoint " << &endP
+                    << " because endpoint can not receive packets");
+      return;
+    }
+
+  if (endP->GetBoundNetDevice ())
+    {
+      if (endP->GetBoundNetDevice () != incomingInterface->GetDevice ())
         {
-          // Case 2:
-          localAddressIsAny = true;
+          NS_LOG_LOGIC ("Skipping endpoint " << &endP
+                                             << " because endpoint is bound to specific device and"
+                                             << endP->GetBoundNetDevice ()
+                                             << " does not match packet device " << incomingInterface->GetDevice ());
+          return;
         }
-      else
+    }
+
+  bool localAddressMatchesExact = false;
+  bool localAddressIsAny = false;
+  bool localAddressIsSubnetAny = false;
+
+  // We have 3 cases:
+  // 1) Exact local / destination address match
+  // 2) Local endpoint bound to Any -> matches anything
+  // 3) Local endpoint bound to x.y.z.0 -> matches Subnet-directed broadcast packet (e.g., x.y.z.255 in a /24 net) and direct destination match.
+
+  if (endP->GetLocalAddress () == daddr)
+    {
+      // Case 1:
+      localAddressMatchesExact = true;
+    }
+  else if (endP->GetLocalAddress () == Ipv4Address::GetAny ())
+    {
+      // Case 2:
+      localAddressIsAny = true;
+    }
+  else
+    {
+      // Case 3:
+      for (uint32_t i = 0; i < incomingInterface->GetNAddresses (); i++)
         {
-          // Case 3:
-          for (uint32_t i = 0; i < incomingInterface->GetNAddresses (); i++)
+          Ipv4InterfaceAddress addr = incomingInterface->GetAddress (i);
+
+          Ipv4Address addrNetpart = addr.GetLocal ().CombineMask (addr.GetMask ());
+          if (endP->GetLocalAddress () == addrNetpart)
             {
-              Ipv4InterfaceAddress addr = incomingInterface->GetAddress (i);
+              NS_LOG_LOGIC ("Endpoint is SubnetDirectedAny " << endP->GetLocalAddress () << "/" << addr.GetMask ().GetPrefixLength ());
 
-              Ipv4Address addrNetpart = addr.GetLocal ().CombineMask (addr.GetMask ());
-              if (endP->GetLocalAddress () == addrNetpart)
+              Ipv4Address daddrNetPart = daddr.CombineMask (addr.GetMask ());
+              if (addrNetpart == daddrNetPart)
                 {
-                  NS_LOG_LOGIC ("Endpoint is SubnetDirectedAny " << endP->GetLocalAddress () << "/" << addr.GetMask ().GetPrefixLength ());
-
-                  Ipv4Address daddrNetPart = daddr.CombineMask (addr.GetMask ());
-                  if (addrNetpart == daddrNetPart)
-                    {
-                      localAddressIsSubnetAny = true;
-                    }
+                  localAddressIsSubnetAny = true;
                 }
             }
-
-          // if no match here, keep looking
-          if (!localAddressIsSubnetAny)
-            continue;
         }
 
-      bool remotePortMatchesExact = endP->GetPeerPort () == sport;
-      bool remotePortMatchesWildCard = endP->GetPeerPort () == 0;
-      bool remoteAddressMatchesExact = endP->GetPeerAddress () == saddr;
-      bool remoteAddressMatchesWildCard = endP->GetPeerAddress () == Ipv4Address::GetAny ();
+      // if no match here, keep looking
+      if (!localAddressIsSubnetAny)
+        return;
+    }
 
-      // If remote does not match either with exact or wildcard,
-      // skip this one
-      if (!(remotePortMatchesExact || remotePortMatchesWildCard))
-        continue;
-      if (!(remoteAddressMatchesExact || remoteAddressMatchesWildCard))
-        continue;
+  bool remotePortMatchesExact = endP->GetPeerPort () == sport;
+  bool remotePortMatchesWildCard = endP->GetPeerPort () == 0;
+  bool remoteAddressMatchesExact = endP->GetPeerAddress () == saddr;
+  bool remoteAddressMatchesWildCard = endP->GetPeerAddress () == Ipv4Address::GetAny ();
 
-      bool localAddressMatchesWildCard = localAddressIsAny || localAddressIsSubnetAny;
+  // If remote does not match either with exact or wildcard,
+  // skip this one
+  if (!(remotePortMatchesExact || remotePortMatchesWildCard))
+    return;
+  if (!(remoteAddressMatchesExact || remoteAddressMatchesWildCard))
+    return;
 
-      if (localAddressMatchesExact && remoteAddressMatchesExact && remotePortMatchesExact)
-        { // All 4 match - this is the case of an open TCP connection, for example.
-          NS_LOG_LOGIC ("Found an endpoint for case 4, adding " << endP->GetLocalAddress () << ":" << endP->GetLocalPort ());
-          retval4.push_back (endP);
-        }
-      if (localAddressMatchesWildCard && remoteAddressMatchesExact && remotePortMatchesExact)
-        { // All but local address - no idea what this case could be.
-          NS_LOG_LOGIC ("Found an endpoint for case 3, adding " << endP->GetLocalAddress () << ":" << endP->GetLocalPort ());
-          retval3.push_back (endP);
-        }
-      if (localAddressMatchesExact && remoteAddressMatchesWildCard && remotePortMatchesWildCard)
-        { // Only local port and local address matches exactly - Not yet opened connection
-          NS_LOG_LOGIC ("Found an endpoint for case 2, adding " << endP->GetLocalAddress () << ":" << endP->GetLocalPort ());
-          retval2.push_back (endP);
-        }
-      if (localAddressMatchesWildCard && remoteAddressMatchesWildCard && remotePortMatchesWildCard)
-        { // Only local port matches exactly - Endpoint open to "any" connection
-          NS_LOG_LOGIC ("Found an endpoint for case 1, adding " << endP->GetLocalAddress () << ":" << endP->GetLocalPort ());
-          retval1.push_back (endP);
-        }
-    }
+  bool localAddressMatchesWildCard = localAddressIsAny || localAddressIsSubnetAny;
 
-  // Here we find the most exact match
-  EndPoints retval;
-  if (!retval4.empty ()) retval = retval4;
-  else if (!retval3.empty ()) retval = retval3;
-  else if (!retval2.empty ()) retval = retval2;
-  else retval = retval1;
-
-  NS_ABORT_MSG_IF (retval.size () > 1, "Too many endpoints - perhaps you created too many sockets without binding them to different NetDevices.");
-  return retval;  // might be empty if no matches
+  if (localAddressMatchesExact && remoteAddressMatchesExact && remotePortMatchesExact)
+    { // All 4 match - this is the case of an open TCP connection, for example.
+      NS_LOG_LOGIC ("Found an endpoint for case 4, adding " << endP->GetLocalAddress () << ":" << endP->GetLocalPort ());
+      retval[3].push_back (endP);
+    }
+  if (localAddressMatchesWildCard && remoteAddressMatchesExact && remotePortMatchesExact)
+    { // All but local address - no idea what this case could be.
+      NS_LOG_LOGIC ("Found an endpoint for case 3, adding " << endP->GetLocalAddress () << ":" << endP->GetLocalPort ());
+      retval[2].push_back (endP);
+    }
+  if (localAddressMatchesExact && remoteAddressMatchesWildCard && remotePortMatchesWildCard)
+    { // Only local port and local address matches exactly - Not yet opened connection
+      NS_LOG_LOGIC ("Found an endpoint for case 2, adding " << endP->GetLocalAddress () << ":" << endP->GetLocalPort ());
+      retval[1].push_back (endP);
+    }
+  if (localAddressMatchesWildCard && remoteAddressMatchesWildCard && remotePortMatchesWildCard)
+    { // Only local port matches exactly - Endpoint open to "any" connection
+      NS_LOG_LOGIC ("Found an endpoint for case 1, adding " << endP->GetLocalAddress () << ":" << endP->GetLocalPort ());
+      retval[0].push_back (endP);
+    }
 }
 
 Ipv4EndPoint *
@@ -343,16 +460,27 @@ Ipv4EndPointDemux::SimpleLookup (Ipv4Address daddr,
 {
   NS_LOG_FUNCTION (this << daddr << dport << saddr << sport);
 
+  PortMap::iterator port = m_ports.find (dport);
+  if (port == m_ports.end ())
+    {
+      return 0;
+    }
+  auto range = port->second.m_connected.equal_range (PeerKey (saddr, sport));
+  for (auto i = range.first; i != range.second; i++)
+    {
+      if (i->second->GetLocalAddress () == daddr)
+        {
+          /* this is an exact match. */
+          return i->second;
+        }
+    }
+
   // this code is a copy/paste version of an old BSD ip stack lookup
   // function.
   uint32_t genericity = 3;
   Ipv4EndPoint *generic = 0;
-  for (EndPointsI i = m_endPoints.begin (); i != m_endPoints.end (); i++) 
+  for (EndPointsI i = port->second.m_wildcard.begin (); i != port->second.m_wildcard.end (); i++) 
     {
-      if ((*i)->GetLocalPort () != dport) 
-        {
-          continue;
-        }
       if ((*i)->GetLocalAddress () == daddr &&
           (*i)->GetPeerPort () == sport &&
           (*i)->GetPeerAddress () == saddr) 
@@ -375,6 +503,16 @@ Ipv4EndPointDemux::SimpleLookup (Ipv4Address daddr,
           genericity = tmp;
         }
     }
+  // The endpoints with another peer come last
+  for (auto i = port->second.m_connected.begin (); i != port->second.m_connected.end () && genericity > 0; i++)
+    {
+      uint32_t tmp = i->second->GetLocalAddress () == Ipv4Address::GetAny () ? 1 : 0;
+      if (tmp < genericity)
+        {
+          generic = i->second;
+          genericity = tmp;
+        }
+    }
   return generic;
 }
 uint16_t
@@ -401,4 +539,3 @@ Ipv4EndPointDemux::AllocateEphemeralPort (void)
 }
 
 } // namespace ns3
-
@@ -23,6 +23,7 @@
 
 #include <stdint.h>
 #include <list>
+#include <unordered_map>
 #include "ns3/ipv4-address.h"
 #include "ipv4-interface.h"
 
@@ -40,6 +41,13 @@ class Ipv4EndPoint;
  * of endpoints, and has APIs to add and find endpoints in this demux.  This
  * code is shared in common to TCP and UDP protocols in ns3.  This demux
  * sits between ns3's layer four and the socket layer
+ *
+ * The endpoints are grouped by local port.  Within a port, the endpoints
+ * that have a peer address and port, such as the connections of a server,
+ * are indexed by them in a hash table: a packet can only match those of its
+ * source.  The others (listening, unconnected or partly wildcard endpoints)
+ * are kept in a list, and checked for every packet to the port.  A lookup
+ * thus costs the same whatever the number of connections.
  */
 
 class Ipv4EndPointDemux {
@@ -59,6 +67,9 @@ public:
 
   /**
    * \brief Get the entire list of end points registered.
+   *
+   * The end points are grouped by local port, in no particular order.
+   *
    * \return list of Ipv4EndPoint
    */
   EndPoints GetAllEndPoints (void);
@@ -166,6 +177,65 @@ public:
   void DeAllocate (Ipv4EndPoint *endPoint);
 
 private:
+  friend class Ipv4EndPoint;
+
+  /**
+   * \brief The endpoints of a local port.
+   */
+  struct PortEndPoints
+  {
+    EndPoints m_wildcard; //!< endpoints without a peer address or port
+    std::unordered_multimap<uint64_t, Ipv4EndPoint *> m_connected; //!< endpoints with a peer, by PeerKey
+  };
+
+  /**
+   * \brief Container of the endpoints, by local port.
+   */
+  typedef std::unordered_map<uint16_t, PortEndPoints> PortMap;
+
+  /**
+   * \brief Get the key of a peer in the index of the connected endpoints.
+   * \param address peer address
+   * \param port peer port
+   * \returns the key
+   */
+  static uint64_t PeerKey (Ipv4Address address, uint16_t port);
+
+  /**
+   * \brief Check if an endpoint with this peer goes in the index.
+   * \param address peer address
+   * \param port peer port
+   * \returns true if neither the address nor the port is a wildcard
+   */
+  static bool HasPeer (Ipv4Address address, uint16_t port);
+
+  /**
+   * \brief Add an endpoint to the containers.
+   * \param endPoint the endpoint
+   */
+  void Link (Ipv4EndPoint *endPoint);
+
+  /**
+   * \brief Remove an endpoint from the containers.
+   * \param endPoint the endpoint
+   * \returns true if the endpoint was found
+   */
+  bool Unlink (Ipv4EndPoint *endPoint);
+
+  /**
+   * \brief Check how an endpoint of the destination port matches a packet.
+   *
+   * The endpoint is added to the list of its case in retval, see Lookup.
+   *
+   * \param endP the endpoint
+   * \param daddr destination address
+   * \param saddr source address
+   * \param sport source port
+   * \param incomingInterface the incoming interface
+   * \param retval the lists of matching endpoints of the cases 1 to 4
+   */
+  void Match (Ipv4EndPoint *endP, Ipv4Address daddr, Ipv4Address saddr, uint16_t sport,
+              Ptr<Ipv4Interface> incomingInterface, EndPoints retval[4]);
 
   /**
    * \brief Allocate an ephemeral port.
@@ -189,9 +259,14 @@ private:
   uint16_t m_portFirst;
 
   /**
-   * \brief A list of IPv4 end points.
+   * \brief The IPv4 end points, by local port.
+   */
+  PortMap m_ports;
+
+  /**
+   * \brief The number of end points.
    */
-  EndPoints m_endPoints;
+  uint32_t m_nEndPoints;
 };
 
 } // namespace ns3
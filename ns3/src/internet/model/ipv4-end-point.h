@@ -32,6 +32,7 @@ namespace ns3 {
 
 class Header;
 class Packet;
+class Ipv4EndPointDemux;
 
 /**
  * \ingroup ipv4
@@ -88,6 +89,9 @@ public:
 
   /**
    * \brief Set the peer information (address and port).
+   *
+   * The demux that holds the endpoint moves it to the index of its new peer.
+   *
    * \param address peer address
    * \param port peer port
    */
@@ -183,6 +187,8 @@ public:
   bool IsRxEnabled (void);
 
 private:
+  friend class Ipv4EndPointDemux;
+
   /**
    * \brief The local address.
    */
@@ -227,6 +233,12 @@ private:
    * \brief true if the endpoint can receive packets.
    */
   bool m_rxEnabled;
+
+  /**
+   * \brief The demux that holds the endpoint (if any), which indexes it
+   * by its peer.
+   */
+  Ipv4EndPointDemux *m_demux;
 };
 
 } // namespace ns3
@@ -17,6 +17,8 @@
 //
 
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <iomanip>
 #include "ns3/names.h"
 #include "ns3/log.h"
@@ -60,7 +62,9 @@ Ipv4GlobalRouting::GetTypeId (void)
 
 Ipv4GlobalRouting::Ipv4GlobalRouting () 
   : m_randomEcmpRouting (false),
-    m_respondToInterfaceEvents (false)
+    m_respondToInterfaceEvents (false),
+    m_compiled (false),
+    m_routeSlotBits (0)
 {
   NS_LOG_FUNCTION (this);
 
@@ -81,6 +85,7 @@ Ipv4GlobalRouting::AddHostRouteTo (Ipv4Address dest,
   Ipv4RoutingTableEntry *route = new Ipv4RoutingTableEntry ();
   *route = Ipv4RoutingTableEntry::CreateHostRouteTo (dest, nextHop, interface);
   m_hostRoutes.push_back (route);
+  m_compiled = false;
 }
 
 void 
@@ -91,6 +96,7 @@ Ipv4GlobalRouting::AddHostRouteTo (Ipv4Address dest,
   Ipv4RoutingTableEntry *route = new Ipv4RoutingTableEntry ();
   *route = Ipv4RoutingTableEntry::CreateHostRouteTo (dest, interface);
   m_hostRoutes.push_back (route);
+  m_compiled = false;
 }
 
 void 
@@ -106,6 +112,7 @@ Ipv4GlobalRouting::AddNetworkRouteTo (Ipv4Address network,
                                                         nextHop,
                                                         interface);
   m_networkRoutes.push_back (route);
+  m_compiled = false;
 }
 
 void 
@@ -119,6 +126,7 @@ Ipv4GlobalRouting::AddNetworkRouteTo (Ipv4Address network,
                                                         networkMask,
                                                         interface);
   m_networkRoutes.push_back (route);
+  m_compiled = false;
 }
 
 void 
@@ -134,64 +142,129 @@ Ipv4GlobalRouting::AddASExternalRouteTo (Ipv4Address network,
                                                         nextHop,
                                                         interface);
   m_ASexternalRoutes.push_back (route);
+  m_compiled = false;
 }
 
 
+void
+Ipv4GlobalRouting::CompileRoutes (void)
+{
+  NS_LOG_FUNCTION (this);
+  // the levels of the network routes, from the longest prefix
+  std::vector<uint32_t> networkMasks;
+  for (NetworkRoutesCI j = m_networkRoutes.begin ();
+       j != m_networkRoutes.end ();
+       j++)
+    {
+      networkMasks.push_back ((*j)->GetDestNetworkMask ().Get ());
+    }
+  std::sort (networkMasks.begin (), networkMasks.end (), std::greater<uint32_t> ());
+  networkMasks.erase (std::unique (networkMasks.begin (), networkMasks.end ()), networkMasks.end ());
+  m_levelMasks.assign (1, 0xffffffff);
+  m_levelMasks.insert (m_levelMasks.end (), networkMasks.begin (), networkMasks.end ());
+
+  // the routes to each destination of each level, in the order of the lists
+  typedef std::map<std::pair<uint32_t, uint32_t>, std::vector<Ipv4RoutingTableEntry *> > RouteSets;
+  RouteSets sets;
+  for (HostRoutesCI i = m_hostRoutes.begin ();
+       i != m_hostRoutes.end ();
+       i++)
+    {
+      NS_ASSERT ((*i)->IsHost ());
+      sets[std::make_pair (0, (*i)->GetDest ().Get ())].push_back (*i);
+    }
+  for (NetworkRoutesCI j = m_networkRoutes.begin ();
+       j != m_networkRoutes.end ();
+       j++)
+    {
+      uint32_t mask = (*j)->GetDestNetworkMask ().Get ();
+      uint32_t level = 1 + (std::find (networkMasks.begin (), networkMasks.end (), mask) - networkMasks.begin ());
+      sets[std::make_pair (level, (*j)->GetDestNetwork ().Get () & mask)].push_back (*j);
+    }
+
+  m_routeSlotBits = 4;
+  while ((1u << m_routeSlotBits) < 2 * sets.size ())
+    {
+      m_routeSlotBits++;
+    }
+  RouteSlot free = { 0, 0, 0, 0 };
+  m_routeSlots.assign (1u << m_routeSlotBits, free);
+  m_compiledRoutes.clear ();
+  uint32_t mask = m_routeSlots.size () - 1;
+  for (RouteSets::const_iterator k = sets.begin (); k != sets.end (); k++)
+    {
+      uint32_t index = (k->first.second ^ (k->first.first * 0x85ebca6b)) * 0x9e3779b1 >> (32 - m_routeSlotBits);
+      while (m_routeSlots[index].count != 0)
+        {
+          index = (index + 1) & mask;
+        }
+      RouteSlot &slot = m_routeSlots[index];
+      slot.dest = k->first.second;
+      slot.level = k->first.first;
+      slot.begin = m_compiledRoutes.size ();
+      slot.count = k->second.size ();
+      m_compiledRoutes.insert (m_compiledRoutes.end (), k->second.begin (), k->second.end ());
+    }
+  NS_LOG_LOGIC ("Compiled " << m_compiledRoutes.size () << " routes to " << sets.size ()
+                << " destinations in " << m_levelMasks.size () << " levels");
+  m_compiled = true;
+}
+
+const Ipv4GlobalRouting::RouteSlot*
+Ipv4GlobalRouting::FindRouteSlot (uint32_t dest, uint32_t level) const
+{
+  uint32_t mask = m_routeSlots.size () - 1;
+  uint32_t index = (dest ^ (level * 0x85ebca6b)) * 0x9e3779b1 >> (32 - m_routeSlotBits);
+  for (;; index = (index + 1) & mask)
+    {
+      const RouteSlot &slot = m_routeSlots[index];
+      if (slot.count == 0)
+        {
+          return 0;
+        }
+      if (slot.dest == dest && slot.level == level)
+        {
+          return &slot;
+        }
+    }
+}
+
 Ptr<Ipv4Route>
 Ipv4GlobalRouting::LookupGlobal (Ipv4Address dest, Ptr<NetDevice> oif)
 {
   NS_LOG_FUNCTION (this << dest << oif);
   NS_LOG_LOGIC ("Looking for route for destination " << dest);
-  Ptr<Ipv4Route> rtentry = 0;
-  // store all available routes that bring packets to their destination
-  typedef std::vector<Ipv4RoutingTableEntry*> RouteVec_t;
-  RouteVec_t allRoutes;
-
-  NS_LOG_LOGIC ("Number of m_hostRoutes = " << m_hostRoutes.size ());
-  for (HostRoutesCI i = m_hostRoutes.begin (); 
-       i != m_hostRoutes.end (); 
-       i++) 
+  if (!m_compiled)
     {
-      NS_ASSERT ((*i)->IsHost ());
-      if ((*i)->GetDest () == dest)
-        {
-          if (oif != 0)
-            {
-              if (oif != m_ipv4->GetNetDevice ((*i)->GetInterface ()))
-                {
-                  NS_LOG_LOGIC ("Not on requested interface, skipping");
-                  continue;
-                }
-            }
-          allRoutes.push_back (*i);
-          NS_LOG_LOGIC (allRoutes.size () << "Found global host route" << *i); 
-        }
+      CompileRoutes ();
     }
-  if (allRoutes.size () == 0) // if no host route is found
+  // the available routes that bring packets to their destination, as
+  // the routes of a slot on the oif if any, or one external route
+  const RouteSlot *found = 0;
+  uint32_t nRoutes = 0;
+  Ipv4RoutingTableEntry *external = 0;
+
+  // host routes first, then network routes by decreasing prefix length
+  for (uint32_t level = 0; level < m_levelMasks.size () && nRoutes == 0; level++)
     {
-      NS_LOG_LOGIC ("Number of m_networkRoutes" << m_networkRoutes.size ());
-      for (NetworkRoutesI j = m_networkRoutes.begin (); 
-           j != m_networkRoutes.end (); 
-           j++) 
+      found = FindRouteSlot (dest.Get () & m_levelMasks[level], level);
+      if (found == 0)
+        {
+          continue;
+        }
+      for (uint32_t i = found->begin; i < found->begin + found->count; i++)
         {
-          Ipv4Mask mask = (*j)->GetDestNetworkMask ();
-          Ipv4Address entry = (*j)->GetDestNetwork ();
-          if (mask.IsMatch (dest, entry)) 
+          if (oif != 0 && oif != m_ipv4->GetNetDevice (m_compiledRoutes[i]->GetInterface ()))
             {
-              if (oif != 0)
-                {
-                  if (oif != m_ipv4->GetNetDevice ((*j)->GetInterface ()))
-                    {
-                      NS_LOG_LOGIC ("Not on requested interface, skipping");
-                      continue;
-                    }
-                }
-              allRoutes.push_back (*j);
-              NS_LOG_LOGIC (allRoutes.size () << "Found global network route" << *j);
+              NS_LOG_LOGIC ("Not on requested interface, skipping");
+              continue;
             }
+          nRoutes++;
+          NS_LOG_LOGIC (nRoutes << "Found global " << (level == 0 ? "host" : "network")
+                                << " route" << m_compiledRoutes[i]);
         }
     }
-  if (allRoutes.size () == 0)  // consider external if no host/network found
+  if (nRoutes == 0)  // consider external if no host/network found
     {
       for (ASExternalRoutesI k = m_ASexternalRoutes.begin ();
            k != m_ASexternalRoutes.end ();
@@ -210,12 +283,13 @@ Ipv4GlobalRouting::LookupGlobal (Ipv4Address dest, Ptr<NetDevice> oif)
                       continue;
                     }
                 }
-              allRoutes.push_back (*k);
+              external = *k;
+              nRoutes = 1;
               break;
             }
         }
     }
-  if (allRoutes.size () > 0 ) // if route(s) is found
+  if (nRoutes > 0) // if route(s) is found
     {
       // pick up one of the routes uniformly at random if random
       // ECMP routing is enabled, or always select the first route
@@ -223,15 +297,27 @@ Ipv4GlobalRouting::LookupGlobal (Ipv4Address dest, Ptr<NetDevice> oif)
       uint32_t selectIndex;
       if (m_randomEcmpRouting)
         {
-          selectIndex = m_rand->GetInteger (0, allRoutes.size ()-1);
+          selectIndex = m_rand->GetInteger (0, nRoutes-1);
         }
       else 
         {
           selectIndex = 0;
         }
-      Ipv4RoutingTableEntry* route = allRoutes.at (selectIndex); 
+      Ipv4RoutingTableEntry* route = external;
+      for (uint32_t i = external ? 0 : found->begin; route == 0; i++)
+        {
+          // the selectIndex-th route of the slot on the oif
+          if (oif == 0 || oif == m_ipv4->GetNetDevice (m_compiledRoutes[i]->GetInterface ()))
+            {
+              if (selectIndex == 0)
+                {
+                  route = m_compiledRoutes[i];
+                }
+              selectIndex--;
+            }
+        }
       // create a Ipv4Route object from the selected routing table entry
-      rtentry = Create<Ipv4Route> ();
+      Ptr<Ipv4Route> rtentry = Create<Ipv4Route> ();
       rtentry->SetDestination (route->GetDest ());
       /// \todo handle multi-address case
       rtentry->SetSource (m_ipv4->GetAddress (route->GetInterface (), 0).GetLocal ());
@@ -310,6 +396,7 @@ void
 Ipv4GlobalRouting::RemoveRoute (uint32_t index)
 {
   NS_LOG_FUNCTION (this << index);
+  m_compiled = false;
   if (index < m_hostRoutes.size ())
     {
       uint32_t tmp = 0;
@@ -393,6 +480,9 @@ Ipv4GlobalRouting::DoDispose (void)
     {
       delete (*l);
     }
+  m_compiled = false;
+  m_routeSlots.clear ();
+  m_compiledRoutes.clear ();
 
   Ipv4RoutingProtocol::DoDispose ();
 }
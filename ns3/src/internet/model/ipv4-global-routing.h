@@ -21,6 +21,7 @@
 #define IPV4_GLOBAL_ROUTING_H
 
 #include <list>
+#include <vector>
 #include <stdint.h>
 #include "ns3/ipv4-address.h"
 #include "ns3/ipv4-header.h"
@@ -65,6 +66,13 @@ class Node;
  *
  * This class deals with Ipv4 unicast routes only.
  *
+ * The host and network routes are compiled, on the first lookup after a
+ * change, into a hash table of the sets of equal-cost routes to each
+ * destination, with one level per prefix length.  A lookup probes the
+ * levels from the host routes to the shortest prefix, so it takes the
+ * routes of the longest matching prefix in a few probes instead of
+ * scanning the lists.
+ *
  * \see Ipv4RoutingProtocol
  * \see GlobalRouteManager
  */
@@ -268,10 +276,39 @@ private:
    */
   Ptr<Ipv4Route> LookupGlobal (Ipv4Address dest, Ptr<NetDevice> oif = 0);
 
+  /// The equal-cost routes to a destination, in a slot of the compiled table
+  struct RouteSlot
+  {
+    uint32_t dest;  //!< destination, masked by the mask of the level
+    uint32_t level; //!< index of the level in m_levelMasks
+    uint32_t begin; //!< index of the first route in m_compiledRoutes
+    uint32_t count; //!< number of routes, 0 if the slot is free
+  };
+
+  /**
+   * \brief Compile the host and network routes into m_routeSlots.
+   */
+  void CompileRoutes (void);
+  /**
+   * \brief Find the routes to a destination in the compiled table.
+   * \param dest destination, masked by the mask of the level
+   * \param level index of the level
+   * \return the slot of the routes, or 0 if there are none
+   */
+  const RouteSlot* FindRouteSlot (uint32_t dest, uint32_t level) const;
+
   HostRoutes m_hostRoutes;             //!< Routes to hosts
   NetworkRoutes m_networkRoutes;       //!< Routes to networks
   ASExternalRoutes m_ASexternalRoutes; //!< External routes imported
 
+  bool m_compiled; //!< True if the compiled table holds the current routes
+  /// Masks of the levels, in lookup order: the host routes, then the
+  /// network routes from the longest prefix to the shortest
+  std::vector<uint32_t> m_levelMasks;
+  std::vector<RouteSlot> m_routeSlots; //!< Open addressing table, a power of two of slots
+  uint32_t m_routeSlotBits; //!< Log2 of the number of slots
+  std::vector<Ipv4RoutingTableEntry *> m_compiledRoutes; //!< Routes of the slots, in the order of the lists
+
   Ptr<Ipv4> m_ipv4; //!< associated IPv4 instance
 };
 
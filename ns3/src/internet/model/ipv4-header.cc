@@ -383,13 +383,6 @@ void
 Ipv4Header::Serialize (Buffer::Iterator start) const
 {
   NS_LOG_FUNCTION (this << &start);
-  Buffer::Iterator i = start;
-
-  uint8_t verIhl = (4 << 4) | (5);
-  i.WriteU8 (verIhl);
-  i.WriteU8 (m_tos);
-  i.WriteHtonU16 (m_payloadSize + 5*4);
-  i.WriteHtonU16 (m_identification);
   uint32_t fragmentOffset = m_fragmentOffset / 8;
   uint8_t flagsFrag = (fragmentOffset >> 8) & 0x1f;
   if (m_flags & DONT_FRAGMENT) 
@@ -400,14 +393,24 @@ Ipv4Header::Serialize (Buffer::Iterator start) const
     {
       flagsFrag |= (1<<5);
     }
-  i.WriteU8 (flagsFrag);
-  uint8_t frag = fragmentOffset & 0xff;
-  i.WriteU8 (frag);
-  i.WriteU8 (m_ttl);
-  i.WriteU8 (m_protocol);
-  i.WriteHtonU16 (0);
-  i.WriteHtonU32 (m_source.Get ());
-  i.WriteHtonU32 (m_destination.Get ());
+  // Lay out the header in network order and copy it to the buffer at once
+  uint16_t totalLength = m_payloadSize + 5*4;
+  uint32_t source = m_source.Get ();
+  uint32_t destination = m_destination.Get ();
+  uint8_t header[20] = {
+    (4 << 4) | (5), uint8_t (m_tos),
+    uint8_t (totalLength >> 8), uint8_t (totalLength),
+    uint8_t (m_identification >> 8), uint8_t (m_identification),
+    flagsFrag, uint8_t (fragmentOffset & 0xff),
+    uint8_t (m_ttl), uint8_t (m_protocol),
+    0, 0,
+    uint8_t (source >> 24), uint8_t (source >> 16),
+    uint8_t (source >> 8), uint8_t (source),
+    uint8_t (destination >> 24), uint8_t (destination >> 16),
+    uint8_t (destination >> 8), uint8_t (destination)
+  };
+  Buffer::Iterator i = start;
+  i.Write (header, sizeof (header));
 
   if (m_calcChecksum) 
     {
@@ -30,6 +30,7 @@
 #include "ns3/node.h"
 #include "ns3/pointer.h"
 #include "ns3/traffic-control-layer.h"
+#include "ns3/vcp-trace.h"
 
 
 namespace ns3 {
@@ -214,7 +215,7 @@ Ipv4Interface::Send (Ptr<Packet> p, const Ipv4Header & hdr, Ipv4Address dest)
 {
   NS_LOG_FUNCTION (this << *p << dest);
 
-  NS_LOG_DEBUG("(VCP) ip header ecn=" << hdr.GetEcn());
+  NS_VCP_TRACE ("ip header ecn=" << hdr.GetEcn ());
 
   if (!IsUp ())
     {
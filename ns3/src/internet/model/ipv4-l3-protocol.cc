@@ -36,6 +36,7 @@
 #include "ns3/ipv4-routing-table-entry.h"
 #include "ns3/traffic-control-layer.h"
 #include "ns3/vcp-packet-tag.h"
+#include "ns3/vcp-trace.h"
 #include "ns3/tcp-header.h"
 
 #include "loopback-net-device.h"
@@ -668,7 +669,7 @@ Ipv4L3Protocol::Receive ( Ptr<NetDevice> device, Ptr<const Packet> p, uint16_t p
   VcpPacketTag vcpTag;
   if (p->PeekPacketTag(vcpTag)) {
     ipHeader.SetEcn((Ipv4Header::EcnType)vcpTag.GetLoad());
-    NS_LOG_DEBUG("(VCP) after setting: ipHeader.GetEcn()=" << ipHeader.GetEcn() << ", packet=" << p->ToString()); // TODO: delete
+    NS_VCP_TRACE ("after setting: ipHeader.GetEcn()=" << ipHeader.GetEcn () << ", packet=" << p->ToString ());
   }
 
   if (!m_routingProtocol->RouteInput (packet, ipHeader, device,
@@ -1014,7 +1015,7 @@ Ipv4L3Protocol::SendRealOut (Ptr<Ipv4Route> route,
         {
           CallTxTrace (ipHeader, packet, m_node->GetObject<Ipv4> (), interface);
 
-          NS_LOG_DEBUG("(VCP) ip header ecn=" << ipHeader.GetEcn()); // TODO: delete
+          NS_VCP_TRACE ("ip header ecn=" << ipHeader.GetEcn ());
 
           outInterface->Send (packet, ipHeader, target);
         }
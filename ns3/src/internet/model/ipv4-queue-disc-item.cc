@@ -94,6 +94,20 @@ Ipv4QueueDiscItem::Mark (void)
   return false;
 }
 
+bool
+Ipv4QueueDiscItem::MarkVcpLoad (uint8_t load)
+{
+  NS_LOG_FUNCTION (this << (uint16_t) load);
+  if (m_headerAdded)
+    {
+      return false;
+    }
+  if (load > m_header.GetEcn ())
+    {
+      m_header.SetEcn ((Ipv4Header::EcnType) load);
+    }
+  return true;
+}
 
 bool
 Ipv4QueueDiscItem::GetUint8Value (QueueItem::Uint8Values field, uint8_t& value) const
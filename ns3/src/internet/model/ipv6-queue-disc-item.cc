@@ -94,6 +94,21 @@ Ipv6QueueDiscItem::Mark (void)
   return false;
 }
 
+bool
+Ipv6QueueDiscItem::MarkVcpLoad (uint8_t load)
+{
+  NS_LOG_FUNCTION (this << (uint16_t) load);
+  if (m_headerAdded)
+    {
+      return false;
+    }
+  if (load > m_header.GetEcn ())
+    {
+      m_header.SetEcn ((Ipv6Header::EcnType) load);
+    }
+  return true;
+}
+
 bool
 Ipv6QueueDiscItem::GetUint8Value (QueueItem::Uint8Values field, uint8_t& value) const
 {
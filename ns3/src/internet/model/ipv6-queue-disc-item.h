@@ -83,6 +83,14 @@ public:
    */
   virtual bool Mark (void);
 
+  /**
+   * \brief Sets the ECN bits to the given VCP load if it is higher than the
+   * load they currently carry. The header must not have been added yet.
+   * \param load the VCP load code point
+   * \return true if the ECN bits carry at least the given load, false otherwise
+   */
+  virtual bool MarkVcpLoad (uint8_t load);
+
   /**
    * \brief Computes the hash of the packet's 5-tuple
    *
@@ -314,15 +314,24 @@ TcpHeader::GetSerializedSize (void)  const
 void
 TcpHeader::Serialize (Buffer::Iterator start)  const
 {
+  // Lay out the fixed part of the header in network order and copy it
+  // to the buffer at once
+  uint32_t sequenceNumber = m_sequenceNumber.GetValue ();
+  uint32_t ackNumber = m_ackNumber.GetValue ();
+  uint8_t fixed[20] = {
+    uint8_t (m_sourcePort >> 8), uint8_t (m_sourcePort),
+    uint8_t (m_destinationPort >> 8), uint8_t (m_destinationPort),
+    uint8_t (sequenceNumber >> 24), uint8_t (sequenceNumber >> 16),
+    uint8_t (sequenceNumber >> 8), uint8_t (sequenceNumber),
+    uint8_t (ackNumber >> 24), uint8_t (ackNumber >> 16),
+    uint8_t (ackNumber >> 8), uint8_t (ackNumber),
+    uint8_t (GetLength () << 4), m_flags, //reserved bits are all zero
+    uint8_t (m_windowSize >> 8), uint8_t (m_windowSize),
+    0, 0,
+    uint8_t (m_urgentPointer >> 8), uint8_t (m_urgentPointer)
+  };
   Buffer::Iterator i = start;
-  i.WriteHtonU16 (m_sourcePort);
-  i.WriteHtonU16 (m_destinationPort);
-  i.WriteHtonU32 (m_sequenceNumber.GetValue ());
-  i.WriteHtonU32 (m_ackNumber.GetValue ());
-  i.WriteHtonU16 (GetLength () << 12 | m_flags); //reserved bits are all zero
-  i.WriteHtonU16 (m_windowSize);
-  i.WriteHtonU16 (0);
-  i.WriteHtonU16 (m_urgentPointer);
+  i.Write (fixed, sizeof (fixed));
 
   // Serialize options if they exist
   // This implementation does not presently try to align options on word
@@ -29,6 +29,7 @@
 #include "ns3/simulator.h"
 #include "ns3/ipv4-route.h"
 #include "ns3/ipv6-route.h"
+#include "ns3/vcp-trace.h"
 
 #include "tcp-l4-protocol.h"
 #include "tcp-header.h"
@@ -438,12 +439,7 @@ TcpL4Protocol::Receive (Ptr<Packet> packet,
 {
   NS_LOG_FUNCTION (this << packet << incomingIpHeader << incomingInterface);
 
-  // (VCP): TODO check more info
-  //if (packet) {
-    // VcpPacketTag vcpTag;
-    // bool hasVcpTag = packet->PeekPacketTag(vcpTag);
-    NS_LOG_DEBUG("(VCP) ip header ecn: " << incomingIpHeader.GetEcn());
-  //}
+  NS_VCP_TRACE ("ip header ecn=" << incomingIpHeader.GetEcn ());
 
   TcpHeader incomingTcpHeader;
   IpL4Protocol::RxStatus checksumControl;
@@ -18,6 +18,8 @@
  * Author: Adrian Sai-wah Tam <adrian.sw.tam@gmail.com>
  */
 
+#include <algorithm>
+
 #include "ns3/packet.h"
 #include "ns3/log.h"
 #include "tcp-rx-buffer.h"
@@ -59,6 +61,17 @@ TcpRxBuffer::~TcpRxBuffer ()
 {
 }
 
+TcpRxBuffer::Segment::Segment (const SequenceNumber32 &seq, Ptr<Packet> packet)
+  : m_seq (seq), m_packet (packet)
+{
+}
+
+SequenceNumber32
+TcpRxBuffer::Segment::End (void) const
+{
+  return m_seq + SequenceNumber32 (m_packet->GetSize ());
+}
+
 SequenceNumber32
 TcpRxBuffer::NextRxSequence (void) const
 {
@@ -113,9 +126,9 @@ TcpRxBuffer::MaxRxSequence (void) const
     { // No data allowed beyond FIN
       return m_finSeq;
     }
-  else if (m_data.size () && m_nextRxSeq > m_data.begin ()->first)
+  else if (m_inOrder.size ())
     { // No data allowed beyond Rx window allowed
-      return m_data.begin ()->first + SequenceNumber32 (m_maxBuffer);
+      return m_inOrder.front ().m_seq + SequenceNumber32 (m_maxBuffer);
     }
   return m_nextRxSeq + SequenceNumber32 (m_maxBuffer);
 }
@@ -149,32 +162,40 @@ TcpRxBuffer::Add (Ptr<Packet> p, TcpHeader const& tcph)
 
   // Trim packet to fit Rx window specification
   if (headSeq < m_nextRxSeq) headSeq = m_nextRxSeq;
-  if (m_data.size ())
+  if (m_inOrder.size () || m_outOfOrder.size ())
     {
-      SequenceNumber32 maxSeq = m_data.begin ()->first + SequenceNumber32 (m_maxBuffer);
+      SequenceNumber32 firstSeq = m_inOrder.size () ? m_inOrder.front ().m_seq : m_outOfOrder.front ().m_seq;
+      SequenceNumber32 maxSeq = firstSeq + SequenceNumber32 (m_maxBuffer);
       if (maxSeq < tailSeq) tailSeq = maxSeq;
       if (tailSeq < headSeq) headSeq = tailSeq;
     }
-  // Remove overlapped bytes from packet
-  BufIterator i = m_data.begin ();
-  while (i != m_data.end () && i->first <= tailSeq)
+  // Remove overlapped bytes from packet. The data below m_nextRxSeq cannot
+  // overlap it, and the out-of-order segments that do are contiguous in the
+  // array, starting at the first one that ends after headSeq.
+  SegmentList::iterator i = m_outOfOrder.end ();
+  if (m_outOfOrder.size () && m_outOfOrder.back ().End () > headSeq)
+    {
+      i = std::partition_point (m_outOfOrder.begin (), m_outOfOrder.end (),
+                                [headSeq] (const Segment &s) { return s.End () <= headSeq; });
+    }
+  while (i != m_outOfOrder.end () && i->m_seq <= tailSeq)
     {
-      SequenceNumber32 lastByteSeq = i->first + SequenceNumber32 (i->second->GetSize ());
+      SequenceNumber32 lastByteSeq = i->End ();
       if (lastByteSeq > headSeq)
         {
-          if (i->first > headSeq && lastByteSeq < tailSeq)
+          if (i->m_seq > headSeq && lastByteSeq < tailSeq)
             { // Rare case: Existing packet is embedded fully in the new packet
-              m_size -= i->second->GetSize ();
-              m_data.erase (i++);
+              m_size -= i->m_packet->GetSize ();
+              i = m_outOfOrder.erase (i);
               continue;
             }
-          if (i->first <= headSeq)
+          if (i->m_seq <= headSeq)
             { // Incoming head is overlapped
               headSeq = lastByteSeq;
             }
           if (lastByteSeq >= tailSeq)
             { // Incoming tail is overlapped
-              tailSeq = i->first;
+              tailSeq = i->m_seq;
             }
         }
       ++i;
@@ -185,40 +206,56 @@ TcpRxBuffer::Add (Ptr<Packet> p, TcpHeader const& tcph)
       NS_LOG_LOGIC ("Nothing to buffer");
       return false; // Nothing to buffer anyway
     }
-  else
+  else if (headSeq != tcph.GetSequenceNumber () || static_cast<uint32_t> (tailSeq - headSeq) != pktSize)
     {
       uint32_t start = static_cast<uint32_t> (headSeq - tcph.GetSequenceNumber ());
       uint32_t length = static_cast<uint32_t> (tailSeq - headSeq);
       p = p->CreateFragment (start, length);
       NS_ASSERT (length == p->GetSize ());
     }
-  // Insert packet into buffer
-  NS_ASSERT (m_data.find (headSeq) == m_data.end ()); // Shouldn't be there yet
-  m_data [ headSeq ] = p;
-
-  if (headSeq > m_nextRxSeq)
+  else
     {
-      // Generate a new SACK block
-      UpdateSackList (headSeq, tailSeq);
+      p = p->Copy ();
     }
+  // The data goes to the application without the tags of the lower layers
+  p->RemoveAllPacketTags ();
 
   NS_LOG_LOGIC ("Buffered packet of seqno=" << headSeq << " len=" << p->GetSize ());
-  // Update variables
   m_size += p->GetSize ();      // Occupancy
-  for (i = m_data.begin (); i != m_data.end (); ++i)
+  if (headSeq > m_nextRxSeq)
     {
-      if (i->first < m_nextRxSeq)
+      // Insert packet into buffer, after the segments that precede it
+      if (m_outOfOrder.empty () || m_outOfOrder.back ().m_seq < headSeq)
         {
-          continue;
+          m_outOfOrder.push_back (Segment (headSeq, p));
         }
-      else if (i->first > m_nextRxSeq)
+      else
         {
-          break;
-        };
-      m_nextRxSeq = i->first + SequenceNumber32 (i->second->GetSize ());
-      m_availBytes += i->second->GetSize ();
+          i = std::partition_point (m_outOfOrder.begin (), m_outOfOrder.end (),
+                                    [headSeq] (const Segment &s) { return s.m_seq < headSeq; });
+          NS_ASSERT (i == m_outOfOrder.end () || i->m_seq != headSeq); // Shouldn't be there yet
+          m_outOfOrder.insert (i, Segment (headSeq, p));
+        }
+
+      // Generate a new SACK block
+      UpdateSackList (headSeq, tailSeq);
+    }
+  else
+    {
+      // In-order data, and the out-of-order segments it made contiguous
+      m_inOrder.push_back (Segment (headSeq, p));
+      m_nextRxSeq = tailSeq;
+      m_availBytes += p->GetSize ();
+      while (m_outOfOrder.size () && m_outOfOrder.front ().m_seq == m_nextRxSeq)
+        {
+          m_inOrder.push_back (m_outOfOrder.front ());
+          m_outOfOrder.pop_front ();
+          m_nextRxSeq = m_inOrder.back ().End ();
+          m_availBytes += m_inOrder.back ().m_packet->GetSize ();
+        }
       ClearSackList (m_nextRxSeq);
     }
+
   NS_LOG_LOGIC ("Updated buffer occupancy=" << m_size << " nextRxSeq=" << m_nextRxSeq);
   if (m_gotFin && m_nextRxSeq == m_finSeq)
     { // Account for the FIN packet
@@ -368,40 +405,44 @@ TcpRxBuffer::Extract (uint32_t maxSize)
   uint32_t extractSize = std::min (maxSize, m_availBytes);
   NS_LOG_LOGIC ("Requested to extract " << extractSize << " bytes from TcpRxBuffer of size=" << m_size);
   if (extractSize == 0) return nullptr;  // No contiguous block to return
-  NS_ASSERT (m_data.size ()); // At least we have something to extract
-  Ptr<Packet> outPkt = Create<Packet> (); // The packet that contains all the data to return
-  BufIterator i;
+  NS_ASSERT (m_inOrder.size ()); // At least we have something to extract
+  Ptr<Packet> outPkt; // The packet that contains all the data to return
   while (extractSize)
     { // Check the buffered data for delivery
-      i = m_data.begin ();
-      NS_ASSERT (i->first <= m_nextRxSeq); // in-sequence data expected
+      Segment &head = m_inOrder.front ();
       // Check if we send the whole pkt or just a partial
-      uint32_t pktSize = i->second->GetSize ();
+      uint32_t pktSize = head.m_packet->GetSize ();
+      Ptr<Packet> data;
       if (pktSize <= extractSize)
         { // Whole packet is extracted
-          outPkt->AddAtEnd (i->second);
-          m_data.erase (i);
-          m_size -= pktSize;
-          m_availBytes -= pktSize;
-          extractSize -= pktSize;
+          data = head.m_packet;
+          m_inOrder.pop_front ();
         }
       else
         { // Partial is extracted and done
-          outPkt->AddAtEnd (i->second->CreateFragment (0, extractSize));
-          m_data[i->first + SequenceNumber32 (extractSize)] = i->second->CreateFragment (extractSize, pktSize - extractSize);
-          m_data.erase (i);
-          m_size -= extractSize;
-          m_availBytes -= extractSize;
-          extractSize = 0;
+          data = head.m_packet->CreateFragment (0, extractSize);
+          head.m_packet = head.m_packet->CreateFragment (extractSize, pktSize - extractSize);
+          head.m_seq += extractSize;
+          pktSize = extractSize;
+        }
+      m_size -= pktSize;
+      m_availBytes -= pktSize;
+      extractSize -= pktSize;
+      if (outPkt == nullptr && extractSize == 0)
+        { // The head segment holds the whole request: no copy
+          outPkt = data;
+        }
+      else
+        {
+          if (outPkt == nullptr)
+            {
+              outPkt = Create<Packet> ();
+            }
+          outPkt->AddAtEnd (data);
         }
-    }
-  if (outPkt->GetSize () == 0)
-    {
-      NS_LOG_LOGIC ("Nothing extracted.");
-      return nullptr;
     }
   NS_LOG_LOGIC ("Extracted " << outPkt->GetSize ( ) << " bytes, bufsize=" << m_size
-                             << ", num pkts in buffer=" << m_data.size ());
+                             << ", num pkts in buffer=" << m_inOrder.size () + m_outOfOrder.size ());
   return outPkt;
 }
 
@@ -21,7 +21,7 @@
 #ifndef TCP_RX_BUFFER_H
 #define TCP_RX_BUFFER_H
 
-#include <map>
+#include <deque>
 #include "ns3/traced-value.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/sequence-number.h"
@@ -67,6 +67,20 @@ class Packet;
  * For more information about the SACK list, please check the documentation of
  * the method GetSackList.
  *
+ * Storage
+ * -------
+ *
+ * The segments are kept in two arrays, in sequence order: the data received
+ * in order, waiting for the application, and the data received above
+ * NextRxSequence, which never overlap and leave holes between them. An
+ * in-order segment is appended to the first array, and the out-of-order
+ * segments that it makes contiguous move there from the second one; the
+ * segments that overlap a new out-of-order one are found by binary search.
+ * The buffer stores a copy of each packet, without its packet tags,
+ * trimmed only where it overlaps the data already received, and Extract
+ * hands the head segment to the application as is when it covers the
+ * whole request.
+ *
  * \see GetSackList
  * \see UpdateSackList
  */
@@ -141,7 +155,8 @@ public:
    * reflect the number of bytes ready to send to the application. This
    * function handles overlap by triming the head of the inputted packet and
    * removing data from the buffer that overlaps the tail of the inputted
-   * packet
+   * packet. The buffer keeps a copy of the packet, without its packet
+   * tags, which shares its data.
    *
    * \param p packet
    * \param tcph packet's TCP header
@@ -151,7 +166,9 @@ public:
 
   /**
    * Extract data from the head of the buffer as indicated by nextRxSeq.
-   * The extracted data is going to be forwarded to the application.
+   * The extracted data is going to be forwarded to the application. When
+   * the segment at the head holds all the requested bytes, it is returned
+   * as is, or as one fragment of it, without concatenating packets.
    *
    * \param maxSize maximum number of bytes to extract
    * \returns a packet
@@ -215,17 +232,41 @@ private:
    */
   void ClearSackList (const SequenceNumber32 &seq);
 
+  /**
+   * \brief A segment of data stored in the buffer
+   */
+  struct Segment
+  {
+    /**
+     * \brief Constructor
+     * \param seq sequence number of the first byte
+     * \param packet the data
+     */
+    Segment (const SequenceNumber32 &seq, Ptr<Packet> packet);
+
+    /**
+     * \brief Get the sequence number that follows the segment
+     * \returns the sequence number of the byte after the last one
+     */
+    SequenceNumber32 End (void) const;
+
+    SequenceNumber32 m_seq; //!< Sequence number of the first byte
+    Ptr<Packet> m_packet;   //!< Data of the segment
+  };
+
+  /// container for data stored in the buffer, in sequence order
+  typedef std::deque<Segment> SegmentList;
+
   TcpOptionSack::SackList m_sackList; //!< Sack list (updated constantly)
 
-  /// container for data stored in the buffer
-  typedef std::map<SequenceNumber32, Ptr<Packet> >::iterator BufIterator;
   TracedValue<SequenceNumber32> m_nextRxSeq; //!< Seqnum of the first missing byte in data (RCV.NXT)
   SequenceNumber32 m_finSeq;                 //!< Seqnum of the FIN packet
   bool m_gotFin;                             //!< Did I received FIN packet?
   uint32_t m_size;                           //!< Number of total data bytes in the buffer, not necessarily contiguous
   uint32_t m_maxBuffer;                      //!< Upper bound of the number of data bytes in buffer (RCV.WND)
   uint32_t m_availBytes;                     //!< Number of bytes available to read, i.e. contiguous block at head
-  std::map<SequenceNumber32, Ptr<Packet> > m_data; //!< Corresponding data (may be null)
+  SegmentList m_inOrder;                     //!< Data below m_nextRxSeq, not yet extracted
+  SegmentList m_outOfOrder;                  //!< Data above m_nextRxSeq, not overlapping
 };
 
 } //namespace ns3
@@ -3146,22 +3146,11 @@ TcpSocketBase::SendDataPacket (SequenceNumber32 seq, uint32_t maxSize, bool with
           m_state = LAST_ACK;
         }
     }
-  TcpHeader header;
+  TcpHeader &header = GetDataHeaderTemplate ();
   header.SetFlags (flags);
   header.SetSequenceNumber (seq);
   header.SetAckNumber (m_tcb->m_rxBuffer->NextRxSequence ());
-  if (m_endPoint)
-    {
-      header.SetSourcePort (m_endPoint->GetLocalPort ());
-      header.SetDestinationPort (m_endPoint->GetPeerPort ());
-    }
-  else
-    {
-      header.SetSourcePort (m_endPoint6->GetLocalPort ());
-      header.SetDestinationPort (m_endPoint6->GetPeerPort ());
-    }
   header.SetWindowSize (AdvertisedWindowSize ());
-  AddOptions (header);
 
   if (m_retxEvent.IsExpired ())
     {
@@ -4309,6 +4298,41 @@ TcpSocketBase::AddOptionTimestamp (TcpHeader& header)
                option->GetTimestamp () << " echo=" << m_timestampToEcho);
 }
 
+TcpHeader&
+TcpSocketBase::GetDataHeaderTemplate (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  uint16_t sourcePort = m_endPoint ? m_endPoint->GetLocalPort () : m_endPoint6->GetLocalPort ();
+  uint16_t destinationPort = m_endPoint ? m_endPoint->GetPeerPort () : m_endPoint6->GetPeerPort ();
+
+  // The template and m_txTimestamp hold the only references to the option,
+  // unless a trace sink kept a copy of the last header: do not change the
+  // option under its feet then.
+  if (m_txHeader.GetSourcePort () != sourcePort
+      || m_txHeader.GetDestinationPort () != destinationPort
+      || m_txHeader.HasOption (TcpOption::TS) != m_timestampEnabled
+      || (m_txTimestamp != 0 && m_txTimestamp->GetReferenceCount () > 2))
+    {
+      NS_LOG_LOGIC (this << " Build the header template of the data segments");
+      m_txHeader = TcpHeader ();
+      m_txHeader.SetSourcePort (sourcePort);
+      m_txHeader.SetDestinationPort (destinationPort);
+      AddOptions (m_txHeader);
+      m_txTimestamp = DynamicCast<TcpOptionTS> (ConstCast<TcpOption> (m_txHeader.GetOption (TcpOption::TS)));
+      return m_txHeader;
+    }
+
+  if (m_txTimestamp != 0)
+    {
+      m_txTimestamp->SetTimestamp (TcpOptionTS::NowToTsValue ());
+      m_txTimestamp->SetEcho (m_timestampToEcho);
+      NS_LOG_INFO (m_node->GetId () << " Update option TS, ts=" <<
+                   m_txTimestamp->GetTimestamp () << " echo=" << m_timestampToEcho);
+    }
+  return m_txHeader;
+}
+
 void TcpSocketBase::UpdateWindowSize (const TcpHeader &header)
 {
   NS_LOG_FUNCTION (this << header);
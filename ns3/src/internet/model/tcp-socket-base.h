@@ -32,6 +32,8 @@
 #include "ns3/data-rate.h"
 #include "ns3/node.h"
 #include "ns3/tcp-socket-state.h"
+#include "ns3/tcp-header.h"
+#include "ns3/tcp-option-ts.h"
 
 namespace ns3 {
 
@@ -1193,6 +1195,18 @@ protected:
    */
   void AddOptionTimestamp (TcpHeader& header);
 
+  /**
+   * \brief Get the header of the next data segment
+   *
+   * The ports and options of the data segments do not change during a
+   * connection, so their header is kept as a template and reused by every
+   * segment: only the option values are updated here, and the caller sets
+   * the sequence and ack numbers, the flags and the window.
+   *
+   * \return the header template
+   */
+  TcpHeader& GetDataHeaderTemplate (void);
+
   /**
    * \brief Performs a safe subtraction between a and b (a-b)
    *
@@ -1315,6 +1329,10 @@ protected:
   bool     m_timestampEnabled {true}; //!< Timestamp option enabled
   uint32_t m_timestampToEcho  {0};    //!< Timestamp to echo
 
+  // Data segments
+  TcpHeader        m_txHeader {};    //!< Header template of the data segments
+  Ptr<TcpOptionTS> m_txTimestamp {}; //!< Timestamp option of m_txHeader, if any
+
   EventId m_sendPendingDataEvent {}; //!< micro-delay event to send pending data
 
   // Fast Retransmit and Recovery
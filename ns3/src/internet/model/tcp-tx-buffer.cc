@@ -58,7 +58,8 @@ TcpTxBuffer::GetTypeId (void)
  * initialized below is insignificant.
  */
 TcpTxBuffer::TcpTxBuffer (uint32_t n)
-  : m_maxBuffer (32768), m_size (0), m_sentSize (0), m_firstByteSeq (n)
+  : m_maxBuffer (32768), m_size (0), m_sentSize (0), m_firstByteSeq (n),
+    m_highestSack (n), m_lostMarked (n), m_lostHigh (n), m_nextSegHint (n)
 {
   m_rWndCallback = MakeNullCallback<uint32_t> ();
 }
@@ -173,7 +174,8 @@ TcpTxBuffer::SetHeadSequence (const SequenceNumber32& seq)
 
   // if you change the head with data already sent, something bad will happen
   NS_ASSERT (m_sentList.size () == 0);
-  m_highestSack = std::make_pair (m_sentList.end (), SequenceNumber32 (0));
+  m_highestSack = m_lostMarked = m_lostHigh = m_nextSegHint = seq;
+  m_haveSack = false;
 }
 
 bool
@@ -217,6 +219,17 @@ TcpTxBuffer::SizeFromSequence (const SequenceNumber32& seq) const
   return 0;
 }
 
+template <class Iterator>
+Iterator
+TcpTxBuffer::FindSentItem (Iterator begin, Iterator end, const SequenceNumber32 &seq)
+{
+  return std::lower_bound (begin, end, seq,
+                           [] (const TcpTxItem *item, const SequenceNumber32 &s)
+                           {
+                             return item->m_startSeq < s;
+                           });
+}
+
 TcpTxItem *
 TcpTxBuffer::CopyFromSequence (uint32_t numBytes, const SequenceNumber32& seq)
 {
@@ -310,36 +323,32 @@ TcpTxBuffer::GetTransmittedSegment (uint32_t numBytes, const SequenceNumber32 &s
   NS_ASSERT (numBytes <= m_sentSize);
   NS_ASSERT (m_sentList.size () >= 1);
 
-  auto it = m_sentList.begin ();
+  auto it = FindSentItem (m_sentList.begin (), m_sentList.end (), seq);
   bool listEdited = false;
   uint32_t s = numBytes;
 
   // Avoid to merge different packet for this retransmission if flags are
   // different.
-  for (; it != m_sentList.end(); ++it)
+  if (it != m_sentList.end () && (*it)->m_startSeq == seq)
     {
-      if ((*it)->m_startSeq == seq)
+      auto next = it;
+      next++;
+      if (next != m_sentList.end ())
         {
-          auto next = it;
-          next++;
-          if (next != m_sentList.end ())
+          // Next is not sacked and have the same value for m_lost ... there is the possibility to merge
+          if ((! (*next)->m_sacked) && ((*it)->m_lost == (*next)->m_lost))
             {
-              // Next is not sacked and have the same value for m_lost ... there is the possibility to merge
-              if ((! (*next)->m_sacked) && ((*it)->m_lost == (*next)->m_lost))
-                {
-                  s = std::min(s, (*it)->m_packet->GetSize () + (*next)->m_packet->GetSize ());
-                }
-              else
-                {
-                  // Next is sacked... better to retransmit only the first segment
-                  s = std::min(s, (*it)->m_packet->GetSize ());
-                }
+              s = std::min(s, (*it)->m_packet->GetSize () + (*next)->m_packet->GetSize ());
             }
           else
             {
+              // Next is sacked... better to retransmit only the first segment
               s = std::min(s, (*it)->m_packet->GetSize ());
             }
-          break;
+        }
+      else
+        {
+          s = std::min(s, (*it)->m_packet->GetSize ());
         }
     }
 
@@ -437,11 +446,23 @@ TcpTxBuffer::GetPacketFromList (PacketList &list, const SequenceNumber32 &listSt
   PacketList::iterator it = list.begin ();
   SequenceNumber32 beginOfCurrentPacket = listStartFrom;
 
+  if (&list == &m_sentList)
+    {
+      // The items of the sent list know their sequence: skip those before
+      // the one holding seq
+      it = FindSentItem (list.begin (), list.end (), seq + 1);
+      if (it != list.begin ())
+        {
+          --it;
+          beginOfCurrentPacket = (*it)->m_startSeq;
+        }
+    }
+
   while (it != list.end ())
     {
       currentItem = *it;
       currentPacket = currentItem->m_packet;
-      NS_ASSERT_MSG (list != m_sentList || currentItem->m_startSeq >= m_firstByteSeq,
+      NS_ASSERT_MSG (&list != &m_sentList || currentItem->m_startSeq >= m_firstByteSeq,
                      "start: " << m_firstByteSeq << " currentItem start: " <<
                      currentItem->m_startSeq);
 
@@ -617,6 +638,7 @@ TcpTxBuffer::MergeItems (TcpTxItem *t1, TcpTxItem *t2) const
           self->m_retrans -= t2->m_packet->GetSize ();
           t2->m_retrans = false;
         }
+      m_nextSegHint = std::min (m_nextSegHint, t1->m_startSeq);
     }
 
   if (t1->m_lastSent < t2->m_lastSent)
@@ -655,16 +677,15 @@ bool
 TcpTxBuffer::IsRetransmittedDataAcked (const SequenceNumber32& ack) const
 {
   NS_LOG_FUNCTION (this);
-  for (const auto &it : m_sentList)
-     {
-       TcpTxItem *item = it;
-       Ptr<Packet> p = item->m_packet;
-       if (item->m_startSeq + p->GetSize () == ack && !item->m_sacked && item->m_retrans)
-         {
-           return true;
-         }
-     }
-  return false;
+  // Only the item before the first one starting at ack can end at ack
+  auto it = FindSentItem (m_sentList.begin (), m_sentList.end (), ack);
+  if (it == m_sentList.begin ())
+    {
+      return false;
+    }
+  TcpTxItem *item = *(--it);
+  Ptr<Packet> p = item->m_packet;
+  return item->m_startSeq + p->GetSize () == ack && !item->m_sacked && item->m_retrans;
 }
 
 void
@@ -762,6 +783,7 @@ TcpTxBuffer::DiscardUpTo (const SequenceNumber32& seq,
           // when adding Reno dupacks in the count.
           head->m_sacked = false;
           m_sackedOut -= head->m_packet->GetSize ();
+          m_lostMarked = m_nextSegHint = m_firstByteSeq;
           NS_LOG_INFO ("Moving the SACK flag from the HEAD to another segment");
           AddRenoSack ();
           MarkHeadAsLost ();
@@ -772,10 +794,16 @@ TcpTxBuffer::DiscardUpTo (const SequenceNumber32& seq,
                      m_firstByteSeq << " this is the result: " << *this);
     }
 
-  if (m_highestSack.second <= m_firstByteSeq)
+  // The items before SND.UNA are gone: move the hints pointing there to SND.UNA.
+  // The head is never SACKed, so none is if the highest one was discarded
+  if (m_highestSack <= m_firstByteSeq)
     {
-      m_highestSack = std::make_pair (m_sentList.end (), SequenceNumber32 (0));
+      m_haveSack = false;
     }
+  m_highestSack = std::max (m_highestSack, m_firstByteSeq.Get ());
+  m_lostMarked = std::max (m_lostMarked, m_firstByteSeq.Get ());
+  m_lostHigh = std::max (m_lostHigh, m_firstByteSeq.Get ());
+  m_nextSegHint = std::max (m_nextSegHint, m_firstByteSeq.Get ());
 
   NS_LOG_DEBUG ("Discarded up to " << seq << " lost: " << m_lostOut <<
                 " retrans: " << m_retrans << " sacked: " << m_sackedOut);
@@ -796,26 +824,39 @@ TcpTxBuffer::Update (const TcpOptionSack::SackList &list,
 
   for (auto option_it = list.begin (); option_it != list.end (); ++option_it)
     {
-      PacketList::iterator item_it = m_sentList.begin ();
-      SequenceNumber32 beginOfCurrentPacket = m_firstByteSeq;
-
       if (m_firstByteSeq + m_sentSize < (*option_it).first)
         {
           NS_LOG_INFO ("Not updating scoreboard, the option block is outside the sent list");
           return bytesSacked;
         }
 
+      // The items starting before the block are not in it
+      PacketList::iterator item_it = FindSentItem (m_sentList.begin (), m_sentList.end (),
+                                                   (*option_it).first);
+      SequenceNumber32 beginOfCurrentPacket = m_firstByteSeq + m_sentSize;
+      if (item_it != m_sentList.end ())
+        {
+          beginOfCurrentPacket = (*item_it)->m_startSeq;
+        }
+
       while (item_it != m_sentList.end ())
         {
           uint32_t pktSize = (*item_it)->m_packet->GetSize ();
 
+          if (item_it == m_sentList.begin ())
+            {
+              // The head can not be SACKed: otherwise it would have been
+              // ACKed. The block is stale, e.g. it comes with an old ACK
+              NS_LOG_INFO ("Received block " << *option_it <<
+                           ", covering the head " << *(*item_it) << ", ignoring it");
+            }
           // Check the boundary of this packet ... only mark as sacked if
           // it is precisely mapped over the option. It means that if the receiver
           // is reporting as sacked single range bytes that are not mapped 1:1
           // in what we have, the option is discarded. There's room for improvement
           // here.
-          if (beginOfCurrentPacket >= (*option_it).first
-              && beginOfCurrentPacket + pktSize <= (*option_it).second)
+          else if (beginOfCurrentPacket >= (*option_it).first
+                   && beginOfCurrentPacket + pktSize <= (*option_it).second)
             {
               if ((*item_it)->m_sacked)
                 {
@@ -836,16 +877,16 @@ TcpTxBuffer::Update (const TcpOptionSack::SackList &list,
                   m_sackedOut += (*item_it)->m_packet->GetSize ();
                   bytesSacked += (*item_it)->m_packet->GetSize ();
 
-                  if (m_highestSack.first == m_sentList.end()
-                      || m_highestSack.second <= beginOfCurrentPacket + pktSize)
+                  if (!m_haveSack || m_highestSack <= beginOfCurrentPacket + pktSize)
                     {
-                      m_highestSack = std::make_pair (item_it, beginOfCurrentPacket);
+                      m_highestSack = beginOfCurrentPacket;
+                      m_haveSack = true;
                     }
 
                   NS_LOG_INFO ("Received block " << *option_it <<
                                ", checking sentList for block " << *(*item_it) <<
                                ", found in the sackboard, sacking, current highSack: " <<
-                               m_highestSack.second);
+                               m_highestSack);
 
                   if (!sackedCb.IsNull ())
                     {
@@ -869,7 +910,7 @@ TcpTxBuffer::Update (const TcpOptionSack::SackList &list,
 
   if (bytesSacked > 0)
     {
-      NS_ASSERT_MSG (m_highestSack.first != m_sentList.end(), "Buffer status: " << *this);
+      NS_ASSERT_MSG (m_haveSack, "Buffer status: " << *this);
       UpdateLostCount ();
     }
 
@@ -886,21 +927,24 @@ TcpTxBuffer::UpdateLostCount ()
 {
   NS_LOG_FUNCTION (this);
   uint32_t sacked = 0;
-  SequenceNumber32 beginOfCurrentPacket = m_highestSack.second;
-  if (m_highestSack.first == m_sentList.end ())
-    {
-      NS_LOG_INFO ("Status before the update: " << *this <<
-                   ", will start from the latest sent item");
-    }
-  else
-    {
-      NS_LOG_INFO ("Status before the update: " << *this <<
-                   ", will start from item " << *(*m_highestSack.first));
-    }
+  auto highestSack = FindSentItem (m_sentList.begin (), m_sentList.end (), m_highestSack + 1);
+  NS_ASSERT (highestSack != m_sentList.begin ());
+  --highestSack;
+  NS_LOG_INFO ("Status before the update: " << *this <<
+               ", will start from item " << *(*highestSack));
+
+  // The item where the sacked count reaches the threshold
+  auto thresholdItem = m_sentList.end ();
 
-  for (auto it = m_highestSack.first; it != m_sentList.begin(); --it)
+  for (auto it = highestSack; it != m_sentList.begin(); --it)
     {
       TcpTxItem *item = *it;
+      if (sacked >= m_dupAckThresh && item->m_startSeq < m_lostMarked)
+        {
+          // A previous update has marked this item and the ones below
+          break;
+        }
+
       if (item->m_sacked)
         {
           sacked++;
@@ -908,13 +952,16 @@ TcpTxBuffer::UpdateLostCount ()
 
       if (sacked >= m_dupAckThresh)
         {
+          if (thresholdItem == m_sentList.end ())
+            {
+              thresholdItem = it;
+            }
           if (!item->m_sacked && !item->m_lost)
             {
               item->m_lost = true;
               m_lostOut += item->m_packet->GetSize ();
             }
         }
-      beginOfCurrentPacket -= item->m_packet->GetSize ();
     }
 
   if (sacked >= m_dupAckThresh)
@@ -925,6 +972,15 @@ TcpTxBuffer::UpdateLostCount ()
           item->m_lost = true;
           m_lostOut += item->m_packet->GetSize ();
         }
+      m_lostHigh = std::max (m_lostHigh, item->m_startSeq + item->m_packet->GetSize ());
+
+      if (thresholdItem != m_sentList.end ())
+        {
+          // The items up to the threshold one are now lost or sacked
+          m_lostMarked = std::max (m_lostMarked, (*thresholdItem)->m_startSeq +
+                                   (*thresholdItem)->m_packet->GetSize ());
+          m_lostHigh = std::max (m_lostHigh, m_lostMarked);
+        }
     }
   NS_LOG_INFO ("Status after the update: " << *this);
   ConsistencyCheck ();
@@ -935,35 +991,26 @@ TcpTxBuffer::IsLost (const SequenceNumber32 &seq) const
 {
   NS_LOG_FUNCTION (this << seq);
 
-  SequenceNumber32 beginOfCurrentPacket = m_firstByteSeq;
-  PacketList::const_iterator it;
-
-  if (seq >= m_highestSack.second)
+  if (!m_haveSack || seq >= m_highestSack)
     {
       return false;
     }
 
-  // In theory, using a map and hints when inserting elements can improve
-  // performance
-  for (it = m_sentList.begin (); it != m_sentList.end (); ++it)
+  // Check from the first item starting at or after seq
+  for (auto it = FindSentItem (m_sentList.begin (), m_sentList.end (), seq);
+       it != m_sentList.end (); ++it)
     {
-      // Search for the right iterator before calling IsLost()
-      if (beginOfCurrentPacket >= seq)
+      if ((*it)->m_lost == true)
         {
-          if ((*it)->m_lost == true)
-            {
-              NS_LOG_INFO ("seq=" << seq << " is lost because of lost flag");
-              return true;
-            }
-
-          if ((*it)->m_sacked == true)
-            {
-              NS_LOG_INFO ("seq=" << seq << " is not lost because of sacked flag");
-              return false;
-            }
+          NS_LOG_INFO ("seq=" << seq << " is lost because of lost flag");
+          return true;
         }
 
-      beginOfCurrentPacket += (*it)->m_packet->GetSize ();
+      if ((*it)->m_sacked == true)
+        {
+          NS_LOG_INFO ("seq=" << seq << " is not lost because of sacked flag");
+          return false;
+        }
     }
 
   return false;
@@ -991,15 +1038,35 @@ TcpTxBuffer::NextSeg (SequenceNumber32 *seq, SequenceNumber32 *seqHigh, bool isR
   TcpTxItem *item;
   SequenceNumber32 seqPerRule3;
   bool isSeqPerRule3Valid = false;
-  SequenceNumber32 beginOfCurrentPkt = m_firstByteSeq;
+  bool isHintFound = false;
 
-  for (it = m_sentList.begin (); it != m_sentList.end (); ++it)
+  // The items before the hint are retransmitted or sacked
+  it = FindSentItem (m_sentList.begin (), m_sentList.end (), m_nextSegHint);
+  SequenceNumber32 beginOfCurrentPkt = m_firstByteSeq + m_sentSize;
+  if (it != m_sentList.end ())
+    {
+      beginOfCurrentPkt = (*it)->m_startSeq;
+    }
+
+  for (; it != m_sentList.end (); ++it)
     {
       item = *it;
 
+      if (beginOfCurrentPkt >= m_lostHigh && (!isRecovery || seqPerRule3.GetValue () != 0))
+        {
+          // No lost item from here on, and rule 3 does not need another one
+          break;
+        }
+
       // Condition 1.a , 1.b , and 1.c
       if (item->m_retrans == false && item->m_sacked == false)
         {
+          if (!isHintFound)
+            {
+              m_nextSegHint = beginOfCurrentPkt;
+              isHintFound = true;
+            }
+
           if (item->m_lost)
             {
               NS_LOG_INFO("IsLost, returning" << beginOfCurrentPkt);
@@ -1019,6 +1086,11 @@ TcpTxBuffer::NextSeg (SequenceNumber32 *seq, SequenceNumber32 *seqHigh, bool isR
       beginOfCurrentPkt += item->m_packet->GetSize ();
     }
 
+  if (!isHintFound)
+    {
+      m_nextSegHint = beginOfCurrentPkt;
+    }
+
   /* (2) If no sequence number 'S2' per rule (1) exists but there
    *     exists available unsent data and the receiver's advertised
    *     window allows, the sequence range of one segment of up to SMSS
@@ -1200,7 +1272,7 @@ TcpTxBuffer::IsLostRFC (const SequenceNumber32 &seq, const PacketList::const_ite
             }
         }
 
-      if (beginOfCurrentPacket >= m_highestSack.second)
+      if (!m_haveSack || beginOfCurrentPacket >= m_highestSack)
         {
           if (item->m_lost && !item->m_retrans)
             return true;
@@ -1211,10 +1283,7 @@ TcpTxBuffer::IsLostRFC (const SequenceNumber32 &seq, const PacketList::const_ite
 
       beginOfCurrentPacket += current->GetSize ();
     }
-  if (it == m_highestSack.first)
-    {
-      NS_LOG_INFO ("seq=" << seq << " is not lost because there are no sacked segment ahead " << m_highestSack.second);
-    }
+  NS_LOG_INFO ("seq=" << seq << " is not lost because there are no sacked segment ahead " << m_highestSack);
   return false;
 }
 
@@ -1229,7 +1298,8 @@ TcpTxBuffer::ResetRenoSack ()
       (*it)->m_sacked = false;
     }
 
-  m_highestSack = std::make_pair (m_sentList.end (), SequenceNumber32 (0));
+  m_highestSack = m_lostMarked = m_nextSegHint = m_firstByteSeq;
+  m_haveSack = false;
 }
 
 void
@@ -1258,7 +1328,8 @@ TcpTxBuffer::ResetSentList ()
   m_lostOut = 0;
   m_retrans = 0;
   m_sackedOut = 0;
-  m_highestSack = std::make_pair (m_sentList.end (), SequenceNumber32 (0));
+  m_highestSack = m_lostMarked = m_lostHigh = m_nextSegHint = m_firstByteSeq;
+  m_haveSack = false;
 }
 
 void
@@ -1276,6 +1347,8 @@ TcpTxBuffer::ResetLastSegmentSent ()
           m_retrans -= item->m_packet->GetSize ();
         }
       m_appList.insert (m_appList.begin (), item);
+      m_lostMarked = std::min (m_lostMarked, item->m_startSeq);
+      m_nextSegHint = std::min (m_nextSegHint, item->m_startSeq);
     }
   ConsistencyCheck ();
 }
@@ -1290,7 +1363,8 @@ TcpTxBuffer::SetSentListLost (bool resetSack)
     {
       m_sackedOut = 0;
       m_lostOut = m_sentSize;
-      m_highestSack = std::make_pair (m_sentList.end (), SequenceNumber32 (0));
+      m_highestSack = m_firstByteSeq;
+      m_haveSack = false;
     }
   else
     {
@@ -1322,6 +1396,10 @@ TcpTxBuffer::SetSentListLost (bool resetSack)
       (*it)->m_retrans = false;
     }
 
+  // Every item is now lost or sacked, and none is retransmitted
+  m_lostMarked = m_lostHigh = m_firstByteSeq + m_sentSize;
+  m_nextSegHint = m_firstByteSeq;
+
   NS_LOG_INFO ("Set sent list lost, status: " << *this);
   NS_ASSERT_MSG (m_sentSize >= m_sackedOut + m_lostOut, *this);
   ConsistencyCheck ();
@@ -1354,6 +1432,7 @@ TcpTxBuffer::DeleteRetransmittedFlagFromHead ()
     {
       m_sentList.front ()->m_retrans = false;
       m_retrans -= m_sentList.front ()->m_packet->GetSize ();
+      m_nextSegHint = m_firstByteSeq;
     }
   ConsistencyCheck ();
 }
@@ -1383,6 +1462,11 @@ TcpTxBuffer::MarkHeadAsLost ()
           m_sentList.front()->m_lost = true;
           m_lostOut += m_sentList.front ()->m_packet->GetSize ();
         }
+
+      SequenceNumber32 headEnd = m_firstByteSeq + m_sentList.front ()->m_packet->GetSize ();
+      m_lostMarked = std::max (m_lostMarked, headEnd);
+      m_lostHigh = std::max (m_lostHigh, headEnd);
+      m_nextSegHint = m_firstByteSeq;
     }
   ConsistencyCheck ();
 }
@@ -1417,7 +1501,8 @@ TcpTxBuffer::AddRenoSack (void)
     {
       (*it)->m_sacked = true;
       m_sackedOut += (*it)->m_packet->GetSize ();
-      m_highestSack = std::make_pair (it, (*it)->m_startSeq);
+      m_highestSack = (*it)->m_startSeq;
+      m_haveSack = true;
       NS_LOG_INFO ("Added a Reno SACK, status: " << *this);
     }
   else
@@ -1443,6 +1528,8 @@ TcpTxBuffer::ConsistencyCheck () const
   uint32_t lost = 0;
   uint32_t retrans = 0;
 
+  SequenceNumber32 beginOfCurrentPacket = m_firstByteSeq;
+
   for (auto it = m_sentList.begin (); it != m_sentList.end (); ++it)
     {
       if ((*it)->m_sacked)
@@ -1457,6 +1544,16 @@ TcpTxBuffer::ConsistencyCheck () const
         {
           retrans += (*it)->m_packet->GetSize ();
         }
+
+      NS_ASSERT_MSG ((*it)->m_startSeq == beginOfCurrentPacket,
+                     "Item " << **it << " is not at " << beginOfCurrentPacket);
+      NS_ASSERT_MSG (beginOfCurrentPacket >= m_lostMarked || (*it)->m_lost || (*it)->m_sacked,
+                     "Item " << **it << " is below m_lostMarked " << m_lostMarked);
+      NS_ASSERT_MSG (beginOfCurrentPacket < m_lostHigh || !(*it)->m_lost,
+                     "Item " << **it << " is above m_lostHigh " << m_lostHigh);
+      NS_ASSERT_MSG (beginOfCurrentPacket >= m_nextSegHint || (*it)->m_retrans || (*it)->m_sacked,
+                     "Item " << **it << " is below m_nextSegHint " << m_nextSegHint);
+      beginOfCurrentPacket += (*it)->m_packet->GetSize ();
     }
 
   NS_ASSERT_MSG (sacked == m_sackedOut, "Counted SACK: " << sacked <<
@@ -27,6 +27,7 @@
 #include "ns3/sequence-number.h"
 #include "ns3/tcp-option-sack.h"
 #include "ns3/tcp-tx-item.h"
+#include <deque>
 
 namespace ns3 {
 class Packet;
@@ -48,7 +49,8 @@ class Packet;
  * class is allowed to return only ordered (using "<" as operator) subsets
  * (e.g. 1,2 or 2,3 or 1,2,3).
  *
- * The data structure underlying this is composed by two distinct packet lists.
+ * The data structure underlying this is composed by two distinct packet arrays,
+ * kept in sequence order.
  * The first (SentList) is initially empty, and it contains the packets
  * returned by the method CopyFromSequence. The second (AppList) is initially
  * empty, and it contains the packets coming from the applications, but that
@@ -70,8 +72,19 @@ class Packet;
  * associated with every segment sent. This is done through the use of the
  * class TcpTxItem: instead of storing a list of packets, we store a list of
  * TcpTxItem. Each item has different flags (check the corresponding
- * documentation) and maintaining the scoreboard is a matter of travelling the
- * list and set the SACK flag on the corresponding segment sent.
+ * documentation) and maintaining the scoreboard is a matter of finding the
+ * segments sent that a SACK block covers, and set their SACK flag.
+ *
+ * The items of the SentList are contiguous and sorted by their starting
+ * sequence, so that a binary search finds the item of a sequence, instead of
+ * a walk from the head. For windows of tens of thousands of segments, the
+ * walks that remain are cut short with hints, which mark the prefixes of the
+ * SentList that a previous call already examined: the items before
+ * m_lostMarked are all lost or sacked, the lost items all start before
+ * m_lostHigh, and the items before m_nextSegHint are all retransmitted or
+ * sacked. A SACK option, a loss marking and a NextSeg call therefore examine
+ * the segments they change, and the few around them, rather than the whole
+ * window. The methods that clear a flag move the hints back.
  *
  * Item properties
  * ---------------
@@ -411,7 +424,7 @@ public:
 private:
   friend std::ostream & operator<< (std::ostream & os, TcpTxBuffer const & tcpTxBuf);
 
-  typedef std::list<TcpTxItem*> PacketList; //!< container for data stored in the buffer
+  typedef std::deque<TcpTxItem*> PacketList; //!< container for data stored in the buffer
 
   /**
    * \brief Update the lost count
@@ -428,8 +441,9 @@ private:
    * The {New}Reno cases, for now, are managed in TcpSocketBase through the
    * call to MarkHeadAsLost.
    * This function is, therefore, called after a SACK option has been received,
-   * and updates the lost count. It can be probably optimized by not walking
-   * the entire list, but a subset.
+   * and updates the lost count. The walk starts from the highest sacked
+   * segment, and stops at m_lostMarked: the segments below it have been
+   * marked by a previous update.
    *
    */
   void UpdateLostCount ();
@@ -594,6 +608,19 @@ private:
    */
   void ConsistencyCheck () const;
 
+  /**
+   * \brief Find the first item of the sent list that starts at or after a sequence
+   *
+   * The items of the sent list are sorted by sequence: a binary search finds it.
+   *
+   * \param begin the first item of the sent list
+   * \param end the end of the sent list
+   * \param seq Sequence
+   * \return the item, or end if all the items start before seq
+   */
+  template <class Iterator>
+  static Iterator FindSentItem (Iterator begin, Iterator end, const SequenceNumber32 &seq);
+
   /**
    * \brief Find the highest SACK byte
    * \return a pair with the highest byte and an iterator inside m_sentList
@@ -609,7 +636,12 @@ private:
   Callback<uint32_t> m_rWndCallback; //!< Callback to obtain RCV.WND value
 
   TracedValue<SequenceNumber32> m_firstByteSeq; //!< Sequence number of the first byte in data (SND.UNA)
-  std::pair <PacketList::const_iterator, SequenceNumber32> m_highestSack; //!< Highest SACK byte
+  SequenceNumber32 m_highestSack; //!< Start of the highest SACKed item, if m_haveSack, SND.UNA or less otherwise
+  bool m_haveSack {false};        //!< Whether an item is SACKed, m_highestSack being the highest one
+
+  SequenceNumber32 m_lostMarked;  //!< The sent items starting before it are lost or sacked
+  SequenceNumber32 m_lostHigh;    //!< The lost items start before it
+  mutable SequenceNumber32 m_nextSegHint; //!< The sent items starting before it are retransmitted or sacked
 
   uint32_t m_lostOut   {0}; //!< Number of lost bytes
   uint32_t m_sackedOut {0}; //!< Number of sacked bytes
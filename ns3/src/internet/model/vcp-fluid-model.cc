@@ -0,0 +1,310 @@
+/*
+ * vcp-fluid-model.cc
+ */
+
+#include <algorithm>
+
+#include "vcp-fluid-model.h"
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
+#include "ns3/vcp-queue-disc.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE("VcpFluidModel");
+NS_OBJECT_ENSURE_REGISTERED(VcpFluidModel);
+
+TypeId
+VcpFluidModel::GetTypeId()
+{
+  static TypeId tid = TypeId("ns3::VcpFluidModel")
+    .SetParent<Object>()
+    .SetGroupName("Internet")
+    .AddConstructor<VcpFluidModel>()
+    .AddAttribute("MaxSize",
+                  "The maximum number of packets in the bottleneck queue.",
+                  QueueSizeValue(QueueSize("25p")),
+                  MakeQueueSizeAccessor(&VcpFluidModel::m_maxSize),
+                  MakeQueueSizeChecker())
+    .AddAttribute("LinkBandwidth",
+                  "The bottleneck link bandwidth.",
+                  DataRateValue(DataRate("1.5Mbps")),
+                  MakeDataRateAccessor(&VcpFluidModel::m_linkBandwidth),
+                  MakeDataRateChecker())
+    .AddAttribute("TimeInterval",
+                  "Interval over which to sample load factor.",
+                  TimeValue(MilliSeconds(200)),
+                  MakeTimeAccessor(&VcpFluidModel::m_timeInterval),
+                  MakeTimeChecker())
+    .AddAttribute("SampleInterval",
+                  "Interval at which the queue is sampled and the model is stepped.",
+                  TimeValue(MilliSeconds(10)),
+                  MakeTimeAccessor(&VcpFluidModel::m_sampleInterval),
+                  MakeTimeChecker())
+    .AddAttribute("K_q",
+                  "K_q factor used while calculating load factor.",
+                  DoubleValue(0.5),
+                  MakeDoubleAccessor(&VcpFluidModel::m_kq),
+                  MakeDoubleChecker<double>())
+    .AddAttribute("TargetUtil",
+                  "Target utilization of link capacity.",
+                  DoubleValue(1.0),
+                  MakeDoubleAccessor(&VcpFluidModel::m_targetUtil),
+                  MakeDoubleChecker<double>())
+    .AddAttribute("PacketSize",
+                  "Size in bytes of a data packet as seen by the bottleneck queue.",
+                  UintegerValue(1000),
+                  MakeUintegerAccessor(&VcpFluidModel::m_packetSize),
+                  MakeUintegerChecker<uint32_t>(1))
+    .AddAttribute("InitialCwnd",
+                  "Initial congestion window of every flow, in segments.",
+                  UintegerValue(1),
+                  MakeUintegerAccessor(&VcpFluidModel::m_initialCWnd),
+                  MakeUintegerChecker<uint32_t>(1))
+  ;
+
+  return tid;
+}
+
+VcpFluidModel::VcpFluidModel()
+{
+  NS_LOG_FUNCTION(this);
+}
+
+VcpFluidModel::~VcpFluidModel()
+{
+  NS_LOG_FUNCTION(this);
+}
+
+void
+VcpFluidModel::DoDispose()
+{
+  NS_LOG_FUNCTION(this);
+  m_stepEvent.Cancel();
+  m_flows.clear();
+  Object::DoDispose();
+}
+
+void
+VcpFluidModel::AddFlow(Time start, Time baseRtt)
+{
+  NS_LOG_FUNCTION(this << start << baseRtt);
+  NS_ASSERT_MSG(baseRtt.IsStrictlyPositive(), "Flows need a positive RTT");
+
+  Flow flow;
+  flow.cc = CreateObject<Vcp>();
+  flow.start = start;
+  flow.baseRtt = baseRtt;
+  m_flows.push_back(flow);
+}
+
+void
+VcpFluidModel::Start()
+{
+  NS_LOG_FUNCTION(this);
+  NS_ASSERT_MSG(m_maxSize.GetUnit() == QueueSizeUnit::PACKETS,
+                "The fluid model only supports queue sizes in packets");
+
+  m_recentQueueSizes.push_back(0); // same initial sample as VcpQueueDisc
+  m_loadHistory.emplace_back(Simulator::Now(), VcpPacketTag::LOAD_LOW);
+  m_nextLoadFactor = Simulator::Now() + m_timeInterval;
+  m_stepEvent = Simulator::Schedule(m_sampleInterval, &VcpFluidModel::Step, this);
+}
+
+VcpFluidModel::Stats
+VcpFluidModel::GetStats() const
+{
+  Stats stats;
+  stats.nTotalSentPackets = static_cast<uint32_t>(m_sentPackets);
+  stats.nTotalSentBytes = static_cast<uint64_t>(m_sentPackets * m_packetSize);
+  stats.nTotalDroppedPackets = static_cast<uint32_t>(m_droppedPackets);
+  return stats;
+}
+
+QueueSize
+VcpFluidModel::GetCurrentSize() const
+{
+  return QueueSize(QueueSizeUnit::PACKETS, static_cast<uint32_t>(std::lround(m_queue)));
+}
+
+QueueSize
+VcpFluidModel::GetMaxSize() const
+{
+  return m_maxSize;
+}
+
+double
+VcpFluidModel::GetLoadFactor() const
+{
+  return m_loadFactor;
+}
+
+double
+VcpFluidModel::GetCWnd(uint32_t flow) const
+{
+  NS_ASSERT(flow < m_flows.size());
+  return m_flows[flow].cWnd;
+}
+
+void
+VcpFluidModel::Step()
+{
+  NS_LOG_FUNCTION(this);
+
+  Time now = Simulator::Now();
+  double dt = m_sampleInterval.GetSeconds();
+  double bitRate = static_cast<double>(m_linkBandwidth.GetBitRate());
+  double maxQ = m_maxSize.GetValue();
+
+  // Everybody sees the queueing delay of the start of the step
+  Time queueDelay = Seconds(m_queue * m_packetSize * 8. / bitRate);
+
+  // Aggregate arrivals (packets) over the step
+  double arrivals = 0.0;
+  for (auto &flow : m_flows) {
+    if (now < flow.start) {
+      continue;
+    }
+    if (!flow.started) {
+      flow.started = true;
+      flow.cWnd = static_cast<double>(m_initialCWnd) * flow.cc->m_segSize;
+      flow.prevCWnd = flow.cWnd;
+      flow.nextPrevCWnd = now + flow.cc->m_estInterval;
+    }
+    Time rtt = flow.baseRtt + queueDelay;
+    arrivals += flow.cWnd / flow.cc->m_segSize / rtt.GetSeconds() * dt;
+  }
+
+  // Drain the bottleneck at link rate and drop what does not fit
+  double capacity = bitRate / (m_packetSize * 8.) * dt;
+  double backlog = m_queue + arrivals;
+  double served = std::min(backlog, capacity);
+  double drops = 0.0;
+  m_queue = backlog - served;
+  if (m_queue > maxQ) {
+    drops = m_queue - maxQ;
+    m_queue = maxQ;
+  }
+
+  m_sentPackets += served;
+  m_droppedPackets += drops;
+  m_recentArrivals += arrivals;
+
+  // Queue size sampling, as in VcpQueueDisc::SampleQueueSize
+  if (m_recentQueueSizes.size() >=
+          static_cast<size_t>(m_timeInterval.GetMilliSeconds() /
+                              m_sampleInterval.GetMilliSeconds())) {
+    m_qSizesSum -= m_recentQueueSizes.front();
+    m_recentQueueSizes.pop_front();
+  }
+  m_recentQueueSizes.push_back(m_queue);
+  m_qSizesSum += m_queue;
+
+  if (now >= m_nextLoadFactor) {
+    CalcLoadFactor();
+    m_nextLoadFactor += m_timeInterval;
+  }
+
+  // Feedback reaches the sender roughly half an RTT after being stamped
+  Time oldestLookup = now;
+  for (auto &flow : m_flows) {
+    if (!flow.started) {
+      continue;
+    }
+    if (drops > 0.0) {
+      flow.lossPending = true;
+    }
+
+    Time rtt = flow.baseRtt + queueDelay;
+    Time stamped = now - rtt / 2;
+    oldestLookup = std::min(oldestLookup, stamped);
+
+    StepFlow(flow, GetLoadAt(stamped), rtt, dt);
+
+    // Vcp::StorePrevCwnd runs once per estimation interval
+    if (now >= flow.nextPrevCWnd) {
+      flow.prevCWnd = flow.cWnd;
+      flow.nextPrevCWnd += flow.cc->m_estInterval;
+    }
+  }
+
+  while (m_loadHistory.size() > 1 && m_loadHistory[1].first <= oldestLookup) {
+    m_loadHistory.pop_front();
+  }
+
+  NS_LOG_DEBUG("(VCP) fluid t=" << now.GetSeconds() << " q=" << m_queue
+               << " arrivals=" << arrivals << " drops=" << drops);
+
+  m_stepEvent = Simulator::Schedule(m_sampleInterval, &VcpFluidModel::Step, this);
+}
+
+void
+VcpFluidModel::CalcLoadFactor()
+{
+  NS_LOG_FUNCTION(this);
+
+  double persistQSize = m_qSizesSum / m_recentQueueSizes.size();
+  m_loadFactor = VcpQueueDisc::ComputeLoadFactor(m_recentArrivals, persistQSize,
+                                                 m_kq, m_targetUtil,
+                                                 m_linkBandwidth, m_timeInterval);
+  m_recentArrivals = 0.0;
+
+  VcpPacketTag::LoadType load = VcpQueueDisc::LoadFactorToLoad(m_loadFactor);
+  if (load != m_loadHistory.back().second) {
+    m_loadHistory.emplace_back(Simulator::Now(), load);
+  }
+
+  NS_LOG_DEBUG("(VCP) fluid m_loadFactor=" << m_loadFactor << ", load=" << load);
+}
+
+VcpPacketTag::LoadType
+VcpFluidModel::GetLoadAt(Time t) const
+{
+  VcpPacketTag::LoadType load = m_loadHistory.front().second;
+  for (const auto &entry : m_loadHistory) {
+    if (entry.first > t) {
+      break;
+    }
+    load = entry.second;
+  }
+  return load;
+}
+
+void
+VcpFluidModel::StepFlow(Flow &flow, VcpPacketTag::LoadType load, Time rtt, double dt)
+{
+  Ptr<Vcp> cc = flow.cc;
+  Time now = Simulator::Now();
+  int64_t rttMs = rtt.GetMilliSeconds();
+  double rtts = dt / rtt.GetSeconds(); // RTTs elapsed during this step
+
+  if (flow.lossPending) {
+    load = VcpPacketTag::LOAD_OVERLOAD;
+    flow.lossPending = false;
+  }
+
+  // Freeze cwnd after MD, then one RTT of AI
+  if (now < flow.mdFreezeEnd) {
+    return;
+  }
+  bool aiAfterMd = now < flow.aiEnd;
+
+  if (load == VcpPacketTag::LOAD_LOW && !aiAfterMd) {
+    double tmp = flow.cWnd * std::pow(1. + cc->GetScaledXi(rttMs), rtts);
+    flow.cWnd = std::min(tmp, flow.prevCWnd * cc->m_maxCWndIncreasePerRtt);
+  } else if (load == VcpPacketTag::LOAD_HIGH || aiAfterMd) {
+    double tmp = flow.cWnd + cc->GetScaledAlpha(rttMs) * cc->m_segSize * rtts;
+    if (tmp - flow.prevCWnd > cc->m_segSize) {
+      tmp = std::max(flow.prevCWnd + cc->m_segSize, flow.cWnd);
+    }
+    flow.cWnd = tmp;
+  } else if (load == VcpPacketTag::LOAD_OVERLOAD) {
+    flow.cWnd *= cc->m_beta;
+    flow.mdFreezeEnd = now + cc->m_estInterval;
+    flow.aiEnd = flow.mdFreezeEnd + rtt;
+  }
+}
+
+} // namespace ns3
@@ -0,0 +1,120 @@
+/*
+ * vcp-fluid-model.h
+ *
+ * Fluid approximation of a set of Vcp flows sharing one VcpQueueDisc
+ * bottleneck. Instead of simulating every packet, the model advances the
+ * aggregate arrival rate, the bottleneck queue and every flow's cwnd once
+ * per queue sample interval, and recomputes the load factor once per
+ * estimation interval. This makes multi-Gbps datapoints feasible.
+ *
+ * Limitations: only the forward data path through the bottleneck is
+ * modeled. ACKs, reverse traffic and the (non-bottleneck) access links are
+ * ignored, and losses are assumed to hit every active flow (drop-tail
+ * synchronization).
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/data-rate.h"
+#include "ns3/event-id.h"
+#include "ns3/queue-size.h"
+#include "ns3/vcp-packet-tag.h"
+
+#include "vcp.h"
+
+namespace ns3 {
+
+class VcpFluidModel : public Object {
+public:
+  /* Subset of QueueDisc::Stats, so the same tracers work for both engines. */
+  struct Stats {
+    uint32_t nTotalSentPackets {0};
+    uint64_t nTotalSentBytes {0};
+    uint32_t nTotalDroppedPackets {0};
+  };
+
+  static TypeId GetTypeId();
+
+  VcpFluidModel();
+
+  ~VcpFluidModel();
+
+  /* Add a flow starting at start with propagation round-trip time baseRtt.
+   * Its Vcp parameters are taken from the ns3::Vcp attribute defaults. */
+  void AddFlow(Time start, Time baseRtt);
+
+  /* Schedule the first step; the model then follows the simulator clock. */
+  void Start();
+
+  Stats GetStats() const;
+  QueueSize GetCurrentSize() const;
+  QueueSize GetMaxSize() const;
+  double GetLoadFactor() const;
+
+  /* Congestion window (bytes) of the given flow. */
+  double GetCWnd(uint32_t flow) const;
+
+protected:
+  void DoDispose() override;
+
+private:
+  struct Flow {
+    Ptr<Vcp> cc;
+    Time start;
+    Time baseRtt;
+    double cWnd {0.0};
+    double prevCWnd {0.0};
+    Time nextPrevCWnd;
+    Time mdFreezeEnd;
+    Time aiEnd;
+    bool started {false};
+    bool lossPending {false};
+  };
+
+  /* Advance the model by one sample interval. */
+  void Step();
+
+  /* Same computation as VcpQueueDisc::CalcLoadFactor. */
+  void CalcLoadFactor();
+
+  /* Load state that was stamped on packets at time t. */
+  VcpPacketTag::LoadType GetLoadAt(Time t) const;
+
+  /* MI/AI/MD for one flow over dt seconds, mirroring Vcp::CongControl. */
+  void StepFlow(Flow &flow, VcpPacketTag::LoadType load, Time rtt, double dt);
+
+  /* Attributes */
+  DataRate m_linkBandwidth;
+  QueueSize m_maxSize;
+  Time m_timeInterval;
+  Time m_sampleInterval;
+  double m_kq;
+  double m_targetUtil;
+  uint32_t m_packetSize;
+  uint32_t m_initialCWnd;
+
+  std::vector<Flow> m_flows;
+
+  /* Bottleneck state, in (fractional) packets. */
+  double m_queue {0.0};
+  double m_qSizesSum {0.0};
+  std::deque<double> m_recentQueueSizes;
+  double m_recentArrivals {0.0};
+  double m_loadFactor {0.0};
+  Time m_nextLoadFactor;
+
+  /* Load state changes, oldest first, kept as long as some flow may see them. */
+  std::deque<std::pair<Time, VcpPacketTag::LoadType>> m_loadHistory;
+
+  double m_sentPackets {0.0};
+  double m_droppedPackets {0.0};
+
+  EventId m_stepEvent;
+};
+
+} // namespace ns3
@@ -8,6 +8,7 @@
 #include "vcp.h"
 #include "ns3/log.h"
 #include "ns3/simulator.h"
+#include "ns3/boolean.h"
 
 namespace ns3 {
 
@@ -56,6 +57,11 @@ Vcp::GetTypeId()
                   UintegerValue(948),
                   MakeUintegerAccessor(&Vcp::m_segSize),
                   MakeUintegerChecker<uint32_t>())
+    .AddAttribute("Batched",
+                  "Update cwnd once per RTT, or right away on overload, instead of on every ACK.",
+                  BooleanValue(false),
+                  MakeBooleanAccessor(&Vcp::m_batched),
+                  MakeBooleanChecker())
   ;
 
   return tid;
@@ -66,14 +72,21 @@ Vcp::Vcp() : TcpCongestionOps()
   NS_LOG_FUNCTION(this);
 }
 
-Vcp::Vcp(const Vcp& sock) : TcpCongestionOps(sock)
+Vcp::Vcp(const Vcp& sock)
+  : TcpCongestionOps(sock),
+    m_xi(sock.m_xi),
+    m_alpha(sock.m_alpha),
+    m_beta(sock.m_beta),
+    m_xiBound(sock.m_xiBound),
+    m_estInterval(sock.m_estInterval),
+    m_batched(sock.m_batched),
+    m_maxCWndIncreasePerRtt(sock.m_maxCWndIncreasePerRtt),
+    m_segSize(sock.m_segSize)
 {
   NS_LOG_FUNCTION(this);
 }
 
 Vcp::~Vcp() {
-  m_mdTimer.Cancel();
-  m_cWndIncreaseTimer.Cancel();
 }
 
 //void
@@ -140,8 +153,22 @@ Vcp::CongControl(
     const TcpRateOps::TcpRateConnection &rc,
     const TcpRateOps::TcpRateSample &rs)
 {
-  // return;
-  // (VCP) TODO: potential place to do CC
+  Time now = Simulator::Now();
+  LoadState_t load = (LoadState_t)tcb->m_vcpLoadIn;
+
+  // Batched mode: only remember the worst load until the next update is due,
+  // overload is acted on right away
+  if (m_batched && m_cWndFractionalInit) {
+    if (load > m_pendingLoad) {
+      m_pendingLoad = load;
+    }
+    if (now < m_nextUpdate && m_pendingLoad != LOAD_OVERLOAD) {
+      return;
+    }
+    load = m_pendingLoad;
+    m_pendingLoad = LOAD_NOT_SUPPORTED;
+    m_nextUpdate = now + tcb->m_lastRtt.Get();
+  }
 
   // Update RTT
   m_lastRtt = tcb->m_lastRtt.Get().GetMilliSeconds();
@@ -149,88 +176,28 @@ Vcp::CongControl(
   NS_LOG_FUNCTION(this << tcb << &rc << &rs);
   NS_LOG_DEBUG("(VCP) tcb->m_cWnd=" << tcb->m_cWnd);
 
-  // Update load state
-  m_loadState = (LoadState_t)tcb->m_vcpLoadIn;
-  NS_LOG_DEBUG("(VCP) m_loadState=" << m_loadState);
-
   if (!m_cWndFractionalInit) {
     m_cWndFractional = static_cast<double>(tcb->m_cWnd);
     m_cWndFractionalInit = true;
 
     m_prevCWnd = tcb->m_cWnd;
-    m_cWndIncreaseTimer.SetFunction(&Vcp::StorePrevCwnd, this);
-    m_cWndIncreaseTimer.Schedule(MilliSeconds(m_lastRtt));
-  }
-
-  // If the load bits are not supported, fall back to TCP New Reno
-  if (m_loadState == LOAD_NOT_SUPPORTED) {
-    // TODO: What to do if not supported?
-    // m_cWndFractional = static_cast<double>(tcb->m_cWnd);
-    return;
-  }
-
-  // Freeze cwnd after MD
-  if (m_mdFreeze && m_mdTimer.IsRunning()) {
-    NS_LOG_DEBUG("(VCP) freezing cwnd after MD");
-    return;
-  } else if (m_mdFreeze && m_mdTimer.IsExpired()) {
-    m_mdFreeze = false;
-    m_mdTimer.SetFunction(&Vcp::Noop, this);
-    m_mdTimer.Schedule(MilliSeconds(m_lastRtt));
-    NS_LOG_DEBUG("(VCP) set additive increase RTT=" << m_lastRtt);
+    m_nextPrevCWnd = now + MilliSeconds(m_lastRtt);
+    m_nextUpdate = now + tcb->m_lastRtt.Get();
   }
 
-  // Perform AI for one RTT after 
-  if (!m_mdFreeze && m_mdTimer.IsRunning()) {
-    NS_LOG_DEBUG("(VCP) one RTT of additive increase after MD freeze period");
-    AdditiveIncrease(tcb);
-    return;
-  } 
-
-  switch (m_loadState) {
-    case LOAD_LOW:
-      MultiplicativeIncrease(tcb);
-      break;
-    case LOAD_HIGH:
-      AdditiveIncrease(tcb);
-      break;
-    case LOAD_OVERLOAD:
-      MultiplicativeDecrease(tcb);
-      m_mdFreeze = true;
-      m_mdTimer.SetFunction(&Vcp::Noop, this);
-      m_mdTimer.Schedule(m_estInterval);
-      break;
-    default:
-      NS_LOG_DEBUG("loadState = " << m_loadState << ", something went wrong.");
-      break;
-  }
+  StorePrevCwnd();
+  UpdateWindow(tcb, load);
 }
 
 void
-Vcp::PktsAcked(Ptr<TcpSocketState> tcb, uint32_t segmentsAcked, const Time &rtt)
+Vcp::UpdateWindow(Ptr<TcpSocketState> tcb, LoadState_t load)
 {
-  return;
-  // (VCP) TODO: potential place to do CC
-
-  // Update RTT
-  m_lastRtt = rtt.GetMilliSeconds();
-
-  NS_LOG_FUNCTION(this << tcb << segmentsAcked << rtt);
-  NS_LOG_DEBUG("(VCP) tcb->m_cWnd=" << tcb->m_cWnd);
+  Time now = Simulator::Now();
 
   // Update load state
-  m_loadState = (LoadState_t)tcb->m_vcpLoadIn;
+  m_loadState = load;
   NS_LOG_DEBUG("(VCP) m_loadState=" << m_loadState);
 
-  if (!m_cWndFractionalInit) {
-    m_cWndFractional = static_cast<double>(tcb->m_cWnd);
-    m_cWndFractionalInit = true;
-
-    m_prevCWnd = tcb->m_cWnd;
-    m_cWndIncreaseTimer.SetFunction(&Vcp::StorePrevCwnd, this);
-    m_cWndIncreaseTimer.Schedule(m_estInterval);
-  }
-
   // If the load bits are not supported, fall back to TCP New Reno
   if (m_loadState == LOAD_NOT_SUPPORTED) {
     // TODO: What to do if not supported?
@@ -239,18 +206,17 @@ Vcp::PktsAcked(Ptr<TcpSocketState> tcb, uint32_t segmentsAcked, const Time &rtt)
   }
 
   // Freeze cwnd after MD
-  if (m_mdFreeze && m_mdTimer.IsRunning()) {
+  if (m_mdFreeze && now < m_mdEnd) {
     NS_LOG_DEBUG("(VCP) freezing cwnd after MD");
     return;
-  } else if (m_mdFreeze && m_mdTimer.IsExpired()) {
+  } else if (m_mdFreeze) {
     m_mdFreeze = false;
-    m_mdTimer.SetFunction(&Vcp::Noop, this);
-    m_mdTimer.Schedule(MilliSeconds(m_lastRtt));
+    m_aiEnd = now + MilliSeconds(m_lastRtt);
     NS_LOG_DEBUG("(VCP) set additive increase RTT=" << m_lastRtt);
   }
 
   // Perform AI for one RTT after 
-  if (!m_mdFreeze && m_mdTimer.IsRunning()) {
+  if (now < m_aiEnd) {
     NS_LOG_DEBUG("(VCP) one RTT of additive increase after MD freeze period");
     AdditiveIncrease(tcb);
     return;
@@ -266,14 +232,19 @@ Vcp::PktsAcked(Ptr<TcpSocketState> tcb, uint32_t segmentsAcked, const Time &rtt)
     case LOAD_OVERLOAD:
       MultiplicativeDecrease(tcb);
       m_mdFreeze = true;
-      m_mdTimer.SetFunction(&Vcp::Noop, this);
-      m_mdTimer.Schedule(m_estInterval);
+      m_mdEnd = now + m_estInterval;
       break;
     default:
       NS_LOG_DEBUG("loadState = " << m_loadState << ", something went wrong.");
       break;
   }
+}
 
+void
+Vcp::PktsAcked(Ptr<TcpSocketState> tcb, uint32_t segmentsAcked, const Time &rtt)
+{
+  // (VCP) Window updates happen in CongControl
+  return;
 }
 
 void
@@ -341,27 +312,31 @@ Vcp::MultiplicativeDecrease(Ptr<TcpSocketState> tcb)
 }
 
 void
-Vcp::Noop()
+Vcp::StorePrevCwnd()
 {
-}
+  Time now = Simulator::Now();
+  if (now < m_nextPrevCWnd) {
+    return;
+  }
 
-void
-Vcp::EndMdFreezePeriod()
-{
+  // cwnd only changes on ACKs, so it still holds the value it had when the
+  // snapshot was due
+  m_prevCWnd = static_cast<uint32_t>(m_cWndFractional);
+  NS_LOG_DEBUG("(VCP) stored m_prevCWnd=" << m_prevCWnd);
+
+  int64_t missed = (now - m_nextPrevCWnd).GetTimeStep() / m_estInterval.GetTimeStep() + 1;
+  m_nextPrevCWnd += m_estInterval * missed;
 }
 
 void
-Vcp::StorePrevCwnd()
+Vcp::ExtendScaledTables(int64_t rtt)
 {
-  NS_LOG_FUNCTION(this);
+  NS_LOG_FUNCTION(this << rtt);
 
-  m_prevCWnd = static_cast<uint32_t>(m_cWndFractional);
-  NS_LOG_DEBUG("(VCP) stored m_prevCWnd=" << m_prevCWnd);
-
-  NS_LOG_DEBUG("(VCP) scheduling StorePrevCwnd with rtt=" << m_estInterval);
-  m_cWndIncreaseTimer.SetFunction(&Vcp::StorePrevCwnd, this);
-  m_cWndIncreaseTimer.Cancel();
-  m_cWndIncreaseTimer.Schedule(m_estInterval);
+  for (int64_t i = m_scaledXi.size(); i <= rtt; i++) {
+    m_scaledXi.push_back(ComputeScaledXi(i));
+    m_scaledAlpha.push_back(ComputeScaledAlpha(i));
+  }
 }
 
 } // namespace ns3
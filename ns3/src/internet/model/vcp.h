@@ -8,12 +8,14 @@
 #pragma once
 
 #include <cmath>
+#include <vector>
 
 #include "ns3/tcp-congestion-ops.h"
 #include "ns3/tcp-socket-state.h"
-#include "ns3/timer.h"
 
 namespace ns3 {
+
+class VcpFluidModel;
   
 class Vcp : public TcpCongestionOps {
 public:
@@ -42,6 +44,9 @@ public:
   void CwndEvent (Ptr<TcpSocketState> tcb, const TcpSocketState::TcpCAEvent_t event);
 
 private:
+  /* The fluid model steps flows with the same parameters and scaling. */
+  friend class VcpFluidModel;
+
   /* Load state of the current connection. */
   typedef enum {
     LOAD_NOT_SUPPORTED = 0x0,
@@ -64,41 +69,81 @@ private:
   /* Load factor estimation interval in ns. */
   Time m_estInterval {MilliSeconds(200)};
 
+  /* Update cwnd once per RTT (or on overload) instead of on every ACK. */
+  bool m_batched {false};
+
+  /* Run the MI/AI/MD state machine for the given load. */
+  void UpdateWindow(Ptr<TcpSocketState> tcb, LoadState_t load);
+
   /* MI, AI, and MD algorithms. */
   void MultiplicativeIncrease(Ptr<TcpSocketState> tcb);
   void AdditiveIncrease(Ptr<TcpSocketState> tcb);
   void MultiplicativeDecrease(Ptr<TcpSocketState> tcb);
 
-  /* Timer functions */
-  void Noop();
-  void EndMdFreezePeriod();
+  /* Catch up on the per estimation interval snapshots of cwnd. */
   void StorePrevCwnd();
 
+  /* RTTs (ms) up to this value use the precomputed scaled parameters. */
+  static const int64_t MAX_TABLE_RTT = 4096;
+
   /* Scaled MI and AI params based on flow-specific RTT. */
-  inline double GetScaledXi(int64_t rtt) {
+  inline double ComputeScaledXi(int64_t rtt) const {
     return std::min(
       pow(1 + m_xi, static_cast<double>(rtt) / m_estInterval.GetMilliSeconds()) - 1,
       m_xiBound
     );
   }
 
-  inline double GetScaledAlpha(int64_t rtt) {
+  inline double ComputeScaledAlpha(int64_t rtt) const {
     return (m_alpha * (static_cast<double>(rtt) / m_estInterval.GetMilliSeconds()) 
                     * (static_cast<double>(rtt) / m_estInterval.GetMilliSeconds()));
   }
 
+  /* Same as above, looked up in tables filled up to the largest RTT seen. */
+  inline double GetScaledXi(int64_t rtt) {
+    if (rtt < 0 || rtt > MAX_TABLE_RTT) {
+      return ComputeScaledXi(rtt);
+    }
+    if (static_cast<size_t>(rtt) >= m_scaledXi.size()) {
+      ExtendScaledTables(rtt);
+    }
+    return m_scaledXi[rtt];
+  }
+
+  inline double GetScaledAlpha(int64_t rtt) {
+    if (rtt < 0 || rtt > MAX_TABLE_RTT) {
+      return ComputeScaledAlpha(rtt);
+    }
+    if (static_cast<size_t>(rtt) >= m_scaledAlpha.size()) {
+      ExtendScaledTables(rtt);
+    }
+    return m_scaledAlpha[rtt];
+  }
+
+  void ExtendScaledTables(int64_t rtt);
+
+  /* Scaled MI and AI params indexed by RTT in ms. */
+  std::vector<double> m_scaledXi;
+  std::vector<double> m_scaledAlpha;
+
   /* The load state of the connection. */
   LoadState_t m_loadState {LOAD_LOW};
 
   /* The last recorded RTT for the connection. */
   int64_t m_lastRtt {0};
 
-  /* Timer to freeze cwnd after decreasing. */
-  Timer m_mdTimer;
+  /* Freeze cwnd after decreasing until m_mdEnd, then AI until m_aiEnd. */
   bool m_mdFreeze {false};
+  Time m_mdEnd;
+  Time m_aiEnd;
 
-  Timer m_cWndIncreaseTimer;
+  /* cwnd at the start of the current estimation interval. */
   uint32_t m_prevCWnd;
+  Time m_nextPrevCWnd;
+
+  /* Worst load seen since the last batched update, and when the next is due. */
+  LoadState_t m_pendingLoad {LOAD_NOT_SUPPORTED};
+  Time m_nextUpdate;
   double m_maxCWndIncreasePerRtt {1.0625};
 
   /* Fractional cwnd. */
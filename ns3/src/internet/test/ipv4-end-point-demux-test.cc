@@ -0,0 +1,204 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/test.h"
+#include "ns3/log.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/ipv4-interface-address.h"
+#include "ns3/ipv4-end-point.h"
+#include "ns3/ipv4-end-point-demux.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("Ipv4EndPointDemuxTestSuite");
+
+/**
+ * \ingroup internet-tests
+ * \ingroup tests
+ *
+ * \brief The Ipv4EndPointDemux Test
+ */
+class Ipv4EndPointDemuxTestCase : public TestCase
+{
+public:
+  Ipv4EndPointDemuxTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Test which endpoint of a port gets a packet, from the least to
+   * the most specific one.
+   */
+  void TestPrecedence ();
+  /**
+   * \brief Test that SetPeer moves an endpoint to the index of its new peer.
+   */
+  void TestSetPeer ();
+  /**
+   * \brief Look up the endpoint of a packet.
+   * \param demux the demux
+   * \param daddr destination address
+   * \param dport destination port
+   * \param saddr source address
+   * \param sport source port
+   * \returns the matching endpoint, or 0 if none
+   */
+  Ipv4EndPoint *Lookup (Ipv4EndPointDemux &demux,
+                        const char *daddr, uint16_t dport,
+                        const char *saddr, uint16_t sport);
+
+  Ptr<Ipv4Interface> m_interface; //!< The incoming interface of the packets
+};
+
+Ipv4EndPointDemuxTestCase::Ipv4EndPointDemuxTestCase ()
+  : TestCase ("Ipv4EndPointDemux test")
+{
+}
+
+Ipv4EndPoint *
+Ipv4EndPointDemuxTestCase::Lookup (Ipv4EndPointDemux &demux,
+                                   const char *daddr, uint16_t dport,
+                                   const char *saddr, uint16_t sport)
+{
+  Ipv4EndPointDemux::EndPoints endPoints = demux.Lookup (Ipv4Address (daddr), dport,
+                                                         Ipv4Address (saddr), sport,
+                                                         m_interface);
+  return endPoints.empty () ? 0 : endPoints.front ();
+}
+
+void
+Ipv4EndPointDemuxTestCase::DoRun ()
+{
+  m_interface = CreateObject<Ipv4Interface> ();
+  m_interface->AddAddress (Ipv4InterfaceAddress (Ipv4Address ("10.0.0.1"), Ipv4Mask ("255.255.255.0")));
+  m_interface->AddAddress (Ipv4InterfaceAddress (Ipv4Address ("10.0.1.1"), Ipv4Mask ("255.255.255.0")));
+
+  TestPrecedence ();
+  TestSetPeer ();
+
+  m_interface = 0;
+}
+
+void
+Ipv4EndPointDemuxTestCase::TestPrecedence ()
+{
+  Ipv4EndPointDemux demux;
+
+  Ipv4EndPoint *any = demux.Allocate (0, Ipv4Address::GetAny (), 80);
+  NS_TEST_ASSERT_MSG_NE (any, 0, "Could not bind the wildcard address");
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.2", 1000), any,
+                         "The wildcard address does not get the packet");
+
+  Ipv4EndPoint *bound = demux.Allocate (0, Ipv4Address ("10.0.0.1"), 80);
+  NS_TEST_ASSERT_MSG_NE (bound, 0, "Could not bind the local address");
+  NS_TEST_EXPECT_MSG_EQ (demux.Allocate (0, Ipv4Address ("10.0.0.1"), 80), 0,
+                         "The local address was bound twice");
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.2", 1000), bound,
+                         "The bound address does not take precedence over the wildcard");
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.1.1", 80, "10.0.0.2", 1000), any,
+                         "The wildcard address does not get the packets to the other addresses");
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 81, "10.0.0.2", 1000), 0,
+                         "A packet to another port found an endpoint");
+
+  Ipv4EndPoint *anyConnected = demux.Allocate (0, Ipv4Address::GetAny (), 80,
+                                               Ipv4Address ("10.0.0.3"), 2000);
+  NS_TEST_ASSERT_MSG_NE (anyConnected, 0, "Could not connect the wildcard address");
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.3", 2000), anyConnected,
+                         "The peer does not take precedence over the bound address");
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.3", 2001), bound,
+                         "A connected endpoint got the packet of another peer port");
+
+  NS_TEST_EXPECT_MSG_EQ (demux.SimpleLookup (Ipv4Address ("10.0.0.1"), 80, Ipv4Address ("10.0.0.4"), 2000),
+                         bound, "SimpleLookup did not return the least generic endpoint");
+
+  Ipv4EndPoint *connected = demux.Allocate (0, Ipv4Address ("10.0.0.1"), 80,
+                                            Ipv4Address ("10.0.0.3"), 2000);
+  NS_TEST_ASSERT_MSG_NE (connected, 0, "Could not connect the local address");
+  NS_TEST_EXPECT_MSG_EQ (demux.Allocate (0, Ipv4Address ("10.0.0.1"), 80,
+                                         Ipv4Address ("10.0.0.3"), 2000), 0,
+                         "The connection was allocated twice");
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.3", 2000), connected,
+                         "The exact match does not take precedence");
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.1.1", 80, "10.0.0.3", 2000), anyConnected,
+                         "The connected wildcard address does not get the packets to the other addresses");
+
+  NS_TEST_EXPECT_MSG_EQ (demux.SimpleLookup (Ipv4Address ("10.0.0.1"), 80, Ipv4Address ("10.0.0.3"), 2000),
+                         connected, "SimpleLookup missed the exact match");
+
+  demux.DeAllocate (connected);
+  demux.DeAllocate (anyConnected);
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.3", 2000), bound,
+                         "The bound address does not get the packets of a closed connection");
+  demux.DeAllocate (bound);
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.3", 2000), any,
+                         "The wildcard address does not get the packets once the bound one is closed");
+  demux.DeAllocate (any);
+  NS_TEST_EXPECT_MSG_EQ (demux.LookupPortLocal (80), false, "The port is still in use");
+  NS_TEST_EXPECT_MSG_EQ (demux.GetAllEndPoints ().size (), 0, "Endpoints left in the demux");
+}
+
+void
+Ipv4EndPointDemuxTestCase::TestSetPeer ()
+{
+  Ipv4EndPointDemux demux;
+
+  Ipv4EndPoint *endPoint = demux.Allocate (0, Ipv4Address ("10.0.0.1"), 80);
+  NS_TEST_ASSERT_MSG_NE (endPoint, 0, "Could not bind the local address");
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.3", 3000), endPoint,
+                         "The unconnected endpoint does not get the packet");
+
+  endPoint->SetPeer (Ipv4Address ("10.0.0.2"), 2000);
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.2", 2000), endPoint,
+                         "The connected endpoint does not get the packets of its peer");
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.3", 3000), 0,
+                         "The connected endpoint got the packet of another peer");
+
+  endPoint->SetPeer (Ipv4Address ("10.0.0.3"), 3000);
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.2", 2000), 0,
+                         "The endpoint still gets the packets of its previous peer");
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.3", 3000), endPoint,
+                         "The endpoint does not get the packets of its new peer");
+  NS_TEST_EXPECT_MSG_EQ (demux.GetAllEndPoints ().size (), 1, "SetPeer changed the number of endpoints");
+
+  endPoint->SetPeer (Ipv4Address::GetAny (), 0);
+  NS_TEST_EXPECT_MSG_EQ (Lookup (demux, "10.0.0.1", 80, "10.0.0.2", 2000), endPoint,
+                         "The disconnected endpoint does not get the packets of any peer");
+
+  endPoint->SetPeer (Ipv4Address ("10.0.0.2"), 2000);
+  demux.DeAllocate (endPoint);
+  NS_TEST_EXPECT_MSG_EQ (demux.LookupPortLocal (80), false, "The re-linked endpoint was not removed");
+  NS_TEST_EXPECT_MSG_EQ (demux.GetAllEndPoints ().size (), 0, "Endpoints left in the demux");
+}
+
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief the TestSuite for the Ipv4EndPointDemux test case
+ */
+class Ipv4EndPointDemuxTestSuite : public TestSuite
+{
+public:
+  Ipv4EndPointDemuxTestSuite ()
+    : TestSuite ("ipv4-end-point-demux", UNIT)
+  {
+    AddTestCase (new Ipv4EndPointDemuxTestCase, TestCase::QUICK);
+  }
+};
+static Ipv4EndPointDemuxTestSuite g_ipv4EndPointDemuxTestSuite;
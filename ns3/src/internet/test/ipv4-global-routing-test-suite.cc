@@ -1244,6 +1244,106 @@ Ipv4GlobalRoutingSlash32TestCase::DoRun (void)
   Simulator::Destroy ();
 }
 
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief IPv4 GlobalRouting lookup test: longest prefix match, host
+ * routes first, equal-cost routes, output interface and changes of the
+ * routes.
+ */
+class Ipv4GlobalRoutingLookupTestCase : public TestCase
+{
+public:
+  Ipv4GlobalRoutingLookupTestCase ();
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Look up a destination.
+   * \param dest the destination
+   * \param oif the output interface, or 0
+   * \returns the gateway of the route, or 0.0.0.0 if there is none
+   */
+  Ipv4Address Lookup (std::string dest, Ptr<NetDevice> oif = 0);
+
+  Ptr<Ipv4GlobalRouting> m_routing; //!< routing protocol under test
+};
+
+Ipv4GlobalRoutingLookupTestCase::Ipv4GlobalRoutingLookupTestCase ()
+  : TestCase ("Global routing lookup of the longest prefix")
+{
+}
+
+Ipv4Address
+Ipv4GlobalRoutingLookupTestCase::Lookup (std::string dest, Ptr<NetDevice> oif)
+{
+  Ipv4Header header;
+  header.SetDestination (Ipv4Address (dest.c_str ()));
+  Socket::SocketErrno sockerr;
+  Ptr<Ipv4Route> route = m_routing->RouteOutput (Create<Packet> (), header, oif, sockerr);
+  return route ? route->GetGateway () : Ipv4Address ("0.0.0.0");
+}
+
+// A router with two interfaces, 10.0.1.1/24 and 10.0.2.1/24
+void
+Ipv4GlobalRoutingLookupTestCase::DoRun (void)
+{
+  NodeContainer c;
+  c.Create (3);
+  InternetStackHelper internet;
+  internet.Install (c);
+  SimpleNetDeviceHelper devHelper;
+  NetDeviceContainer d01 = devHelper.Install (NodeContainer (c.Get (0), c.Get (1)));
+  NetDeviceContainer d02 = devHelper.Install (NodeContainer (c.Get (0), c.Get (2)));
+  Ipv4AddressHelper ipv4;
+  ipv4.SetBase ("10.0.1.0", "255.255.255.0");
+  ipv4.Assign (d01);
+  ipv4.SetBase ("10.0.2.0", "255.255.255.0");
+  ipv4.Assign (d02);
+
+  m_routing = CreateObject<Ipv4GlobalRouting> ();
+  m_routing->SetIpv4 (c.Get (0)->GetObject<Ipv4> ());
+  Ipv4Address gw1 ("10.0.1.2");
+  Ipv4Address gw2 ("10.0.2.2");
+  m_routing->AddNetworkRouteTo (Ipv4Address ("0.0.0.0"), Ipv4Mask ("0.0.0.0"), gw2, 2);
+  m_routing->AddNetworkRouteTo (Ipv4Address ("172.16.0.0"), Ipv4Mask ("255.255.0.0"), gw1, 1);
+  m_routing->AddNetworkRouteTo (Ipv4Address ("172.16.5.0"), Ipv4Mask ("255.255.255.0"), gw2, 2);
+  m_routing->AddHostRouteTo (Ipv4Address ("172.16.5.7"), gw1, 1);
+  // equal-cost routes, the first one is used
+  m_routing->AddNetworkRouteTo (Ipv4Address ("192.168.0.0"), Ipv4Mask ("255.255.255.0"), gw2, 2);
+  m_routing->AddNetworkRouteTo (Ipv4Address ("192.168.0.0"), Ipv4Mask ("255.255.255.0"), gw1, 1);
+
+  NS_TEST_EXPECT_MSG_EQ (Lookup ("172.16.5.7"), gw1, "Host route not preferred");
+  NS_TEST_EXPECT_MSG_EQ (Lookup ("172.16.5.8"), gw2, "Longest prefix not preferred");
+  NS_TEST_EXPECT_MSG_EQ (Lookup ("172.16.6.8"), gw1, "Network route not found");
+  NS_TEST_EXPECT_MSG_EQ (Lookup ("8.8.8.8"), gw2, "Default route not found");
+  NS_TEST_EXPECT_MSG_EQ (Lookup ("192.168.0.9"), gw2, "Wrong equal-cost route");
+  NS_TEST_EXPECT_MSG_EQ (Lookup ("192.168.0.9", d01.Get (0)), gw1, "Output interface not honored");
+  NS_TEST_EXPECT_MSG_EQ (Lookup ("172.16.5.8", d01.Get (0)), gw1, "No fallback to a shorter prefix on the output interface");
+
+  // the table follows the changes of the routes
+  m_routing->RemoveRoute (0);
+  NS_TEST_EXPECT_MSG_EQ (Lookup ("172.16.5.7"), gw2, "Removed host route still used");
+  m_routing->AddHostRouteTo (Ipv4Address ("8.8.8.8"), gw1, 1);
+  NS_TEST_EXPECT_MSG_EQ (Lookup ("8.8.8.8"), gw1, "Added host route not used");
+
+  // random equal-cost routing picks both routes
+  m_routing->SetAttribute ("RandomEcmpRouting", BooleanValue (true));
+  uint32_t nGw1 = 0;
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      nGw1 += Lookup ("192.168.0.9") == gw1;
+    }
+  NS_TEST_EXPECT_MSG_GT (nGw1, 0, "First equal-cost route never picked");
+  NS_TEST_EXPECT_MSG_LT (nGw1, 100, "Second equal-cost route never picked");
+
+  m_routing->Dispose ();
+  m_routing = 0;
+  Simulator::Destroy ();
+}
+
 /**
  * \ingroup internet-test
  * \ingroup tests
@@ -1267,6 +1367,7 @@ Ipv4GlobalRoutingTestSuite::Ipv4GlobalRoutingTestSuite ()
     AddTestCase (new TwoBridgeTest, TestCase::QUICK);
     AddTestCase (new Ipv4DynamicGlobalRoutingTestCase, TestCase::QUICK);
     AddTestCase (new Ipv4GlobalRoutingSlash32TestCase, TestCase::QUICK);
+    AddTestCase (new Ipv4GlobalRoutingLookupTestCase, TestCase::QUICK);
   }
 
 static Ipv4GlobalRoutingTestSuite g_globalRoutingTestSuite; //!< Static variable for test initialization
@@ -18,8 +18,10 @@
 #include "ns3/test.h"
 #include "ns3/packet.h"
 #include "ns3/log.h"
+#include "ns3/socket.h"
 
 #include "ns3/tcp-rx-buffer.h"
+#include <vector>
 
 using namespace ns3;
 
@@ -44,6 +46,17 @@ private:
    * \brief Test the SACK list update.
    */
   void TestUpdateSACKList ();
+  /**
+   * \brief Test the reassembly of reordered, duplicated and overlapping segments.
+   */
+  void TestReassembly ();
+  /**
+   * \brief Create a packet whose bytes depend on their sequence number.
+   * \param seq sequence number of the first byte
+   * \param size size of the packet
+   * \returns the packet
+   */
+  static Ptr<Packet> CreateData (SequenceNumber32 seq, uint32_t size);
 };
 
 TcpRxBufferTestCase::TcpRxBufferTestCase ()
@@ -55,6 +68,18 @@ void
 TcpRxBufferTestCase::DoRun ()
 {
   TestUpdateSACKList ();
+  TestReassembly ();
+}
+
+Ptr<Packet>
+TcpRxBufferTestCase::CreateData (SequenceNumber32 seq, uint32_t size)
+{
+  std::vector<uint8_t> data (size);
+  for (uint32_t i = 0; i < size; i++)
+    {
+      data[i] = static_cast<uint8_t> ((seq + SequenceNumber32 (i)).GetValue () % 251);
+    }
+  return Create<Packet> (data.data (), size);
 }
 
 void
@@ -338,6 +363,102 @@ TcpRxBufferTestCase::TestUpdateSACKList ()
                          "SACK list should contain no element");
 }
 
+void
+TcpRxBufferTestCase::TestReassembly ()
+{
+  TcpRxBuffer rxBuf;
+  TcpHeader h;
+  SequenceNumber32 isn (0xfffff000);
+  rxBuf.SetNextRxSequence (isn);
+  rxBuf.SetMaxBufferSize (100000);
+
+  // An in-order segment read as a whole is handed over as a copy, which
+  // shares its data but not the packet tags of the lower layers
+  Ptr<Packet> p = CreateData (isn, 100);
+  SocketIpTtlTag tag;
+  tag.SetTtl (64);
+  p->AddPacketTag (tag);
+  h.SetSequenceNumber (isn);
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.Add (p, h), true, "In-order segment not buffered");
+  Ptr<Packet> extracted = rxBuf.Extract (1000);
+  NS_TEST_ASSERT_MSG_NE (extracted, p, "The packet of the caller was handed over");
+  NS_TEST_ASSERT_MSG_EQ (extracted->GetSize (), 100, "Wrong size extracted");
+  NS_TEST_ASSERT_MSG_EQ (extracted->PeekPacketTag (tag), false, "The packet tags were handed over");
+  NS_TEST_ASSERT_MSG_EQ (p->PeekPacketTag (tag), true, "The packet of the caller lost its tags");
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.Size (), 0, "Data left in the buffer");
+
+  // 50 segments of 100 bytes across the wrap around of the sequence numbers:
+  // every group of five arrives in reverse order, with duplicates, and every
+  // group also gets a retransmission that straddles two of its segments
+  SequenceNumber32 base = isn + SequenceNumber32 (100);
+  uint32_t total = 50 * 100;
+  for (uint32_t group = 0; group < 10; group++)
+    {
+      for (int32_t k = 4; k >= 0; k--)
+        {
+          SequenceNumber32 seq = base + SequenceNumber32 ((group * 5 + k) * 100);
+          h.SetSequenceNumber (seq);
+          rxBuf.Add (CreateData (seq, 100), h);
+          if (k == 2)
+            { // duplicate
+              rxBuf.Add (CreateData (seq, 100), h);
+            }
+        }
+      SequenceNumber32 seq = base + SequenceNumber32 (group * 500 + 150);
+      h.SetSequenceNumber (seq);
+      NS_TEST_ASSERT_MSG_EQ (rxBuf.Add (CreateData (seq, 100), h), false,
+                             "Data received twice was buffered");
+      NS_TEST_ASSERT_MSG_EQ (rxBuf.NextRxSequence (), base + SequenceNumber32 ((group + 1) * 500),
+                             "Sequence number differs from expected");
+      NS_TEST_ASSERT_MSG_EQ (rxBuf.GetSackListSize (), 0, "SACK list should be empty");
+    }
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.Available (), total, "Available data differs from expected");
+
+  // Holes filled by segments of other boundaries, partly overlapping data
+  // already received
+  base = base + SequenceNumber32 (total);
+  h.SetSequenceNumber (base + SequenceNumber32 (300));
+  rxBuf.Add (CreateData (base + SequenceNumber32 (300), 300), h);
+  h.SetSequenceNumber (base + SequenceNumber32 (800));
+  rxBuf.Add (CreateData (base + SequenceNumber32 (800), 200), h);
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.GetSackListSize (), 2, "SACK list should contain two elements");
+  h.SetSequenceNumber (base + SequenceNumber32 (200));
+  rxBuf.Add (CreateData (base + SequenceNumber32 (200), 700), h);
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.NextRxSequence (), base, "Sequence number differs from expected");
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.GetSackList ().front ().first, base + SequenceNumber32 (200),
+                         "SACK block different than expected");
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.GetSackList ().front ().second, base + SequenceNumber32 (1000),
+                         "SACK block different than expected");
+  h.SetSequenceNumber (base);
+  rxBuf.Add (CreateData (base, 250), h);
+  total += 1000;
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.NextRxSequence (), base + SequenceNumber32 (1000),
+                         "Sequence number differs from expected");
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.GetSackListSize (), 0, "SACK list should be empty");
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.Size (), total, "Buffer occupancy differs from expected");
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.Available (), total, "Available data differs from expected");
+
+  // Read the data in chunks that do not match the segments
+  SequenceNumber32 seq = isn + SequenceNumber32 (100);
+  while (rxBuf.Available () > 0)
+    {
+      Ptr<Packet> out = rxBuf.Extract (70);
+      NS_TEST_ASSERT_MSG_EQ (out->GetSize (), std::min<uint32_t> (70, total), "Wrong size extracted");
+      std::vector<uint8_t> data (out->GetSize ());
+      out->CopyData (data.data (), data.size ());
+      for (uint32_t i = 0; i < data.size (); i++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (static_cast<uint32_t> (data[i]), (seq + SequenceNumber32 (i)).GetValue () % 251,
+                                 "Wrong byte extracted at " << seq + SequenceNumber32 (i));
+        }
+      seq = seq + SequenceNumber32 (out->GetSize ());
+      total -= out->GetSize ();
+    }
+  NS_TEST_ASSERT_MSG_EQ (seq, rxBuf.NextRxSequence (), "Not all the data was extracted");
+  NS_TEST_ASSERT_MSG_EQ (rxBuf.Size (), 0, "Data left in the buffer");
+  NS_TEST_ASSERT_MSG_EQ ((rxBuf.Extract (70) == nullptr), true, "Data extracted from an empty buffer");
+}
+
 void
 TcpRxBufferTestCase::DoTeardown ()
 {
@@ -53,6 +53,10 @@ private:
   /** \brief Test the logic of merging items in GetTransmittedSegment()
    * which is triggered by CopyFromSequence()*/
   void TestMergeItemsWhenGetTransmittedSegment ();
+  /** \brief Test the scoreboard of a large window, with many holes */
+  void TestLargeWindowRecovery ();
+  /** \brief Test a SACK block covering the head, as sent with an old ACK */
+  void TestHeadSackBlock ();
   /** \brief Callback to provide a value of receiver window */
   uint32_t GetRWnd (void) const;
 };
@@ -98,6 +102,23 @@ TcpTxBufferTestCase::DoRun ()
   Simulator::Schedule (Seconds (0.0),
                          &TcpTxBufferTestCase::TestMergeItemsWhenGetTransmittedSegment, this);
 
+  /*
+   * Case for a large window:
+   *  -> one segment every ten is lost, and the others are sacked one run at a time
+   *  -> the holes become lost as soon as dupThresh segments above are sacked
+   *  -> NextSeg returns the holes in order, and then nothing
+   */
+  Simulator::Schedule (Seconds (0.0),
+                       &TcpTxBufferTestCase::TestLargeWindowRecovery, this);
+
+  /*
+   * Case for a block covering the head:
+   *  -> the head is never sacked, and the block alone changes nothing
+   *  -> the items of the block after the head are sacked
+   */
+  Simulator::Schedule (Seconds (0.0),
+                       &TcpTxBufferTestCase::TestHeadSackBlock, this);
+
   Simulator::Run ();
   Simulator::Destroy ();
 }
@@ -382,6 +403,106 @@ TcpTxBufferTestCase::TestMergeItemsWhenGetTransmittedSegment ()
   txBuf.CopyFromSequence (2000, SequenceNumber32(1));
 }
 
+void
+TcpTxBufferTestCase::TestLargeWindowRecovery ()
+{
+  Ptr<TcpTxBuffer> txBuf = CreateObject<TcpTxBuffer> ();
+  txBuf->SetRWndCallback (MakeCallback (&TcpTxBufferTestCase::GetRWnd, this));
+  SequenceNumber32 head (1);
+  txBuf->SetHeadSequence (head);
+  uint32_t segmentSize = 100;
+  uint32_t nSegments = 5000;
+  txBuf->SetMaxBufferSize (nSegments * segmentSize);
+  txBuf->SetSegmentSize (segmentSize);
+  txBuf->SetDupAckThresh (3);
+  Ptr<TcpOptionSack> sack = CreateObject<TcpOptionSack> ();
+
+  txBuf->Add (Create<Packet> (nSegments * segmentSize));
+  for (uint32_t i = 0; i < nSegments; ++i)
+    {
+      txBuf->CopyFromSequence (segmentSize, head + (segmentSize * i));
+    }
+
+  // The segments i * 10 are lost: sack the nine segments that follow each
+  for (uint32_t hole = 0; hole < nSegments / 10; ++hole)
+    {
+      SequenceNumber32 begin = head + (segmentSize * (hole * 10 + 1));
+      sack->AddSackBlock (TcpOptionSack::SackBlock (begin, begin + (segmentSize * 9)));
+      NS_TEST_ASSERT_MSG_EQ (txBuf->Update (sack->GetSackList ()), segmentSize * 9,
+                             "Different sacked bytes than expected");
+      sack->ClearSackList ();
+      NS_TEST_ASSERT_MSG_EQ (txBuf->GetLost (), segmentSize * (hole + 1),
+                             "Different lost bytes than expected");
+    }
+  NS_TEST_ASSERT_MSG_EQ (txBuf->GetSacked (), segmentSize * nSegments / 10 * 9,
+                         "Different sacked bytes than expected");
+
+  for (uint32_t i = 0; i < nSegments; i += 7)
+    {
+      NS_TEST_ASSERT_MSG_EQ (txBuf->IsLost (head + (segmentSize * i)), (i % 10 == 0),
+                             "Different loss than expected for segment " << i);
+    }
+
+  // Retransmit the holes, in order
+  SequenceNumber32 ret;
+  SequenceNumber32 retHigh;
+  for (uint32_t hole = 0; hole < nSegments / 10; ++hole)
+    {
+      NS_TEST_ASSERT_MSG_EQ (txBuf->NextSeg (&ret, &retHigh, true), true,
+                             "No NextSeq with holes to retransmit");
+      NS_TEST_ASSERT_MSG_EQ (ret, head + (segmentSize * hole * 10),
+                             "Different NextSeq than expected in recovery");
+      txBuf->CopyFromSequence (segmentSize, ret);
+    }
+  NS_TEST_ASSERT_MSG_EQ (txBuf->NextSeg (&ret, &retHigh, true), false,
+                         "NextSeq with all the holes retransmitted");
+  NS_TEST_ASSERT_MSG_EQ (txBuf->BytesInFlight (), segmentSize * nSegments / 10,
+                         "Different bytes in flight than expected");
+
+  txBuf->DiscardUpTo (head + (segmentSize * nSegments));
+  NS_TEST_ASSERT_MSG_EQ (txBuf->Size (), 0,
+                         "Data inside the buffer");
+  NS_TEST_ASSERT_MSG_EQ (txBuf->GetLost () + txBuf->GetSacked () + txBuf->GetRetransmitsCount (), 0,
+                         "Scoreboard not empty");
+}
+
+void
+TcpTxBufferTestCase::TestHeadSackBlock ()
+{
+  Ptr<TcpTxBuffer> txBuf = CreateObject<TcpTxBuffer> ();
+  txBuf->SetRWndCallback (MakeCallback (&TcpTxBufferTestCase::GetRWnd, this));
+  SequenceNumber32 head (1);
+  txBuf->SetHeadSequence (head);
+  txBuf->SetSegmentSize (1000);
+  txBuf->SetDupAckThresh (3);
+  Ptr<TcpOptionSack> sack = CreateObject<TcpOptionSack> ();
+
+  txBuf->Add (Create<Packet> (10000));
+  for (uint32_t i = 0; i < 10; ++i)
+    {
+      txBuf->CopyFromSequence (1000, head + (1000 * i));
+    }
+  txBuf->DiscardUpTo (head + 2000);
+
+  // A reordered old ACK, whose block is exactly the head segment
+  sack->AddSackBlock (TcpOptionSack::SackBlock (head + 2000, head + 3000));
+  NS_TEST_ASSERT_MSG_EQ (txBuf->Update (sack->GetSackList ()), 0,
+                         "The head has been sacked");
+  sack->ClearSackList ();
+  NS_TEST_ASSERT_MSG_EQ (txBuf->GetSacked (), 0, "Different sacked bytes than expected");
+  NS_TEST_ASSERT_MSG_EQ (txBuf->IsLost (head + 2000), false, "The head is lost without SACK");
+
+  // A block starting at the head sacks the segments after it
+  sack->AddSackBlock (TcpOptionSack::SackBlock (head + 2000, head + 6000));
+  NS_TEST_ASSERT_MSG_EQ (txBuf->Update (sack->GetSackList ()), 3000,
+                         "Different sacked bytes than expected");
+  sack->ClearSackList ();
+  NS_TEST_ASSERT_MSG_EQ (txBuf->IsLost (head + 2000), true,
+                         "The head is not lost with three segments sacked above");
+  NS_TEST_ASSERT_MSG_EQ (txBuf->IsLost (head + 6000), false,
+                         "A segment above the highest sacked one is lost");
+}
+
 void
 TcpTxBufferTestCase::TestTransmittedBlock ()
 {
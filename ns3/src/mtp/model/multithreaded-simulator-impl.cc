@@ -0,0 +1,749 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "multithreaded-simulator-impl.h"
+
+#include "ns3/simulator.h"
+#include "ns3/uinteger.h"
+#include "ns3/assert.h"
+#include "ns3/log.h"
+#include "ns3/node.h"
+#include "ns3/node-list.h"
+#include "ns3/channel.h"
+#include "ns3/channel-list.h"
+#include "ns3/net-device.h"
+
+#include <algorithm>
+#include <map>
+#include <thread>
+
+/**
+ * \file
+ * \ingroup mtp
+ * ns3::MultithreadedSimulatorImpl implementation.
+ */
+
+namespace ns3 {
+
+// As in DefaultSimulatorImpl, the event paths do not log.
+NS_LOG_COMPONENT_DEFINE ("MultithreadedSimulatorImpl");
+
+NS_OBJECT_ENSURE_REGISTERED (MultithreadedSimulatorImpl);
+
+/** Time stamp standing for no event. */
+static const uint64_t NO_EVENT = ~(uint64_t) 0;
+
+thread_local MultithreadedSimulatorImpl::LogicalProcess *MultithreadedSimulatorImpl::g_current = 0;
+
+TypeId
+MultithreadedSimulatorImpl::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::MultithreadedSimulatorImpl")
+    .SetParent<SimulatorImpl> ()
+    .SetGroupName ("Mtp")
+    .AddConstructor<MultithreadedSimulatorImpl> ()
+    .AddAttribute ("MaxThreads",
+                   "Maximum number of threads running the logical processes, "
+                   "0 for one per core",
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&MultithreadedSimulatorImpl::m_maxThreads),
+                   MakeUintegerChecker<uint32_t> ())
+  ;
+  return tid;
+}
+
+MultithreadedSimulatorImpl::MultithreadedSimulatorImpl ()
+  : m_global (0),
+    m_partitioned (false),
+    m_lookahead (NO_EVENT),
+    m_maxThreads (0),
+    m_stop (false),
+    m_windowEnd (0),
+    m_window (0),
+    m_start (0),
+    m_nextLp (0),
+    m_done (0),
+    m_quit (false)
+{
+  NS_LOG_FUNCTION (this);
+  m_global = CreateLogicalProcess (0);
+}
+
+MultithreadedSimulatorImpl::~MultithreadedSimulatorImpl ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+MultithreadedSimulatorImpl::DoDispose (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_lps.push_back (m_global);
+  for (LogicalProcess *lp : m_lps)
+    {
+      for (uint32_t parity = 0; parity < 2; parity++)
+        {
+          for (const Message &message : lp->inbox[parity])
+            {
+              message.event->Unref ();
+            }
+        }
+      while (!lp->events->IsEmpty ())
+        {
+          Scheduler::Event next = lp->events->RemoveNext ();
+          next.impl->Unref ();
+        }
+      delete lp;
+    }
+  m_lps.clear ();
+  m_nodeLps.clear ();
+  m_global = 0;
+  SimulatorImpl::DoDispose ();
+}
+
+void
+MultithreadedSimulatorImpl::Destroy ()
+{
+  NS_LOG_FUNCTION (this);
+  while (!m_destroyEvents.empty ())
+    {
+      Ptr<EventImpl> ev = m_destroyEvents.front ().PeekEventImpl ();
+      m_destroyEvents.pop_front ();
+      NS_LOG_LOGIC ("handle destroy " << ev);
+      if (!ev->IsCancelled ())
+        {
+          ev->Invoke ();
+        }
+    }
+}
+
+MultithreadedSimulatorImpl::LogicalProcess *
+MultithreadedSimulatorImpl::CreateLogicalProcess (uint32_t id) const
+{
+  LogicalProcess *lp = new LogicalProcess ();
+  lp->id = id;
+  if (m_global != 0)
+    {
+      lp->events = m_schedulerFactory.Create<Scheduler> ();
+      // keep the uids of the events moved from the global logical process
+      lp->uid = m_global->uid;
+      lp->currentTs = m_global->currentTs;
+    }
+  else
+    {
+      // uids are allocated from 4, see DefaultSimulatorImpl
+      lp->uid = 4;
+      lp->currentTs = 0;
+    }
+  lp->currentUid = 0;
+  lp->currentContext = Simulator::NO_CONTEXT;
+  lp->eventCount = 0;
+  lp->unscheduledEvents = 0;
+  lp->sent = 0;
+  lp->inboxTs[0] = NO_EVENT;
+  lp->inboxTs[1] = NO_EVENT;
+  return lp;
+}
+
+void
+MultithreadedSimulatorImpl::SetScheduler (ObjectFactory schedulerFactory)
+{
+  NS_LOG_FUNCTION (this << schedulerFactory);
+  NS_ASSERT_MSG (g_current == 0, "Simulator::SetScheduler while running");
+  m_schedulerFactory = schedulerFactory;
+
+  m_lps.push_back (m_global);
+  for (LogicalProcess *lp : m_lps)
+    {
+      Ptr<Scheduler> scheduler = schedulerFactory.Create<Scheduler> ();
+      if (lp->events != 0)
+        {
+          while (!lp->events->IsEmpty ())
+            {
+              scheduler->Insert (lp->events->RemoveNext ());
+            }
+        }
+      lp->events = scheduler;
+    }
+  m_lps.pop_back ();
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetSystemId (void) const
+{
+  return 0;
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetNLogicalProcesses (void) const
+{
+  return m_lps.size ();
+}
+
+Time
+MultithreadedSimulatorImpl::GetLookahead (void) const
+{
+  if (m_lookahead == NO_EVENT)
+    {
+      return GetMaximumSimulationTime ();
+    }
+  return TimeStep (m_lookahead);
+}
+
+void
+MultithreadedSimulatorImpl::Partition (void)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t nNodes = NodeList::GetNNodes ();
+
+  // Union-find of the nodes which must share a logical process
+  std::vector<uint32_t> parent (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      parent[i] = i;
+    }
+  auto find = [&parent] (uint32_t n) {
+      while (parent[n] != n)
+        {
+          parent[n] = parent[parent[n]];
+          n = parent[n];
+        }
+      return n;
+    };
+
+  /** A link which may separate two logical processes. */
+  struct Link
+  {
+    uint32_t a;      //!< Node at one end
+    uint32_t b;      //!< Node at the other end
+    uint64_t delay;  //!< Propagation delay
+  };
+  std::vector<Link> links;
+  for (ChannelList::Iterator i = ChannelList::Begin (); i != ChannelList::End (); i++)
+    {
+      Ptr<Channel> channel = *i;
+      std::size_t nDevices = channel->GetNDevices ();
+      if (nDevices == 0)
+        {
+          continue;
+        }
+      TimeValue delay;
+      if (nDevices == 2
+          && channel->GetDevice (0)->IsPointToPoint ()
+          && channel->GetDevice (1)->IsPointToPoint ()
+          && channel->GetAttributeFailSafe ("Delay", delay)
+          && delay.Get ().IsStrictlyPositive ())
+        {
+          Link link;
+          link.a = channel->GetDevice (0)->GetNode ()->GetId ();
+          link.b = channel->GetDevice (1)->GetNode ()->GetId ();
+          link.delay = delay.Get ().GetTimeStep ();
+          links.push_back (link);
+          continue;
+        }
+      uint32_t first = find (channel->GetDevice (0)->GetNode ()->GetId ());
+      for (std::size_t j = 1; j < nDevices; j++)
+        {
+          parent[find (channel->GetDevice (j)->GetNode ()->GetId ())] = first;
+        }
+    }
+
+  std::map<uint32_t, LogicalProcess *> roots;
+  m_nodeLps.resize (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      uint32_t root = find (i);
+      auto it = roots.find (root);
+      if (it == roots.end ())
+        {
+          LogicalProcess *lp = CreateLogicalProcess (m_lps.size ());
+          m_lps.push_back (lp);
+          it = roots.insert (std::make_pair (root, lp)).first;
+        }
+      m_nodeLps[i] = it->second;
+    }
+  m_global->id = m_lps.size ();
+
+  m_lookahead = NO_EVENT;
+  for (const Link &link : links)
+    {
+      if (find (link.a) != find (link.b))
+        {
+          m_lookahead = std::min (m_lookahead, link.delay);
+        }
+    }
+  NS_LOG_INFO (nNodes << " nodes in " << m_lps.size () << " logical processes, lookahead "
+                      << GetLookahead ().As (Time::US));
+
+  // Move the events of the nodes to their logical process
+  std::vector<Scheduler::Event> events;
+  while (!m_global->events->IsEmpty ())
+    {
+      events.push_back (m_global->events->RemoveNext ());
+    }
+  for (const Scheduler::Event &ev : events)
+    {
+      LogicalProcess *lp = GetLogicalProcess (ev.key.m_context);
+      lp->events->Insert (ev);
+      if (lp != m_global)
+        {
+          lp->unscheduledEvents++;
+          m_global->unscheduledEvents--;
+        }
+    }
+  m_partitioned = true;
+}
+
+MultithreadedSimulatorImpl::LogicalProcess *
+MultithreadedSimulatorImpl::GetLogicalProcess (uint32_t context) const
+{
+  return context < m_nodeLps.size () ? m_nodeLps[context] : m_global;
+}
+
+MultithreadedSimulatorImpl::LogicalProcess *
+MultithreadedSimulatorImpl::GetCurrent (void) const
+{
+  return g_current != 0 ? g_current : m_global;
+}
+
+bool
+MultithreadedSimulatorImpl::MessageLess (const Message &a, const Message &b)
+{
+  if (a.ts != b.ts)
+    {
+      return a.ts < b.ts;
+    }
+  if (a.source != b.source)
+    {
+      return a.source < b.source;
+    }
+  return a.sequence < b.sequence;
+}
+
+Scheduler::Event
+MultithreadedSimulatorImpl::Insert (LogicalProcess *lp, uint64_t ts, uint32_t context, EventImpl *event)
+{
+  Scheduler::Event ev;
+  ev.impl = event;
+  ev.key.m_ts = ts;
+  ev.key.m_context = context;
+  ev.key.m_uid = lp->uid;
+  lp->uid++;
+  lp->unscheduledEvents++;
+  lp->events->Insert (ev);
+  return ev;
+}
+
+void
+MultithreadedSimulatorImpl::MergeInbox (LogicalProcess *lp, uint32_t parity)
+{
+  // No message is added to this inbox during the window, but the other
+  // one may be in use
+  std::vector<Message> &inbox = lp->inbox[parity];
+  if (inbox.empty ())
+    {
+      return;
+    }
+  std::sort (inbox.begin (), inbox.end (), &MultithreadedSimulatorImpl::MessageLess);
+  for (const Message &message : inbox)
+    {
+      Insert (lp, message.ts, message.context, message.event);
+    }
+  inbox.clear ();
+  lp->inboxTs[parity] = NO_EVENT;
+}
+
+uint64_t
+MultithreadedSimulatorImpl::GetNextTs (const LogicalProcess *lp) const
+{
+  uint64_t ts = std::min (lp->inboxTs[0], lp->inboxTs[1]);
+  if (!lp->events->IsEmpty ())
+    {
+      ts = std::min (ts, lp->events->PeekNext ().key.m_ts);
+    }
+  return ts;
+}
+
+void
+MultithreadedSimulatorImpl::ProcessOneEvent (LogicalProcess *lp)
+{
+  Scheduler::Event next = lp->events->RemoveNext ();
+
+  NS_ASSERT (next.key.m_ts >= lp->currentTs);
+  lp->unscheduledEvents--;
+  lp->eventCount++;
+
+  lp->currentTs = next.key.m_ts;
+  lp->currentContext = next.key.m_context;
+  lp->currentUid = next.key.m_uid;
+  next.impl->Invoke ();
+  next.impl->Unref ();
+}
+
+void
+MultithreadedSimulatorImpl::CheckOwner (const EventId &id) const
+{
+  NS_ASSERT_MSG (g_current == 0 || id.PeekEventImpl () == 0
+                 || GetLogicalProcess (id.GetContext ()) == g_current,
+                 "Event of context " << id.GetContext () << " accessed from context "
+                 << g_current->currentContext << " of another logical process");
+}
+
+void
+MultithreadedSimulatorImpl::ProcessWindow (void)
+{
+  // The messages sent during the previous window
+  uint32_t parity = (m_window + 1) & 1;
+  for (uint32_t i = m_nextLp++; i < m_lps.size (); i = m_nextLp++)
+    {
+      LogicalProcess *lp = m_lps[i];
+      g_current = lp;
+      MergeInbox (lp, parity);
+      // Simulator::Stop is only checked between the windows: stopping
+      // as soon as it is called would depend on the thread timing
+      while (!lp->events->IsEmpty ()
+             && lp->events->PeekNext ().key.m_ts < m_windowEnd)
+        {
+          ProcessOneEvent (lp);
+        }
+      g_current = 0;
+    }
+}
+
+void
+MultithreadedSimulatorImpl::RunWorker (void)
+{
+  uint32_t started = 0;
+  while (true)
+    {
+      while (m_start.load (std::memory_order_acquire) == started)
+        {
+          std::this_thread::yield ();
+        }
+      started++;
+      if (m_quit)
+        {
+          return;
+        }
+      ProcessWindow ();
+      m_done.fetch_add (1, std::memory_order_release);
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsFinished (void) const
+{
+  if (m_stop)
+    {
+      return true;
+    }
+  for (const LogicalProcess *lp : m_lps)
+    {
+      if (GetNextTs (lp) != NO_EVENT)
+        {
+          return false;
+        }
+    }
+  return GetNextTs (m_global) == NO_EVENT;
+}
+
+void
+MultithreadedSimulatorImpl::Run (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (!m_partitioned)
+    {
+      Partition ();
+    }
+  m_stop = false;
+
+  uint32_t nThreads = m_maxThreads;
+  if (nThreads == 0)
+    {
+      nThreads = std::max (std::thread::hardware_concurrency (), 1U);
+    }
+  nThreads = std::max (std::min<uint32_t> (nThreads, m_lps.size ()), 1U);
+  NS_LOG_INFO ("running " << m_lps.size () << " logical processes on " << nThreads << " threads");
+
+  // The main thread runs the global events, and its share of the windows
+  m_quit = false;
+  m_start = 0;
+  for (uint32_t i = 1; i < nThreads; i++)
+    {
+      Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&MultithreadedSimulatorImpl::RunWorker, this));
+      thread->Start ();
+      m_threads.push_back (thread);
+    }
+
+  while (!m_stop)
+    {
+      MergeInbox (m_global, 0);
+      MergeInbox (m_global, 1);
+      uint64_t global = GetNextTs (m_global);
+      uint64_t next = NO_EVENT;
+      for (const LogicalProcess *lp : m_lps)
+        {
+          next = std::min (next, GetNextTs (lp));
+        }
+      if (global == NO_EVENT && next == NO_EVENT)
+        {
+          break;
+        }
+
+      if (global <= next)
+        {
+          // Every node is done with the earlier events
+          while (!m_stop && !m_global->events->IsEmpty ()
+                 && m_global->events->PeekNext ().key.m_ts == global)
+            {
+              ProcessOneEvent (m_global);
+            }
+          continue;
+        }
+
+      m_windowEnd = (next > NO_EVENT - m_lookahead) ? NO_EVENT : next + m_lookahead;
+      m_windowEnd = std::min (m_windowEnd, global);
+      m_window++;
+      m_nextLp = 0;
+      m_done = 0;
+      m_start.fetch_add (1, std::memory_order_release);
+      ProcessWindow ();
+      m_done.fetch_add (1, std::memory_order_release);
+      while (m_done.load (std::memory_order_acquire) < nThreads)
+        {
+          std::this_thread::yield ();
+        }
+    }
+
+  m_quit = true;
+  m_start.fetch_add (1, std::memory_order_release);
+  for (Ptr<SystemThread> thread : m_threads)
+    {
+      thread->Join ();
+    }
+  m_threads.clear ();
+
+  // Now () is the time of the last event run
+  for (const LogicalProcess *lp : m_lps)
+    {
+      m_global->currentTs = std::max (m_global->currentTs, lp->currentTs);
+      NS_ASSERT (GetNextTs (lp) != NO_EVENT || lp->unscheduledEvents == 0);
+    }
+  NS_ASSERT (GetNextTs (m_global) != NO_EVENT || m_global->unscheduledEvents == 0);
+}
+
+void
+MultithreadedSimulatorImpl::Stop (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_stop = true;
+}
+
+void
+MultithreadedSimulatorImpl::Stop (Time const &delay)
+{
+  NS_LOG_FUNCTION (this << delay.GetTimeStep ());
+  Simulator::Schedule (delay, &Simulator::Stop);
+}
+
+EventId
+MultithreadedSimulatorImpl::Schedule (Time const &delay, EventImpl *event)
+{
+  NS_ASSERT_MSG (delay.IsPositive (), "MultithreadedSimulatorImpl::Schedule(): Negative delay");
+  LogicalProcess *lp = GetCurrent ();
+  Scheduler::Event ev = Insert (lp, lp->currentTs + delay.GetTimeStep (), lp->currentContext, event);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+void
+MultithreadedSimulatorImpl::ScheduleWithContext (uint32_t context, Time const &delay, EventImpl *event)
+{
+  NS_ASSERT_MSG (delay.IsPositive (), "MultithreadedSimulatorImpl::ScheduleWithContext(): Negative delay");
+  LogicalProcess *current = GetCurrent ();
+  LogicalProcess *lp = GetLogicalProcess (context);
+  uint64_t ts = current->currentTs + delay.GetTimeStep ();
+  if (g_current == 0 || lp == current)
+    {
+      // No window is running, or the event stays in this logical process
+      Insert (lp, ts, context, event);
+      return;
+    }
+
+  if (ts < m_windowEnd)
+    {
+      NS_FATAL_ERROR ("Event scheduled from context " << current->currentContext
+                      << " on context " << context << " of another logical process "
+                      << delay.As (Time::US) << " ahead, less than the lookahead "
+                      << GetLookahead ().As (Time::US));
+    }
+  Message message;
+  message.ts = ts;
+  message.context = context;
+  message.source = current->id;
+  message.sequence = current->sent++;
+  message.event = event;
+  uint32_t parity = m_window & 1;
+  CriticalSection cs (lp->inboxMutex);
+  lp->inbox[parity].push_back (message);
+  lp->inboxTs[parity] = std::min (lp->inboxTs[parity], ts);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleNow (EventImpl *event)
+{
+  LogicalProcess *lp = GetCurrent ();
+  Scheduler::Event ev = Insert (lp, lp->currentTs, lp->currentContext, event);
+  return EventId (event, ev.key.m_ts, ev.key.m_context, ev.key.m_uid);
+}
+
+EventId
+MultithreadedSimulatorImpl::ScheduleDestroy (EventImpl *event)
+{
+  NS_ASSERT_MSG (g_current == 0, "Simulator::ScheduleDestroy from a logical process");
+
+  EventId id (Ptr<EventImpl> (event, false), m_global->currentTs, 0xffffffff, 2);
+  m_destroyEvents.push_back (id);
+  m_global->uid++;
+  return id;
+}
+
+Time
+MultithreadedSimulatorImpl::Now (void) const
+{
+  // Do not add function logging here, to avoid stack overflow
+  return TimeStep (GetCurrent ()->currentTs);
+}
+
+Time
+MultithreadedSimulatorImpl::GetDelayLeft (const EventId &id) const
+{
+  CheckOwner (id);
+  if (IsExpired (id))
+    {
+      return TimeStep (0);
+    }
+  else
+    {
+      return TimeStep (id.GetTs () - GetLogicalProcess (id.GetContext ())->currentTs);
+    }
+}
+
+void
+MultithreadedSimulatorImpl::Remove (const EventId &id)
+{
+  if (id.GetUid () == 2)
+    {
+      // destroy events.
+      for (DestroyEvents::iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              m_destroyEvents.erase (i);
+              break;
+            }
+        }
+      return;
+    }
+  CheckOwner (id);
+  if (IsExpired (id))
+    {
+      return;
+    }
+  LogicalProcess *lp = GetLogicalProcess (id.GetContext ());
+  Scheduler::Event event;
+  event.impl = id.PeekEventImpl ();
+  event.key.m_ts = id.GetTs ();
+  event.key.m_context = id.GetContext ();
+  event.key.m_uid = id.GetUid ();
+  lp->events->Remove (event);
+  event.impl->Cancel ();
+  // whenever we remove an event from the event list, we have to unref it.
+  event.impl->Unref ();
+
+  lp->unscheduledEvents--;
+}
+
+void
+MultithreadedSimulatorImpl::Cancel (const EventId &id)
+{
+  CheckOwner (id);
+  if (!IsExpired (id))
+    {
+      id.PeekEventImpl ()->Cancel ();
+    }
+}
+
+bool
+MultithreadedSimulatorImpl::IsExpired (const EventId &id) const
+{
+  if (id.GetUid () == 2)
+    {
+      if (id.PeekEventImpl () == 0
+          || id.PeekEventImpl ()->IsCancelled ())
+        {
+          return true;
+        }
+      // destroy events.
+      for (DestroyEvents::const_iterator i = m_destroyEvents.begin (); i != m_destroyEvents.end (); i++)
+        {
+          if (*i == id)
+            {
+              return false;
+            }
+        }
+      return true;
+    }
+  CheckOwner (id);
+  const LogicalProcess *lp = GetLogicalProcess (id.GetContext ());
+  if (id.PeekEventImpl () == 0
+      || id.GetTs () < lp->currentTs
+      || (id.GetTs () == lp->currentTs && id.GetUid () <= lp->currentUid)
+      || id.PeekEventImpl ()->IsCancelled ())
+    {
+      return true;
+    }
+  else
+    {
+      return false;
+    }
+}
+
+Time
+MultithreadedSimulatorImpl::GetMaximumSimulationTime (void) const
+{
+  return TimeStep (0x7fffffffffffffffLL);
+}
+
+uint32_t
+MultithreadedSimulatorImpl::GetContext (void) const
+{
+  return GetCurrent ()->currentContext;
+}
+
+uint64_t
+MultithreadedSimulatorImpl::GetEventCount (void) const
+{
+  uint64_t count = m_global->eventCount;
+  for (const LogicalProcess *lp : m_lps)
+    {
+      count += lp->eventCount;
+    }
+  return count;
+}
+
+} // namespace ns3
@@ -0,0 +1,309 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef MULTITHREADED_SIMULATOR_IMPL_H
+#define MULTITHREADED_SIMULATOR_IMPL_H
+
+#include "ns3/simulator-impl.h"
+#include "ns3/scheduler.h"
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/system-thread.h"
+#include "ns3/system-mutex.h"
+#include "ns3/nstime.h"
+#include "ns3/ptr.h"
+
+#include <atomic>
+#include <list>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup mtp
+ * ns3::MultithreadedSimulatorImpl declaration.
+ */
+
+namespace ns3 {
+
+/**
+ * \defgroup mtp Multithreaded Simulation
+ *
+ * Parallel simulation on the cores of one machine (--enable-mtp).
+ */
+
+/**
+ * \ingroup mtp
+ *
+ * \brief Simulator implementation running the nodes in parallel threads.
+ *
+ * At the first Run (), the nodes are partitioned into logical
+ * processes: the nodes of a channel that is not a point to point link
+ * with a positive delay, and of a zero delay point to point link, are
+ * kept in the same logical process. The smallest delay of the links
+ * between logical processes is the lookahead: no event of a logical
+ * process can change another one sooner than that.
+ *
+ * The simulation then advances in windows. A window starts at the
+ * earliest pending event of the logical processes and ends one
+ * lookahead later, or at the next global event if that comes first.
+ * The worker threads take the logical processes one by one and run
+ * their events of the window, each logical process with its own
+ * scheduler, as a sequential simulation would. The events a logical
+ * process schedules on the nodes of another one, which are later than
+ * the window, are handed over at the end of the window, in the same
+ * order whatever the thread timing.
+ *
+ * The events without a node context (such as the tracing timers
+ * scheduled by the main program and Simulator::Stop) are global: they
+ * run in the main thread between two windows, once the logical
+ * processes have run all their earlier events, so they can inspect
+ * any node.
+ *
+ * The events of a window are the same as in a sequential simulation,
+ * but the events of equal time stamp in different logical processes,
+ * or on a node and in the global context, do not run in the order of
+ * their scheduling: the global events run first. Packet uids and
+ * random variable stream indices allocated during the simulation
+ * depend on the thread timing.
+ *
+ * During a window, an event can only be cancelled, removed or checked
+ * (Simulator::Cancel, Remove, IsExpired and GetDelayLeft) by the events
+ * of its own logical process, as the others run at the same time; the
+ * global events and the main program can access any event. A
+ * Simulator::Stop called by a node takes effect at the end of the
+ * window, so that the same events run whatever the thread timing.
+ *
+ * This simulator requires the build option --enable-mtp, which makes
+ * the reference counts and the packet buffers thread safe.
+ */
+class MultithreadedSimulatorImpl : public SimulatorImpl
+{
+public:
+  /**
+   *  Register this type.
+   *  \return The object TypeId.
+   */
+  static TypeId GetTypeId (void);
+
+  /** Constructor. */
+  MultithreadedSimulatorImpl ();
+  /** Destructor. */
+  ~MultithreadedSimulatorImpl ();
+
+  // Inherited
+  virtual void Destroy ();
+  virtual bool IsFinished (void) const;
+  virtual void Stop (void);
+  virtual void Stop (const Time &delay);
+  virtual EventId Schedule (const Time &delay, EventImpl *event);
+  virtual void ScheduleWithContext (uint32_t context, const Time &delay, EventImpl *event);
+  virtual EventId ScheduleNow (EventImpl *event);
+  virtual EventId ScheduleDestroy (EventImpl *event);
+  virtual void Remove (const EventId &id);
+  virtual void Cancel (const EventId &id);
+  virtual bool IsExpired (const EventId &id) const;
+  virtual void Run (void);
+  virtual Time Now (void) const;
+  virtual Time GetDelayLeft (const EventId &id) const;
+  virtual Time GetMaximumSimulationTime (void) const;
+  virtual void SetScheduler (ObjectFactory schedulerFactory);
+  virtual uint32_t GetSystemId (void) const;
+  virtual uint32_t GetContext (void) const;
+  virtual uint64_t GetEventCount (void) const;
+
+  /**
+   * Get the number of logical processes of the nodes.
+   *
+   * \returns The number of logical processes, 0 before the first Run ().
+   */
+  uint32_t GetNLogicalProcesses (void) const;
+  /**
+   * Get the lookahead.
+   *
+   * \returns The smallest delay of the links between logical processes,
+   *          or GetMaximumSimulationTime () if there are none.
+   */
+  Time GetLookahead (void) const;
+
+private:
+  virtual void DoDispose (void);
+
+  /** An event scheduled on another logical process during a window. */
+  struct Message
+  {
+    uint64_t ts;         //!< Event time stamp
+    uint32_t context;    //!< Event context
+    uint32_t source;     //!< Sending logical process
+    uint64_t sequence;   //!< Rank of the message among those of the sender
+    EventImpl *event;    //!< The event implementation
+  };
+
+  /**
+   * Compare two messages in the order they are handed over.
+   *
+   * \param [in] a The first message.
+   * \param [in] b The second message.
+   * \returns \c true if \pname{a} is handed over first.
+   */
+  static bool MessageLess (const Message &a, const Message &b);
+
+  /** The nodes of a logical process, or the global events, and their events. */
+  struct LogicalProcess
+  {
+    /** Index in m_lps; m_lps.size () for the global events. */
+    uint32_t id;
+    /** The event priority queue. */
+    Ptr<Scheduler> events;
+    /** Next event unique id. */
+    uint32_t uid;
+    /** Unique id of the current event. */
+    uint32_t currentUid;
+    /** Timestamp of the current event. */
+    uint64_t currentTs;
+    /** Execution context of the current event. */
+    uint32_t currentContext;
+    /** The event count. */
+    uint64_t eventCount;
+    /** Number of events inserted but not yet run or removed. */
+    int unscheduledEvents;
+    /** Number of messages sent. */
+    uint64_t sent;
+    /** Mutex of the inboxes. */
+    SystemMutex inboxMutex;
+    /**
+     * Messages received, by window parity: the messages sent during a
+     * window are merged during the next one.
+     */
+    std::vector<Message> inbox[2];
+    /** Earliest time stamp in each inbox. */
+    uint64_t inboxTs[2];
+  };
+
+  /**
+   * Create a logical process with no event.
+   *
+   * \param [in] id The logical process index.
+   * \returns The logical process.
+   */
+  LogicalProcess *CreateLogicalProcess (uint32_t id) const;
+  /**
+   * Partition the nodes into logical processes and move the events
+   * scheduled so far to their logical process.
+   */
+  void Partition (void);
+  /**
+   * Get the logical process of a context.
+   *
+   * \param [in] context The context.
+   * \returns The logical process of the node, or the global one.
+   */
+  LogicalProcess *GetLogicalProcess (uint32_t context) const;
+  /**
+   * Get the logical process of the calling thread.
+   *
+   * \returns The logical process whose events the thread is running,
+   *          the global one outside of the windows.
+   */
+  LogicalProcess *GetCurrent (void) const;
+  /**
+   * Insert an event in a logical process.
+   *
+   * \param [in] lp The logical process.
+   * \param [in] ts The event time stamp.
+   * \param [in] context The event context.
+   * \param [in] event The event implementation.
+   * \returns The scheduled event.
+   */
+  Scheduler::Event Insert (LogicalProcess *lp, uint64_t ts, uint32_t context, EventImpl *event);
+  /**
+   * Move the messages of an inbox to the scheduler of their logical process.
+   *
+   * \param [in] lp The logical process.
+   * \param [in] parity The parity of the window the messages were sent in.
+   */
+  void MergeInbox (LogicalProcess *lp, uint32_t parity);
+  /**
+   * Get the time stamp of the earliest event of a logical process,
+   * including the messages not merged yet.
+   *
+   * \param [in] lp The logical process.
+   * \returns The time stamp, or ~0 if there is no event.
+   */
+  uint64_t GetNextTs (const LogicalProcess *lp) const;
+  /**
+   * Run the next event of a logical process.
+   *
+   * \param [in] lp The logical process.
+   */
+  void ProcessOneEvent (LogicalProcess *lp);
+  /**
+   * Check that the calling thread may access an event: during a window,
+   * only the events of the logical process it runs.
+   *
+   * \param [in] id The event.
+   */
+  void CheckOwner (const EventId &id) const;
+  /** Run the events of the current window of the logical processes left. */
+  void ProcessWindow (void);
+  /** Body of the worker threads. */
+  void RunWorker (void);
+
+  /** Logical processes of the nodes. */
+  std::vector<LogicalProcess *> m_lps;
+  /** Logical process of the global events. */
+  LogicalProcess *m_global;
+  /** Logical process of each node, by node id. */
+  std::vector<LogicalProcess *> m_nodeLps;
+  /** Whether the nodes have been partitioned. */
+  bool m_partitioned;
+  /** Smallest delay of the links between logical processes. */
+  uint64_t m_lookahead;
+  /** Factory of the schedulers of the logical processes. */
+  ObjectFactory m_schedulerFactory;
+  /** Maximum number of threads, 0 for one per core. */
+  uint32_t m_maxThreads;
+
+  /** Container type for the events to run at Simulator::Destroy() */
+  typedef std::list<EventId> DestroyEvents;
+  /** The container of events to run at Destroy. */
+  DestroyEvents m_destroyEvents;
+  /** Flag calling for the end of the simulation. */
+  std::atomic<bool> m_stop;
+
+  /** End of the current window (exclusive). */
+  uint64_t m_windowEnd;
+  /** Number of windows run, their parity selects the inboxes. */
+  uint32_t m_window;
+  /** Incremented by the main thread to start a window. */
+  std::atomic<uint32_t> m_start;
+  /** Index of the next logical process to run in the window. */
+  std::atomic<uint32_t> m_nextLp;
+  /** Number of threads done with the window. */
+  std::atomic<uint32_t> m_done;
+  /** Whether the worker threads should exit. */
+  std::atomic<bool> m_quit;
+  /** The worker threads, during Run (). */
+  std::vector<Ptr<SystemThread> > m_threads;
+
+  /** Logical process run by the current thread, 0 outside of the windows. */
+  static thread_local LogicalProcess *g_current;
+};
+
+} // namespace ns3
+
+#endif /* MULTITHREADED_SIMULATOR_IMPL_H */
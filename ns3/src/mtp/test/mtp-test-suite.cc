@@ -0,0 +1,268 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/simulator.h"
+#include "ns3/config.h"
+#include "ns3/string.h"
+#include "ns3/uinteger.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/simple-net-device-helper.h"
+#include "ns3/mac48-address.h"
+#include "ns3/packet.h"
+#include "ns3/multithreaded-simulator-impl.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/**
+ * \file
+ * \ingroup mtp-tests
+ * MultithreadedSimulatorImpl test suite.
+ */
+
+/**
+ * \ingroup mtp
+ * \defgroup mtp-tests Multithreaded simulation tests
+ */
+
+using namespace ns3;
+
+/**
+ * \ingroup mtp-tests
+ *
+ * \brief Run the same packet exchange with DefaultSimulatorImpl and
+ * MultithreadedSimulatorImpl and check that every node receives the same
+ * packets at the same times.
+ *
+ * The six nodes are linked by SimpleChannels:
+ *
+ *     5 --0.5ms-- 0 --1ms-- 1 --3ms-- 2 --0ms-- 3 ==2ms== 4
+ *
+ * The zero delay link and the shared channel (==) keep nodes 2, 3 and 4
+ * in one logical process, so there are four of them and the lookahead is
+ * 0.5 ms. Every node sends a packet on each of its links every few tens
+ * of microseconds, and forwards the packets it receives a few hops.
+ *
+ * When node 1 calls Simulator::Stop, the other logical processes finish
+ * the window, so the results are compared with a single thread run of
+ * MultithreadedSimulatorImpl instead.
+ */
+class MultithreadedSimulatorTestCase : public TestCase
+{
+public:
+  /**
+   * Constructor
+   * \param maxThreads the MaxThreads of the simulator
+   * \param nodeStop whether node 1 stops the simulation
+   */
+  MultithreadedSimulatorTestCase (uint32_t maxThreads, bool nodeStop);
+
+private:
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  /// Packets received by a node: time stamp and size
+  typedef std::vector<std::pair<int64_t, uint32_t> > Log;
+
+  /**
+   * Build the network, run the simulation and collect what the nodes received.
+   * \param simulatorType the SimulatorImplementationType
+   * \param maxThreads the MaxThreads of MultithreadedSimulatorImpl
+   * \returns the packets received, by node
+   */
+  std::vector<Log> Simulate (std::string simulatorType, uint32_t maxThreads);
+  /**
+   * Send a packet on every device of a node, and schedule the next ones.
+   * \param node the node
+   */
+  void Send (Ptr<Node> node);
+  /**
+   * Log a received packet and forward it, up to a few hops.
+   * \param device the receiving device
+   * \param packet the packet
+   * \param protocol the protocol number
+   * \param from the sender address
+   * \returns true
+   */
+  bool Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol, const Address &from);
+
+  uint32_t m_maxThreads;     //!< MaxThreads of the simulator
+  bool m_nodeStop;           //!< Whether node 1 stops the simulation
+  std::vector<Log> m_logs;   //!< Packets received, by node
+  uint32_t m_nLps;           //!< Number of logical processes of the last run
+  Time m_lookahead;          //!< Lookahead of the last run
+};
+
+MultithreadedSimulatorTestCase::MultithreadedSimulatorTestCase (uint32_t maxThreads, bool nodeStop)
+  : TestCase ("Check that MultithreadedSimulatorImpl with " + std::to_string (maxThreads)
+              + " threads runs the events of "
+              + (nodeStop ? "a single thread when a node stops" : "DefaultSimulatorImpl")),
+    m_maxThreads (maxThreads),
+    m_nodeStop (nodeStop),
+    m_nLps (0)
+{
+}
+
+void
+MultithreadedSimulatorTestCase::Send (Ptr<Node> node)
+{
+  for (uint32_t i = 0; i < node->GetNDevices (); i++)
+    {
+      // The size holds the sender and the number of hops
+      Ptr<Packet> packet = Create<Packet> (100 + node->GetId () * 10);
+      node->GetDevice (i)->Send (packet, Mac48Address::GetBroadcast (), 0x800);
+    }
+  if (Simulator::Now () < MilliSeconds (20))
+    {
+      Simulator::Schedule (MicroSeconds (30 + node->GetId () * 7), &MultithreadedSimulatorTestCase::Send, this, node);
+    }
+}
+
+bool
+MultithreadedSimulatorTestCase::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol, const Address &from)
+{
+  Ptr<Node> node = device->GetNode ();
+  m_logs[node->GetId ()].push_back (std::make_pair (Simulator::Now ().GetTimeStep (), packet->GetSize ()));
+  uint32_t hops = packet->GetSize () % 10;
+  if (hops < 3)
+    {
+      Ptr<Packet> forward = Create<Packet> (packet->GetSize () + 1);
+      Ptr<NetDevice> out = node->GetDevice ((node->GetId () + hops) % node->GetNDevices ());
+      out->Send (forward, Mac48Address::GetBroadcast (), protocol);
+    }
+  return true;
+}
+
+std::vector<MultithreadedSimulatorTestCase::Log>
+MultithreadedSimulatorTestCase::Simulate (std::string simulatorType, uint32_t maxThreads)
+{
+  Config::SetGlobal ("SimulatorImplementationType", StringValue (simulatorType));
+  Config::SetDefault ("ns3::MultithreadedSimulatorImpl::MaxThreads", UintegerValue (maxThreads));
+
+  NodeContainer nodes;
+  nodes.Create (6);
+  m_logs.assign (nodes.GetN (), Log ());
+
+  SimpleNetDeviceHelper helper;
+  helper.SetNetDevicePointToPointMode (true);
+  NetDeviceContainer devices;
+  uint32_t links[4][2] = { { 5, 0 }, { 0, 1 }, { 1, 2 }, { 2, 3 } };
+  Time delays[4] = { MicroSeconds (500), MilliSeconds (1), MilliSeconds (3), Seconds (0) };
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      helper.SetChannelAttribute ("Delay", TimeValue (delays[i]));
+      devices.Add (helper.Install (NodeContainer (nodes.Get (links[i][0]), nodes.Get (links[i][1]))));
+    }
+  helper.SetNetDevicePointToPointMode (false);
+  helper.SetChannelAttribute ("Delay", TimeValue (MilliSeconds (2)));
+  devices.Add (helper.Install (NodeContainer (nodes.Get (3), nodes.Get (4))));
+
+  for (uint32_t i = 0; i < devices.GetN (); i++)
+    {
+      devices.Get (i)->SetReceiveCallback (MakeCallback (&MultithreadedSimulatorTestCase::Receive, this));
+    }
+  for (uint32_t i = 0; i < nodes.GetN (); i++)
+    {
+      Simulator::ScheduleWithContext (i, MicroSeconds (i), &MultithreadedSimulatorTestCase::Send, this, nodes.Get (i));
+    }
+  if (m_nodeStop)
+    {
+      Simulator::ScheduleWithContext (1, MilliSeconds (10), static_cast<void (*) (void)> (&Simulator::Stop));
+    }
+  Simulator::Stop (MilliSeconds (30));
+  Simulator::Run ();
+
+  Ptr<MultithreadedSimulatorImpl> impl = DynamicCast<MultithreadedSimulatorImpl> (Simulator::GetImplementation ());
+  if (impl != 0)
+    {
+      m_nLps = impl->GetNLogicalProcesses ();
+      m_lookahead = impl->GetLookahead ();
+    }
+  Simulator::Destroy ();
+
+  std::vector<Log> logs = m_logs;
+  for (Log &log : logs)
+    {
+      // Packets received at the same time may come in another order
+      std::sort (log.begin (), log.end ());
+    }
+  return logs;
+}
+
+void
+MultithreadedSimulatorTestCase::DoRun (void)
+{
+  std::vector<Log> expected;
+  if (m_nodeStop)
+    {
+      expected = Simulate ("ns3::MultithreadedSimulatorImpl", 1);
+    }
+  else
+    {
+      expected = Simulate ("ns3::DefaultSimulatorImpl", 0);
+    }
+  std::vector<Log> logs = Simulate ("ns3::MultithreadedSimulatorImpl", m_maxThreads);
+
+  NS_TEST_ASSERT_MSG_EQ (m_nLps, 4, "Wrong partition");
+  NS_TEST_ASSERT_MSG_EQ (m_lookahead, MicroSeconds (500), "Wrong lookahead");
+  for (uint32_t i = 0; i < expected.size (); i++)
+    {
+      NS_TEST_ASSERT_MSG_GT (expected[i].size (), 100, "Too few packets received by node " << i);
+      if (m_nodeStop)
+        {
+          NS_TEST_ASSERT_MSG_LT (expected[i].back ().first, (MilliSeconds (10) + m_lookahead).GetTimeStep (),
+                                 "Node " << i << " ran past the window of the Stop");
+        }
+      NS_TEST_ASSERT_MSG_EQ (logs[i].size (), expected[i].size (), "Wrong number of packets received by node " << i);
+      for (uint32_t j = 0; j < std::min (logs[i].size (), expected[i].size ()); j++)
+        {
+          NS_TEST_ASSERT_MSG_EQ (logs[i][j].first, expected[i][j].first, "Packet " << j << " of node " << i << " received at another time");
+          NS_TEST_ASSERT_MSG_EQ (logs[i][j].second, expected[i][j].second, "Packet " << j << " of node " << i << " differs");
+        }
+    }
+}
+
+void
+MultithreadedSimulatorTestCase::DoTeardown (void)
+{
+  Config::SetGlobal ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+}
+
+/**
+ * \ingroup mtp-tests
+ *
+ * \brief MultithreadedSimulatorImpl TestSuite
+ */
+class MultithreadedSimulatorTestSuite : public TestSuite
+{
+public:
+  MultithreadedSimulatorTestSuite ();
+};
+
+MultithreadedSimulatorTestSuite::MultithreadedSimulatorTestSuite ()
+  : TestSuite ("multithreaded-simulator", UNIT)
+{
+  AddTestCase (new MultithreadedSimulatorTestCase (1, false), TestCase::QUICK);
+  AddTestCase (new MultithreadedSimulatorTestCase (4, false), TestCase::QUICK);
+  AddTestCase (new MultithreadedSimulatorTestCase (4, true), TestCase::QUICK);
+}
+
+static MultithreadedSimulatorTestSuite g_multithreadedSimulatorTestSuite; //!< Static variable for test initialization
@@ -20,6 +20,8 @@
 #include "buffer.h"
 #include "ns3/assert.h"
 #include "ns3/log.h"
+#include "ns3/global-value.h"
+#include "ns3/uinteger.h"
 
 #define LOG_INTERNAL_STATE(y)                                                                    \
   NS_LOG_LOGIC (y << "start="<<m_start<<", end="<<m_end<<", zero start="<<m_zeroAreaStart<<              \
@@ -50,68 +52,69 @@ namespace ns3 {
 NS_LOG_COMPONENT_DEFINE ("Buffer");
 
 
+#ifdef NS3_MTP
+thread_local uint32_t Buffer::g_recommendedStart = 0;
+#else
 uint32_t Buffer::g_recommendedStart = 0;
+#endif
 #ifdef BUFFER_FREE_LIST
-/* The following macros are pretty evil but they are needed to allow us to
- * keep track of 3 possible states for the g_freeList variable:
- *  - uninitialized means that no one has created a buffer yet
- *    so no one has created the associated free list (it is created
- *    on-demand when the first buffer is created)
- *  - initialized means that the free list exists and is valid
- *  - destroyed means that the static destructors of this compilation unit
- *    have run so, the free list has been cleared from its content
- * The key is that in destroyed state, we are careful not re-create it
- * which is a typical weakness of lazy evaluation schemes which use 
- * '0' as a special value to indicate both un-initialized and destroyed.
- * Note that it is important to use '0' as the marker for un-initialized state
- * because the variable holding this state information is initialized to zero
- * which the compiler assigns to zero-memory which is initialized to _zero_
- * before the constructors run so this ensures perfect handling of crazy 
- * constructor orderings.
+/**
+ * \relates Buffer
+ * Maximum number of free BufferData each thread keeps per size class.
+ *
+ * This is accessible as "--BufferFreeListCapacity" from CommandLine.
  */
-#define MAGIC_DESTROYED (~(long) 0)
-#define IS_UNINITIALIZED(x) (x == (Buffer::FreeList*)0)
-#define IS_DESTROYED(x) (x == (Buffer::FreeList*)MAGIC_DESTROYED)
-#define IS_INITIALIZED(x) (!IS_UNINITIALIZED (x) && !IS_DESTROYED (x))
-#define DESTROYED ((Buffer::FreeList*)MAGIC_DESTROYED)
-#define UNINITIALIZED ((Buffer::FreeList*)0)
-uint32_t Buffer::g_maxSize = 0;
-Buffer::FreeList *Buffer::g_freeList = 0;
-struct Buffer::LocalStaticDestructor Buffer::g_localStaticDestructor;
-
-Buffer::LocalStaticDestructor::~LocalStaticDestructor(void)
+static GlobalValue g_bufferFreeListCapacity ("BufferFreeListCapacity",
+                                             "Maximum number of free buffers kept per size class by each thread",
+                                             UintegerValue (1000),
+                                             MakeUintegerChecker<uint32_t> ());
+
+namespace {
+
+/** Free list of the current thread. */
+thread_local SizeClassFreeList g_bufferFreeList;
+
+/** Releases the free list of a thread when it exits. */
+struct BufferFreeListCloser
 {
-  NS_LOG_FUNCTION (this);
-  if (IS_INITIALIZED (g_freeList))
-    {
-      for (Buffer::FreeList::iterator i = g_freeList->begin ();
-           i != g_freeList->end (); i++)
-        {
-          Buffer::Deallocate (*i);
-        }
-      delete g_freeList;
-      g_freeList = DESTROYED;
-    }
-}
+  /** Does nothing: calling it odr-uses the thread_local closer, so that its destructor runs at thread exit. */
+  void Register (void)
+  {
+  }
+  ~BufferFreeListCloser ()
+  {
+    g_bufferFreeList.Close ();
+  }
+};
+
+/** Closer of the free list of the current thread. */
+thread_local BufferFreeListCloser g_bufferFreeListCloser;
+
+/** Largest BufferData recycled by the current thread. */
+thread_local uint32_t g_maxSize = 0;
+
+} // unnamed namespace
 
 void
 Buffer::Recycle (struct Buffer::Data *data)
 {
   NS_LOG_FUNCTION (data);
   NS_ASSERT (data->m_count == 0);
-  NS_ASSERT (!IS_UNINITIALIZED (g_freeList));
   g_maxSize = std::max (g_maxSize, data->m_size);
-  /* feed into free list */
-  if (data->m_size < g_maxSize ||
-      IS_DESTROYED (g_freeList) ||
-      g_freeList->size () > 1000)
+  if (!g_bufferFreeList.IsOpen ())
     {
-      Buffer::Deallocate (data);
+      UintegerValue capacity;
+      g_bufferFreeListCapacity.GetValue (capacity);
+      g_bufferFreeList.Open (capacity.Get ());
+      g_bufferFreeListCloser.Register ();
     }
-  else
+  /* feed into free list, unless smaller than the next requests */
+  uint32_t c = SizeClassFreeList::GetClass (data->m_size);
+  if (SizeClassFreeList::GetClassSize (c) != data->m_size
+      || c < SizeClassFreeList::GetClass (g_maxSize)
+      || !g_bufferFreeList.Put (reinterpret_cast<uint8_t *> (data), c))
     {
-      NS_ASSERT (IS_INITIALIZED (g_freeList));
-      g_freeList->push_back (data);
+      Buffer::Deallocate (data);
     }
 }
 
@@ -120,28 +123,29 @@ Buffer::Create (uint32_t dataSize)
 {
   NS_LOG_FUNCTION (dataSize);
   /* try to find a buffer correctly sized. */
-  if (IS_UNINITIALIZED (g_freeList))
+  uint32_t c = SizeClassFreeList::GetClass (std::max (dataSize, g_maxSize));
+  if (c >= SizeClassFreeList::CLASSES)
     {
-      g_freeList = new Buffer::FreeList ();
+      return Buffer::Allocate (dataSize);
     }
-  else if (IS_INITIALIZED (g_freeList))
+  uint8_t *block = g_bufferFreeList.Get (c);
+  if (block != 0)
     {
-      while (!g_freeList->empty ()) 
-        {
-          struct Buffer::Data *data = g_freeList->back ();
-          g_freeList->pop_back ();
-          if (data->m_size >= dataSize) 
-            {
-              data->m_count = 1;
-              return data;
-            }
-          Buffer::Deallocate (data);
-        }
+      struct Buffer::Data *data = reinterpret_cast<struct Buffer::Data *> (block);
+      data->m_size = SizeClassFreeList::GetClassSize (c);
+      data->m_count = 1;
+      return data;
     }
-  struct Buffer::Data *data = Buffer::Allocate (dataSize);
+  struct Buffer::Data *data = Buffer::Allocate (SizeClassFreeList::GetClassSize (c));
   NS_ASSERT (data->m_count == 1);
   return data;
 }
+
+FreeListStats
+Buffer::GetFreeListStats (void)
+{
+  return g_bufferFreeList.GetStats ();
+}
 #else /* BUFFER_FREE_LIST */
 void
 Buffer::Recycle (struct Buffer::Data *data)
@@ -157,6 +161,13 @@ Buffer::Create (uint32_t size)
   NS_LOG_FUNCTION (size);
   return Allocate (size);
 }
+
+FreeListStats
+Buffer::GetFreeListStats (void)
+{
+  FreeListStats stats = FreeListStats ();
+  return stats;
+}
 #endif /* BUFFER_FREE_LIST */
 
 struct Buffer::Data *
@@ -262,8 +273,7 @@ Buffer::operator = (Buffer const&o)
   if (m_data != o.m_data) 
     {
       // not assignment to self.
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (--m_data->m_count == 0) 
         {
           Recycle (m_data);
         }
@@ -285,8 +295,7 @@ Buffer::~Buffer ()
   NS_LOG_FUNCTION (this);
   NS_ASSERT (CheckInternalState ());
   g_recommendedStart = std::max (g_recommendedStart, m_maxZeroAreaStart);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (--m_data->m_count == 0) 
     {
       Recycle (m_data);
     }
@@ -310,7 +319,12 @@ Buffer::AddAtStart (uint32_t start)
 {
   NS_LOG_FUNCTION (this << start);
   NS_ASSERT (CheckInternalState ());
+#ifdef NS3_MTP
+  // Another thread may extend the dirty area of a shared buffer at any time
+  bool isDirty = m_data->m_count > 1;
+#else
   bool isDirty = m_data->m_count > 1 && m_start > m_data->m_dirtyStart;
+#endif
   if (m_start >= start && !isDirty)
     {
       /* enough space in the buffer and not dirty. 
@@ -328,8 +342,7 @@ Buffer::AddAtStart (uint32_t start)
       uint32_t newSize = GetInternalSize () + start;
       struct Buffer::Data *newData = Buffer::Create (newSize);
       memcpy (newData->m_data + start, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0)
+      if (--m_data->m_count == 0)
         {
           Buffer::Recycle (m_data);
         }
@@ -355,7 +368,11 @@ Buffer::AddAtEnd (uint32_t end)
 {
   NS_LOG_FUNCTION (this << end);
   NS_ASSERT (CheckInternalState ());
+#ifdef NS3_MTP
+  bool isDirty = m_data->m_count > 1;
+#else
   bool isDirty = m_data->m_count > 1 && m_end < m_data->m_dirtyEnd;
+#endif
   if (GetInternalEnd () + end <= m_data->m_size && !isDirty)
     {
       /* enough space in buffer and not dirty
@@ -373,8 +390,7 @@ Buffer::AddAtEnd (uint32_t end)
       uint32_t newSize = GetInternalSize () + end;
       struct Buffer::Data *newData = Buffer::Create (newSize);
       memcpy (newData->m_data, m_data->m_data + m_start, GetInternalSize ());
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (--m_data->m_count == 0) 
         {
           Buffer::Recycle (m_data);
         }
@@ -24,6 +24,10 @@
 #include <vector>
 #include <ostream>
 #include "ns3/assert.h"
+#include "size-class-free-list.h"
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 
 #define BUFFER_FREE_LIST 1
 
@@ -57,7 +61,14 @@ namespace ns3 {
  * safe to modify the content of a BufferData if the modification
  * falls outside of the "dirty area" defined by the BufferData.
  * In every other case, the BufferData must be copied before
- * being modified.
+ * being modified. When built with --enable-mtp, the Buffer instances
+ * sharing a BufferData may be used from different threads, so the
+ * reference count is atomic and a shared BufferData is always copied
+ * before being modified.
+ *
+ * The BufferData of the destroyed buffers are kept for reuse in a free
+ * list per thread, sorted by size classes at most 25% apart, up to
+ * BufferFreeListCapacity BufferData per class (see GetFreeListStats).
  *
  * To understand the way the Buffer::Add and Buffer::Remove methods
  * work, you first need to understand the "virtual offsets" used to
@@ -642,6 +653,16 @@ private:
    */
   Buffer (uint32_t dataSize, bool initialize);
   ~Buffer ();
+
+  /**
+   * \brief Get the statistics of the free list of the calling thread.
+   *
+   * Its capacity is read from the BufferFreeListCapacity GlobalValue
+   * when the thread destroys its first buffer.
+   *
+   * \returns the free list statistics
+   */
+  static FreeListStats GetFreeListStats (void);
 private:
   /**
    * This data structure is variable-sized through its last member whose size
@@ -663,7 +684,11 @@ private:
      * The reference count of an instance of this data structure.
      * Each buffer which references an instance holds a count.
      */
+#ifdef NS3_MTP
+    std::atomic<uint32_t> m_count;
+#else
     uint32_t m_count;
+#endif
     /**
      * the size of the m_data field below.
      */
@@ -767,7 +792,11 @@ private:
    * writing data. i.e., m_start should be initialized to this 
    * value.
    */
+#ifdef NS3_MTP
+  static thread_local uint32_t g_recommendedStart;
+#else
   static uint32_t g_recommendedStart;
+#endif
 
   /**
    * offset to the start of the virtual zero area from the start
@@ -789,19 +818,6 @@ private:
    * instance from the start of m_data->m_data
    */
   uint32_t m_end;
-
-#ifdef BUFFER_FREE_LIST
-  /// Container for buffer data
-  typedef std::vector<struct Buffer::Data*> FreeList;
-  /// Local static destructor structure
-  struct LocalStaticDestructor 
-  {
-    ~LocalStaticDestructor ();
-  };
-  static uint32_t g_maxSize; //!< Max observed data size
-  static FreeList *g_freeList; //!< Buffer data container
-  static struct LocalStaticDestructor g_localStaticDestructor; //!< Local static destructor
-#endif
 };
 
 } // namespace ns3
@@ -22,8 +22,13 @@
 #include <vector>
 #include <cstring>
 #include <limits>
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 
+#ifndef NS3_MTP
 #define USE_FREE_LIST 1
+#endif
 #define FREE_LIST_SIZE 1000
 #define OFFSET_MAX (std::numeric_limits<int32_t>::max ())
 
@@ -40,7 +45,11 @@ NS_LOG_COMPONENT_DEFINE ("ByteTagList");
  */
 struct ByteTagListData {
   uint32_t size;   //!< size of the data
+#ifdef NS3_MTP
+  std::atomic<uint32_t> count;  //!< use counter (for smart deallocation)
+#else
   uint32_t count;  //!< use counter (for smart deallocation)
+#endif
   uint32_t dirty;  //!< number of bytes actually in use
   uint8_t data[4]; //!< data
 };
@@ -199,8 +208,14 @@ ByteTagList::Add (TypeId tid, uint32_t bufferSize, int32_t start, int32_t end)
       m_data = Allocate (spaceNeeded);
       m_used = 0;
     } 
+#ifdef NS3_MTP
+  // The lists sharing the data may be adding tags from other threads
+  else if (m_data->size < spaceNeeded ||
+           m_data->count != 1)
+#else
   else if (m_data->size < spaceNeeded ||
            (m_data->count != 1 && m_data->dirty != m_used))
+#endif
     {
       struct ByteTagListData *newData = Allocate (spaceNeeded);
       std::memcpy (&newData->data, &m_data->data, m_used);
@@ -376,8 +391,7 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
       return;
     }
   g_maxSize = std::max (g_maxSize, data->size);
-  data->count--;
-  if (data->count == 0)
+  if (--data->count == 0)
     {
       if (g_freeList.size () > FREE_LIST_SIZE ||
           data->size < g_maxSize)
@@ -414,8 +428,7 @@ ByteTagList::Deallocate (struct ByteTagListData *data)
     {
       return;
     }
-  data->count--;
-  if (data->count == 0)
+  if (--data->count == 0)
     {
       uint8_t *buffer = (uint8_t *)data;
       delete [] buffer;
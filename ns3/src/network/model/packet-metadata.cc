@@ -17,11 +17,14 @@
  *
  * Author: Mathieu Lacage <mathieu.lacage@sophia.inria.fr>
  */
+#include <algorithm>
 #include <utility>
 #include <list>
 #include "ns3/assert.h"
 #include "ns3/fatal-error.h"
 #include "ns3/log.h"
+#include "ns3/global-value.h"
+#include "ns3/uinteger.h"
 #include "packet-metadata.h"
 #include "buffer.h"
 #include "header.h"
@@ -34,24 +37,55 @@ NS_LOG_COMPONENT_DEFINE ("PacketMetadata");
 bool PacketMetadata::m_enable = false;
 bool PacketMetadata::m_enableChecking = false;
 bool PacketMetadata::m_metadataSkipped = false;
+#ifdef NS3_MTP
+thread_local uint32_t PacketMetadata::m_maxSize = 0;
+thread_local uint16_t PacketMetadata::m_chunkUid = 0;
+#else
 uint32_t PacketMetadata::m_maxSize = 0;
 uint16_t PacketMetadata::m_chunkUid = 0;
-PacketMetadata::DataFreeList PacketMetadata::m_freeList;
+#endif
 
-PacketMetadata::DataFreeList::~DataFreeList ()
+/**
+ * \relates PacketMetadata
+ * Maximum number of free metadata buffers each thread keeps per size class.
+ *
+ * This is accessible as "--PacketMetadataFreeListCapacity" from CommandLine.
+ */
+static GlobalValue g_packetMetadataFreeListCapacity ("PacketMetadataFreeListCapacity",
+                                                     "Maximum number of free metadata buffers kept per size class by each thread",
+                                                     UintegerValue (1000),
+                                                     MakeUintegerChecker<uint32_t> ());
+
+namespace {
+
+/** Free list of the current thread. */
+thread_local SizeClassFreeList g_metadataFreeList;
+
+/** Releases the free list of a thread when it exits. */
+struct MetadataFreeListCloser
 {
-  NS_LOG_FUNCTION (this);
-  for (iterator i = begin (); i != end (); i++)
-    {
-      PacketMetadata::Deallocate (*i);
-    }
-  PacketMetadata::m_enable = false;
-}
+  /** Does nothing: calling it odr-uses the thread_local closer, so that its destructor runs at thread exit. */
+  void Register (void)
+  {
+  }
+  ~MetadataFreeListCloser ()
+  {
+    g_metadataFreeList.Close ();
+  }
+};
+
+/** Closer of the free list of the current thread. */
+thread_local MetadataFreeListCloser g_metadataFreeListCloser;
+
+} // unnamed namespace
 
 void 
 PacketMetadata::Enable (void)
 {
   NS_LOG_FUNCTION_NOARGS ();
+#ifdef NS3_NO_PACKET_METADATA
+  NS_LOG_WARN ("Packet metadata is compiled out by --disable-packet-metadata");
+#else
   NS_ASSERT_MSG (!m_metadataSkipped,
                  "Error: attempting to enable the packet metadata "
                  "subsystem too late in the simulation, which is not allowed.\n"
@@ -60,6 +94,7 @@ PacketMetadata::Enable (void)
                  "to call ns3::PacketMetadata::Enable () near the beginning of"
                  " the program, before any packets are sent.");
   m_enable = true;
+#endif
 }
 
 void 
@@ -70,6 +105,17 @@ PacketMetadata::EnableChecking (void)
   m_enableChecking = true;
 }
 
+void
+PacketMetadata::Materialize (void)
+{
+  if (m_data == 0)
+    {
+      NS_LOG_FUNCTION (this);
+      m_data = PacketMetadata::Create (10);
+      memset (m_data->m_data, 0xff, 4);
+    }
+}
+
 void
 PacketMetadata::ReserveCopy (uint32_t size)
 {
@@ -77,8 +123,7 @@ PacketMetadata::ReserveCopy (uint32_t size)
   struct PacketMetadata::Data *newData = PacketMetadata::Create (m_used + size);
   memcpy (newData->m_data, m_data->m_data, m_used);
   newData->m_dirtyEnd = m_used;
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (--m_data->m_count == 0)
     {
       PacketMetadata::Recycle (m_data);
     }
@@ -100,10 +145,16 @@ PacketMetadata::Reserve (uint32_t size)
 {
   NS_LOG_FUNCTION (this << size);
   NS_ASSERT (m_data != 0);
+#ifdef NS3_MTP
+  // Another thread may be appending to shared data at any time
+  if (m_data->m_size >= m_used + size &&
+      m_data->m_count == 1)
+#else
   if (m_data->m_size >= m_used + size &&
       (m_head == 0xffff ||
        m_data->m_count == 1 ||
        m_data->m_dirtyEnd == m_used))
+#endif
     {
       /* enough room, not dirty. */
     }
@@ -379,10 +430,15 @@ PacketMetadata::AddSmall (const struct PacketMetadata::SmallItem *item)
   uint32_t typeUidSize = GetUleb128Size (item->typeUid);
   uint32_t sizeSize = GetUleb128Size (item->size);
   uint32_t n =  2 + 2 + typeUidSize + sizeSize + 2;
+#ifdef NS3_MTP
+  if (m_used + n > m_data->m_size ||
+      m_data->m_count != 1)
+#else
   if (m_used + n > m_data->m_size ||
       (m_head != 0xffff &&
        m_data->m_count != 1 &&
        m_used != m_data->m_dirtyEnd))
+#endif
     {
       ReserveCopy (n);
     }
@@ -417,10 +473,15 @@ PacketMetadata::AddBig (uint32_t next, uint32_t prev,
   uint32_t fragEndSize = GetUleb128Size (extraItem->fragmentEnd);
   uint32_t n = 2 + 2 + typeUidSize + sizeSize + 2 + fragStartSize + fragEndSize + 4;
 
+#ifdef NS3_MTP
+  if (m_used + n > m_data->m_size ||
+      m_data->m_count != 1)
+#else
   if (m_used + n > m_data->m_size ||
       (m_head != 0xffff &&
        m_data->m_count != 1 &&
        m_used != m_data->m_dirtyEnd))
+#endif
     {
       ReserveCopy (n);
     }
@@ -575,45 +636,53 @@ PacketMetadata::Create (uint32_t size)
     {
       m_maxSize = size;
     }
-  while (!m_freeList.empty ()) 
+  uint32_t c = SizeClassFreeList::GetClass (std::max<uint32_t> (m_maxSize, PACKET_METADATA_DATA_M_DATA_SIZE));
+  if (c >= SizeClassFreeList::CLASSES)
     {
-      struct PacketMetadata::Data *data = m_freeList.back ();
-      m_freeList.pop_back ();
-      if (data->m_size >= size) 
-        {
-          NS_LOG_LOGIC ("create found size="<<data->m_size);
-          data->m_count = 1;
-          return data;
-        }
-      NS_LOG_LOGIC ("create dealloc size="<<data->m_size);
-      PacketMetadata::Deallocate (data);
+      return PacketMetadata::Allocate (m_maxSize);
+    }
+  uint8_t *block = g_metadataFreeList.Get (c);
+  if (block != 0)
+    {
+      struct PacketMetadata::Data *data = reinterpret_cast<struct PacketMetadata::Data *> (block);
+      NS_LOG_LOGIC ("create found size="<<SizeClassFreeList::GetClassSize (c));
+      data->m_size = SizeClassFreeList::GetClassSize (c);
+      data->m_count = 1;
+      data->m_dirtyEnd = 0;
+      return data;
     }
-  NS_LOG_LOGIC ("create alloc size="<<m_maxSize);
-  return PacketMetadata::Allocate (m_maxSize);
+  NS_LOG_LOGIC ("create alloc size="<<SizeClassFreeList::GetClassSize (c));
+  return PacketMetadata::Allocate (SizeClassFreeList::GetClassSize (c));
 }
 
 void
 PacketMetadata::Recycle (struct PacketMetadata::Data *data)
 {
   NS_LOG_FUNCTION (data);
-  if (!m_enable)
-    {
-      PacketMetadata::Deallocate (data);
-      return;
-    } 
-  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<m_freeList.size ());
   NS_ASSERT (data->m_count == 0);
-  if (m_freeList.size () > 1000 ||
-      data->m_size < m_maxSize) 
+  if (!g_metadataFreeList.IsOpen ())
     {
-      PacketMetadata::Deallocate (data);
-    } 
-  else 
+      UintegerValue capacity;
+      g_packetMetadataFreeListCapacity.GetValue (capacity);
+      g_metadataFreeList.Open (capacity.Get ());
+      g_metadataFreeListCloser.Register ();
+    }
+  NS_LOG_LOGIC ("recycle size="<<data->m_size<<", list="<<g_metadataFreeList.GetStats ().length);
+  uint32_t c = SizeClassFreeList::GetClass (data->m_size);
+  if (SizeClassFreeList::GetClassSize (c) != data->m_size
+      || c < SizeClassFreeList::GetClass (m_maxSize)
+      || !g_metadataFreeList.Put (reinterpret_cast<uint8_t *> (data), c))
     {
-      m_freeList.push_back (data);
+      PacketMetadata::Deallocate (data);
     }
 }
 
+FreeListStats
+PacketMetadata::GetFreeListStats (void)
+{
+  return g_metadataFreeList.GetStats ();
+}
+
 struct PacketMetadata::Data *
 PacketMetadata::Allocate (uint32_t n)
 {
@@ -651,24 +720,19 @@ PacketMetadata::CreateFragment (uint32_t start, uint32_t end) const
 }
 
 void 
-PacketMetadata::AddHeader (const Header &header, uint32_t size)
+PacketMetadata::DoAddHeader (const Header &header, uint32_t size)
 {
   NS_LOG_FUNCTION (this << &header << size);
+  Materialize ();
   NS_ASSERT (IsStateOk ());
   uint32_t uid = header.GetInstanceTypeId ().GetUid () << 1;
-  DoAddHeader (uid, size);
+  AddHeaderUid (uid, size);
   NS_ASSERT (IsStateOk ());
 }
 void
-PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
+PacketMetadata::AddHeaderUid (uint32_t uid, uint32_t size)
 {
   NS_LOG_FUNCTION (this << uid << size);
-  if (!m_enable)
-    {
-      m_metadataSkipped = true;
-      return;
-    }
-
   struct PacketMetadata::SmallItem item;
   item.next = m_head;
   item.prev = 0xffff;
@@ -680,16 +744,12 @@ PacketMetadata::DoAddHeader (uint32_t uid, uint32_t size)
   UpdateHead (written);
 }
 void 
-PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
+PacketMetadata::DoRemoveHeader (const Header &header, uint32_t size)
 {
   uint32_t uid = header.GetInstanceTypeId ().GetUid () << 1;
   NS_LOG_FUNCTION (this << &header << size);
+  Materialize ();
   NS_ASSERT (IsStateOk ());
-  if (!m_enable) 
-    {
-      m_metadataSkipped = true;
-      return;
-    }
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_head, &item, &extraItem);
@@ -728,16 +788,12 @@ PacketMetadata::RemoveHeader (const Header &header, uint32_t size)
   NS_ASSERT (IsStateOk ());
 }
 void 
-PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
+PacketMetadata::DoAddTrailer (const Trailer &trailer, uint32_t size)
 {
   uint32_t uid = trailer.GetInstanceTypeId ().GetUid () << 1;
   NS_LOG_FUNCTION (this << &trailer << size);
+  Materialize ();
   NS_ASSERT (IsStateOk ());
-  if (!m_enable)
-    {
-      m_metadataSkipped = true;
-      return;
-    }
   struct PacketMetadata::SmallItem item;
   item.next = 0xffff;
   item.prev = m_tail;
@@ -750,16 +806,12 @@ PacketMetadata::AddTrailer (const Trailer &trailer, uint32_t size)
   NS_ASSERT (IsStateOk ());
 }
 void 
-PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
+PacketMetadata::DoRemoveTrailer (const Trailer &trailer, uint32_t size)
 {
   uint32_t uid = trailer.GetInstanceTypeId ().GetUid () << 1;
   NS_LOG_FUNCTION (this << &trailer << size);
+  Materialize ();
   NS_ASSERT (IsStateOk ());
-  if (!m_enable) 
-    {
-      m_metadataSkipped = true;
-      return;
-    }
   struct PacketMetadata::SmallItem item;
   struct PacketMetadata::ExtraItem extraItem;
   uint32_t read = ReadItems (m_tail, &item, &extraItem);
@@ -798,15 +850,11 @@ PacketMetadata::RemoveTrailer (const Trailer &trailer, uint32_t size)
   NS_ASSERT (IsStateOk ());
 }
 void
-PacketMetadata::AddAtEnd (PacketMetadata const&o)
+PacketMetadata::DoAddAtEnd (PacketMetadata const&o)
 {
   NS_LOG_FUNCTION (this << &o);
+  Materialize ();
   NS_ASSERT (IsStateOk ());
-  if (!m_enable) 
-    {
-      m_metadataSkipped = true;
-      return;
-    }
   if (m_tail == 0xffff)
     {
       // We have no items so 'AddAtEnd' is 
@@ -875,26 +923,12 @@ PacketMetadata::AddAtEnd (PacketMetadata const&o)
     }
   NS_ASSERT (IsStateOk ());
 }
-void
-PacketMetadata::AddPaddingAtEnd (uint32_t end)
-{
-  NS_LOG_FUNCTION (this << end);
-  if (!m_enable)
-    {
-      m_metadataSkipped = true;
-      return;
-    }
-}
 void 
-PacketMetadata::RemoveAtStart (uint32_t start)
+PacketMetadata::DoRemoveAtStart (uint32_t start)
 {
   NS_LOG_FUNCTION (this << start);
+  Materialize ();
   NS_ASSERT (IsStateOk ());
-  if (!m_enable) 
-    {
-      m_metadataSkipped = true;
-      return;
-    }
   NS_ASSERT (m_data != 0);
   uint32_t leftToRemove = start;
   uint16_t current = m_head;
@@ -949,15 +983,11 @@ PacketMetadata::RemoveAtStart (uint32_t start)
   NS_ASSERT (IsStateOk ());
 }
 void 
-PacketMetadata::RemoveAtEnd (uint32_t end)
+PacketMetadata::DoRemoveAtEnd (uint32_t end)
 {
   NS_LOG_FUNCTION (this << end);
+  Materialize ();
   NS_ASSERT (IsStateOk ());
-  if (!m_enable) 
-    {
-      m_metadataSkipped = true;
-      return;
-    }
   NS_ASSERT (m_data != 0);
 
   uint32_t leftToRemove = end;
@@ -1141,7 +1171,7 @@ PacketMetadata::GetSerializedSize (void) const
   // if packet-metadata not enabled, total size
   // is simply 4-bytes for itself plus 8-bytes 
   // for packet uid
-  if (!m_enable)
+  if (!IsEnabled ())
     {
       return totalSize;
     }
@@ -1329,6 +1359,7 @@ PacketMetadata::Deserialize (const uint8_t* buffer, uint32_t size)
                     ", size="<<item.size<<", chunkUid="<<item.chunkUid<<
                     ", fragmentStart="<<extraItem.fragmentStart<<", fragmentEnd="<<
                     extraItem.fragmentEnd<< ", packetUid="<<extraItem.packetUid);
+      Materialize ();
       uint32_t tmp = AddBig (0xffff, m_tail, &item, &extraItem);
       UpdateTail (tmp);
     }
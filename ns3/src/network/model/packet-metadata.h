@@ -23,10 +23,14 @@
 #include <stdint.h>
 #include <vector>
 #include <limits>
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 #include "ns3/callback.h"
 #include "ns3/assert.h"
 #include "ns3/type-id.h"
 #include "buffer.h"
+#include "size-class-free-list.h"
 
 namespace ns3 {
 
@@ -74,6 +78,16 @@ class Trailer;
  * integers, and some others as variable-size 32-bit integers.
  * The variable-size 32 bit integers are stored using the uleb128
  * encoding.
+ *
+ * The data buffers of the destroyed instances are kept for reuse in a
+ * free list per thread, sorted by size classes at most 25% apart, up to
+ * PacketMetadataFreeListCapacity buffers per class (see
+ * GetFreeListStats).
+ *
+ * Until Enable is called, no data buffer is allocated and nothing is
+ * recorded. Configuring ns-3 with --disable-packet-metadata removes
+ * the recording altogether, for simulations which enable printing
+ * but do not need it (see IsEnabled).
  */
 class PacketMetadata 
 {
@@ -154,12 +168,38 @@ private:
 
   /**
    * \brief Enable the packet metadata
+   *
+   * This has no effect when ns-3 is configured with
+   * --disable-packet-metadata.
    */
   static void Enable (void);
   /**
    * \brief Enable the packet metadata checking
+   *
+   * This has no effect when ns-3 is configured with
+   * --disable-packet-metadata.
    */
   static void EnableChecking (void);
+  /**
+   * \brief Check if the packet metadata is recorded
+   *
+   * When it is not, the methods which record the headers, trailers and
+   * fragments of a packet return at once, and no storage is allocated.
+   * With --disable-packet-metadata, this is a constant and they compile
+   * to nothing.
+   *
+   * \returns true if the packet metadata is enabled
+   */
+  static inline bool IsEnabled (void);
+  /**
+   * \brief Get the statistics of the free list of the calling thread.
+   *
+   * Its capacity is read from the PacketMetadataFreeListCapacity
+   * GlobalValue when the thread destroys its first metadata.
+   *
+   * \returns the free list statistics
+   */
+  static FreeListStats GetFreeListStats (void);
 
   /**
    * \brief Constructor
@@ -185,26 +225,26 @@ private:
    * \param header header to add
    * \param size header serialized size
    */
-  void AddHeader (Header const &header, uint32_t size);
+  inline void AddHeader (Header const &header, uint32_t size);
   /**
    * \brief Remove an header
    * \param header header to remove
    * \param size header serialized size
    */
-  void RemoveHeader (Header const &header, uint32_t size);
+  inline void RemoveHeader (Header const &header, uint32_t size);
 
   /**
    * Add a trailer
    * \param trailer trailer to add
    * \param size trailer serialized size
    */
-  void AddTrailer (Trailer const &trailer, uint32_t size);
+  inline void AddTrailer (Trailer const &trailer, uint32_t size);
   /**
    * Remove a trailer
    * \param trailer trailer to remove
    * \param size trailer serialized size
    */
-  void RemoveTrailer (Trailer const &trailer, uint32_t size);
+  inline void RemoveTrailer (Trailer const &trailer, uint32_t size);
 
   /**
    * \brief Creates a fragment.
@@ -222,22 +262,22 @@ private:
    * \brief Add a metadata at the metadata start
    * \param o the metadata to add
    */
-  void AddAtEnd (PacketMetadata const&o);
+  inline void AddAtEnd (PacketMetadata const&o);
   /**
    * \brief Add some padding at the end
    * \param end size of padding
    */
-  void AddPaddingAtEnd (uint32_t end);
+  inline void AddPaddingAtEnd (uint32_t end);
   /**
    * \brief Remove a chunk of metadata at the metadata start
    * \param start the size of metadata to remove
    */
-  void RemoveAtStart (uint32_t start);
+  inline void RemoveAtStart (uint32_t start);
   /**
    * \brief Remove a chunk of metadata at the metadata end
    * \param end the size of metadata to remove
    */
-  void RemoveAtEnd (uint32_t end);
+  inline void RemoveAtEnd (uint32_t end);
 
   /**
    * \brief Get the packet Uid
@@ -413,7 +453,11 @@ private:
    */
   struct Data {
     /** number of references to this struct Data instance. */
+#ifdef NS3_MTP
+    std::atomic<uint32_t> m_count;
+#else
     uint32_t m_count;
+#endif
     /** size (in bytes) of m_data buffer below */
     uint16_t m_size;
     /** max of the m_used field over all objects which
@@ -494,16 +538,6 @@ private:
     uint64_t packetUid;
   };
 
-  /**
-   * \brief Class to hold all the metadata
-   */
-  class DataFreeList : public std::vector<struct Data *>
-  {
-public:
-    ~DataFreeList ();
-  };
-
-  friend DataFreeList::~DataFreeList ();
   /// Friend class
   friend class ItemIterator;
 
@@ -619,7 +653,57 @@ public:
    * \param uid header's uid to add
    * \param size header serialized size
    */
-  void DoAddHeader (uint32_t uid, uint32_t size);
+  void AddHeaderUid (uint32_t uid, uint32_t size);
+  /**
+   * \brief Add an header, when metadata is enabled
+   * \param header header to add
+   * \param size header serialized size
+   */
+  void DoAddHeader (Header const &header, uint32_t size);
+  /**
+   * \brief Remove an header, when metadata is enabled
+   * \param header header to remove
+   * \param size header serialized size
+   */
+  void DoRemoveHeader (Header const &header, uint32_t size);
+  /**
+   * \brief Add a trailer, when metadata is enabled
+   * \param trailer trailer to add
+   * \param size trailer serialized size
+   */
+  void DoAddTrailer (Trailer const &trailer, uint32_t size);
+  /**
+   * \brief Remove a trailer, when metadata is enabled
+   * \param trailer trailer to remove
+   * \param size trailer serialized size
+   */
+  void DoRemoveTrailer (Trailer const &trailer, uint32_t size);
+  /**
+   * \brief Add a metadata at the metadata end, when metadata is enabled
+   * \param o the metadata to add
+   */
+  void DoAddAtEnd (PacketMetadata const&o);
+  /**
+   * \brief Remove a chunk of metadata at the metadata start, when
+   * metadata is enabled
+   * \param start the size of metadata to remove
+   */
+  void DoRemoveAtStart (uint32_t start);
+  /**
+   * \brief Remove a chunk of metadata at the metadata end, when
+   * metadata is enabled
+   * \param end the size of metadata to remove
+   */
+  void DoRemoveAtEnd (uint32_t end);
+  /**
+   * \brief Record that a packet was changed while metadata was disabled
+   */
+  static inline void Skip (void);
+  /**
+   * \brief Allocate the storage of a metadata created while metadata was
+   * disabled
+   */
+  void Materialize (void);
   /**
    * \brief Check if the metadata state is ok
    * \returns true if the internal state is ok
@@ -661,7 +745,6 @@ public:
    */
   static void Deallocate (struct PacketMetadata::Data *data);
 
-  static DataFreeList m_freeList; //!< the metadata data storage
   static bool m_enable; //!< Enable the packet metadata
   static bool m_enableChecking; //!< Enable the packet metadata checking
 
@@ -672,8 +755,13 @@ public:
    */
   static bool m_metadataSkipped;
 
+#ifdef NS3_MTP
+  static thread_local uint32_t m_maxSize; //!< maximum metadata size
+  static thread_local uint16_t m_chunkUid; //!< Chunk Uid
+#else
   static uint32_t m_maxSize; //!< maximum metadata size
   static uint16_t m_chunkUid; //!< Chunk Uid
+#endif
 
   struct Data *m_data; //!< Metadata storage
   /*
@@ -691,17 +779,44 @@ public:
 
 namespace ns3 {
 
+bool
+PacketMetadata::IsEnabled (void)
+{
+#ifdef NS3_NO_PACKET_METADATA
+  return false;
+#else
+  return m_enable;
+#endif
+}
+void
+PacketMetadata::Skip (void)
+{
+#ifndef NS3_NO_PACKET_METADATA
+  m_metadataSkipped = true;
+#endif
+}
+
 PacketMetadata::PacketMetadata (uint64_t uid, uint32_t size)
-  : m_data (PacketMetadata::Create (10)),
+  : m_data (0),
     m_head (0xffff),
     m_tail (0xffff),
     m_used (0),
     m_packetUid (uid)
 {
+  if (!IsEnabled ())
+    {
+      // m_data is allocated if metadata is enabled later
+      if (size > 0)
+        {
+          Skip ();
+        }
+      return;
+    }
+  m_data = PacketMetadata::Create (10);
   memset (m_data->m_data, 0xff, 4);
   if (size > 0)
     {
-      DoAddHeader (0, size);
+      AddHeaderUid (0, size);
     }
 }
 PacketMetadata::PacketMetadata (PacketMetadata const &o)
@@ -711,9 +826,11 @@ PacketMetadata::PacketMetadata (PacketMetadata const &o)
     m_used (o.m_used),
     m_packetUid (o.m_packetUid)
 {
-  NS_ASSERT (m_data != 0);
-  NS_ASSERT (m_data->m_count < std::numeric_limits<uint32_t>::max());
-  m_data->m_count++;
+  if (m_data != 0)
+    {
+      NS_ASSERT (m_data->m_count < std::numeric_limits<uint32_t>::max());
+      m_data->m_count++;
+    }
 }
 PacketMetadata &
 PacketMetadata::operator = (PacketMetadata const& o)
@@ -721,15 +838,15 @@ PacketMetadata::operator = (PacketMetadata const& o)
   if (m_data != o.m_data) 
     {
       // not self assignment
-      NS_ASSERT (m_data != 0);
-      m_data->m_count--;
-      if (m_data->m_count == 0) 
+      if (m_data != 0 && --m_data->m_count == 0)
         {
           PacketMetadata::Recycle (m_data);
         }
       m_data = o.m_data;
-      NS_ASSERT (m_data != 0);
-      m_data->m_count++;
+      if (m_data != 0)
+        {
+          m_data->m_count++;
+        }
     }
   m_head = o.m_head;
   m_tail = o.m_tail;
@@ -739,14 +856,105 @@ PacketMetadata::operator = (PacketMetadata const& o)
 }
 PacketMetadata::~PacketMetadata ()
 {
-  NS_ASSERT (m_data != 0);
-  m_data->m_count--;
-  if (m_data->m_count == 0) 
+  if (m_data != 0 && --m_data->m_count == 0)
     {
       PacketMetadata::Recycle (m_data);
     }
 }
 
+void
+PacketMetadata::AddHeader (Header const &header, uint32_t size)
+{
+  if (IsEnabled ())
+    {
+      DoAddHeader (header, size);
+    }
+  else
+    {
+      Skip ();
+    }
+}
+void
+PacketMetadata::RemoveHeader (Header const &header, uint32_t size)
+{
+  if (IsEnabled ())
+    {
+      DoRemoveHeader (header, size);
+    }
+  else
+    {
+      Skip ();
+    }
+}
+void
+PacketMetadata::AddTrailer (Trailer const &trailer, uint32_t size)
+{
+  if (IsEnabled ())
+    {
+      DoAddTrailer (trailer, size);
+    }
+  else
+    {
+      Skip ();
+    }
+}
+void
+PacketMetadata::RemoveTrailer (Trailer const &trailer, uint32_t size)
+{
+  if (IsEnabled ())
+    {
+      DoRemoveTrailer (trailer, size);
+    }
+  else
+    {
+      Skip ();
+    }
+}
+void
+PacketMetadata::AddAtEnd (PacketMetadata const&o)
+{
+  if (IsEnabled ())
+    {
+      DoAddAtEnd (o);
+    }
+  else
+    {
+      Skip ();
+    }
+}
+void
+PacketMetadata::AddPaddingAtEnd (uint32_t end)
+{
+  if (!IsEnabled ())
+    {
+      Skip ();
+    }
+}
+void
+PacketMetadata::RemoveAtStart (uint32_t start)
+{
+  if (IsEnabled ())
+    {
+      DoRemoveAtStart (start);
+    }
+  else
+    {
+      Skip ();
+    }
+}
+void
+PacketMetadata::RemoveAtEnd (uint32_t end)
+{
+  if (IsEnabled ())
+    {
+      DoRemoveAtEnd (end);
+    }
+  else
+    {
+      Skip ();
+    }
+}
+
 } // namespace ns3
 
 
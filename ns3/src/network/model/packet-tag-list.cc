@@ -51,6 +51,17 @@ PacketTagList::CreateTagData (size_t dataSize)
   return tag;
 }
 
+void
+PacketTagList::RemoveInline (uint32_t i)
+{
+  NS_ASSERT (i < m_nInline);
+  for (uint32_t j = i + 1; j < m_nInline; j++)
+    {
+      m_inline[j - 1] = m_inline[j];
+    }
+  m_nInline--;
+}
+
 bool
 PacketTagList::COWTraverse (Tag & tag, PacketTagList::COWWriter Writer)
 {
@@ -175,6 +186,18 @@ PacketTagList::COWTraverse (Tag & tag, PacketTagList::COWWriter Writer)
 bool
 PacketTagList::Remove (Tag & tag)
 {
+  TypeId tid = tag.GetInstanceTypeId ();
+  for (uint32_t i = 0; i < m_nInline; i++)
+    {
+      if (m_inline[i].tid == tid)
+        {
+          NS_LOG_INFO ("found inline tid");
+          struct InlineTag &cur = m_inline[i];
+          tag.Deserialize (TagBuffer (cur.data, cur.data + cur.size));
+          RemoveInline (i);
+          return true;
+        }
+    }
   return COWTraverse (tag, &PacketTagList::RemoveWriter);
 }
 
@@ -214,6 +237,26 @@ PacketTagList::RemoveWriter (Tag & tag, bool preMerge,
 bool
 PacketTagList::Replace (Tag & tag)
 {
+  TypeId tid = tag.GetInstanceTypeId ();
+  for (uint32_t i = 0; i < m_nInline; i++)
+    {
+      if (m_inline[i].tid == tid)
+        {
+          uint32_t size = tag.GetSerializedSize ();
+          if (size > INLINE_TAG_SIZE)
+            {
+              // does not fit inline anymore, move to the TagData list
+              RemoveInline (i);
+              Add (tag);
+              return true;
+            }
+          NS_LOG_INFO ("found inline tid, rewriting");
+          struct InlineTag &cur = m_inline[i];
+          cur.size = size;
+          tag.Serialize (TagBuffer (cur.data, cur.data + cur.size));
+          return true;
+        }
+    }
   bool found = COWTraverse (tag, &PacketTagList::ReplaceWriter);
   if (!found)
     {
@@ -261,11 +304,26 @@ PacketTagList::Add (const Tag &tag) const
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
   // ensure this id was not yet added
+  for (uint32_t i = 0; i < m_nInline; i++)
+    {
+      NS_ASSERT_MSG (m_inline[i].tid != tag.GetInstanceTypeId (),
+                     "Error: cannot add the same kind of tag twice.");
+    }
   for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
     {
       NS_ASSERT_MSG (cur->tid != tag.GetInstanceTypeId (),
                      "Error: cannot add the same kind of tag twice.");
     }
+  uint32_t size = tag.GetSerializedSize ();
+  if (m_nInline < INLINE_TAGS && size <= INLINE_TAG_SIZE)
+    {
+      PacketTagList *self = const_cast<PacketTagList *> (this);
+      struct InlineTag &slot = self->m_inline[self->m_nInline++];
+      slot.tid = tag.GetInstanceTypeId ();
+      slot.size = size;
+      tag.Serialize (TagBuffer (slot.data, slot.data + slot.size));
+      return;
+    }
   struct TagData * head = CreateTagData (tag.GetSerializedSize ());
   head->count = 1;
   head->next = 0;
@@ -281,6 +339,17 @@ PacketTagList::Peek (Tag &tag) const
 {
   NS_LOG_FUNCTION (this << tag.GetInstanceTypeId ());
   TypeId tid = tag.GetInstanceTypeId ();
+  for (uint32_t i = 0; i < m_nInline; i++)
+    {
+      if (m_inline[i].tid == tid)
+        {
+          /* found inline tag */
+          const struct InlineTag &cur = m_inline[i];
+          tag.Deserialize (TagBuffer (const_cast<uint8_t *> (cur.data),
+                                      const_cast<uint8_t *> (cur.data) + cur.size));
+          return true;
+        }
+    }
   for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
     {
       if (cur->tid == tid)
@@ -309,12 +378,21 @@ PacketTagList::GetSerializedSize (void) const
 
   size = 4; // numberOfTags
 
+  // TypeId hash; ensure size is multiple of 4 bytes
+  uint32_t hashSize = (sizeof (TypeId::hash_t)+3) & (~3);
+
+  for (uint32_t i = 0; i < m_nInline; i++)
+    {
+      size += 4; // InlineTag -> size
+      size += hashSize;
+      // InlineTag -> data; ensure size is multiple of 4 bytes
+      size += (m_inline[i].size+3) & (~3);
+    }
+
   for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
     {
       size += 4; // TagData -> size
 
-      // TypeId hash; ensure size is multiple of 4 bytes
-      uint32_t hashSize = (sizeof (TypeId::hash_t)+3) & (~3);
       size += hashSize;
 
       // TagData -> data; ensure size is multiple of 4 bytes
@@ -325,6 +403,51 @@ PacketTagList::GetSerializedSize (void) const
   return size;
 }
 
+bool
+PacketTagList::SerializeTag (TypeId tid, const uint8_t *data, uint32_t dataSize,
+                             uint32_t *&p, uint32_t &size, uint32_t maxSize)
+{
+  if (size + 4 <= maxSize)
+    {
+      *p++ = dataSize;
+      size += 4;
+    }
+  else
+    {
+      return false;
+    }
+
+  NS_LOG_INFO("Serializing tag id " << tid);
+
+  // ensure size is multiple of 4 bytes for 4 byte boundaries
+  uint32_t hashSize = (sizeof (TypeId::hash_t)+3) & (~3);
+  if (size + hashSize <= maxSize)
+    {
+      TypeId::hash_t hash = tid.GetHash ();
+      memcpy (p, &hash, sizeof (TypeId::hash_t));
+      p += hashSize / 4;
+      size += hashSize;
+    }
+  else
+    {
+      return false;
+    }
+
+  // ensure size is multiple of 4 bytes for 4 byte boundaries
+  uint32_t tagWordSize = (dataSize+3) & (~3);
+  if (size + tagWordSize <= maxSize)
+    {
+      memcpy (p, data, dataSize);
+      size += tagWordSize;
+      p += tagWordSize / 4;
+    }
+  else
+    {
+      return false;
+    }
+  return true;
+}
+
 uint32_t
 PacketTagList::Serialize (uint32_t* buffer, uint32_t maxSize) const
 {
@@ -346,47 +469,22 @@ PacketTagList::Serialize (uint32_t* buffer, uint32_t maxSize) const
       return 0;
     }
 
-  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+  for (uint32_t i = 0; i < m_nInline; i++)
     {
-      if (size + 4 <= maxSize)
-        {
-          *p++ = cur->size;
-          size += 4;
-        }
-      else
-        {
-          return 0;
-        }
-
-      NS_LOG_INFO("Serializing tag id " << cur->tid);
-
-      // ensure size is multiple of 4 bytes for 4 byte boundaries
-      uint32_t hashSize = (sizeof (TypeId::hash_t)+3) & (~3);
-      if (size + hashSize <= maxSize)
-        {
-          TypeId::hash_t tid = cur->tid.GetHash ();
-          memcpy (p, &tid, sizeof (TypeId::hash_t));
-          p += hashSize / 4;
-          size += hashSize;
-        }
-      else
+      const struct InlineTag &cur = m_inline[i];
+      if (!SerializeTag (cur.tid, cur.data, cur.size, p, size, maxSize))
         {
           return 0;
         }
+      (*numberOfTags)++;
+    }
 
-      // ensure size is multiple of 4 bytes for 4 byte boundaries
-      uint32_t tagWordSize = (cur->size+3) & (~3);
-      if (size + tagWordSize <= maxSize)
-        {
-          memcpy (p, cur->data, cur->size);
-          size += tagWordSize;
-          p += tagWordSize / 4;
-        }
-      else
+  for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
+    {
+      if (!SerializeTag (cur->tid, cur->data, cur->size, p, size, maxSize))
         {
           return 0;
         }
-
       (*numberOfTags)++;
     }
 
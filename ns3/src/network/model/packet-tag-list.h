@@ -27,6 +27,9 @@
 
 #include <stdint.h>
 #include <ostream>
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 #include "ns3/type-id.h"
 
 namespace ns3 {
@@ -119,10 +122,26 @@ class Tag;
  *       The portion of the list between the first branch and the target is
  *       shared. This portion is copied before the #Remove or #Replace is
  *       performed.
+ *
+ * \par <b> Inline tags </b>
+ *
+ *   - Most packets carry only one or two small tags, so the first
+ *     #INLINE_TAGS tags of at most #INLINE_TAG_SIZE bytes are not put in
+ *     a TagData, but serialized in the PacketTagList itself.
+ *
+ *   - Inline tags are copied along with the PacketTagList, and are
+ *     removed or replaced in place, without any allocation.
+ *
+ *   - Further tags, and larger ones, spill into the TagData list above.
  */
 class PacketTagList 
 {
 public:
+  /** Number of tags stored inline, without a TagData. */
+  static const uint32_t INLINE_TAGS = 2;
+  /** Largest serialized size of a tag stored inline. */
+  static const uint32_t INLINE_TAG_SIZE = 12;
+
   /**
    * Tree node for sharing serialized tags.
    *
@@ -141,7 +160,11 @@ public:
   struct TagData
   {
     struct TagData * next;      /**< Pointer to next in list */
+#ifdef NS3_MTP
+    std::atomic<uint32_t> count; /**< Number of incoming links */
+#else
     uint32_t count;             /**< Number of incoming links */
+#endif
     TypeId tid;                 /**< Type of the tag serialized into #data */
     uint32_t size;              /**< Size of the \c data buffer */
     uint8_t data[1];            /**< Serialization buffer */
@@ -210,11 +233,13 @@ public:
    */
   bool Peek (Tag &tag) const;
   /**
-   * Remove all tags from this list (up to the first merge).
+   * Remove all tags from this list (up to the first merge), including
+   * the inline tags.
    */
   inline void RemoveAll (void);
   /**
-   * \returns pointer to head of tag list
+   * \returns pointer to head of the TagData list, which does not hold
+   *          the inline tags
    */
   const struct PacketTagList::TagData *Head (void) const;
   /**
@@ -243,6 +268,40 @@ public:
   uint32_t Deserialize (const uint32_t* buffer, uint32_t size);
 
 private:
+  /// Friend class, to iterate over the inline tags
+  friend class PacketTagIterator;
+
+  /**
+   * Tag stored inline in the PacketTagList.
+   */
+  struct InlineTag
+  {
+    TypeId tid;                      /**< Type of the tag serialized into #data */
+    uint16_t size;                   /**< Size of the tag in \c data */
+    uint8_t data[INLINE_TAG_SIZE];   /**< Serialization buffer */
+  };
+
+  /**
+   * Remove an inline tag, keeping the others in order.
+   *
+   * \param [in] i The index of the tag in #m_inline.
+   */
+  void RemoveInline (uint32_t i);
+
+  /**
+   * Serialize one tag, as part of #Serialize.
+   *
+   * \param [in] tid The type of the tag.
+   * \param [in] data The serialized tag.
+   * \param [in] dataSize The size of \pname{data}.
+   * \param [in,out] p The position in the byte buffer.
+   * \param [in,out] size The number of bytes used in the byte buffer.
+   * \param [in] maxSize The max size of the byte buffer.
+   * \returns false if the tag does not fit in the byte buffer
+   */
+  static bool SerializeTag (TypeId tid, const uint8_t *data, uint32_t dataSize,
+                            uint32_t *&p, uint32_t &size, uint32_t maxSize);
+
   /**
    * Allocate and construct a TagData struct, sizing the data area
    * large enough to serialize dataSize bytes from a Tag.
@@ -306,6 +365,14 @@ private:
    * Pointer to first \ref TagData on the list
    */
   struct TagData *m_next;
+  /**
+   * Number of tags in #m_inline
+   */
+  uint32_t m_nInline;
+  /**
+   * Tags stored inline
+   */
+  struct InlineTag m_inline[INLINE_TAGS];
 };
 
 } // namespace ns3
@@ -317,32 +384,46 @@ private:
 namespace ns3 {
 
 PacketTagList::PacketTagList ()
-  : m_next ()
+  : m_next (),
+    m_nInline (0)
 {
 }
 
 PacketTagList::PacketTagList (PacketTagList const &o)
-  : m_next (o.m_next)
+  : m_next (o.m_next),
+    m_nInline (o.m_nInline)
 {
   if (m_next != 0)
     {
       m_next->count++;
     }
+  for (uint32_t i = 0; i < m_nInline; i++)
+    {
+      m_inline[i] = o.m_inline[i];
+    }
 }
 
 PacketTagList &
 PacketTagList::operator = (PacketTagList const &o)
 {
   // self assignment
-  if (m_next == o.m_next) 
+  if (this == &o) 
     {
       return *this;
     }
-  RemoveAll ();
-  m_next = o.m_next;
-  if (m_next != 0) 
+  if (m_next != o.m_next)
     {
-      m_next->count++;
+      RemoveAll ();
+      m_next = o.m_next;
+      if (m_next != 0) 
+        {
+          m_next->count++;
+        }
+    }
+  m_nInline = o.m_nInline;
+  for (uint32_t i = 0; i < m_nInline; i++)
+    {
+      m_inline[i] = o.m_inline[i];
     }
   return *this;
 }
@@ -358,8 +439,7 @@ PacketTagList::RemoveAll (void)
   struct TagData *prev = 0;
   for (struct TagData *cur = m_next; cur != 0; cur = cur->next)
     {
-      cur->count--;
-      if (cur->count > 0) 
+      if (--cur->count > 0)
         {
           break;
         }
@@ -376,6 +456,7 @@ PacketTagList::RemoveAll (void)
       std::free (prev);
     }
   m_next = 0;
+  m_nInline = 0;
 }
 
 } // namespace ns3
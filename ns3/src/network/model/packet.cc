@@ -28,7 +28,11 @@ namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("Packet");
 
+#ifdef NS3_MTP
+std::atomic<uint32_t> Packet::m_globalUid (0);
+#else
 uint32_t Packet::m_globalUid = 0;
+#endif
 
 TypeId 
 ByteTagIterator::Item::GetTypeId (void) const
@@ -81,39 +85,48 @@ ByteTagIterator::ByteTagIterator (ByteTagList::Iterator i)
 }
 
 
-PacketTagIterator::PacketTagIterator (const struct PacketTagList::TagData *head)
-  : m_current (head)
+PacketTagIterator::PacketTagIterator (const PacketTagList &list)
+  : m_list (&list),
+    m_inline (0),
+    m_current (list.Head ())
 {
 }
 bool
 PacketTagIterator::HasNext (void) const
 {
-  return m_current != 0;
+  return m_inline < m_list->m_nInline || m_current != 0;
 }
 PacketTagIterator::Item
 PacketTagIterator::Next (void)
 {
   NS_ASSERT (HasNext ());
+  if (m_inline < m_list->m_nInline)
+    {
+      const struct PacketTagList::InlineTag &tag = m_list->m_inline[m_inline++];
+      return PacketTagIterator::Item (tag.tid, tag.data, tag.size);
+    }
   const struct PacketTagList::TagData *prev = m_current;
   m_current = m_current->next;
-  return PacketTagIterator::Item (prev);
+  return PacketTagIterator::Item (prev->tid, prev->data, prev->size);
 }
 
-PacketTagIterator::Item::Item (const struct PacketTagList::TagData *data)
-  : m_data (data)
+PacketTagIterator::Item::Item (TypeId tid, const uint8_t *data, uint32_t size)
+  : m_tid (tid),
+    m_data (data),
+    m_size (size)
 {
 }
 TypeId
 PacketTagIterator::Item::GetTypeId (void) const
 {
-  return m_data->tid;
+  return m_tid;
 }
 void
 PacketTagIterator::Item::GetTag (Tag &tag) const
 {
-  NS_ASSERT (tag.GetInstanceTypeId () == m_data->tid);
-  tag.Deserialize (TagBuffer ((uint8_t*)m_data->data,
-                              (uint8_t*)m_data->data + m_data->size));
+  NS_ASSERT (tag.GetInstanceTypeId () == m_tid);
+  tag.Deserialize (TagBuffer ((uint8_t*)m_data,
+                              (uint8_t*)m_data + m_size));
 }
 
 
@@ -136,10 +149,9 @@ Packet::Packet ()
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, 0),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid++, 0),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 
 Packet::Packet (const Packet &o)
@@ -178,10 +190,9 @@ Packet::Packet (uint32_t size)
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid++, size),
     m_nixVector (0)
 {
-  m_globalUid++;
 }
 Packet::Packet (uint8_t const *buffer, uint32_t size, bool magic)
   : m_buffer (0, false),
@@ -204,10 +215,9 @@ Packet::Packet (uint8_t const*buffer, uint32_t size)
      * zero.  The lower 32 bits are for the 
      * global UID
      */
-    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid, size),
+    m_metadata (static_cast<uint64_t> (Simulator::GetSystemId ()) << 32 | m_globalUid++, size),
     m_nixVector (0)
 {
-  m_globalUid++;
   m_buffer.AddAtStart (size);
   Buffer::Iterator i = m_buffer.Begin ();
   i.Write (buffer, size);
@@ -1013,7 +1023,7 @@ Packet::PrintPacketTags (std::ostream &os) const
 PacketTagIterator 
 Packet::GetPacketTagIterator (void) const
 {
-  return PacketTagIterator (m_packetTagList.Head ());
+  return PacketTagIterator (m_packetTagList);
 }
 
 std::ostream& operator<< (std::ostream& os, const Packet &packet)
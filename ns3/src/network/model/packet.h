@@ -21,6 +21,9 @@
 #define PACKET_H
 
 #include <stdint.h>
+#ifdef NS3_MTP
+#include <atomic>
+#endif
 #include "buffer.h"
 #include "header.h"
 #include "trailer.h"
@@ -155,10 +158,14 @@ private:
     friend class PacketTagIterator;
     /**
      * Constructor
-     * \param data the data to copy.
+     * \param tid the type of the tag
+     * \param data the serialized tag
+     * \param size the size of the serialized tag
      */
-    Item (const struct PacketTagList::TagData *data);
-    const struct PacketTagList::TagData *m_data; //!< the tag data
+    Item (TypeId tid, const uint8_t *data, uint32_t size);
+    TypeId m_tid;          //!< the type of the tag
+    const uint8_t *m_data; //!< the serialized tag
+    uint32_t m_size;       //!< the size of the serialized tag
   };
   /**
    * \returns true if calling Next is safe, false otherwise.
@@ -173,10 +180,12 @@ private:
   friend class Packet;
   /**
    * Constructor
-   * \param head head of the items
+   * \param list the tags of the packet
    */
-  PacketTagIterator (const struct PacketTagList::TagData *head);
-  const struct PacketTagList::TagData *m_current;  //!< actual position over the set of tags in a packet
+  PacketTagIterator (const PacketTagList &list);
+  const PacketTagList *m_list;  //!< the tags of the packet
+  uint32_t m_inline;  //!< position over the inline tags
+  const struct PacketTagList::TagData *m_current;  //!< actual position over the TagData list
 };
 
 /**
@@ -787,7 +796,11 @@ private:
   /* Please see comments above about nix-vector */
   Ptr<NixVector> m_nixVector; //!< the packet's Nix vector
 
+#ifdef NS3_MTP
+  static std::atomic<uint32_t> m_globalUid; //!< Global counter of packets Uid
+#else
   static uint32_t m_globalUid; //!< Global counter of packets Uid
+#endif
 };
 
 /**
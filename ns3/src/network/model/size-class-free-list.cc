@@ -0,0 +1,140 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "size-class-free-list.h"
+#include "ns3/assert.h"
+#include <cstring>
+
+namespace ns3 {
+
+double
+FreeListStats::GetHitRate (void) const
+{
+  uint64_t requests = hits + misses;
+  return requests == 0 ? 0 : (double) hits / requests;
+}
+
+uint32_t
+SizeClassFreeList::GetClass (uint32_t size)
+{
+  if (size <= 4)
+    {
+      return size == 0 ? 0 : size - 1;
+    }
+  // size is in (4 << (g - 1), 8 << (g - 1)], cut in four steps
+  uint32_t p = 0;
+  while ((UINT64_C (2) << p) < size)
+    {
+      p++;
+    }
+  uint32_t g = p - 1;
+  uint64_t step = UINT64_C (1) << (g - 1);
+  uint32_t c = 4 * g + (size + step - 1) / step - 5;
+  return c < CLASSES ? c : CLASSES;
+}
+
+uint32_t
+SizeClassFreeList::GetClassSize (uint32_t c)
+{
+  if (c >= CLASSES)
+    {
+      return 0;
+    }
+  if (c < 4)
+    {
+      return c + 1;
+    }
+  return (5 + c % 4) << (c / 4 - 1);
+}
+
+bool
+SizeClassFreeList::IsOpen (void) const
+{
+  return opened && !closed;
+}
+
+void
+SizeClassFreeList::Open (uint32_t capacity)
+{
+  if (!opened)
+    {
+      opened = true;
+      stats.capacity = capacity;
+    }
+}
+
+void
+SizeClassFreeList::Close (void)
+{
+  for (uint32_t c = 0; c < CLASSES; c++)
+    {
+      while (free[c] != 0)
+        {
+          uint8_t *block = free[c];
+          std::memcpy (&free[c], block, sizeof (block));
+          delete [] block;
+        }
+      classLength[c] = 0;
+    }
+  stats.length = 0;
+  closed = true;
+}
+
+uint8_t *
+SizeClassFreeList::Get (uint32_t c)
+{
+  if (c >= CLASSES || free[c] == 0)
+    {
+      stats.misses++;
+      return 0;
+    }
+  uint8_t *block = free[c];
+  std::memcpy (&free[c], block, sizeof (block));
+  classLength[c]--;
+  stats.length--;
+  stats.hits++;
+  return block;
+}
+
+bool
+SizeClassFreeList::Put (uint8_t *block, uint32_t c)
+{
+  if (c >= CLASSES || !IsOpen () || classLength[c] >= stats.capacity)
+    {
+      stats.released++;
+      return false;
+    }
+  std::memcpy (block, &free[c], sizeof (block));
+  free[c] = block;
+  classLength[c]++;
+  stats.length++;
+  if (stats.length > stats.highWater)
+    {
+      stats.highWater = stats.length;
+    }
+  stats.recycled++;
+  return true;
+}
+
+FreeListStats
+SizeClassFreeList::GetStats (void) const
+{
+  return stats;
+}
+
+} // namespace ns3
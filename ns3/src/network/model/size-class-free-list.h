@@ -0,0 +1,140 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef SIZE_CLASS_FREE_LIST_H
+#define SIZE_CLASS_FREE_LIST_H
+
+#include <stdint.h>
+
+namespace ns3 {
+
+/**
+ * \ingroup packet
+ *
+ * \brief Statistics of the free list of a thread.
+ */
+struct FreeListStats
+{
+  uint64_t hits;       //!< Blocks handed out from the free list
+  uint64_t misses;     //!< Requests the free list could not serve
+  uint64_t recycled;   //!< Blocks kept for reuse
+  uint64_t released;   //!< Blocks given back to the allocator instead
+  uint32_t length;     //!< Blocks currently in the free list
+  uint32_t highWater;  //!< Largest number of blocks held at once
+  uint32_t capacity;   //!< Maximum number of blocks per size class
+
+  /**
+   * \returns The fraction of the requests served from the free list.
+   */
+  double GetHitRate (void) const;
+};
+
+/**
+ * \ingroup packet
+ *
+ * \brief Free blocks of one thread, sorted by size classes.
+ *
+ * This backs the Buffer and PacketMetadata free lists. Each thread has
+ * its own (declared \c thread_local by the user), so no lock is needed;
+ * a block freed by another thread than the one which allocated it simply
+ * lands in the list of the freeing thread, whose capacity bounds the
+ * blocks it can hoard.
+ *
+ * The class is trivially constructible and destructible, so that a
+ * zero-initialized \c thread_local instance is usable at any time,
+ * including while the thread exits and the remaining packets are
+ * destroyed: once Close () has been called, Put () refuses every block.
+ *
+ * The blocks are arrays of \c uint8_t allocated with \c new[] by the
+ * user, at least one pointer large; the free list uses their first bytes
+ * to chain them.
+ *
+ * A request is served with a block of the smallest class that holds it.
+ * Above 4 bytes, each power of two is cut in four classes, e.g. 1280,
+ * 1536, 1792 and 2048 bytes: a block is at most 25% larger than the
+ * request (a 1500 byte buffer takes 1536 bytes). Finer classes would
+ * waste less memory per block, but split the free blocks among more
+ * lists, each holding up to the capacity of blocks.
+ */
+struct SizeClassFreeList
+{
+  /** Number of size classes: blocks up to 1 MiB are kept. */
+  static const uint32_t CLASSES = 76;
+
+  /**
+   * Get the size class of a block size.
+   *
+   * \param [in] size The block size.
+   * \returns The smallest class whose blocks can hold \pname{size} bytes,
+   *          or CLASSES if the blocks are too large to be kept.
+   */
+  static uint32_t GetClass (uint32_t size);
+  /**
+   * Get the size of the blocks of a size class.
+   *
+   * \param [in] c The size class.
+   * \returns The block size, or 0 if \pname{c} is not below CLASSES.
+   */
+  static uint32_t GetClassSize (uint32_t c);
+
+  /**
+   * Whether the free list can take blocks.
+   *
+   * \returns \c true between Open () and Close ().
+   */
+  bool IsOpen (void) const;
+  /**
+   * Start keeping blocks, unless the list was closed.
+   *
+   * \param [in] capacity The maximum number of blocks per size class.
+   */
+  void Open (uint32_t capacity);
+  /** Release all the blocks, and refuse the next ones. */
+  void Close (void);
+
+  /**
+   * Take a block of a size class.
+   *
+   * \param [in] c The size class.
+   * \returns The block, or 0 if there is none.
+   */
+  uint8_t *Get (uint32_t c);
+  /**
+   * Keep a block for reuse.
+   *
+   * \param [in] block The block, of exactly GetClassSize (c) bytes of payload.
+   * \param [in] c The size class.
+   * \returns \c false if the block was not kept: the caller must release it.
+   */
+  bool Put (uint8_t *block, uint32_t c);
+
+  /**
+   * \returns The statistics of the free list.
+   */
+  FreeListStats GetStats (void) const;
+
+  uint8_t *free[CLASSES];        //!< Free blocks, by size class
+  uint32_t classLength[CLASSES]; //!< Number of free blocks, by size class
+  FreeListStats stats;           //!< Statistics
+  bool opened;                   //!< Whether Open () was called
+  bool closed;                   //!< Whether Close () was called
+};
+
+} // namespace ns3
+
+#endif /* SIZE_CLASS_FREE_LIST_H */
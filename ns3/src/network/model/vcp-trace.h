@@ -0,0 +1,68 @@
+/*
+ * vcp-trace.h
+ *
+ * Debug tracing of VCP load information along the packet path.
+ *
+ * The macros below expand to nothing unless ns-3 was configured with
+ * --enable-vcp-trace (which defines NS3_VCP_TRACE) and logging is compiled
+ * in, so the header peeks and casts they need cost nothing in normal runs.
+ * When enabled, output goes through NS_LOG_DEBUG of the calling component
+ * and the peeks only happen if that component has debug logging enabled.
+ */
+
+#pragma once
+
+#include "ns3/log.h"
+#include "ns3/queue-item.h"
+#include "vcp-packet-tag.h"
+
+#if defined (NS3_VCP_TRACE) && defined (NS3_LOG_ENABLE)
+
+/* Log a VCP debug message. */
+#define NS_VCP_TRACE(msg)                                       \
+  NS_LOG_DEBUG ("(VCP) " << msg)
+
+/* Log the ECN bits of a packet starting with an IPv4 header. The TOS byte
+ * is read directly so that no Ipv4Header needs to be deserialized. */
+#define NS_VCP_TRACE_PACKET_ECN(packet)                         \
+  do {                                                          \
+      uint8_t vcpTraceBuf[2];                                   \
+      if (g_log.IsEnabled (ns3::LOG_DEBUG)                      \
+          && (packet)->CopyData (vcpTraceBuf, 2) == 2           \
+          && (vcpTraceBuf[0] >> 4) == 4)                        \
+        {                                                       \
+          NS_VCP_TRACE ("ip header ecn=" << (vcpTraceBuf[1] & 0x3)); \
+        }                                                       \
+  } while (false)
+
+/* Log the ECN bits of a queue disc item carrying an IP header. */
+#define NS_VCP_TRACE_ITEM_ECN(item)                             \
+  do {                                                          \
+      uint8_t vcpTraceTos;                                      \
+      if (g_log.IsEnabled (ns3::LOG_DEBUG)                      \
+          && (item)->GetUint8Value (ns3::QueueItem::IP_DSFIELD, \
+                                    vcpTraceTos))               \
+        {                                                       \
+          NS_VCP_TRACE ("ip header ecn=" << (vcpTraceTos & 0x3)); \
+        }                                                       \
+  } while (false)
+
+/* Log whether a packet carries a VcpPacketTag. */
+#define NS_VCP_TRACE_TAG(packet)                                \
+  do {                                                          \
+      if (g_log.IsEnabled (ns3::LOG_DEBUG))                     \
+        {                                                       \
+          ns3::VcpPacketTag vcpTraceTag;                        \
+          NS_VCP_TRACE ("hasVcpTag="                            \
+                        << (packet)->PeekPacketTag (vcpTraceTag)); \
+        }                                                       \
+  } while (false)
+
+#else /* NS3_VCP_TRACE && NS3_LOG_ENABLE */
+
+#define NS_VCP_TRACE(msg)
+#define NS_VCP_TRACE_PACKET_ECN(packet)
+#define NS_VCP_TRACE_ITEM_ECN(item)
+#define NS_VCP_TRACE_TAG(packet)
+
+#endif /* NS3_VCP_TRACE && NS3_LOG_ENABLE */
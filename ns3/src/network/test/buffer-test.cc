@@ -22,6 +22,10 @@
 #include "ns3/random-variable-stream.h"
 #include "ns3/double.h"
 #include "ns3/test.h"
+#include "ns3/config.h"
+#include "ns3/uinteger.h"
+#include "ns3/system-thread.h"
+#include <vector>
 
 using namespace ns3;
 
@@ -389,6 +393,101 @@ BufferTest::DoRun (void)
   NS_TEST_ASSERT_MSG_EQ (val1, val2, "Bad ReadNtohU16()");
 }
 
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * Buffer free list tests: a new thread gets its own free list, with the
+ * capacity set by BufferFreeListCapacity.
+ */
+class BufferFreeListTest : public TestCase {
+private:
+  /** Create and destroy buffers in a new thread, and record its statistics. */
+  void Churn (void);
+
+  FreeListStats m_before; //!< Statistics after the first buffer
+  FreeListStats m_after;  //!< Statistics at the end
+  bool m_dataOk;          //!< Whether the reused buffers read back their data
+public:
+  virtual void DoRun (void);
+  BufferFreeListTest ();
+};
+
+BufferFreeListTest::BufferFreeListTest ()
+  : TestCase ("Buffer free list") {
+}
+
+void
+BufferFreeListTest::Churn (void)
+{
+  {
+    // Learn the buffer size, large enough for the writes below
+    Buffer first;
+    first.AddAtEnd (4096);
+  }
+  m_before = Buffer::GetFreeListStats ();
+
+  // One is reused, the 9 others are allocated; 4 are kept when destroyed
+  std::vector<Buffer> buffers (10);
+  for (uint32_t i = 0; i < buffers.size (); i++)
+    {
+      buffers[i].AddAtEnd (4);
+    }
+  buffers.clear ();
+
+  // All reused
+  m_dataOk = true;
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      buffers.push_back (Buffer ());
+      buffers.back ().AddAtEnd (4);
+      Buffer::Iterator it = buffers.back ().Begin ();
+      it.WriteU32 (i);
+    }
+  for (uint32_t i = 0; i < 4; i++)
+    {
+      m_dataOk = m_dataOk && buffers[i].Begin ().ReadU32 () == i;
+    }
+  m_after = Buffer::GetFreeListStats ();
+}
+
+void
+BufferFreeListTest::DoRun (void)
+{
+  Config::SetGlobal ("BufferFreeListCapacity", UintegerValue (4));
+  Ptr<SystemThread> thread = Create<SystemThread> (MakeCallback (&BufferFreeListTest::Churn, this));
+  thread->Start ();
+  thread->Join ();
+  Config::SetGlobal ("BufferFreeListCapacity", UintegerValue (1000));
+
+  NS_TEST_ASSERT_MSG_EQ (m_after.capacity, 4, "Capacity not taken from BufferFreeListCapacity");
+  NS_TEST_ASSERT_MSG_EQ (m_after.hits - m_before.hits, 5, "Wrong number of buffers reused");
+  NS_TEST_ASSERT_MSG_EQ (m_after.misses - m_before.misses, 9, "Wrong number of buffers allocated");
+  NS_TEST_ASSERT_MSG_EQ (m_after.recycled - m_before.recycled, 4, "Wrong number of buffers kept");
+  NS_TEST_ASSERT_MSG_EQ (m_after.released - m_before.released, 6, "Wrong number of buffers released");
+  NS_TEST_ASSERT_MSG_EQ (m_after.highWater, 5, "Wrong high water mark");
+  NS_TEST_ASSERT_MSG_EQ (m_dataOk, true, "Reused buffers corrupted");
+  NS_TEST_ASSERT_MSG_GT (m_after.GetHitRate (), 0.25, "Low hit rate");
+
+  // The size classes are at most 25% larger than the requests they serve
+  for (uint32_t c = 0; c < SizeClassFreeList::CLASSES; c++)
+    {
+      NS_TEST_ASSERT_MSG_EQ (SizeClassFreeList::GetClass (SizeClassFreeList::GetClassSize (c)), c,
+                             "Class " << c << " does not hold its own size");
+    }
+  bool tight = true;
+  for (uint32_t size = 5; size <= (1 << 20); size++)
+    {
+      uint32_t classSize = SizeClassFreeList::GetClassSize (SizeClassFreeList::GetClass (size));
+      tight = tight && classSize >= size && classSize * UINT64_C (4) < size * UINT64_C (5);
+    }
+  NS_TEST_ASSERT_MSG_EQ (tight, true, "Size classes too far apart");
+  NS_TEST_ASSERT_MSG_EQ (SizeClassFreeList::GetClassSize (SizeClassFreeList::GetClass (1500)), 1536,
+                         "Wrong size class for a 1500 byte buffer");
+  NS_TEST_ASSERT_MSG_EQ (SizeClassFreeList::GetClass ((1 << 20) + 1), SizeClassFreeList::CLASSES,
+                         "Blocks above 1 MiB must not be kept");
+}
+
 /**
  * \ingroup network-test
  * \ingroup tests
@@ -405,6 +504,7 @@ BufferTestSuite::BufferTestSuite ()
   : TestSuite ("buffer", UNIT)
 {
   AddTestCase (new BufferTest, TestCase::QUICK);
+  AddTestCase (new BufferFreeListTest, TestCase::QUICK);
 }
 
 static BufferTestSuite g_bufferTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,191 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/ptr.h"
+#include "ns3/columnar-trace.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace ns3;
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Write series with several blocks and read them back
+ */
+class ColumnarTraceRoundTripTestCase : public TestCase
+{
+public:
+  ColumnarTraceRoundTripTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+ColumnarTraceRoundTripTestCase::ColumnarTraceRoundTripTestCase ()
+  : TestCase ("Check that the rows of interleaved series survive a write and read")
+{
+}
+
+void
+ColumnarTraceRoundTripTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("columnar-trace-test.cols");
+
+  {
+    Ptr<ColumnarTraceWriter> writer = Create<ColumnarTraceWriter> (filename, "program=test\n");
+    writer->SetBlockRows (7);
+    uint16_t queue = writer->AddSeries ("queue", {{"time", ColumnarTraceWriter::DOUBLE},
+                                                  {"packets", ColumnarTraceWriter::UINT32}});
+    uint16_t bytes = writer->AddSeries ("bytes", {{"time", ColumnarTraceWriter::DOUBLE},
+                                                  {"sent", ColumnarTraceWriter::UINT64},
+                                                  {"delta", ColumnarTraceWriter::INT64}});
+    for (uint32_t i = 0; i < 100; i++)
+      {
+        writer->Append (queue, i * 0.01, i % 13);
+        if (i % 3 == 0)
+          {
+            writer->Append (bytes, i * 0.01, (uint64_t) i * 1000000000ULL, -(int64_t) i);
+          }
+      }
+    // The remaining rows are written when the last reference goes away
+  }
+
+  ColumnarTraceReader reader (filename);
+  NS_TEST_ASSERT_MSG_EQ (reader.GetMetadata (), "program=test\n", "Metadata mismatch");
+  NS_TEST_ASSERT_MSG_EQ (reader.HasSeries ("queue"), true, "Missing series");
+  NS_TEST_ASSERT_MSG_EQ (reader.HasSeries ("cwnd"), false, "Unexpected series");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetNRows ("queue"), 100, "Wrong number of rows");
+  NS_TEST_ASSERT_MSG_EQ (reader.GetNRows ("bytes"), 34, "Wrong number of rows");
+
+  std::vector<double> time = reader.GetColumn ("queue", "time");
+  std::vector<double> packets = reader.GetColumn ("queue", "packets");
+  for (uint32_t i = 0; i < 100; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (time[i], i * 0.01, "Wrong time in row " << i);
+      NS_TEST_EXPECT_MSG_EQ (packets[i], i % 13, "Wrong value in row " << i);
+    }
+
+  std::vector<double> sent = reader.GetColumn ("bytes", "sent");
+  std::vector<double> delta = reader.GetColumn ("bytes", "delta");
+  for (uint32_t j = 0; j < 34; j++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (sent[j], j * 3 * 1e9, "Wrong value in row " << j);
+      NS_TEST_EXPECT_MSG_EQ (delta[j], -(double) j * 3, "Wrong value in row " << j);
+    }
+
+  std::remove (filename.c_str ());
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Read a file cut off by an interrupted writer in the middle of a
+ * column of a series declaration
+ */
+class ColumnarTraceTruncatedSchemaTestCase : public TestCase
+{
+public:
+  ColumnarTraceTruncatedSchemaTestCase ();
+
+private:
+  virtual void DoRun (void);
+};
+
+ColumnarTraceTruncatedSchemaTestCase::ColumnarTraceTruncatedSchemaTestCase ()
+  : TestCase ("Check that a truncated series declaration adds no column")
+{
+}
+
+void
+ColumnarTraceTruncatedSchemaTestCase::DoRun (void)
+{
+  std::string filename = CreateTempDirFilename ("columnar-trace-truncated-test.cols");
+
+  std::streamoff declared;
+  {
+    Ptr<ColumnarTraceWriter> writer = Create<ColumnarTraceWriter> (filename);
+    uint16_t queue = writer->AddSeries ("queue", {{"time", ColumnarTraceWriter::DOUBLE},
+                                                  {"packets", ColumnarTraceWriter::UINT32}});
+    for (uint32_t i = 0; i < 20; i++)
+      {
+        writer->Append (queue, i * 0.01, i);
+      }
+    writer->Flush ();
+    declared = std::ifstream (filename.c_str (), std::ios::binary | std::ios::ate).tellg ();
+
+    // A second source declares the same series
+    writer->AddSeries ("queue", {{"time", ColumnarTraceWriter::DOUBLE},
+                                 {"packets", ColumnarTraceWriter::UINT32}});
+  }
+
+  // Cut the file in the middle of the name of the first column of the
+  // second declaration: 'S', identifier, name length, name and number of
+  // columns, then the type, the name length and 2 bytes of "time"
+  std::string contents;
+  {
+    std::ifstream in (filename.c_str (), std::ios::binary);
+    contents.assign ((std::istreambuf_iterator<char> (in)), std::istreambuf_iterator<char> ());
+  }
+  std::streamoff cut = declared + 1 + 2 + 1 + 5 + 2 + 1 + 1 + 2;
+  NS_TEST_ASSERT_MSG_GT (contents.size (), (size_t) cut, "The second declaration was not written");
+  {
+    std::ofstream out (filename.c_str (), std::ios::binary | std::ios::trunc);
+    out.write (contents.data (), cut);
+  }
+
+  ColumnarTraceReader reader (filename);
+  NS_TEST_ASSERT_MSG_EQ (reader.HasSeries ("queue"), true, "Missing series");
+  NS_TEST_EXPECT_MSG_EQ (reader.GetNRows ("queue"), 20, "The truncated column hides the rows of the series");
+
+  std::vector<double> packets = reader.GetColumn ("queue", "packets");
+  NS_TEST_ASSERT_MSG_EQ (packets.size (), 20, "Wrong number of values");
+  for (uint32_t i = 0; i < 20; i++)
+    {
+      NS_TEST_EXPECT_MSG_EQ (packets[i], i, "Wrong value in row " << i);
+    }
+
+  std::remove (filename.c_str ());
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Columnar trace TestSuite
+ */
+class ColumnarTraceTestSuite : public TestSuite
+{
+public:
+  ColumnarTraceTestSuite ();
+};
+
+ColumnarTraceTestSuite::ColumnarTraceTestSuite ()
+  : TestSuite ("columnar-trace", UNIT)
+{
+  AddTestCase (new ColumnarTraceRoundTripTestCase, TestCase::QUICK);
+  AddTestCase (new ColumnarTraceTruncatedSchemaTestCase, TestCase::QUICK);
+}
+
+static ColumnarTraceTestSuite g_columnarTraceTestSuite; //!< Static variable for test initialization
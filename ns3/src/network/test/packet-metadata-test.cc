@@ -477,8 +477,14 @@ PacketMetadataTest::DoAddHeader (Ptr<Packet> p)
 void
 PacketMetadataTest::DoRun (void)
 {
+  // No metadata is allocated for this one until it is first changed
+  Ptr<Packet> early = Create<Packet> ();
+
   PacketMetadata::Enable ();
 
+  ADD_HEADER (early, 1);
+  CHECK_HISTORY (early, 1, 1);
+
   Ptr<Packet> p = Create<Packet> (0);
   Ptr<Packet> p1 = Create<Packet> (0);
 
@@ -918,7 +924,9 @@ public:
 PacketMetadataTestSuite::PacketMetadataTestSuite ()
   : TestSuite ("packet-metadata", UNIT)
 {
+#ifndef NS3_NO_PACKET_METADATA
   AddTestCase (new PacketMetadataTest, TestCase::QUICK);
+#endif
 }
 
 static PacketMetadataTestSuite g_packetMetadataTest; //!< Static variable for test initialization
@@ -19,6 +19,7 @@
  */
 #include "ns3/packet.h"
 #include "ns3/packet-tag-list.h"
+#include "ns3/flow-id-tag.h"
 #include "ns3/test.h"
 #include "ns3/unused.h"
 #include <limits>     // std:numeric_limits
@@ -1014,7 +1015,14 @@ PacketTagListTest::DoRun (void)
 
   MAKE_TEST_TAGS ;
   
+  // Fill the inline slots first, so that t1..t7 exercise the
+  // shared, copy-on-write list.  The inline path is checked below.
+  ATestTag<0> f1 (1);
+  FlowIdTag f2 (1);
+
   PacketTagList ref;  // empty list
+  ref.Add (f1);       // inline
+  ref.Add (f2);       // inline
   ref.Add (t1);       // last
   ref.Add (t2);       // post merge
   ref.Add (t3);       // merge successor
@@ -1035,6 +1043,10 @@ PacketTagListTest::DoRun (void)
     { PacketTagList ptl (ref);
       CheckRefList (ref, "copy ctor orig");
       CheckRefList (ptl, "copy ctor copy");
+      CheckRef (ptl, f1, "copy ctor inline");
+      FlowIdTag flowId;
+      NS_TEST_EXPECT_MSG_EQ (ptl.Peek (flowId), true, "copy ctor inline");
+      NS_TEST_EXPECT_MSG_EQ (flowId.GetFlowId (), 1, "copy ctor inline");
     }
     { PacketTagList ptl = ref;
       CheckRefList (ref, "assignment orig");
@@ -1109,6 +1121,22 @@ PacketTagListTest::DoRun (void)
     ReplaceCheck (7);
   }
   
+  { // Inline tags
+    std::cout << GetName () << "check inline tags" << std::endl;
+    PacketTagList ptl;
+    ptl.Add (t1);
+    ptl.Add (t2);
+    PacketTagList cpy = ptl;
+    cpy.Replace (t2);
+    cpy.Remove (t1);
+    CheckRef (ptl, t1, "inline orig");
+    CheckRef (ptl, t2, "inline orig");
+    CheckRef (cpy, t1, "inline copy", true);
+    CheckRef (cpy, t2, "inline copy");
+    ptl.Add (t3);
+    CheckRef (ptl, t3, "inline spill");
+  }
+
   { // Timing
     std::cout << GetName () << "add+remove timing" << std::endl;
     int flm = std::numeric_limits<int>::max ();
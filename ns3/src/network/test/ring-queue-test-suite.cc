@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/test.h"
+#include "ns3/ring-queue.h"
+#include "ns3/drop-tail-queue.h"
+#include "ns3/object-factory.h"
+#include "ns3/string.h"
+#include <vector>
+
+using namespace ns3;
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * RingQueue unit tests: run the same operations on a RingQueue and on a
+ * DropTailQueue, across the wrap around and the growth of the ring.
+ */
+class RingQueueTestCase : public TestCase
+{
+public:
+  RingQueueTestCase ();
+  virtual void DoRun (void);
+};
+
+RingQueueTestCase::RingQueueTestCase ()
+  : TestCase ("Check that the ring queue behaves as the drop tail queue")
+{
+}
+
+void
+RingQueueTestCase::DoRun (void)
+{
+  ObjectFactory factory;
+  factory.SetTypeId ("ns3::RingQueue<Packet>");
+  factory.Set ("MaxSize", StringValue ("3000B"));
+  Ptr<Queue<Packet> > ring = factory.Create<Queue<Packet> > ();
+  Ptr<Queue<Packet> > list = CreateObject<DropTailQueue<Packet> > ();
+  list->SetMaxSize (QueueSize ("3000B"));
+
+  // Fill and drain the queues to varying depths, so that the items wrap
+  // around the ring before and after it grows
+  std::vector<Ptr<Packet> > packets;
+  uint32_t seed = 1;
+  for (uint32_t round = 0; round < 50; round++)
+    {
+      uint32_t nIn = round % 13;
+      for (uint32_t i = 0; i < nIn; i++)
+        {
+          seed = seed * 1103515245 + 12345;
+          Ptr<Packet> p = Create<Packet> (50 + (seed >> 16) % 300);
+          NS_TEST_EXPECT_MSG_EQ (ring->Enqueue (p), list->Enqueue (p), "Different admission of packet " << p->GetUid ());
+        }
+      uint32_t nOut = (round * 7) % 11;
+      for (uint32_t i = 0; i < nOut; i++)
+        {
+          Ptr<const Packet> peek = ring->Peek ();
+          NS_TEST_EXPECT_MSG_EQ (peek, list->Peek (), "Different head of line");
+          Ptr<Packet> p = (i % 3 == 2) ? ring->Remove () : ring->Dequeue ();
+          Ptr<Packet> q = (i % 3 == 2) ? list->Remove () : list->Dequeue ();
+          NS_TEST_EXPECT_MSG_EQ (p, q, "Different packet out");
+          NS_TEST_EXPECT_MSG_EQ (ConstCast<Packet> (peek), p, "Peek does not return the head");
+        }
+      NS_TEST_EXPECT_MSG_EQ (ring->GetNPackets (), list->GetNPackets (), "Different number of packets");
+      NS_TEST_EXPECT_MSG_EQ (ring->GetNBytes (), list->GetNBytes (), "Different number of bytes");
+    }
+  NS_TEST_EXPECT_MSG_EQ (ring->GetTotalDroppedPacketsBeforeEnqueue (), list->GetTotalDroppedPacketsBeforeEnqueue (),
+                         "Different drops before enqueue");
+  NS_TEST_EXPECT_MSG_GT (ring->GetTotalDroppedPacketsBeforeEnqueue (), 0, "The queue never filled up");
+  NS_TEST_EXPECT_MSG_EQ (ring->GetTotalDroppedPacketsAfterDequeue (), list->GetTotalDroppedPacketsAfterDequeue (),
+                         "Different drops after dequeue");
+  NS_TEST_EXPECT_MSG_EQ (ring->GetTotalReceivedPackets (), list->GetTotalReceivedPackets (),
+                         "Different number of received packets");
+
+  ring->Flush ();
+  NS_TEST_EXPECT_MSG_EQ (ring->IsEmpty (), true, "Flush left packets in the queue");
+  NS_TEST_EXPECT_MSG_EQ (ring->GetNBytes (), 0, "Flush left bytes in the queue");
+  NS_TEST_EXPECT_MSG_EQ ((ring->Dequeue () == 0), true, "Dequeue from an empty queue");
+  NS_TEST_EXPECT_MSG_EQ ((ring->Peek () == 0), true, "Peek into an empty queue");
+}
+
+/**
+ * \ingroup network-test
+ * \ingroup tests
+ *
+ * \brief Ring Queue TestSuite
+ */
+class RingQueueTestSuite : public TestSuite
+{
+public:
+  RingQueueTestSuite ()
+    : TestSuite ("ring-queue", UNIT)
+  {
+    AddTestCase (new RingQueueTestCase (), TestCase::QUICK);
+  }
+};
+
+static RingQueueTestSuite g_ringQueueTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,331 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "columnar-trace.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include <cstring>
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("ColumnarTrace");
+
+/// Magic string at the start of every file, including the terminating nul
+static const char COLUMNAR_MAGIC[8] = "NS3COLS";
+/// Current file format version
+static const uint32_t COLUMNAR_VERSION = 1;
+
+/**
+ * Write a value in host byte order.
+ * \param os output stream
+ * \param value the value
+ */
+template <typename T>
+static void
+WriteRaw (std::ostream &os, T value)
+{
+  os.write (reinterpret_cast<const char *> (&value), sizeof (value));
+}
+
+/**
+ * Size in bytes of a column type.
+ * \param type the type character
+ * \returns the size, or 0 for an unknown type
+ */
+static size_t
+ColumnTypeSize (char type)
+{
+  switch (type)
+    {
+    case ColumnarTraceWriter::DOUBLE:
+    case ColumnarTraceWriter::INT64:
+    case ColumnarTraceWriter::UINT64:
+      return 8;
+    case ColumnarTraceWriter::UINT32:
+      return 4;
+    default:
+      return 0;
+    }
+}
+
+ColumnarTraceWriter::ColumnarTraceWriter (std::string filename, std::string metadata)
+  : m_blockRows (4096)
+{
+  NS_LOG_FUNCTION (this << filename);
+  m_file.open (filename.c_str (), std::ios::out | std::ios::binary | std::ios::trunc);
+  NS_ABORT_MSG_UNLESS (m_file.is_open (), "ColumnarTraceWriter: Unable to open " << filename);
+
+  m_file.write (COLUMNAR_MAGIC, sizeof (COLUMNAR_MAGIC));
+  WriteRaw<uint32_t> (m_file, COLUMNAR_VERSION);
+  WriteRaw<uint32_t> (m_file, metadata.size ());
+  m_file.write (metadata.data (), metadata.size ());
+}
+
+ColumnarTraceWriter::~ColumnarTraceWriter ()
+{
+  NS_LOG_FUNCTION (this);
+  Flush ();
+}
+
+uint16_t
+ColumnarTraceWriter::AddSeries (std::string name, const Columns &columns)
+{
+  NS_LOG_FUNCTION (this << name << columns.size ());
+  NS_ABORT_MSG_IF (m_series.size () > UINT16_MAX, "Too many series");
+  NS_ABORT_MSG_IF (name.size () > UINT8_MAX, "Series name too long: " << name);
+
+  uint16_t id = m_series.size ();
+  Series series;
+  series.nRows = 0;
+  series.data.resize (columns.size ());
+
+  m_file.put ('S');
+  WriteRaw<uint16_t> (m_file, id);
+  WriteRaw<uint8_t> (m_file, name.size ());
+  m_file.write (name.data (), name.size ());
+  WriteRaw<uint16_t> (m_file, columns.size ());
+  for (const auto &column : columns)
+    {
+      NS_ABORT_MSG_IF (column.first.size () > UINT8_MAX, "Column name too long: " << column.first);
+      WriteRaw<uint8_t> (m_file, column.second);
+      WriteRaw<uint8_t> (m_file, column.first.size ());
+      m_file.write (column.first.data (), column.first.size ());
+      series.types.push_back (column.second);
+    }
+
+  m_series.push_back (series);
+  return id;
+}
+
+void
+ColumnarTraceWriter::SetBlockRows (uint32_t rows)
+{
+  NS_LOG_FUNCTION (this << rows);
+  NS_ABORT_MSG_IF (rows == 0, "Blocks need at least one row");
+  m_blockRows = rows;
+}
+
+void
+ColumnarTraceWriter::Flush (void)
+{
+  NS_LOG_FUNCTION (this);
+  for (uint16_t id = 0; id < m_series.size (); id++)
+    {
+      if (m_series[id].nRows > 0)
+        {
+          WriteBlock (id);
+        }
+    }
+  m_file.flush ();
+}
+
+void
+ColumnarTraceWriter::WriteBlock (uint16_t id)
+{
+  NS_LOG_FUNCTION (this << id);
+  Series &series = m_series[id];
+
+  m_file.put ('B');
+  WriteRaw<uint16_t> (m_file, id);
+  WriteRaw<uint32_t> (m_file, series.nRows);
+  for (auto &data : series.data)
+    {
+      m_file.write (data.data (), data.size ());
+      data.clear ();
+    }
+  series.nRows = 0;
+}
+
+ColumnarTraceReader::ColumnarTraceReader (std::string filename)
+{
+  NS_LOG_FUNCTION (this << filename);
+  std::ifstream in (filename.c_str (), std::ios::in | std::ios::binary);
+  NS_ABORT_MSG_UNLESS (in.is_open (), "ColumnarTraceReader: Unable to open " << filename);
+  std::vector<char> buf ((std::istreambuf_iterator<char> (in)), std::istreambuf_iterator<char> ());
+
+  size_t off = 0;
+  auto take = [&] (void *dst, size_t n) {
+      if (off + n > buf.size ())
+        {
+          return false;
+        }
+      std::memcpy (dst, buf.data () + off, n);
+      off += n;
+      return true;
+    };
+  auto takeString = [&] (size_t n, std::string &s) {
+      if (off + n > buf.size ())
+        {
+          return false;
+        }
+      s.assign (buf.data () + off, n);
+      off += n;
+      return true;
+    };
+
+  char magic[sizeof (COLUMNAR_MAGIC)];
+  uint32_t version = 0;
+  uint32_t metaLen = 0;
+  NS_ABORT_MSG_UNLESS (take (magic, sizeof (magic)) && std::memcmp (magic, COLUMNAR_MAGIC, sizeof (magic)) == 0,
+                       filename << " is not a columnar trace file");
+  NS_ABORT_MSG_UNLESS (take (&version, sizeof (version)) && version == COLUMNAR_VERSION,
+                       filename << ": unsupported version " << version);
+  NS_ABORT_MSG_UNLESS (take (&metaLen, sizeof (metaLen)) && takeString (metaLen, m_metadata),
+                       filename << ": truncated header");
+
+  // Names and types of the columns of every series, by identifier
+  std::map<uint16_t, std::pair<std::string, std::vector<std::pair<std::string, char> > > > schemas;
+
+  char record;
+  while (take (&record, 1))
+    {
+      uint16_t id;
+      if (record == 'S')
+        {
+          uint8_t nameLen;
+          uint16_t nColumns;
+          std::string name;
+          if (!take (&id, sizeof (id)) || !take (&nameLen, 1) || !takeString (nameLen, name)
+              || !take (&nColumns, sizeof (nColumns)))
+            {
+              break;
+            }
+          auto &schema = schemas[id];
+          schema.first = name;
+          bool ok = true;
+          for (uint16_t i = 0; i < nColumns && ok; i++)
+            {
+              uint8_t type;
+              uint8_t columnLen;
+              std::string column;
+              ok = take (&type, 1) && take (&columnLen, 1) && takeString (columnLen, column);
+              if (ok)
+                {
+                  NS_ABORT_MSG_IF (ColumnTypeSize (type) == 0, filename << ": bad column type " << type);
+                  schema.second.emplace_back (column, type);
+                  m_series[name][column];
+                }
+            }
+          if (!ok)
+            {
+              break;
+            }
+        }
+      else if (record == 'B')
+        {
+          uint32_t nRows;
+          if (!take (&id, sizeof (id)) || !take (&nRows, sizeof (nRows)))
+            {
+              break;
+            }
+          auto it = schemas.find (id);
+          NS_ABORT_MSG_IF (it == schemas.end (), filename << ": block of undeclared series " << id);
+          size_t blockSize = 0;
+          for (const auto &column : it->second.second)
+            {
+              blockSize += nRows * ColumnTypeSize (column.second);
+            }
+          if (off + blockSize > buf.size ())
+            {
+              // Truncated by an interrupted writer
+              break;
+            }
+          SeriesColumns &series = m_series[it->second.first];
+          for (const auto &column : it->second.second)
+            {
+              std::vector<double> &values = series[column.first];
+              const char *p = buf.data () + off;
+              for (uint32_t row = 0; row < nRows; row++)
+                {
+                  switch (column.second)
+                    {
+                    case ColumnarTraceWriter::DOUBLE:
+                      {
+                        double v;
+                        std::memcpy (&v, p, sizeof (v));
+                        values.push_back (v);
+                        break;
+                      }
+                    case ColumnarTraceWriter::INT64:
+                      {
+                        int64_t v;
+                        std::memcpy (&v, p, sizeof (v));
+                        values.push_back (v);
+                        break;
+                      }
+                    case ColumnarTraceWriter::UINT64:
+                      {
+                        uint64_t v;
+                        std::memcpy (&v, p, sizeof (v));
+                        values.push_back (v);
+                        break;
+                      }
+                    case ColumnarTraceWriter::UINT32:
+                      {
+                        uint32_t v;
+                        std::memcpy (&v, p, sizeof (v));
+                        values.push_back (v);
+                        break;
+                      }
+                    }
+                  p += ColumnTypeSize (column.second);
+                }
+              off += nRows * ColumnTypeSize (column.second);
+            }
+        }
+      else
+        {
+          NS_ABORT_MSG (filename << ": bad record type " << record);
+        }
+    }
+}
+
+std::string
+ColumnarTraceReader::GetMetadata (void) const
+{
+  return m_metadata;
+}
+
+bool
+ColumnarTraceReader::HasSeries (std::string series) const
+{
+  return m_series.find (series) != m_series.end ();
+}
+
+uint32_t
+ColumnarTraceReader::GetNRows (std::string series) const
+{
+  auto it = m_series.find (series);
+  if (it == m_series.end () || it->second.empty ())
+    {
+      return 0;
+    }
+  return it->second.begin ()->second.size ();
+}
+
+std::vector<double>
+ColumnarTraceReader::GetColumn (std::string series, std::string column) const
+{
+  auto it = m_series.find (series);
+  NS_ABORT_MSG_IF (it == m_series.end (), "No series " << series);
+  auto col = it->second.find (column);
+  NS_ABORT_MSG_IF (col == it->second.end (), "No column " << column << " in series " << series);
+  return col->second;
+}
+
+} // namespace ns3
@@ -0,0 +1,242 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef COLUMNAR_TRACE_H
+#define COLUMNAR_TRACE_H
+
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ns3/assert.h"
+#include "ns3/simple-ref-count.h"
+
+namespace ns3 {
+
+/**
+ * @brief Buffered, append-only binary writer for time series.
+ *
+ * A file holds any number of series, each with its own typed columns.
+ * Rows appended to a series are buffered column by column and written as
+ * one block once the series holds BlockRows rows, on Flush () and on
+ * destruction. Nothing is formatted and nothing is flushed per row, so
+ * tracing a value every few milliseconds costs a few stores.
+ *
+ * The file layout, in host (little-endian) byte order, is
+ *
+ * \verbatim
+ *   file   := "NS3COLS\0" uint32 version uint32 metaLen meta record*
+ *   record := 'S' uint16 series uint8 nameLen name uint16 nColumns
+ *                 (uint8 type uint8 nameLen name)*
+ *           | 'B' uint16 series uint32 nRows (nRows values of each column)*
+ * \endverbatim
+ *
+ * where the column types are the numpy type characters 'd' (double),
+ * 'q' (int64_t), 'Q' (uint64_t) and 'I' (uint32_t), so that readers can map
+ * every block of a column directly. plotting/columnar.py is such a reader;
+ * ColumnarTraceReader reads the files back in C++.
+ *
+ * Like OutputStreamWrapper, this class is meant to be passed around as a
+ * Ptr<> bound into trace sinks:
+ *
+ * \verbatim
+ *   Ptr<ColumnarTraceWriter> writer = Create<ColumnarTraceWriter> ("traces.cols");
+ *   uint16_t queue = writer->AddSeries ("queue", {{"time", ColumnarTraceWriter::DOUBLE},
+ *                                                 {"packets", ColumnarTraceWriter::UINT32}});
+ *   ...
+ *   writer->Append (queue, Simulator::Now ().GetSeconds (), q->GetNPackets ());
+ * \endverbatim
+ */
+class ColumnarTraceWriter : public SimpleRefCount<ColumnarTraceWriter>
+{
+public:
+  /// Column types, with the numpy type character as value
+  enum ColumnType
+  {
+    DOUBLE = 'd',
+    INT64 = 'q',
+    UINT64 = 'Q',
+    UINT32 = 'I'
+  };
+
+  /// Names and types of the columns of a series
+  typedef std::vector<std::pair<std::string, ColumnType> > Columns;
+
+  /**
+   * Constructor
+   * \param filename file name, truncated if it exists
+   * \param metadata free-form text stored in the file header
+   */
+  ColumnarTraceWriter (std::string filename, std::string metadata = "");
+  ~ColumnarTraceWriter ();
+
+  /**
+   * Declare a new series.
+   * \param name series name
+   * \param columns names and types of the columns
+   * \returns the series identifier to pass to Append
+   */
+  uint16_t AddSeries (std::string name, const Columns &columns);
+
+  /**
+   * Append a row to a series, one value per column, converted to the
+   * column type.
+   * \param series series identifier returned by AddSeries
+   * \param values the values
+   */
+  template <typename... Ts>
+  void Append (uint16_t series, Ts... values);
+
+  /**
+   * Set the number of buffered rows at which a series is written out.
+   * \param rows the number of rows per block
+   */
+  void SetBlockRows (uint32_t rows);
+
+  /// Write out the buffered rows of every series.
+  void Flush (void);
+
+private:
+  /// Buffered rows of a series
+  struct Series
+  {
+    std::vector<ColumnType> types;           //!< column types
+    std::vector<std::vector<char> > data;    //!< buffered values, per column
+    uint32_t nRows;                          //!< number of buffered rows
+  };
+
+  /**
+   * Buffer one value.
+   * \param series the series
+   * \param column the column index
+   * \param value the value
+   */
+  template <typename T>
+  void Put (Series &series, size_t column, T value);
+
+  /**
+   * Write out the buffered rows of a series.
+   * \param id the series identifier
+   */
+  void WriteBlock (uint16_t id);
+
+  std::ofstream m_file;            //!< output file
+  std::vector<Series> m_series;    //!< series, indexed by identifier
+  uint32_t m_blockRows;            //!< rows per block
+};
+
+/**
+ * @brief Reads back a file written by ColumnarTraceWriter.
+ *
+ * The whole file is read on construction and every column is converted to
+ * double, which is exact for all but very large 64-bit integers.
+ */
+class ColumnarTraceReader
+{
+public:
+  /**
+   * Constructor
+   * \param filename file name
+   */
+  ColumnarTraceReader (std::string filename);
+
+  /// \returns the metadata stored in the file header
+  std::string GetMetadata (void) const;
+
+  /**
+   * \param series series name
+   * \returns true if the file holds that series
+   */
+  bool HasSeries (std::string series) const;
+
+  /**
+   * \param series series name
+   * \returns the number of rows of the series
+   */
+  uint32_t GetNRows (std::string series) const;
+
+  /**
+   * \param series series name
+   * \param column column name
+   * \returns the values of the column
+   */
+  std::vector<double> GetColumn (std::string series, std::string column) const;
+
+private:
+  /// Columns of a series, by name
+  typedef std::map<std::string, std::vector<double> > SeriesColumns;
+
+  std::string m_metadata;                        //!< file metadata
+  std::map<std::string, SeriesColumns> m_series; //!< series, by name
+};
+
+template <typename T>
+void
+ColumnarTraceWriter::Put (Series &series, size_t column, T value)
+{
+  std::vector<char> &data = series.data[column];
+  switch (series.types[column])
+    {
+    case DOUBLE:
+      {
+        double v = static_cast<double> (value);
+        data.insert (data.end (), reinterpret_cast<char *> (&v), reinterpret_cast<char *> (&v) + sizeof (v));
+        break;
+      }
+    case INT64:
+      {
+        int64_t v = static_cast<int64_t> (value);
+        data.insert (data.end (), reinterpret_cast<char *> (&v), reinterpret_cast<char *> (&v) + sizeof (v));
+        break;
+      }
+    case UINT64:
+      {
+        uint64_t v = static_cast<uint64_t> (value);
+        data.insert (data.end (), reinterpret_cast<char *> (&v), reinterpret_cast<char *> (&v) + sizeof (v));
+        break;
+      }
+    case UINT32:
+      {
+        uint32_t v = static_cast<uint32_t> (value);
+        data.insert (data.end (), reinterpret_cast<char *> (&v), reinterpret_cast<char *> (&v) + sizeof (v));
+        break;
+      }
+    }
+}
+
+template <typename... Ts>
+void
+ColumnarTraceWriter::Append (uint16_t series, Ts... values)
+{
+  NS_ASSERT_MSG (series < m_series.size (), "Unknown series " << series);
+  Series &s = m_series[series];
+  NS_ASSERT_MSG (sizeof... (values) == s.types.size (),
+                 "Series " << series << " has " << s.types.size () << " columns");
+  size_t column = 0;
+  int expand[] = { 0, (Put (s, column++, values), 0)... };
+  (void) expand;
+  if (++s.nRows >= m_blockRows)
+    {
+      WriteBlock (series);
+    }
+}
+
+} // namespace ns3
+
+#endif /* COLUMNAR_TRACE_H */
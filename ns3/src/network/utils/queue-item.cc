@@ -139,6 +139,13 @@ QueueDiscItem::Print (std::ostream& os) const
   ;
 }
 
+bool
+QueueDiscItem::MarkVcpLoad (uint8_t load)
+{
+  NS_LOG_FUNCTION (this << (uint16_t) load);
+  return false;
+}
+
 uint32_t
 QueueDiscItem::Hash (uint32_t perturbation) const
 {
@@ -215,6 +215,17 @@ public:
    */
   virtual bool Mark (void) = 0;
 
+  /**
+   * \brief Max-merges a VCP load code point into the ECN field of the packet
+   *
+   * This method just returns false. Subclasses carrying an IP header should
+   * set the ECN field to the given load if it exceeds the current value.
+   *
+   * \param load the VCP load code point (a VcpPacketTag::LoadType value)
+   * \return true if the ECN field now carries at least the given load, false otherwise
+   */
+  virtual bool MarkVcpLoad (uint8_t load);
+
   /**
    * \brief Computes the hash of various fields of the packet header
    *
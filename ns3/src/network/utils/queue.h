@@ -407,6 +407,29 @@ protected:
    */
   Ptr<const Item> DoPeek (ConstIterator pos) const;
 
+  /**
+   * \brief Check that an item fits in the queue, and drop it otherwise
+   *
+   * Subclasses that keep the items in their own container call this method
+   * before storing an item, and NotifyEnqueued once it is stored.
+   *
+   * \param item the item to enqueue
+   * \return true if the item fits, false if it has been dropped
+   */
+  bool Admit (Ptr<Item> item);
+
+  /**
+   * \brief Count an item that has been stored in the queue
+   * \param item the item
+   */
+  void NotifyEnqueued (Ptr<Item> item);
+
+  /**
+   * \brief Count an item that has been taken out of the queue
+   * \param item the item
+   */
+  void NotifyDequeued (Ptr<Item> item);
+
   /**
    * \brief Drop a packet before enqueue
    * \param item item that was dropped
@@ -500,25 +523,13 @@ Queue<Item>::DoEnqueue (ConstIterator pos, Ptr<Item> item, Iterator& ret)
 {
   NS_LOG_FUNCTION (this << item);
 
-  if (GetCurrentSize () + item > GetMaxSize ())
+  if (!Admit (item))
     {
-      NS_LOG_LOGIC ("Queue full -- dropping pkt");
-      DropBeforeEnqueue (item);
       return false;
     }
 
   ret = m_packets.insert (pos, item);
-
-  uint32_t size = item->GetSize ();
-  m_nBytes += size;
-  m_nTotalReceivedBytes += size;
-
-  m_nPackets++;
-  m_nTotalReceivedPackets++;
-
-  NS_LOG_LOGIC ("m_traceEnqueue (p)");
-  m_traceEnqueue (item);
-
+  NotifyEnqueued (item);
   return true;
 }
 
@@ -539,14 +550,7 @@ Queue<Item>::DoDequeue (ConstIterator pos)
 
   if (item != 0)
     {
-      NS_ASSERT (m_nBytes.Get () >= item->GetSize ());
-      NS_ASSERT (m_nPackets.Get () > 0);
-
-      m_nBytes -= item->GetSize ();
-      m_nPackets--;
-
-      NS_LOG_LOGIC ("m_traceDequeue (p)");
-      m_traceDequeue (item);
+      NotifyDequeued (item);
     }
   return item;
 }
@@ -568,21 +572,55 @@ Queue<Item>::DoRemove (ConstIterator pos)
 
   if (item != 0)
     {
-      NS_ASSERT (m_nBytes.Get () >= item->GetSize ());
-      NS_ASSERT (m_nPackets.Get () > 0);
-
-      m_nBytes -= item->GetSize ();
-      m_nPackets--;
-
       // packets are first dequeued and then dropped
-      NS_LOG_LOGIC ("m_traceDequeue (p)");
-      m_traceDequeue (item);
-
+      NotifyDequeued (item);
       DropAfterDequeue (item);
     }
   return item;
 }
 
+template <typename Item>
+bool
+Queue<Item>::Admit (Ptr<Item> item)
+{
+  if (GetCurrentSize () + item > GetMaxSize ())
+    {
+      NS_LOG_LOGIC ("Queue full -- dropping pkt");
+      DropBeforeEnqueue (item);
+      return false;
+    }
+  return true;
+}
+
+template <typename Item>
+void
+Queue<Item>::NotifyEnqueued (Ptr<Item> item)
+{
+  uint32_t size = item->GetSize ();
+  m_nBytes += size;
+  m_nTotalReceivedBytes += size;
+
+  m_nPackets++;
+  m_nTotalReceivedPackets++;
+
+  NS_LOG_LOGIC ("m_traceEnqueue (p)");
+  m_traceEnqueue (item);
+}
+
+template <typename Item>
+void
+Queue<Item>::NotifyDequeued (Ptr<Item> item)
+{
+  NS_ASSERT (m_nBytes.Get () >= item->GetSize ());
+  NS_ASSERT (m_nPackets.Get () > 0);
+
+  m_nBytes -= item->GetSize ();
+  m_nPackets--;
+
+  NS_LOG_LOGIC ("m_traceDequeue (p)");
+  m_traceDequeue (item);
+}
+
 template <typename Item>
 void
 Queue<Item>::Flush (void)
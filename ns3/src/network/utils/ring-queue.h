@@ -0,0 +1,243 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef RING_QUEUE_H
+#define RING_QUEUE_H
+
+#include "ns3/queue.h"
+#include <vector>
+
+namespace ns3 {
+
+/**
+ * \ingroup queue
+ *
+ * \brief A FIFO packet queue that drops tail-end packets on overflow,
+ * and keeps its items in a circular array
+ *
+ * RingQueue behaves like DropTailQueue, but stores the items in a
+ * power of two array that grows when it is full, so that enqueue and
+ * dequeue do not allocate once the array has reached the size of the
+ * queue.  It is selected like the other queues, by its TypeId, e.g.,
+ * SetQueue ("ns3::RingQueue<Packet>") on a PointToPointHelper.
+ *
+ * The items only enter at the tail and leave at the head: the subclasses
+ * that insert or remove items at other positions derive from Queue, whose
+ * iterators stay valid across these operations.
+ */
+template <typename Item>
+class RingQueue : public Queue<Item>
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  /**
+   * \brief RingQueue Constructor
+   *
+   * Creates a ring queue with a maximum size of 100 packets by default
+   */
+  RingQueue ();
+
+  virtual ~RingQueue ();
+
+  virtual bool Enqueue (Ptr<Item> item);
+  virtual Ptr<Item> Dequeue (void);
+  virtual Ptr<Item> Remove (void);
+  virtual Ptr<const Item> Peek (void) const;
+
+private:
+  using Queue<Item>::Admit;
+  using Queue<Item>::NotifyEnqueued;
+  using Queue<Item>::NotifyDequeued;
+  using Queue<Item>::DropAfterDequeue;
+
+  /**
+   * Take the item at the head of the ring
+   * \return the item, or 0 if the queue is empty
+   */
+  Ptr<Item> Pop (void);
+
+  /// Double the size of the ring, keeping the items in order
+  void Grow (void);
+
+  std::vector<Ptr<Item> > m_ring; //!< the items, a power of two of slots
+  uint32_t m_head;                //!< index of the item at the head
+  uint32_t m_count;               //!< number of items in the ring
+
+  NS_LOG_TEMPLATE_DECLARE;     //!< redefinition of the log component
+};
+
+
+/**
+ * Implementation of the templates declared above.
+ */
+
+template <typename Item>
+TypeId
+RingQueue<Item>::GetTypeId (void)
+{
+  static TypeId tid = TypeId (("ns3::RingQueue<" + GetTypeParamName<RingQueue<Item> > () + ">").c_str ())
+    .SetParent<Queue<Item> > ()
+    .SetGroupName ("Network")
+    .template AddConstructor<RingQueue<Item> > ()
+    .AddAttribute ("MaxSize",
+                   "The max queue size",
+                   QueueSizeValue (QueueSize ("100p")),
+                   MakeQueueSizeAccessor (&QueueBase::SetMaxSize,
+                                          &QueueBase::GetMaxSize),
+                   MakeQueueSizeChecker ())
+  ;
+  return tid;
+}
+
+template <typename Item>
+RingQueue<Item>::RingQueue () :
+  Queue<Item> (),
+  m_head (0),
+  m_count (0),
+  NS_LOG_TEMPLATE_DEFINE ("RingQueue")
+{
+  NS_LOG_FUNCTION (this);
+}
+
+template <typename Item>
+RingQueue<Item>::~RingQueue ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+template <typename Item>
+bool
+RingQueue<Item>::Enqueue (Ptr<Item> item)
+{
+  NS_LOG_FUNCTION (this << item);
+
+  if (!Admit (item))
+    {
+      return false;
+    }
+
+  if (m_count == m_ring.size ())
+    {
+      Grow ();
+    }
+  m_ring[(m_head + m_count) & (m_ring.size () - 1)] = item;
+  m_count++;
+  NotifyEnqueued (item);
+  return true;
+}
+
+template <typename Item>
+Ptr<Item>
+RingQueue<Item>::Pop (void)
+{
+  if (m_count == 0)
+    {
+      NS_LOG_LOGIC ("Queue empty");
+      return 0;
+    }
+
+  Ptr<Item> item = m_ring[m_head];
+  m_ring[m_head] = 0;
+  m_head = (m_head + 1) & (m_ring.size () - 1);
+  m_count--;
+  return item;
+}
+
+template <typename Item>
+Ptr<Item>
+RingQueue<Item>::Dequeue (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<Item> item = Pop ();
+  if (item != 0)
+    {
+      NotifyDequeued (item);
+    }
+
+  NS_LOG_LOGIC ("Popped " << item);
+
+  return item;
+}
+
+template <typename Item>
+Ptr<Item>
+RingQueue<Item>::Remove (void)
+{
+  NS_LOG_FUNCTION (this);
+
+  Ptr<Item> item = Pop ();
+  if (item != 0)
+    {
+      // packets are first dequeued and then dropped
+      NotifyDequeued (item);
+      DropAfterDequeue (item);
+    }
+
+  NS_LOG_LOGIC ("Removed " << item);
+
+  return item;
+}
+
+template <typename Item>
+Ptr<const Item>
+RingQueue<Item>::Peek (void) const
+{
+  NS_LOG_FUNCTION (this);
+
+  if (m_count == 0)
+    {
+      NS_LOG_LOGIC ("Queue empty");
+      return 0;
+    }
+
+  return m_ring[m_head];
+}
+
+template <typename Item>
+void
+RingQueue<Item>::Grow (void)
+{
+  NS_LOG_FUNCTION (this << m_ring.size ());
+
+  std::vector<Ptr<Item> > ring (m_ring.empty () ? 8 : 2 * m_ring.size ());
+  for (uint32_t i = 0; i < m_count; i++)
+    {
+      ring[i] = m_ring[(m_head + i) & (m_ring.size () - 1)];
+    }
+  m_ring.swap (ring);
+  m_head = 0;
+}
+
+// The following explicit template instantiation declarations prevent all the
+// translation units including this header file to implicitly instantiate the
+// RingQueue<Packet> class and the RingQueue<QueueDiscItem> class. The
+// unique instances of these classes are explicitly created through the macros
+// NS_OBJECT_TEMPLATE_CLASS_DEFINE (RingQueue,Packet) and
+// NS_OBJECT_TEMPLATE_CLASS_DEFINE (RingQueue,QueueDiscItem), which are included
+// in ring-queue.cc
+extern template class RingQueue<Packet>;
+extern template class RingQueue<QueueDiscItem>;
+
+} // namespace ns3
+
+#endif /* RING_QUEUE_H */
@@ -25,7 +25,7 @@
 #include "ns3/trace-source-accessor.h"
 #include "ns3/uinteger.h"
 #include "ns3/pointer.h"
-#include "ns3/ipv4-header.h"
+#include "ns3/vcp-trace.h"
 #include "point-to-point-net-device.h"
 #include "point-to-point-channel.h"
 #include "ppp-header.h"
@@ -368,10 +368,7 @@ PointToPointNetDevice::Receive (Ptr<Packet> packet)
       //
       ProcessHeader (packet, protocol);
 
-      // (VCP): TODO: delete
-      Ipv4Header ipHeader;
-      packet->PeekHeader(ipHeader);
-      NS_LOG_DEBUG("(VCP) ip header ecn=" << ipHeader.GetEcn());
+      NS_VCP_TRACE_PACKET_ECN (packet);
 
       if (!m_promiscCallback.IsNull ())
         {
@@ -519,9 +516,7 @@ PointToPointNetDevice::Send (
   NS_LOG_LOGIC ("p=" << packet << ", dest=" << &dest);
   NS_LOG_LOGIC ("UID is " << packet->GetUid ());
 
-  Ipv4Header ipHeader;
-  packet->PeekHeader(ipHeader);
-  NS_LOG_DEBUG("(VCP) ip header ecn=" << ipHeader.GetEcn()); // TODO: delete
+  NS_VCP_TRACE_PACKET_ECN (packet);
 
   //
   // If IsLinkUp() is false it means there is no channel to send any packet 
@@ -22,7 +22,7 @@
 #include "fifo-queue-disc.h"
 #include "ns3/object-factory.h"
 #include "ns3/drop-tail-queue.h"
-#include "ns3/vcp-packet-tag.h"
+#include "ns3/vcp-trace.h"
 
 namespace ns3 {
 
@@ -93,10 +93,7 @@ FifoQueueDisc::DoDequeue (void)
       return 0;
     }
 
-  // (VCP): TODO check more info
-  VcpPacketTag vcpTag;
-  bool hasVcpTag = item->GetPacket()->PeekPacketTag(vcpTag);
-  NS_LOG_DEBUG("(VCP) hasVcpTag=" << hasVcpTag);
+  NS_VCP_TRACE_TAG (item->GetPacket ());
 
   return item;
 }
@@ -29,13 +29,39 @@
 #include "queue-disc.h"
 #include "ns3/net-device-queue-interface.h"
 #include "ns3/queue.h"
-#include "ns3/vcp-packet-tag.h"
-#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/vcp-trace.h"
+#include "ns3/system-mutex.h"
+#include <cstring>
+#include <deque>
+#include <unordered_map>
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("QueueDisc");
 
+namespace {
+
+/// The reasons to drop or mark packets interned by all the queue discs
+struct ReasonRegistry
+{
+  SystemMutex mutex;                                          //!< Protects the registry
+  std::deque<std::string> names;                              //!< The reasons, by id; never moved
+  std::unordered_map<std::string, QueueDisc::ReasonId> ids;   //!< The id of each reason
+};
+
+/**
+ * \brief Get the registry of the reasons
+ * \return the registry
+ */
+ReasonRegistry &
+GetReasonRegistry (void)
+{
+  static ReasonRegistry registry;
+  return registry;
+}
+
+} // unnamed namespace
+
 
 NS_OBJECT_ENSURE_REGISTERED (QueueDiscClass);
 
@@ -108,6 +134,16 @@ QueueDisc::Stats::Stats ()
 {
 }
 
+QueueDisc::ReasonStats::ReasonStats ()
+  : nDroppedPacketsBeforeEnqueue (0),
+    nDroppedBytesBeforeEnqueue (0),
+    nDroppedPacketsAfterDequeue (0),
+    nDroppedBytesAfterDequeue (0),
+    nMarkedPackets (0),
+    nMarkedBytes (0)
+{
+}
+
 uint32_t
 QueueDisc::Stats::GetNDroppedPackets (std::string reason) const
 {
@@ -354,18 +390,16 @@ QueueDisc::QueueDisc (QueueDiscSizePolicy policy)
   // the packet is dropped.
   m_childQueueDiscDbeFunctor = [this] (Ptr<const QueueDiscItem> item, const char* r)
     {
-      return DropBeforeEnqueue (item,
-                                m_childQueueDiscDropMsg.assign (CHILD_QUEUE_DISC_DROP).append (r).data ());
+      return DropBeforeEnqueue (item, InternReason (CHILD_QUEUE_DISC_DROP, r));
     };
   m_childQueueDiscDadFunctor = [this] (Ptr<const QueueDiscItem> item, const char* r)
     {
-      return DropAfterDequeue (item,
-                               m_childQueueDiscDropMsg.assign (CHILD_QUEUE_DISC_DROP).append (r).data ());
+      return DropAfterDequeue (item, InternReason (CHILD_QUEUE_DISC_DROP, r));
     };
   m_childQueueDiscMarkFunctor = [this] (Ptr<const QueueDiscItem> item, const char* r)
     {
       return Mark (const_cast<QueueDiscItem *> (PeekPointer (item)),
-                   m_childQueueDiscMarkMsg.assign (CHILD_QUEUE_DISC_MARK).append (r).data ());
+                   InternReason (CHILD_QUEUE_DISC_MARK, r));
     };
 }
 
@@ -435,9 +469,97 @@ QueueDisc::GetStats (void)
   m_stats.nTotalSentBytes = m_stats.nTotalDequeuedBytes - (m_requeued ? m_requeued->GetSize () : 0)
                             - m_stats.nTotalDroppedBytesAfterDequeue;
 
+  // the counters for each reason are likewise only copied to the maps here:
+  // a reason has an entry in a map once a packet was dropped or marked for it
+  for (ReasonId id = 0; id < m_reasonStats.size (); id++)
+    {
+      const ReasonStats &rs = m_reasonStats[id];
+      if (rs.nDroppedPacketsBeforeEnqueue)
+        {
+          m_stats.nDroppedPacketsBeforeEnqueue[GetReasonName (id)] = rs.nDroppedPacketsBeforeEnqueue;
+          m_stats.nDroppedBytesBeforeEnqueue[GetReasonName (id)] = rs.nDroppedBytesBeforeEnqueue;
+        }
+      if (rs.nDroppedPacketsAfterDequeue)
+        {
+          m_stats.nDroppedPacketsAfterDequeue[GetReasonName (id)] = rs.nDroppedPacketsAfterDequeue;
+          m_stats.nDroppedBytesAfterDequeue[GetReasonName (id)] = rs.nDroppedBytesAfterDequeue;
+        }
+      if (rs.nMarkedPackets)
+        {
+          m_stats.nMarkedPackets[GetReasonName (id)] = rs.nMarkedPackets;
+          m_stats.nMarkedBytes[GetReasonName (id)] = rs.nMarkedBytes;
+        }
+    }
+
   return m_stats;
 }
 
+QueueDisc::ReasonId
+QueueDisc::GetReasonId (const std::string &reason)
+{
+  ReasonRegistry &registry = GetReasonRegistry ();
+  CriticalSection critical (registry.mutex);
+
+  auto it = registry.ids.find (reason);
+  if (it != registry.ids.end ())
+    {
+      return it->second;
+    }
+  ReasonId id = registry.names.size ();
+  registry.names.push_back (reason);
+  registry.ids[reason] = id;
+  return id;
+}
+
+const std::string &
+QueueDisc::GetReasonName (ReasonId id)
+{
+  ReasonRegistry &registry = GetReasonRegistry ();
+  CriticalSection critical (registry.mutex);
+
+  NS_ASSERT_MSG (id < registry.names.size (), "Unknown reason " << id);
+  return registry.names[id];
+}
+
+QueueDisc::Reason
+QueueDisc::InternReason (const char* prefix, const char* string)
+{
+  for (auto &entry : m_reasons)
+    {
+      if (entry.string == string && entry.prefix == prefix)
+        {
+          // the caller may have changed the string since it was interned
+          const char* suffix = entry.reason.name + entry.prefixLength;
+          if (suffix != string && std::strcmp (suffix, string) != 0)
+            {
+              ReasonId id = GetReasonId (std::string (prefix ? prefix : "") + string);
+              entry.reason.id = id;
+              entry.reason.name = GetReasonName (id).c_str ();
+            }
+          return entry.reason;
+        }
+    }
+
+  ReasonEntry entry;
+  entry.prefix = prefix;
+  entry.string = string;
+  entry.prefixLength = prefix ? std::strlen (prefix) : 0;
+  entry.reason.id = GetReasonId (std::string (prefix ? prefix : "") + string);
+  entry.reason.name = GetReasonName (entry.reason.id).c_str ();
+  m_reasons.push_back (entry);
+  return entry.reason;
+}
+
+QueueDisc::ReasonStats&
+QueueDisc::GetReasonStats (ReasonId id)
+{
+  if (id >= m_reasonStats.size ())
+    {
+      m_reasonStats.resize (id + 1);
+    }
+  return m_reasonStats[id];
+}
+
 uint32_t
 QueueDisc::GetNPackets () const
 {
@@ -730,72 +852,52 @@ QueueDisc::PacketDequeued (Ptr<const QueueDiscItem> item)
 void
 QueueDisc::DropBeforeEnqueue (Ptr<const QueueDiscItem> item, const char* reason)
 {
-  NS_LOG_FUNCTION (this << item << reason);
+  DropBeforeEnqueue (item, InternReason (0, reason));
+}
+
+void
+QueueDisc::DropBeforeEnqueue (Ptr<const QueueDiscItem> item, Reason reason)
+{
+  NS_LOG_FUNCTION (this << item << reason.name);
 
   m_stats.nTotalDroppedPackets++;
   m_stats.nTotalDroppedBytes += item->GetSize ();
   m_stats.nTotalDroppedPacketsBeforeEnqueue++;
   m_stats.nTotalDroppedBytesBeforeEnqueue += item->GetSize ();
 
-  // update the number of packets dropped for the given reason
-  std::map<std::string, uint32_t>::iterator itp = m_stats.nDroppedPacketsBeforeEnqueue.find (reason);
-  if (itp != m_stats.nDroppedPacketsBeforeEnqueue.end ())
-    {
-      itp->second++;
-    }
-  else
-    {
-      m_stats.nDroppedPacketsBeforeEnqueue[reason] = 1;
-    }
-  // update the amount of bytes dropped for the given reason
-  std::map<std::string, uint64_t>::iterator itb = m_stats.nDroppedBytesBeforeEnqueue.find (reason);
-  if (itb != m_stats.nDroppedBytesBeforeEnqueue.end ())
-    {
-      itb->second += item->GetSize ();
-    }
-  else
-    {
-      m_stats.nDroppedBytesBeforeEnqueue[reason] = item->GetSize ();
-    }
+  // update the packets and bytes dropped for the given reason
+  ReasonStats &rs = GetReasonStats (reason.id);
+  rs.nDroppedPacketsBeforeEnqueue++;
+  rs.nDroppedBytesBeforeEnqueue += item->GetSize ();
 
   NS_LOG_DEBUG ("Total packets/bytes dropped before enqueue: "
                 << m_stats.nTotalDroppedPacketsBeforeEnqueue << " / "
                 << m_stats.nTotalDroppedBytesBeforeEnqueue);
   NS_LOG_LOGIC ("m_traceDropBeforeEnqueue (p)");
   m_traceDrop (item);
-  m_traceDropBeforeEnqueue (item, reason);
+  m_traceDropBeforeEnqueue (item, reason.name);
 }
 
 void
 QueueDisc::DropAfterDequeue (Ptr<const QueueDiscItem> item, const char* reason)
 {
-  NS_LOG_FUNCTION (this << item << reason);
+  DropAfterDequeue (item, InternReason (0, reason));
+}
+
+void
+QueueDisc::DropAfterDequeue (Ptr<const QueueDiscItem> item, Reason reason)
+{
+  NS_LOG_FUNCTION (this << item << reason.name);
 
   m_stats.nTotalDroppedPackets++;
   m_stats.nTotalDroppedBytes += item->GetSize ();
   m_stats.nTotalDroppedPacketsAfterDequeue++;
   m_stats.nTotalDroppedBytesAfterDequeue += item->GetSize ();
 
-  // update the number of packets dropped for the given reason
-  std::map<std::string, uint32_t>::iterator itp = m_stats.nDroppedPacketsAfterDequeue.find (reason);
-  if (itp != m_stats.nDroppedPacketsAfterDequeue.end ())
-    {
-      itp->second++;
-    }
-  else
-    {
-      m_stats.nDroppedPacketsAfterDequeue[reason] = 1;
-    }
-  // update the amount of bytes dropped for the given reason
-  std::map<std::string, uint64_t>::iterator itb = m_stats.nDroppedBytesAfterDequeue.find (reason);
-  if (itb != m_stats.nDroppedBytesAfterDequeue.end ())
-    {
-      itb->second += item->GetSize ();
-    }
-  else
-    {
-      m_stats.nDroppedBytesAfterDequeue[reason] = item->GetSize ();
-    }
+  // update the packets and bytes dropped for the given reason
+  ReasonStats &rs = GetReasonStats (reason.id);
+  rs.nDroppedPacketsAfterDequeue++;
+  rs.nDroppedBytesAfterDequeue += item->GetSize ();
 
   // if in the context of a peek request a dequeued packet is dropped, we need
   // to update the statistics and fire the dequeue trace before firing the drop
@@ -813,13 +915,19 @@ QueueDisc::DropAfterDequeue (Ptr<const QueueDiscItem> item, const char* reason)
                 << m_stats.nTotalDroppedBytesAfterDequeue);
   NS_LOG_LOGIC ("m_traceDropAfterDequeue (p)");
   m_traceDrop (item);
-  m_traceDropAfterDequeue (item, reason);
+  m_traceDropAfterDequeue (item, reason.name);
 }
 
 bool
 QueueDisc::Mark (Ptr<QueueDiscItem> item, const char* reason)
 {
-  NS_LOG_FUNCTION (this << item << reason);
+  return Mark (item, InternReason (0, reason));
+}
+
+bool
+QueueDisc::Mark (Ptr<QueueDiscItem> item, Reason reason)
+{
+  NS_LOG_FUNCTION (this << item << reason.name);
 
   bool retval = item->Mark ();
 
@@ -831,31 +939,15 @@ QueueDisc::Mark (Ptr<QueueDiscItem> item, const char* reason)
   m_stats.nTotalMarkedPackets++;
   m_stats.nTotalMarkedBytes += item->GetSize ();
 
-  // update the number of packets marked for the given reason
-  std::map<std::string, uint32_t>::iterator itp = m_stats.nMarkedPackets.find (reason);
-  if (itp != m_stats.nMarkedPackets.end ())
-    {
-      itp->second++;
-    }
-  else
-    {
-      m_stats.nMarkedPackets[reason] = 1;
-    }
-  // update the amount of bytes marked for the given reason
-  std::map<std::string, uint64_t>::iterator itb = m_stats.nMarkedBytes.find (reason);
-  if (itb != m_stats.nMarkedBytes.end ())
-    {
-      itb->second += item->GetSize ();
-    }
-  else
-    {
-      m_stats.nMarkedBytes[reason] = item->GetSize ();
-    }
+  // update the packets and bytes marked for the given reason
+  ReasonStats &rs = GetReasonStats (reason.id);
+  rs.nMarkedPackets++;
+  rs.nMarkedBytes += item->GetSize ();
 
   NS_LOG_DEBUG ("Total packets/bytes marked: "
                 << m_stats.nTotalMarkedPackets << " / "
                 << m_stats.nTotalMarkedBytes);
-  m_traceMark (item, reason);
+  m_traceMark (item, reason.name);
   return true;
 }
 
@@ -921,12 +1013,10 @@ QueueDisc::Dequeue (void)
     {
       item = DoDequeue ();
 
-      // (VCP): TODO check more info
-      if (item) {
-        VcpPacketTag vcpTag;
-        bool hasVcpTag = item->GetPacket()->PeekPacketTag(vcpTag);
-        NS_LOG_DEBUG("(VCP) hasVcpTag=" << hasVcpTag);
-      }
+      if (item)
+        {
+          NS_VCP_TRACE_TAG (item->GetPacket ());
+        }
     }
 
   NS_ASSERT (m_nPackets == m_stats.nTotalEnqueuedPackets - m_stats.nTotalDequeuedPackets);
@@ -1056,12 +1146,7 @@ QueueDisc::DequeuePacket ()
           // If the item is not null, add the header to the packet.
           if (item != 0)
             {
-              Ipv4Header ipHeader;
-              if (DynamicCast<Ipv4QueueDiscItem>(item)) {
-                ipHeader = DynamicCast<Ipv4QueueDiscItem>(item)->GetHeader();
-                NS_LOG_DEBUG("(VCP) ip header ecn=" << ipHeader.GetEcn()); // TODO: delete
-              }
-
+              NS_VCP_TRACE_ITEM_ECN (item);
               item->AddHeader ();
             }
           // Here, Linux tries bulk dequeues
@@ -168,6 +168,13 @@ enum QueueDiscSizePolicy
  * queue disc, the reason is "(Dropped by child queue disc) " followed by the
  * reason why the child queue disc dropped the packet.
  *
+ * The reasons are interned: each distinct string gets a small integer id,
+ * shared by all the queue discs, and the counters of a queue disc are kept in
+ * an array indexed by it. A queue disc remembers the id of each string that
+ * it was passed, by address, so that a drop only compares the string to the
+ * one it has already seen. The per-reason maps of the statistics are filled
+ * from the array by GetStats.
+ *
  * The QueueDisc base class provides the SojournTime trace source, which provides
  * the sojourn time of every packet dequeued from a queue disc, including packets
  * that are dropped or requeued after being dequeued. The sojourn time is taken
@@ -204,21 +211,21 @@ public:
     uint32_t nTotalDroppedPackets;
     /// Total packets dropped before enqueue
     uint32_t nTotalDroppedPacketsBeforeEnqueue;
-    /// Packets dropped before enqueue, for each reason
+    /// Packets dropped before enqueue, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint32_t> nDroppedPacketsBeforeEnqueue;
     /// Total packets dropped after dequeue
     uint32_t nTotalDroppedPacketsAfterDequeue;
-    /// Packets dropped after dequeue, for each reason
+    /// Packets dropped after dequeue, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint32_t> nDroppedPacketsAfterDequeue;
     /// Total dropped bytes
     uint64_t nTotalDroppedBytes;
     /// Total bytes dropped before enqueue
     uint64_t nTotalDroppedBytesBeforeEnqueue;
-    /// Bytes dropped before enqueue, for each reason
+    /// Bytes dropped before enqueue, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint64_t> nDroppedBytesBeforeEnqueue;
     /// Total bytes dropped after dequeue
     uint64_t nTotalDroppedBytesAfterDequeue;
-    /// Bytes dropped after dequeue, for each reason
+    /// Bytes dropped after dequeue, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint64_t> nDroppedBytesAfterDequeue;
     /// Total requeued packets
     uint32_t nTotalRequeuedPackets;
@@ -226,11 +233,11 @@ public:
     uint64_t nTotalRequeuedBytes;
     /// Total marked packets
     uint32_t nTotalMarkedPackets;
-    /// Marked packets, for each reason
+    /// Marked packets, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint32_t> nMarkedPackets;
     /// Total marked bytes
     uint32_t nTotalMarkedBytes;
-    /// Marked bytes, for each reason
+    /// Marked bytes, for each reason -- this value is not kept up to date, call GetStats first
     std::map<std::string, uint64_t> nMarkedBytes;
 
     /// constructor
@@ -273,6 +280,27 @@ public:
    */
   static TypeId GetTypeId (void);
 
+  /// Identifier of an interned reason to drop or mark packets
+  typedef uint32_t ReasonId;
+
+  /**
+   * \brief Get the identifier of a reason to drop or mark packets
+   *
+   * The reason is interned the first time it is seen: the identifiers are
+   * dense, starting from 0, and shared by all the queue discs.
+   *
+   * \param reason the reason
+   * \return the identifier of the reason
+   */
+  static ReasonId GetReasonId (const std::string &reason);
+
+  /**
+   * \brief Get the reason with the given identifier
+   * \param id the identifier returned by GetReasonId
+   * \return the reason
+   */
+  static const std::string & GetReasonName (ReasonId id);
+
   /**
    * \brief Constructor
    * \param policy the policy to handle the queue disc size
@@ -691,6 +719,77 @@ private:
    */
   void PacketDequeued (Ptr<const QueueDiscItem> item);
 
+  /// An interned reason to drop or mark packets
+  struct Reason
+  {
+    ReasonId id;      //!< Identifier of the reason
+    const char* name; //!< The interned string
+  };
+
+  /// A string passed as a reason, with the interned reason it stands for
+  struct ReasonEntry
+  {
+    const char* prefix;       //!< Prefix added to the string, or null
+    const char* string;       //!< Address of the string
+    std::size_t prefixLength; //!< Length of the prefix
+    Reason reason;            //!< The interned concatenation of prefix and string
+  };
+
+  /// Counters kept for each reason to drop or mark packets
+  struct ReasonStats
+  {
+    /// constructor
+    ReasonStats ();
+
+    uint32_t nDroppedPacketsBeforeEnqueue; //!< Packets dropped before enqueue
+    uint64_t nDroppedBytesBeforeEnqueue;   //!< Bytes dropped before enqueue
+    uint32_t nDroppedPacketsAfterDequeue;  //!< Packets dropped after dequeue
+    uint64_t nDroppedBytesAfterDequeue;    //!< Bytes dropped after dequeue
+    uint32_t nMarkedPackets;               //!< Marked packets
+    uint64_t nMarkedBytes;                 //!< Marked bytes
+  };
+
+  /**
+   * \brief Get the interned reason for the given string
+   *
+   * The string is looked up in m_reasons by address, and interned when it is
+   * not found or when the string at that address has changed.
+   *
+   * \param prefix the prefix of the reason, or null
+   * \param string the string passed by the caller
+   * \return the interned concatenation of prefix and string
+   */
+  Reason InternReason (const char* prefix, const char* string);
+
+  /**
+   * \brief Get the counters of the given reason
+   * \param id the identifier of the reason
+   * \return the counters
+   */
+  ReasonStats& GetReasonStats (ReasonId id);
+
+  /**
+   * \brief Record a packet dropped before enqueue for an interned reason
+   * \param item item that was dropped
+   * \param reason the reason why the item was dropped
+   */
+  void DropBeforeEnqueue (Ptr<const QueueDiscItem> item, Reason reason);
+
+  /**
+   * \brief Record a packet dropped after dequeue for an interned reason
+   * \param item item that was dropped
+   * \param reason the reason why the item was dropped
+   */
+  void DropAfterDequeue (Ptr<const QueueDiscItem> item, Reason reason);
+
+  /**
+   * \brief Mark a packet for an interned reason
+   * \param item item that has to be marked
+   * \param reason the reason why the item has to be marked
+   * \return true if the item was successfully marked, false otherwise
+   */
+  bool Mark (Ptr<QueueDiscItem> item, Reason reason);
+
   static const uint32_t DEFAULT_QUOTA = 64; //!< Default quota (as in /proc/sys/net/core/dev_weight)
 
   std::vector<Ptr<InternalQueue> > m_queues;    //!< Internal queues
@@ -709,8 +808,8 @@ private:
   bool m_running;                   //!< The queue disc is performing multiple dequeue operations
   Ptr<QueueDiscItem> m_requeued;    //!< The last packet that failed to be transmitted
   bool m_peeked;                    //!< A packet was dequeued because Peek was called
-  std::string m_childQueueDiscDropMsg;  //!< Reason why a packet was dropped by a child queue disc
-  std::string m_childQueueDiscMarkMsg;  //!< Reason why a packet was marked by a child queue disc
+  std::vector<ReasonEntry> m_reasons;     //!< The strings passed as reasons, with their interned reason
+  std::vector<ReasonStats> m_reasonStats; //!< Counters for each reason, indexed by ReasonId
   QueueDiscSizePolicy m_sizePolicy;     //!< The queue disc size policy
   bool m_prohibitChangeMode;            //!< True if changing mode is prohibited
 
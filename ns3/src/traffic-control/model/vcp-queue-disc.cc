@@ -1,6 +1,9 @@
+#include <algorithm>
+
 #include "vcp-queue-disc.h"
 #include "ns3/simulator.h"
 #include "ns3/vcp-packet-tag.h"
+#include "ns3/vcp-trace.h"
 #include "ns3/packet.h"
 #include "ns3/drop-tail-queue.h"
 #include "ns3/tcp-header.h"
@@ -48,6 +51,18 @@ TypeId VcpQueueDisc::GetTypeId (void)
                    DoubleValue(1.0),
                    MakeDoubleAccessor (&VcpQueueDisc::m_target_util),
                    MakeDoubleChecker<double> ()) 
+    .AddAttribute ("UseEcn",
+                   "Write the load bits directly into the ECN field of the "
+                   "IP header instead of a VcpPacketTag",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&VcpQueueDisc::m_useEcn),
+                   MakeBooleanChecker ())
+    .AddAttribute ("TimeWeightedQueue",
+                   "Use the exact time-weighted average queue size, updated on "
+                   "enqueue and dequeue, instead of sampling every SampleInterval",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&VcpQueueDisc::m_timeWeighted),
+                   MakeBooleanChecker ())
   ;
 
   return tid;
@@ -58,9 +73,7 @@ VcpQueueDisc::VcpQueueDisc () :
 {
   NS_LOG_FUNCTION (this);
   m_queue_size_sample_timer.SetFunction(&VcpQueueDisc::SampleQueueSize, this);
-  m_queue_size_sample_timer.Schedule(m_QueueSampleInterval);
   m_load_factor_timer.SetFunction(&VcpQueueDisc::CalcLoadFactor, this);
-  m_load_factor_timer.Schedule(m_timeInterval);
 }
 
 VcpQueueDisc::~VcpQueueDisc ()
@@ -74,6 +87,8 @@ void
 VcpQueueDisc::DoDispose (void)
 {
   NS_LOG_FUNCTION (this);
+  m_queue_size_sample_timer.Cancel();
+  m_load_factor_timer.Cancel();
   QueueDisc::DoDispose ();
 }
 
@@ -82,11 +97,20 @@ VcpQueueDisc::DoEnqueue (Ptr<QueueDiscItem> item)
 {
   NS_LOG_FUNCTION (this << item);
 
-  NS_LOG_DEBUG("(VCP) packet=" << item->GetPacket()->ToString());
-  NS_LOG_DEBUG("(VCP) VcpQueueDisc::this=" << this);
+  NS_VCP_TRACE ("packet=" << item->GetPacket ()->ToString ());
+
+  if (!m_timers_running)
+    {
+      ResumeTimers ();
+    }
 
   // add to recent arrivals counter
   m_recent_arrivals++;
+
+  if (m_timeWeighted)
+    {
+      UpdateQueueIntegral ();
+    }
   /*
   // Update vcp tag with worst load (highest load factor bits)
   VcpPacketTag vcpTag;
@@ -135,6 +159,11 @@ VcpQueueDisc::DoDequeue (void)
 {
   NS_LOG_FUNCTION (this);
 
+  if (m_timeWeighted)
+    {
+      UpdateQueueIntegral ();
+    }
+
   Ptr<QueueDiscItem> item = GetInternalQueue (0)->Dequeue ();
 
   if (!item)
@@ -142,6 +171,13 @@ VcpQueueDisc::DoDequeue (void)
       NS_LOG_LOGIC ("Queue empty");
       return 0;
     }
+
+  // Max-merge the load into the IP header kept by the item, no tag needed
+  if (m_useEcn)
+    {
+      item->MarkVcpLoad (LoadFactorToLoad (m_load_factor));
+      return item;
+    }
   
   // Update vcp tag with worst load (highest load factor bits)
   VcpPacketTag vcpTag;
@@ -176,64 +212,183 @@ VcpQueueDisc::InitializeParams (void)
   NS_LOG_FUNCTION (this);
   
   m_qsizes_sum = 0;
-  recent_queue_sizes.push(0); // add one initial queue size sample
+  m_sample_head = 0;
+  m_n_samples = 0;
+  m_queue_integral = 0.0;
+  m_last_queue_update = Simulator::Now ();
+  m_interval_start = Simulator::Now ();
+
+  // One slot per sample taken during an estimation interval
+  size_t capacity = std::max<int64_t> (1, m_timeInterval.GetMilliSeconds () /
+                                          m_QueueSampleInterval.GetMilliSeconds ());
+  m_queue_size_samples.assign (capacity, 0);
+  m_n_samples = 1; // add one initial queue size sample
+  m_sample_head = 1 % capacity;
+
+  // Timers are started by the first enqueue, so that queue discs on
+  // interfaces that never carry traffic do not schedule any event
+  m_timers_running = false;
+  m_next_sample_tick = Simulator::Now () + m_QueueSampleInterval;
+  m_next_load_tick = Simulator::Now () + m_timeInterval;
 }
 
 void
-VcpQueueDisc::SampleQueueSize()
+VcpQueueDisc::ResumeTimers()
 {
   NS_LOG_FUNCTION (this);
 
-  // NS_LOG_DEBUG("(VCP) this=" << this); // TODO: delete
+  Time now = Simulator::Now ();
 
-  if (recent_queue_sizes.size () >=
-          (size_t) (m_timeInterval.ToInteger(Time::Unit::MS) /
-          m_QueueSampleInterval.ToInteger(Time::Unit::MS)))
-  {
-    m_qsizes_sum -= recent_queue_sizes.front ();
-    recent_queue_sizes.pop ();
-  }
+  // Ticks due at the current time still run, after this packet
+  if (!m_timeWeighted)
+    {
+      if (m_next_sample_tick < now)
+        {
+          int64_t missed = (now - m_next_sample_tick - TimeStep (1)).GetTimeStep ()
+            / m_QueueSampleInterval.GetTimeStep () + 1;
+          if (missed >= (int64_t) m_queue_size_samples.size ())
+            {
+              std::fill (m_queue_size_samples.begin (), m_queue_size_samples.end (), 0);
+              m_n_samples = m_queue_size_samples.size ();
+              m_sample_head = 0;
+              m_qsizes_sum = 0;
+            }
+          else
+            {
+              for (int64_t i = 0; i < missed; i++)
+                {
+                  PushQueueSizeSample (0);
+                }
+            }
+          m_next_sample_tick += m_QueueSampleInterval * missed;
+        }
+      m_queue_size_sample_timer.Schedule (m_next_sample_tick - now);
+    }
 
-  uint32_t cur_size = GetCurrentSize ().GetValue ();
+  if (m_next_load_tick < now)
+    {
+      int64_t missed = (now - m_next_load_tick - TimeStep (1)).GetTimeStep ()
+        / m_timeInterval.GetTimeStep () + 1;
+      m_next_load_tick += m_timeInterval * missed;
+      m_load_factor = ComputeLoadFactor (0, 0, m_kq, m_target_util,
+                                         m_linkBandwidth, m_timeInterval);
+    }
+  m_queue_integral = 0.0;
+  m_last_queue_update = now;
+  m_interval_start = m_next_load_tick - m_timeInterval;
+  m_load_factor_timer.Schedule (m_next_load_tick - now);
 
-  // NS_LOG_DEBUG ("(VCP) Current queue size=" << cur_size);
-  
-  recent_queue_sizes.push (cur_size);
-  m_qsizes_sum += cur_size;
+  m_timers_running = true;
+}
 
-  m_queue_size_sample_timer.SetFunction(&VcpQueueDisc::SampleQueueSize, this);
-  m_queue_size_sample_timer.Cancel();
+void
+VcpQueueDisc::SampleQueueSize()
+{
+  NS_LOG_FUNCTION (this);
+
+  PushQueueSizeSample (GetCurrentSize ().GetValue ());
+
+  m_next_sample_tick = Simulator::Now () + m_QueueSampleInterval;
   m_queue_size_sample_timer.Schedule(m_QueueSampleInterval);
 }
 
+void
+VcpQueueDisc::PushQueueSizeSample(uint32_t size)
+{
+  // Overwrite the oldest sample once the ring buffer is full
+  if (m_n_samples == m_queue_size_samples.size ())
+    {
+      m_qsizes_sum -= m_queue_size_samples[m_sample_head];
+    }
+  else
+    {
+      m_n_samples++;
+    }
+  m_queue_size_samples[m_sample_head] = size;
+  m_qsizes_sum += size;
+  m_sample_head = (m_sample_head + 1) % m_queue_size_samples.size ();
+}
+
+void
+VcpQueueDisc::UpdateQueueIntegral()
+{
+  Time now = Simulator::Now ();
+  m_queue_integral += GetCurrentSize ().GetValue () * (now - m_last_queue_update).GetSeconds ();
+  m_last_queue_update = now;
+}
+
+double
+VcpQueueDisc::GetPersistentQueueSize()
+{
+  if (!m_timeWeighted)
+    {
+      return (double) m_qsizes_sum / m_n_samples;
+    }
+
+  UpdateQueueIntegral ();
+  double elapsed = (Simulator::Now () - m_interval_start).GetSeconds ();
+  double avg = elapsed > 0 ? m_queue_integral / elapsed : GetCurrentSize ().GetValue ();
+  m_queue_integral = 0.0;
+  m_interval_start = Simulator::Now ();
+  return avg;
+}
+
 void
 VcpQueueDisc::CalcLoadFactor()
 {
   NS_LOG_FUNCTION(this);
 
-  Time now = Simulator::Now();
+  double persist_q_size = GetPersistentQueueSize ();
 
-  double persist_q_size = (double) m_qsizes_sum / recent_queue_sizes.size ();
-
-  // Use naming convention from paper for clarity
   double lambda_l = m_recent_arrivals;
   m_recent_arrivals = 0;
-  double kappa_q = m_kq;
-  double q_tilde_l = persist_q_size;
-  double gamma_l = m_target_util;
-  double C_l = m_linkBandwidth.GetBitRate() / (1000. * 8.); // TODO: divide by 1000?
-  double t_rho = m_timeInterval.GetMilliSeconds() / 1000.;
-  m_load_factor = (lambda_l + kappa_q * q_tilde_l) / (gamma_l * C_l * t_rho);
-
-  // TODO: address this below
-  m_load_factor = m_load_factor * 1. + 0.0;
+  m_load_factor = ComputeLoadFactor (lambda_l, persist_q_size, m_kq,
+                                     m_target_util, m_linkBandwidth,
+                                     m_timeInterval);
 
   NS_LOG_DEBUG("lambda_l=" << lambda_l << ", m_load_factor=" << m_load_factor);
 
-  m_load_factor_timer.SetFunction(&VcpQueueDisc::CalcLoadFactor, this);
-  m_load_factor_timer.Cancel();
+  // Stop both timers after a whole idle interval, the next enqueue resumes them
+  if (lambda_l == 0 && m_load_factor == 0 && GetInternalQueue (0)->IsEmpty ()
+      && (m_timeWeighted || m_qsizes_sum == 0))
+    {
+      NS_LOG_LOGIC ("Idle, suspending timers");
+      m_queue_size_sample_timer.Cancel ();
+      m_timers_running = false;
+      m_next_load_tick = Simulator::Now () + m_timeInterval;
+      return;
+    }
+
+  m_next_load_tick = Simulator::Now () + m_timeInterval;
   m_load_factor_timer.Schedule(m_timeInterval);
 }
 
+double
+VcpQueueDisc::ComputeLoadFactor (double arrivals, double persistQueueSize,
+                                 double kq, double targetUtil,
+                                 DataRate linkBandwidth, Time interval)
+{
+  // Use naming convention from paper for clarity
+  double lambda_l = arrivals;
+  double kappa_q = kq;
+  double q_tilde_l = persistQueueSize;
+  double gamma_l = targetUtil;
+  double C_l = linkBandwidth.GetBitRate() / (1000. * 8.); // TODO: divide by 1000?
+  double t_rho = interval.GetMilliSeconds() / 1000.;
+
+  return (lambda_l + kappa_q * q_tilde_l) / (gamma_l * C_l * t_rho);
+}
+
+VcpPacketTag::LoadType
+VcpQueueDisc::LoadFactorToLoad (double loadFactor)
+{
+  if (loadFactor < .8) {
+    return VcpPacketTag::LOAD_LOW;
+  } else if (loadFactor < 1.) {
+    return VcpPacketTag::LOAD_HIGH;
+  }
+  return VcpPacketTag::LOAD_OVERLOAD;
+}
+
 } // namespace ns3
 
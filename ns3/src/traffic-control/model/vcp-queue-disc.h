@@ -6,8 +6,9 @@
 #include "ns3/boolean.h"
 #include "ns3/data-rate.h"
 #include "ns3/timer.h"
+#include "ns3/vcp-packet-tag.h"
 
-#include <queue>
+#include <vector>
 
 namespace ns3 {
 
@@ -38,6 +39,31 @@ public:
    */ 
   virtual ~VcpQueueDisc ();
 
+  /**
+   * \brief Compute the VCP load factor of a link
+   *
+   * Shared by the packet-level queue disc and the fluid model so that both
+   * use exactly the same estimator.
+   *
+   * \param arrivals number of packets that arrived during the interval
+   * \param persistQueueSize persistent (averaged) queue size in packets
+   * \param kq the K_q constant
+   * \param targetUtil the target utilization of the link
+   * \param linkBandwidth the link bandwidth
+   * \param interval the load factor estimation interval
+   * \return the load factor
+   */
+  static double ComputeLoadFactor (double arrivals, double persistQueueSize,
+                                   double kq, double targetUtil,
+                                   DataRate linkBandwidth, Time interval);
+
+  /**
+   * \brief Map a load factor onto the VCP load region it falls in
+   * \param loadFactor the load factor
+   * \return LOAD_LOW, LOAD_HIGH or LOAD_OVERLOAD
+   */
+  static VcpPacketTag::LoadType LoadFactorToLoad (double loadFactor);
+
 protected:
   /**
    * \brief Dispose of the object
@@ -59,6 +85,35 @@ private:
 
   void SampleQueueSize();
 
+  /**
+   * \brief Add a queue size sample to the ring buffer
+   * \param size the queue size in packets
+   */
+  void PushQueueSizeSample(uint32_t size);
+
+  /**
+   * \brief Restart the timers on the first enqueue after an idle period
+   *
+   * The samples and load factors that would have been computed while idle are
+   * all zero, so they are filled in here and the timers are rescheduled on
+   * the same time grid as if they had never been stopped.
+   */
+  void ResumeTimers();
+
+  /**
+   * \brief Accumulate the queue size integral up to now
+   *
+   * Called before every change of the queue size when TimeWeightedQueue is
+   * set, so that the integral is exact without periodic sampling.
+   */
+  void UpdateQueueIntegral();
+
+  /**
+   * \brief Persistent queue size over the last estimation interval
+   * \return the average queue size in packets
+   */
+  double GetPersistentQueueSize();
+
   void CalcLoadFactor();
 
   // ** Variables supplied by user
@@ -67,10 +122,20 @@ private:
   Time m_QueueSampleInterval {Time(10000000)}; //!< Interval at which to sample queue size
   double m_kq {0.5};              //!< K_q constant used while calculating VCP load factor
   double m_target_util {0.98};     //!< Target utilization of link capacity (set close to 1)
+  bool m_useEcn {false};          //!< Carry the load bits in the IP ECN field instead of a VcpPacketTag
+  bool m_timeWeighted {false};    //!< Average the queue size over time instead of sampling it
 
   // ** Variables maintained by RED
   uint32_t m_qsizes_sum {0};            //!< Sum of queue sizes queue
-  std::queue<uint32_t> recent_queue_sizes; //!< recent samples of queue size
+  std::vector<uint32_t> m_queue_size_samples; //!< ring buffer of recent samples of queue size
+  size_t m_sample_head {0};             //!< next slot to write in the ring buffer
+  size_t m_n_samples {0};               //!< number of valid samples in the ring buffer
+  double m_queue_integral {0.0};        //!< integral of the queue size (packets * s) over the current interval
+  Time m_last_queue_update;             //!< time up to which m_queue_integral is accumulated
+  Time m_interval_start;                //!< start of the current estimation interval
+  bool m_timers_running {false};        //!< whether the sample and load factor timers are running
+  Time m_next_sample_tick;              //!< time of the next queue size sample
+  Time m_next_load_tick;                //!< time of the next load factor computation
   size_t m_recent_arrivals {0}; //!< number of packet arrivals during current time interval
   double m_load_factor {0.0}; //!< current load factor for most recent time interval
   Timer m_queue_size_sample_timer; //!< time interval for sampling queue size
@@ -555,6 +555,34 @@ QueueDiscTracesTestCase::DoRun (void)
   CheckDroppedBeforeEnqueue (child, 1, pktSizeUnit * 5);
   CheckDroppedAfterDequeue (child, 2, pktSizeUnit * 3);
 
+  // The drops are also counted for each reason; the root queue disc prefixes
+  // the reasons of its child
+  QueueDisc::Stats stats = child->GetStats ();
+
+  NS_TEST_EXPECT_MSG_EQ (stats.GetNDroppedPackets (TestChildQueueDisc::BEFORE_ENQUEUE), 1,
+                         "Verify that the packets dropped before enqueue are counted for their reason");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetNDroppedBytes (TestChildQueueDisc::BEFORE_ENQUEUE), pktSizeUnit * 5,
+                         "Verify that the bytes dropped before enqueue are counted for their reason");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetNDroppedPackets (TestChildQueueDisc::AFTER_DEQUEUE), 2,
+                         "Verify that the packets dropped after dequeue are counted for their reason");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetNDroppedBytes (TestChildQueueDisc::AFTER_DEQUEUE), pktSizeUnit * 3,
+                         "Verify that the bytes dropped after dequeue are counted for their reason");
+
+  stats = root->GetStats ();
+
+  NS_TEST_EXPECT_MSG_EQ (stats.GetNDroppedPackets (TestChildQueueDisc::BEFORE_ENQUEUE), 0,
+                         "Verify that the reasons of the child queue disc are prefixed");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetNDroppedPackets (std::string (QueueDisc::CHILD_QUEUE_DISC_DROP)
+                                                   + TestChildQueueDisc::BEFORE_ENQUEUE), 1,
+                         "Verify that the packets dropped by the child are counted for their reason");
+  NS_TEST_EXPECT_MSG_EQ (stats.GetNDroppedBytes (std::string (QueueDisc::CHILD_QUEUE_DISC_DROP)
+                                                 + TestChildQueueDisc::AFTER_DEQUEUE), pktSizeUnit * 3,
+                         "Verify that the bytes dropped by the child are counted for their reason");
+  NS_TEST_EXPECT_MSG_EQ (stats.nDroppedPacketsBeforeEnqueue.size (), 1,
+                         "Verify that only one reason to drop before enqueue was recorded");
+  NS_TEST_EXPECT_MSG_EQ (stats.nDroppedPacketsAfterDequeue.size (), 1,
+                         "Verify that only one reason to drop after dequeue was recorded");
+
   Simulator::Destroy ();
 }
 
@@ -0,0 +1,196 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program benchmarks the Ipv4EndPointDemux of a server.  The server
+// listens on a port and holds the endpoints of its connections, one per
+// client, as a TCP server does after accepting them; it also has a few
+// UDP sockets.  The program looks up the endpoints of the segments of
+// random connections, and of the connection requests of new clients, and
+// then closes and reopens connections.  It reports the time and the heap
+// allocations per operation.
+// Sample usage:  ./waf --run 'bench-end-point-demux --endPoints=50000 --n=1000000'
+
+#include "ns3/command-line.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/simulator.h"
+#include "ns3/simple-net-device.h"
+#include "ns3/ipv4-interface.h"
+#include "ns3/ipv4-interface-address.h"
+#include "ns3/ipv4-end-point.h"
+#include "ns3/ipv4-end-point-demux.h"
+#include "ns3/random-variable-stream.h"
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+/// Number of calls to malloc, counted only where it can be interposed
+static uint64_t g_nAllocations = 0;
+
+#ifdef __GLIBC__
+// The containers of the demux end up in malloc
+extern "C" void *__libc_malloc (std::size_t size);
+
+extern "C" void *
+malloc (std::size_t size)
+{
+  g_nAllocations++;
+  return __libc_malloc (size);
+}
+#endif
+
+/// Port of the server
+static const uint16_t SERVER_PORT = 80;
+
+/**
+ * Get the address of a client.
+ *
+ * \param i index of the client
+ * \returns the address
+ */
+static Ipv4Address
+GetClientAddress (uint32_t i)
+{
+  return Ipv4Address (0x0b000000 + i / 16);
+}
+
+/**
+ * Get the port of a client.
+ *
+ * \param i index of the client
+ * \returns the port
+ */
+static uint16_t
+GetClientPort (uint32_t i)
+{
+  return 49152 + i % 16;
+}
+
+/**
+ * Print the results of a phase.
+ *
+ * \param what the operation
+ * \param n number of operations
+ * \param ms duration in ms
+ * \param allocations number of allocations
+ */
+static void
+Report (std::string what, uint32_t n, uint64_t ms, uint64_t allocations)
+{
+  std::cout << what << ": "
+            << (ms * 1000000.0) / n << " ns, "
+            << (double) allocations / n << " allocations" << std::endl;
+}
+
+/**
+ * Run the lookups and print the results.
+ *
+ * \param nEndPoints number of connections of the server
+ * \param n number of lookups
+ */
+static void
+BenchDemux (uint32_t nEndPoints, uint32_t n)
+{
+  Ipv4Address server ("10.0.0.1");
+  Ptr<Ipv4Interface> interface = CreateObject<Ipv4Interface> ();
+  interface->SetDevice (CreateObject<SimpleNetDevice> ());
+  interface->AddAddress (Ipv4InterfaceAddress (server, Ipv4Mask ("255.0.0.0")));
+
+  Ipv4EndPointDemux demux;
+  demux.Allocate (0, SERVER_PORT); // the listening socket
+  for (uint16_t port = 5000; port < 5010; port++)
+    {
+      demux.Allocate (0, port); // the UDP sockets
+    }
+  SystemWallClockMs clock;
+  uint64_t allocations = g_nAllocations;
+  clock.Start ();
+  std::vector<Ipv4EndPoint *> endPoints (nEndPoints);
+  for (uint32_t i = 0; i < nEndPoints; i++)
+    {
+      endPoints[i] = demux.Allocate (0, server, SERVER_PORT, GetClientAddress (i), GetClientPort (i));
+    }
+  Report ("accept", nEndPoints, clock.End (), g_nAllocations - allocations);
+
+  Ptr<UniformRandomVariable> random = CreateObject<UniformRandomVariable> ();
+  std::vector<uint32_t> clients (n);
+  for (uint32_t i = 0; i < n; i++)
+    {
+      clients[i] = random->GetInteger (0, nEndPoints - 1);
+    }
+
+  uint32_t found = 0;
+  allocations = g_nAllocations;
+  clock.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint32_t c = clients[i];
+      found += demux.Lookup (server, SERVER_PORT, GetClientAddress (c), GetClientPort (c), interface).size ();
+    }
+  Report ("lookup of a connection", n, clock.End (), g_nAllocations - allocations);
+
+  allocations = g_nAllocations;
+  clock.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint32_t c = nEndPoints + clients[i];
+      found += demux.Lookup (server, SERVER_PORT, GetClientAddress (c), GetClientPort (c), interface).size ();
+    }
+  Report ("lookup of a new client", n, clock.End (), g_nAllocations - allocations);
+
+  uint32_t nChurn = std::min (n, nEndPoints);
+  allocations = g_nAllocations;
+  clock.Start ();
+  for (uint32_t i = 0; i < nChurn; i++)
+    {
+      uint32_t c = clients[i];
+      demux.DeAllocate (endPoints[c]);
+      endPoints[c] = demux.Allocate (0, server, SERVER_PORT, GetClientAddress (c), GetClientPort (c));
+    }
+  Report ("close and accept", nChurn, clock.End (), g_nAllocations - allocations);
+
+  std::cout << nEndPoints << " connections, "
+            << found << " endpoints found in " << 2 * n << " lookups" << std::endl;
+  Simulator::Stop ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t nEndPoints = 50000;
+  uint32_t n = 1000000;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("endPoints", "number of connections of the server", nEndPoints);
+  cmd.AddValue ("n", "number of lookups", n);
+  cmd.Parse (argc, argv);
+
+  if (nEndPoints == 0 || n == 0)
+    {
+      std::cerr << "endPoints and n must be positive" << std::endl;
+      return 1;
+    }
+
+  // Run in an event, as the sockets do: Time objects created before the
+  // simulation starts are recorded for a change of resolution
+  Simulator::ScheduleNow (&BenchDemux, nEndPoints, n);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,179 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program benchmarks the bookkeeping of a FlowMonitor with many
+// flows: every packet is classified by an Ipv4FlowClassifier, and its
+// transmission, forwarding and reception are reported to the monitor
+// while a few packets of every flow are in flight, and optionally some
+// packets are lost without a drop report. It reports the time
+// and the heap allocations per packet, and the heap memory held by the
+// monitor and the classifier at the end.
+// Sample usage:  ./waf --run 'bench-flow-monitor --flows=10000 --n=1000000'
+
+#include "ns3/command-line.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/flow-monitor.h"
+#include "ns3/flow-probe.h"
+#include "ns3/ipv4-flow-classifier.h"
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+using namespace ns3;
+
+/// Number of calls to malloc, counted only where it can be interposed
+static uint64_t g_nAllocations = 0;
+
+#ifdef __GLIBC__
+// The map and vector nodes of the monitor end up in malloc
+extern "C" void *__libc_malloc (std::size_t size);
+
+extern "C" void *
+malloc (std::size_t size)
+{
+  g_nAllocations++;
+  return __libc_malloc (size);
+}
+#endif
+
+/**
+ * \returns the bytes of heap memory in use, or 0 where it is not known
+ */
+static uint64_t
+GetHeapInUse (void)
+{
+#ifdef __GLIBC__
+  return mallinfo2 ().uordblks;
+#else
+  return 0;
+#endif
+}
+
+/// A FlowProbe that is not attached to any node
+class BenchFlowProbe : public FlowProbe
+{
+public:
+  /**
+   * Constructor
+   * \param monitor the FlowMonitor to report to
+   */
+  BenchFlowProbe (Ptr<FlowMonitor> monitor)
+    : FlowProbe (monitor)
+  {
+  }
+};
+
+/**
+ * Report n packets to a FlowMonitor and print the results.
+ *
+ * \param n number of packets
+ * \param nFlows number of flows
+ * \param inFlight number of packets in flight per flow
+ * \param lossEvery one packet in lossEvery is lost, none if 0
+ */
+static void
+BenchReports (uint32_t n, uint32_t nFlows, uint32_t inFlight, uint32_t lossEvery)
+{
+  // The headers and the payloads carrying the ports of the flows
+  std::vector<Ipv4Header> headers (nFlows);
+  std::vector<Ptr<Packet> > payloads (nFlows);
+  for (uint32_t i = 0; i < nFlows; i++)
+    {
+      headers[i].SetSource (Ipv4Address (0x0a000000 + i / 100));
+      headers[i].SetDestination (Ipv4Address (0x0b000000 + i % 100));
+      headers[i].SetProtocol (6);
+      uint8_t ports[4] = { uint8_t (i >> 8), uint8_t (i), 0x13, 0x89 };
+      payloads[i] = Create<Packet> (ports, sizeof (ports));
+    }
+  // The packets in flight, as (flow index, FlowId, FlowPacketId)
+  struct InFlight
+  {
+    uint32_t flow;
+    FlowId flowId;
+    FlowPacketId packetId;
+  };
+  std::vector<InFlight> inFlightPackets (nFlows * inFlight);
+
+  uint64_t heap = GetHeapInUse ();
+  Ptr<FlowMonitor> monitor = CreateObject<FlowMonitor> ();
+  Ptr<Ipv4FlowClassifier> classifier = Create<Ipv4FlowClassifier> ();
+  monitor->AddFlowClassifier (classifier);
+  Ptr<FlowProbe> source = CreateObject<BenchFlowProbe> (monitor);
+  Ptr<FlowProbe> router = CreateObject<BenchFlowProbe> (monitor);
+  Ptr<FlowProbe> sink = CreateObject<BenchFlowProbe> (monitor);
+  monitor->StartRightNow ();
+
+  uint64_t allocations = g_nAllocations;
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      InFlight &packet = inFlightPackets[i % inFlightPackets.size ()];
+      if (i >= inFlightPackets.size () && (lossEvery == 0 || i % lossEvery != 0))
+        {
+          // the packet sent inFlight rounds of the flows ago arrives
+          monitor->ReportForwarding (router, packet.flowId, packet.packetId, 1000);
+          monitor->ReportLastRx (sink, packet.flowId, packet.packetId, 1000);
+        }
+      packet.flow = i % nFlows;
+      classifier->Classify (headers[packet.flow], payloads[packet.flow], &packet.flowId, &packet.packetId);
+      monitor->ReportFirstTx (source, packet.flowId, packet.packetId, 1000);
+    }
+  uint64_t ms = clock.End ();
+  allocations = g_nAllocations - allocations;
+  heap = GetHeapInUse () - heap;
+
+  std::cout << nFlows << " flows, " << inFlight << " packets in flight per flow, "
+            << "1 in " << lossEvery << " lost" << std::endl
+            << (ms * 1000000.0) / n << " ns/packet, "
+            << (double) allocations / n << " allocations/packet" << std::endl
+            << heap << " bytes of heap in use, "
+            << (double) heap / nFlows << " bytes/flow" << std::endl;
+
+  monitor->Dispose ();
+  Simulator::Stop ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t n = 1000000;
+  uint32_t nFlows = 10000;
+  uint32_t inFlight = 4;
+  uint32_t lossEvery = 0;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("n", "number of packets", n);
+  cmd.AddValue ("flows", "number of flows", nFlows);
+  cmd.AddValue ("inFlight", "number of packets in flight per flow", inFlight);
+  cmd.AddValue ("lossEvery", "lose one packet in this many, without a drop report (0 for none)", lossEvery);
+  cmd.Parse (argc, argv);
+
+  // Run in an event, as the probes do: Time objects created before the
+  // simulation starts are recorded for a change of resolution
+  Simulator::ScheduleNow (&BenchReports, n, nFlows, inFlight, lossEvery);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return 0;
+}
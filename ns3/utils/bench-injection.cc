@@ -0,0 +1,132 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program benchmarks the injection of events from other threads
+// into the DefaultSimulatorImpl: 1, 2, 4, ... threads each schedule n
+// events with ScheduleWithContext while the simulation runs, and it
+// reports the time until all of them ran and the injected events/s,
+// in total and per thread.
+// Sample usage:  ./waf --run 'bench-injection --n=1000000 --maxThreads=8'
+
+#include "ns3/command-line.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/system-thread.h"
+#include "ns3/simulator.h"
+#include "ns3/nstime.h"
+#include "ns3/global-value.h"
+#include "ns3/string.h"
+#include <iostream>
+#include <list>
+
+using namespace ns3;
+
+/// Number of events to run
+static uint64_t g_expected = 0;
+/// Number of injected events run
+static uint64_t g_received = 0;
+/// Number of events injected by each thread
+static uint32_t g_n = 0;
+
+/// Run an injected event
+static void
+Receive (void)
+{
+  g_received++;
+}
+
+/// Keep the simulation running until all the injected events ran
+static void
+KeepAlive (void)
+{
+  if (g_received < g_expected)
+    {
+      Simulator::Schedule (MicroSeconds (1), &KeepAlive);
+    }
+}
+
+/**
+ * Inject the events of a thread.
+ *
+ * \param threadno the context of the events
+ */
+static void
+InjectingThread (uint32_t threadno)
+{
+  for (uint32_t i = 0; i < g_n; i++)
+    {
+      Simulator::ScheduleWithContext (threadno, Seconds (0), &Receive);
+    }
+}
+
+/**
+ * Inject n events from each of a number of threads and print the results.
+ *
+ * \param nThreads number of injecting threads
+ */
+static void
+BenchInjection (uint32_t nThreads)
+{
+  g_expected = (uint64_t) nThreads * g_n;
+  g_received = 0;
+
+  std::list<Ptr<SystemThread> > threads;
+  for (uint32_t i = 0; i < nThreads; i++)
+    {
+      threads.push_back (Create<SystemThread> (MakeBoundCallback (&InjectingThread, i)));
+    }
+  Simulator::Schedule (MicroSeconds (1), &KeepAlive);
+
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (std::list<Ptr<SystemThread> >::iterator it = threads.begin (); it != threads.end (); ++it)
+    {
+      (*it)->Start ();
+    }
+  Simulator::Run ();
+  uint64_t ms = clock.End ();
+  for (std::list<Ptr<SystemThread> >::iterator it = threads.begin (); it != threads.end (); ++it)
+    {
+      (*it)->Join ();
+    }
+  Simulator::Destroy ();
+
+  double rate = ms > 0 ? g_received / (ms / 1000.0) : 0;
+  std::cout << nThreads << " threads: " << g_received << " events in " << ms << " ms, "
+            << rate / 1e6 << " million events/s, "
+            << rate / nThreads / 1e6 << " million events/s per thread" << std::endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t n = 1000000;
+  uint32_t maxThreads = 8;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("n", "number of events injected by each thread", n);
+  cmd.AddValue ("maxThreads", "largest number of injecting threads", maxThreads);
+  cmd.Parse (argc, argv);
+
+  GlobalValue::Bind ("SimulatorImplementationType", StringValue ("ns3::DefaultSimulatorImpl"));
+  g_n = n;
+  for (uint32_t nThreads = 1; nThreads <= maxThreads; nThreads *= 2)
+    {
+      BenchInjection (nThreads);
+    }
+  return 0;
+}
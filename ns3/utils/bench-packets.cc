@@ -21,11 +21,21 @@
 // This program can be used to benchmark packet serialization/deserialization
 // operations using Headers and Tags, for various numbers of packets 'n'
 // Sample usage:  ./waf --run 'bench-packets --n=10000'
+//
+// Packet metadata is not recorded unless --enable-printing or
+// --enable-checking is given; comparing the runs with and without them
+// shows the cost of the metadata.
 
 #include "ns3/command-line.h"
 #include "ns3/system-wall-clock-ms.h"
 #include "ns3/packet.h"
 #include "ns3/packet-metadata.h"
+#ifdef BENCH_TCP_SEGMENTS
+#include "ns3/tcp-header.h"
+#include "ns3/tcp-option-ts.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ppp-header.h"
+#endif
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -35,6 +45,21 @@
 
 using namespace ns3;
 
+/// Number of calls to malloc, counted only where it can be interposed
+static uint64_t g_nAllocations = 0;
+
+#ifdef __GLIBC__
+// Packets, buffers and tags allocated with operator new end up in malloc
+extern "C" void *__libc_malloc (std::size_t size);
+
+extern "C" void *
+malloc (std::size_t size)
+{
+  g_nAllocations++;
+  return __libc_malloc (size);
+}
+#endif
+
 /// BenchHeader class used for benchmarking packet serialization/deserialization
 template <int N>
 class BenchHeader : public Header
@@ -328,6 +353,77 @@ benchByteTags (uint32_t n)
     }
 }
 
+static void
+benchPacketTags (uint32_t n)
+{
+  // Sizes of SocketIpTosTag and Ipv4PacketInfoTag
+  BenchTag<1> tos;
+  BenchTag<9> info;
+
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<Packet> p = Create<Packet> (2000);
+      p->AddPacketTag (tos);
+      p->AddPacketTag (info);
+      Ptr<Packet> o = p->Copy ();
+      o->ReplacePacketTag (info);
+      o->RemovePacketTag (tos);
+      p->RemovePacketTag (info);
+      p->RemovePacketTag (tos);
+    }
+}
+
+#ifdef BENCH_TCP_SEGMENTS
+static void
+benchTcpSegments (uint32_t n)
+{
+  // What TcpSocketBase::SendDataPacket, TcpL4Protocol, Ipv4L3Protocol and
+  // PointToPointNetDevice do to every segment of a bulk flow
+  Ptr<Packet> txBuffer = Create<Packet> (1448 * 64);
+  Ipv4Address source ("10.1.1.1");
+  Ipv4Address destination ("10.1.2.1");
+
+  // The socket keeps the header of its data segments as a template
+  TcpHeader header;
+  header.SetSourcePort (49153);
+  header.SetDestinationPort (5001);
+  Ptr<TcpOptionTS> ts = CreateObject<TcpOptionTS> ();
+  header.AppendOption (ts);
+
+  for (uint32_t i = 0; i < n; i++)
+    {
+      uint32_t seq = 1 + (i % 64) * 1448;
+      Ptr<Packet> p = txBuffer->CreateFragment (seq - 1, 1448);
+
+      ts->SetTimestamp (i);
+      ts->SetEcho (i - 1);
+      header.SetFlags (TcpHeader::ACK);
+      header.SetSequenceNumber (SequenceNumber32 (seq));
+      header.SetAckNumber (SequenceNumber32 (1));
+      header.SetWindowSize (65535);
+
+      TcpHeader outgoingHeader = header;
+      outgoingHeader.InitializeChecksum (source, destination, 6);
+      p->AddHeader (outgoingHeader);
+
+      Ipv4Header ipHeader;
+      ipHeader.SetSource (source);
+      ipHeader.SetDestination (destination);
+      ipHeader.SetProtocol (6);
+      ipHeader.SetPayloadSize (p->GetSize ());
+      ipHeader.SetTtl (64);
+      ipHeader.SetTos (0);
+      ipHeader.SetDontFragment ();
+      ipHeader.SetIdentification (i);
+      p->AddHeader (ipHeader);
+
+      PppHeader ppp;
+      ppp.SetProtocol (0x0021);
+      p->AddHeader (ppp);
+    }
+}
+#endif
+
 static uint64_t
 runBenchOneIteration (void (*bench) (uint32_t), uint32_t n)
 {
@@ -343,6 +439,7 @@ static void
 runBench (void (*bench) (uint32_t), uint32_t n, uint32_t minIterations, char const *name)
 {
   uint64_t minDelay = std::numeric_limits<uint64_t>::max();
+  uint64_t allocations = g_nAllocations;
   for (uint32_t i = 0; i < minIterations; i++)
     {
       uint64_t delay = runBenchOneIteration(bench, n);
@@ -351,8 +448,11 @@ runBench (void (*bench) (uint32_t), uint32_t n, uint32_t minIterations, char con
   double ps = n;
   ps *= 1000;
   ps /= minDelay;
+  double perPacket = g_nAllocations - allocations;
+  perPacket /= static_cast<double> (n) * minIterations;
   std::cout << ps << " packets/s"
-            << " (" << minDelay << " ms elapsed)\t"
+            << " (" << minDelay << " ms elapsed, "
+            << perPacket << " allocations/packet)\t"
             << name
             << std::endl;
 }
@@ -362,12 +462,14 @@ int main (int argc, char *argv[])
   uint32_t n = 0;
   uint32_t minIterations = 1;
   bool enablePrinting = false;
+  bool enableChecking = false;
 
   CommandLine cmd (__FILE__);
   cmd.Usage ("Benchmark Packet class");
   cmd.AddValue ("n", "number of iterations", n);
   cmd.AddValue ("min-iterations", "number of subiterations to minimize iteration time over", minIterations);
   cmd.AddValue ("enable-printing", "enable packet printing", enablePrinting);
+  cmd.AddValue ("enable-checking", "enable packet printing and checking", enableChecking);
   cmd.Parse (argc, argv);
 
   if (n == 0)
@@ -376,7 +478,19 @@ int main (int argc, char *argv[])
         "by command-line argument --n=(number of packets)" << std::endl;
       exit (1);
     }
+  if (enablePrinting)
+    {
+      Packet::EnablePrinting ();
+    }
+  if (enableChecking)
+    {
+      Packet::EnableChecking ();
+    }
+
   std::cout << "Running bench-packets with n=" << n << std::endl;
+  std::cout << "Packet metadata is "
+            << (PacketMetadata::IsEnabled () ? "enabled" : "disabled")
+            << "." << std::endl;
   std::cout << "All tests begin by adding UDP and IPv4 headers." << std::endl;
 
   runBench (&benchA, n, minIterations, "Copy packet, remove headers");
@@ -385,6 +499,10 @@ int main (int argc, char *argv[])
   runBench (&benchD, n, minIterations, "Intermixed add/remove headers and tags");
   runBench (&benchFragment, n, minIterations, "Fragmentation and concatenation");
   runBench (&benchByteTags, n, minIterations, "Benchmark byte tags");
+  runBench (&benchPacketTags, n, minIterations, "Add/remove small packet tags");
+#ifdef BENCH_TCP_SEGMENTS
+  runBench (&benchTcpSegments, n, minIterations, "Build TCP/IPv4/PPP data segments");
+#endif
 
   return 0;
 }
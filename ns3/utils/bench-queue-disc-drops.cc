@@ -0,0 +1,148 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program benchmarks the cost of a drop storm in a queue disc, as in
+// the overload phases of VCP: it fills a FifoQueueDisc, a VcpQueueDisc and
+// a PrioQueueDisc (whose drops are made by a child FifoQueueDisc) up to
+// their limit, then offers them n more packets, which are all dropped
+// before enqueue.  It reports the time and the heap allocations per drop,
+// and checks the statistics kept for the reason of the drops.
+// Sample usage:  ./waf --run 'bench-queue-disc-drops --n=1000000'
+
+#include "ns3/command-line.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/queue-size.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/fifo-queue-disc.h"
+#include "ns3/prio-queue-disc.h"
+#include "ns3/vcp-queue-disc.h"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace ns3;
+
+/// Number of calls to malloc, counted only where it can be interposed
+static uint64_t g_nAllocations = 0;
+
+#ifdef __GLIBC__
+// The per-reason statistics of the queue discs end up in malloc
+extern "C" void *__libc_malloc (std::size_t size);
+
+extern "C" void *
+malloc (std::size_t size)
+{
+  g_nAllocations++;
+  return __libc_malloc (size);
+}
+#endif
+
+/**
+ * Fill a queue disc, offer it n packets to drop and print the results.
+ *
+ * \param name name of the queue disc
+ * \param qdisc the queue disc
+ * \param reason the reason why the queue disc drops the packets
+ * \param n number of packets to drop
+ */
+static void
+BenchDrops (std::string name, Ptr<QueueDisc> qdisc, std::string reason, uint32_t n)
+{
+  qdisc->Initialize ();
+
+  Ipv4Header ipHeader;
+  ipHeader.SetProtocol (6);
+  ipHeader.SetPayloadSize (1000);
+
+  // Fill the queue disc: the first packet dropped tells that it is full
+  uint32_t nQueued = 0;
+  while (qdisc->Enqueue (Create<Ipv4QueueDiscItem> (Create<Packet> (1000), Address (), 0x0800, ipHeader)))
+    {
+      nQueued++;
+    }
+  uint32_t nDropped = qdisc->GetStats ().nTotalDroppedPackets;
+
+  // The dropped packets are not kept: offer the same one again and again
+  Ptr<Ipv4QueueDiscItem> item = Create<Ipv4QueueDiscItem> (Create<Packet> (1000), Address (), 0x0800, ipHeader);
+  uint64_t allocations = g_nAllocations;
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      qdisc->Enqueue (item);
+    }
+  uint64_t ms = clock.End ();
+  allocations = g_nAllocations - allocations;
+
+  const QueueDisc::Stats &stats = qdisc->GetStats ();
+  std::cout << name << ": "
+            << (ms * 1000000.0) / n << " ns/drop, "
+            << (double) allocations / n << " allocations/drop, "
+            << nQueued << " packets queued, "
+            << stats.nTotalDroppedPackets - nDropped << " dropped, "
+            << stats.GetNDroppedPackets (reason) << " for \"" << reason << "\"" << std::endl;
+
+  qdisc->Dispose ();
+}
+
+/**
+ * Run the drop storms.
+ *
+ * \param n number of packets to drop
+ */
+static void
+BenchAll (uint32_t n)
+{
+  Ptr<FifoQueueDisc> fifo = CreateObject<FifoQueueDisc> ();
+  fifo->SetAttribute ("MaxSize", QueueSizeValue (QueueSize ("100p")));
+  BenchDrops ("fifo", fifo, FifoQueueDisc::LIMIT_EXCEEDED_DROP, n);
+
+  Ptr<VcpQueueDisc> vcp = CreateObject<VcpQueueDisc> ();
+  vcp->SetAttribute ("MaxSize", QueueSizeValue (QueueSize ("100p")));
+  BenchDrops ("vcp", vcp, VcpQueueDisc::LIMIT_EXCEEDED_DROP, n);
+
+  BenchDrops ("prio", CreateObject<PrioQueueDisc> (),
+              std::string (QueueDisc::CHILD_QUEUE_DISC_DROP) + FifoQueueDisc::LIMIT_EXCEEDED_DROP, n);
+
+  Simulator::Stop ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t n = 1000000;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("n", "number of packets to drop", n);
+  cmd.Parse (argc, argv);
+
+  if (n == 0)
+    {
+      std::cerr << "n must be positive" << std::endl;
+      return 1;
+    }
+
+  // Run in an event: the VcpQueueDisc starts its timers on the first enqueue
+  Simulator::ScheduleNow (&BenchAll, n);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return 0;
+}
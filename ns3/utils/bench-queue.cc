@@ -0,0 +1,114 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program benchmarks the packet queues: it enqueues and dequeues n
+// packets in a DropTailQueue, which keeps its packets in a list, and in a
+// RingQueue, holding a number of packets in the queue, and reports the
+// time, the rate and the heap allocations per packet.
+// Sample usage:  ./waf --run 'bench-queue --n=10000000 --depth=1'
+
+#include "ns3/command-line.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/object-factory.h"
+#include "ns3/queue.h"
+#include "ns3/packet.h"
+#include "ns3/string.h"
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+/// Number of calls to malloc, counted only where it can be interposed
+static uint64_t g_nAllocations = 0;
+
+#ifdef __GLIBC__
+// The list nodes of the queues end up in malloc
+extern "C" void *__libc_malloc (std::size_t size);
+
+extern "C" void *
+malloc (std::size_t size)
+{
+  g_nAllocations++;
+  return __libc_malloc (size);
+}
+#endif
+
+/**
+ * Enqueue and dequeue n packets and print the results.
+ *
+ * \param typeId the TypeId of the queue
+ * \param n number of packets
+ * \param depth number of packets in the queue
+ */
+static void
+BenchQueue (std::string typeId, uint32_t n, uint32_t depth)
+{
+  ObjectFactory factory;
+  factory.SetTypeId (typeId);
+  factory.Set ("MaxSize", StringValue (std::to_string (depth) + "p"));
+  Ptr<Queue<Packet> > queue = factory.Create<Queue<Packet> > ();
+
+  std::vector<Ptr<Packet> > packets (depth);
+  for (uint32_t i = 0; i < depth; i++)
+    {
+      packets[i] = Create<Packet> (1000);
+    }
+  for (uint32_t i = 0; i + 1 < depth; i++)
+    {
+      queue->Enqueue (packets[i]);
+    }
+
+  uint64_t allocations = g_nAllocations;
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      queue->Enqueue (packets[(i + depth - 1) % depth]);
+      queue->Dequeue ();
+    }
+  uint64_t ms = clock.End ();
+  allocations = g_nAllocations - allocations;
+
+  std::cout << typeId << ", " << depth << " packets in the queue: "
+            << (ms * 1000000.0) / n << " ns/packet, "
+            << (ms > 0 ? n / (ms * 1000.0) : 0) << " Mpps, "
+            << (double) allocations / n << " allocations/packet" << std::endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t n = 10000000;
+  uint32_t depth = 1;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("n", "number of packets", n);
+  cmd.AddValue ("depth", "number of packets in the queue", depth);
+  cmd.Parse (argc, argv);
+
+  if (depth == 0)
+    {
+      std::cerr << "depth must be at least 1" << std::endl;
+      return 1;
+    }
+
+  BenchQueue ("ns3::DropTailQueue<Packet>", n, depth);
+  BenchQueue ("ns3::RingQueue<Packet>", n, depth);
+  return 0;
+}
@@ -0,0 +1,178 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program benchmarks the route lookups of Ipv4GlobalRouting on a
+// router of a large topology.  The router holds the routes that the
+// GlobalRouteManager installs for a topology of point-to-point links:
+// for every node, a host route to the address of its link and a /30
+// network route to the link, through one of the interfaces of the
+// router, or several of them for the equal-cost multi-path routes.  It
+// reports the time and the heap allocations per lookup of a random
+// destination.
+// Sample usage:  ./waf --run 'bench-routing --nodes=10000 --n=1000000'
+
+#include "ns3/command-line.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "ns3/packet.h"
+#include "ns3/node-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-global-routing.h"
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using namespace ns3;
+
+/// Number of calls to malloc, counted only where it can be interposed
+static uint64_t g_nAllocations = 0;
+
+#ifdef __GLIBC__
+// The routes created by the lookups end up in malloc
+extern "C" void *__libc_malloc (std::size_t size);
+
+extern "C" void *
+malloc (std::size_t size)
+{
+  g_nAllocations++;
+  return __libc_malloc (size);
+}
+#endif
+
+/**
+ * Look up n random destinations on a router and print the results.
+ *
+ * \param n number of lookups
+ * \param nNodes number of nodes of the topology
+ * \param nInterfaces number of interfaces of the router
+ * \param nPaths number of equal-cost paths to every node
+ * \param randomEcmp value of the RandomEcmpRouting attribute
+ */
+static void
+BenchLookups (uint32_t n, uint32_t nNodes, uint32_t nInterfaces, uint32_t nPaths, bool randomEcmp)
+{
+  // The router and its neighbors
+  NodeContainer router;
+  router.Create (1);
+  NodeContainer neighbors;
+  neighbors.Create (nInterfaces);
+  InternetStackHelper internet;
+  internet.Install (router);
+  internet.Install (neighbors);
+  PointToPointHelper p2p;
+  Ipv4AddressHelper address ("192.168.0.0", "255.255.255.252");
+  for (uint32_t i = 0; i < nInterfaces; i++)
+    {
+      address.Assign (p2p.Install (router.Get (0), neighbors.Get (i)));
+      address.NewNetwork ();
+    }
+
+  Ptr<Ipv4> ipv4 = router.Get (0)->GetObject<Ipv4> ();
+  Ptr<Ipv4GlobalRouting> routing = CreateObject<Ipv4GlobalRouting> ();
+  routing->SetAttribute ("RandomEcmpRouting", BooleanValue (randomEcmp));
+  routing->SetIpv4 (ipv4);
+
+  // The link of node i is 10.0.0.0/30 + 4 i, and its address the first one
+  std::vector<Ipv4Address> destinations (nNodes);
+  for (uint32_t i = 0; i < nNodes; i++)
+    {
+      Ipv4Address link (0x0a000000 + 4 * i);
+      destinations[i] = Ipv4Address (link.Get () + 1);
+      for (uint32_t path = 0; path < nPaths; path++)
+        {
+          uint32_t interface = 1 + (i + path) % nInterfaces;
+          Ipv4Address nextHop (ipv4->GetAddress (interface, 0).GetLocal ().Get () ^ 3);
+          routing->AddHostRouteTo (destinations[i], nextHop, interface);
+          routing->AddNetworkRouteTo (link, Ipv4Mask ("255.255.255.252"), nextHop, interface);
+        }
+    }
+
+  // Half of the lookups are for the host routes, half for the networks
+  std::vector<Ipv4Header> headers (1024);
+  for (uint32_t i = 0; i < headers.size (); i++)
+    {
+      Ipv4Address destination = destinations[std::rand () % nNodes];
+      headers[i].SetDestination (Ipv4Address (destination.Get () + (i % 2)));
+    }
+  Ptr<Packet> packet = Create<Packet> (100);
+  Socket::SocketErrno sockerr;
+
+  // the first lookup after the routes are added compiles them
+  SystemWallClockMs clock;
+  clock.Start ();
+  routing->RouteOutput (packet, headers[0], 0, sockerr);
+  uint64_t firstMs = clock.End ();
+
+  uint32_t found = 0;
+  uint64_t allocations = g_nAllocations;
+  clock.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      if (routing->RouteOutput (packet, headers[i % headers.size ()], 0, sockerr) != 0)
+        {
+          found++;
+        }
+    }
+  uint64_t ms = clock.End ();
+  allocations = g_nAllocations - allocations;
+
+  std::cout << nNodes << " nodes, " << routing->GetNRoutes () << " routes, "
+            << nPaths << " paths per node" << std::endl
+            << firstMs << " ms for the first lookup, "
+            << (ms * 1000000.0) / n << " ns/lookup, "
+            << (double) allocations / n << " allocations/lookup, "
+            << found << " routes found" << std::endl;
+
+  routing->Dispose ();
+  Simulator::Stop ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t n = 1000000;
+  uint32_t nNodes = 10000;
+  uint32_t nInterfaces = 4;
+  uint32_t nPaths = 1;
+  bool randomEcmp = false;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("n", "number of lookups", n);
+  cmd.AddValue ("nodes", "number of nodes of the topology", nNodes);
+  cmd.AddValue ("interfaces", "number of interfaces of the router", nInterfaces);
+  cmd.AddValue ("paths", "number of equal-cost paths to every node", nPaths);
+  cmd.AddValue ("randomEcmp", "pick one of the equal-cost paths at random", randomEcmp);
+  cmd.Parse (argc, argv);
+
+  if (nPaths > nInterfaces)
+    {
+      std::cerr << "paths must be at most interfaces" << std::endl;
+      return 1;
+    }
+
+  // Run in an event, as the routing protocols do: Time objects created
+  // before the simulation starts are recorded for a change of resolution
+  Simulator::ScheduleNow (&BenchLookups, n, nNodes, nInterfaces, nPaths, randomEcmp);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return 0;
+}
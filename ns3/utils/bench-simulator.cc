@@ -28,6 +28,20 @@
 
 using namespace ns3;
 
+/// Number of calls to malloc, counted only where it can be interposed
+static uint64_t g_nAllocations = 0;
+
+#ifdef __GLIBC__
+// Every event allocated with operator new ends up in malloc
+extern "C" void *__libc_malloc (std::size_t size);
+
+extern "C" void *
+malloc (std::size_t size)
+{
+  g_nAllocations++;
+  return __libc_malloc (size);
+}
+#endif
 
 bool g_debug = false;
 
@@ -115,10 +129,12 @@ Bench::RunBench (void)
   DEB ("initialization took " << init << "s");
 
   DEB ("running");
+  uint64_t allocations = g_nAllocations;
   time.Start ();
   Simulator::Run ();
   simu = time.End ();
   simu /= 1000;
+  allocations = g_nAllocations - allocations;
   DEB ("run took " << simu << "s");
 
   LOG (std::setw (g_fwidth) << init <<
@@ -126,7 +142,8 @@ Bench::RunBench (void)
        std::setw (g_fwidth) << (init / m_population) <<
        std::setw (g_fwidth) << simu <<
        std::setw (g_fwidth) << (m_count / simu) <<
-       std::setw (g_fwidth) << (simu / m_count));
+       std::setw (g_fwidth) << (simu / m_count) <<
+       std::setw (g_fwidth) << ((double) allocations / m_count));
 
 }
 
@@ -208,12 +225,14 @@ int main (int argc, char *argv[])
   bool schedList          = false;
   bool schedMap           = true;
   bool schedPriorityQueue = false;
+  bool schedWheel         = false;
 
   uint32_t pop   =  100000;
   uint32_t total = 1000000;
   uint32_t runs  =       1;
   std::string filename = "";
   bool calRev = false;
+  bool noPool = false;
 
   CommandLine cmd (__FILE__);
   cmd.Usage ("Benchmark the simulator scheduler.\n"
@@ -230,12 +249,14 @@ int main (int argc, char *argv[])
   cmd.AddValue ("list",  "use ListSheduler",              schedList);
   cmd.AddValue ("map",   "use MapScheduler (default)",    schedMap);
   cmd.AddValue ("pri",   "use PriorityQueue",             schedPriorityQueue);
+  cmd.AddValue ("wheel", "use TimingWheelScheduler",      schedWheel);
   cmd.AddValue ("debug", "enable debugging output",       g_debug);
   cmd.AddValue ("pop",   "event population size (default 1E5)",         pop);
   cmd.AddValue ("total", "total number of events to run (default 1E6)", total);
   cmd.AddValue ("runs",  "number of runs (default 1)",    runs);
   cmd.AddValue ("file",  "file of relative event times",  filename);
   cmd.AddValue ("prec",  "printed output precision",      g_fwidth);
+  cmd.AddValue ("nopool", "disable the reuse of freed events", noPool);
   cmd.Parse (argc, argv);
   g_me = cmd.GetName () + ": ";
   g_fwidth += 6;  // 5 extra chars in '2.000002e+07 ': . e+0 _
@@ -258,8 +279,13 @@ int main (int argc, char *argv[])
     {
       factory.SetTypeId ("ns3::PriorityQueueScheduler");
     }
+  if (schedWheel)
+    {
+      factory.SetTypeId ("ns3::TimingWheelScheduler");
+    }
       
   Simulator::SetScheduler (factory);
+  EventImpl::SetPooling (!noPool);
 
   LOGME (std::setprecision (g_fwidth - 6));
   DEB ("debugging is ON");
@@ -273,6 +299,7 @@ int main (int argc, char *argv[])
   LOGME ("population: " << pop);
   LOGME ("total events: " << total);
   LOGME ("runs: " << runs);
+  LOGME ("event pooling: " << (noPool ? "off" : "on"));
 
   Bench *bench = new Bench (pop, total);
   bench->SetRandomStream (GetRandomStream (filename));
@@ -281,14 +308,15 @@ int main (int argc, char *argv[])
   LOG ("");
   LOG (std::left << std::setw (g_fwidth) << "Run #" <<
        std::left << std::setw (3 * g_fwidth) << "Initialization:" <<
-       std::left << std::setw (3 * g_fwidth) << "Simulation:");
+       std::left << std::setw (4 * g_fwidth) << "Simulation:");
   LOG (std::left << std::setw (g_fwidth) << "" <<
        std::left << std::setw (g_fwidth) << "Time (s)" <<
        std::left << std::setw (g_fwidth) << "Rate (ev/s)" <<
        std::left << std::setw (g_fwidth) << "Per (s/ev)" <<
        std::left << std::setw (g_fwidth) << "Time (s)" <<
        std::left << std::setw (g_fwidth) << "Rate (ev/s)" <<
-       std::left << std::setw (g_fwidth) << "Per (s/ev)" );
+       std::left << std::setw (g_fwidth) << "Per (s/ev)" <<
+       std::left << std::setw (g_fwidth) << "Allocs (/ev)" );
   LOG (std::setfill ('-') <<
        std::right << std::setw (g_fwidth) << " " <<
        std::right << std::setw (g_fwidth) << " " <<
@@ -297,6 +325,7 @@ int main (int argc, char *argv[])
        std::right << std::setw (g_fwidth) << " " <<
        std::right << std::setw (g_fwidth) << " " <<
        std::right << std::setw (g_fwidth) << " " <<
+       std::right << std::setw (g_fwidth) << " " <<
        std::setfill (' ')
        );
 
@@ -0,0 +1,161 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program benchmarks the scoreboard of a TcpTxBuffer in the loss
+// recovery of a large window.  It sends a window of segments, of which
+// one every lossEvery is lost, and then makes the calls of a SACK
+// sender on every ACK of the recovery: each ACK sacks the run of
+// segments that follows a hole, the sender checks the head for losses,
+// asks NextSeg for a segment and retransmits it, and reads the bytes in
+// flight.  It reports the time and the heap allocations per ACK.
+// Sample usage:  ./waf --run 'bench-tcp-tx-buffer --window=50000 --lossEvery=10'
+
+#include "ns3/command-line.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/tcp-tx-buffer.h"
+#include "ns3/tcp-option-sack.h"
+#include <cstdlib>
+#include <iostream>
+
+using namespace ns3;
+
+/// Number of calls to malloc, counted only where it can be interposed
+static uint64_t g_nAllocations = 0;
+
+#ifdef __GLIBC__
+// The items of the buffer and their containers end up in malloc
+extern "C" void *__libc_malloc (std::size_t size);
+
+extern "C" void *
+malloc (std::size_t size)
+{
+  g_nAllocations++;
+  return __libc_malloc (size);
+}
+#endif
+
+/// The receiver window: large enough to never limit the sender
+static uint32_t
+GetRWnd (void)
+{
+  return 0xffffffff;
+}
+
+/**
+ * Recover a window with holes and print the results.
+ *
+ * \param window number of segments of the window
+ * \param lossEvery one segment every lossEvery is lost
+ * \param segmentSize segment size
+ */
+static void
+BenchRecovery (uint32_t window, uint32_t lossEvery, uint32_t segmentSize)
+{
+  Ptr<TcpTxBuffer> txBuf = CreateObject<TcpTxBuffer> ();
+  SequenceNumber32 head (1);
+  txBuf->SetRWndCallback (MakeCallback (&GetRWnd));
+  txBuf->SetHeadSequence (head);
+  txBuf->SetMaxBufferSize (window * segmentSize);
+  txBuf->SetSegmentSize (segmentSize);
+  txBuf->SetDupAckThresh (3);
+
+  // Send the window
+  txBuf->Add (Create<Packet> (window * segmentSize));
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < window; i++)
+    {
+      txBuf->CopyFromSequence (segmentSize, head + segmentSize * i);
+    }
+  uint64_t sendMs = clock.End ();
+
+  uint32_t nAcks = 0;
+  uint32_t nRetransmissions = 0;
+  uint64_t inFlight = 0;
+  Ptr<TcpOptionSack> sack = CreateObject<TcpOptionSack> ();
+  uint64_t allocations = g_nAllocations;
+  clock.Start ();
+  for (uint32_t hole = 0; hole < window; hole += lossEvery)
+    {
+      // The ACK of the segments that follow the hole
+      SequenceNumber32 begin = head + segmentSize * (hole + 1);
+      SequenceNumber32 end = head + segmentSize * std::min (hole + lossEvery, window);
+      if (begin >= end)
+        {
+          continue;
+        }
+      sack->ClearSackList ();
+      sack->AddSackBlock (TcpOptionSack::SackBlock (begin, end));
+      txBuf->Update (sack->GetSackList ());
+      nAcks++;
+
+      txBuf->IsLost (txBuf->HeadSequence ());
+      SequenceNumber32 seq;
+      SequenceNumber32 seqHigh;
+      if (txBuf->NextSeg (&seq, &seqHigh, true))
+        {
+          txBuf->CopyFromSequence (segmentSize, seq);
+          nRetransmissions++;
+        }
+      inFlight += txBuf->BytesInFlight ();
+    }
+  // The retransmissions fill the holes: the last ACK acknowledges everything
+  txBuf->DiscardUpTo (head + segmentSize * window);
+  nAcks++;
+  uint64_t ms = clock.End ();
+  allocations = g_nAllocations - allocations;
+
+  std::cout << window << " segments in the window, one every " << lossEvery << " lost" << std::endl
+            << sendMs << " ms to send the window, "
+            << ms << " ms for the recovery, "
+            << (ms * 1000.0) / nAcks << " us/ACK, "
+            << (double) allocations / nAcks << " allocations/ACK" << std::endl
+            << nAcks << " ACKs, " << nRetransmissions << " retransmissions, "
+            << inFlight / nAcks << " bytes in flight on average" << std::endl;
+
+  Simulator::Stop ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t window = 50000;
+  uint32_t lossEvery = 10;
+  uint32_t segmentSize = 1448;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("window", "number of segments of the window", window);
+  cmd.AddValue ("lossEvery", "one segment every lossEvery is lost", lossEvery);
+  cmd.AddValue ("segmentSize", "segment size", segmentSize);
+  cmd.Parse (argc, argv);
+
+  if (lossEvery < 2 || uint64_t (window) * segmentSize > 0x7fffffff)
+    {
+      std::cerr << "lossEvery must be at least 2, and the window below 2 GB" << std::endl;
+      return 1;
+    }
+
+  // Run in an event, as the sockets do: Time objects created before the
+  // simulation starts are recorded for a change of resolution
+  Simulator::ScheduleNow (&BenchRecovery, window, lossEvery, segmentSize);
+  Simulator::Run ();
+  Simulator::Destroy ();
+  return 0;
+}
@@ -0,0 +1,126 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program benchmarks the cost of forwarding a packet through a
+// VcpQueueDisc, with the load bits carried either in a VcpPacketTag or
+// directly in the ECN field of the IPv4 header (UseEcn), and reports the
+// number of heap allocations per forwarded packet.
+// Sample usage:  ./waf --run 'bench-vcp-queue-disc --n=100000'
+
+#include "ns3/command-line.h"
+#include "ns3/system-wall-clock-ms.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/boolean.h"
+#include "ns3/queue-size.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-queue-disc-item.h"
+#include "ns3/vcp-packet-tag.h"
+#include "ns3/vcp-queue-disc.h"
+#include <cstdlib>
+#include <iostream>
+
+using namespace ns3;
+
+/// Number of calls to malloc, counted only where it can be interposed
+static uint64_t g_nAllocations = 0;
+
+#ifdef __GLIBC__
+// Both operator new and PacketTagList::CreateTagData end up in malloc
+extern "C" void *__libc_malloc (std::size_t size);
+
+extern "C" void *
+malloc (std::size_t size)
+{
+  g_nAllocations++;
+  return __libc_malloc (size);
+}
+#endif
+
+/**
+ * Forward n packets through a VcpQueueDisc and print the results.
+ *
+ * Every packet arrives already carrying the load stamped by a previous hop,
+ * as a VcpPacketTag or as ECN bits depending on the mode, and is a copy of
+ * the received packet (sharing its tag list) as on the forwarding path.
+ *
+ * \param useEcn value of the VcpQueueDisc UseEcn attribute
+ * \param n number of packets
+ */
+static void
+BenchForward (bool useEcn, uint32_t n)
+{
+  Ptr<VcpQueueDisc> qdisc = CreateObject<VcpQueueDisc> ();
+  qdisc->SetAttribute ("UseEcn", BooleanValue (useEcn));
+  qdisc->SetAttribute ("MaxSize", QueueSizeValue (QueueSize ("1000p")));
+  qdisc->Initialize ();
+
+  Ipv4Header ipHeader;
+  ipHeader.SetProtocol (6);
+  ipHeader.SetPayloadSize (1000);
+
+  uint64_t nAllocations = 0;
+  SystemWallClockMs clock;
+  clock.Start ();
+  for (uint32_t i = 0; i < n; i++)
+    {
+      Ptr<Packet> received = Create<Packet> (1000);
+      if (useEcn)
+        {
+          ipHeader.SetEcn ((Ipv4Header::EcnType) VcpPacketTag::LOAD_LOW);
+        }
+      else
+        {
+          VcpPacketTag tag;
+          tag.SetLoad (VcpPacketTag::LOAD_LOW);
+          received->AddPacketTag (tag);
+        }
+      // Like Ipv4L3Protocol::IpForward, forward a copy of the received packet
+      Ptr<Packet> p = received->Copy ();
+      Ptr<Ipv4QueueDiscItem> item = Create<Ipv4QueueDiscItem> (p, Address (), 0x0800, ipHeader);
+
+      uint64_t before = g_nAllocations;
+      qdisc->Enqueue (item);
+      item = 0;
+      Ptr<QueueDiscItem> out = qdisc->Dequeue ();
+      nAllocations += g_nAllocations - before;
+    }
+  uint64_t ms = clock.End ();
+
+  std::cout << (useEcn ? "ecn" : "tag") << " "
+            << (double) nAllocations / n << " allocations/packet "
+            << (ms * 1000000.0) / n << " ns/packet" << std::endl;
+
+  qdisc->Dispose ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  uint32_t n = 100000;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("n", "number of packets to forward", n);
+  cmd.Parse (argc, argv);
+
+  BenchForward (false, n);
+  BenchForward (true, n);
+
+  Simulator::Destroy ();
+  return 0;
+}
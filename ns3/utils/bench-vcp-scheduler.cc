@@ -0,0 +1,253 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * Copyright (c) 2021 Stanford University
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+// This program replays the scheduler operations recorded from a VCP
+// simulation against each of the simulator schedulers and reports the
+// cost per operation and the peak memory held by the scheduler.
+//
+// Unlike bench-simulator, whose events are drawn from a single random
+// distribution, the recorded mix holds what the VCP simulations really
+// schedule: the periodic VcpQueueDisc and tracing timers, one transmit
+// complete event per packet and link, and the TCP retransmission and
+// delayed ACK timers that are rescheduled on almost every segment (a
+// cancelled event stays in the scheduler until it expires).
+//
+// Sample usage:
+//   ./waf --run 'single-bottleneck-datapoint --bwBottleneck=1000 --time=20
+//                --schedulerTrace=sched.cols'
+//   ./waf --run 'bench-vcp-scheduler --trace=sched.cols'
+
+#include "ns3/command-line.h"
+#include "ns3/abort.h"
+#include "ns3/event-impl.h"
+#include "ns3/object-factory.h"
+#include "ns3/scheduler.h"
+#include "ns3/columnar-trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+using namespace ns3;
+
+/// Bytes currently allocated with operator new
+static std::size_t g_liveBytes = 0;
+/// Highest value of g_liveBytes since the last reset
+static std::size_t g_peakBytes = 0;
+
+/// Room kept in front of every allocation for its size, preserving alignment
+static const std::size_t ALLOC_HEADER = 16;
+
+void *
+operator new (std::size_t size)
+{
+  void *block = std::malloc (size + ALLOC_HEADER);
+  if (block == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  *static_cast<std::size_t *> (block) = size;
+  g_liveBytes += size;
+  g_peakBytes = std::max (g_peakBytes, g_liveBytes);
+  return static_cast<char *> (block) + ALLOC_HEADER;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  if (p == 0)
+    {
+      return;
+    }
+  void *block = static_cast<char *> (p) - ALLOC_HEADER;
+  g_liveBytes -= *static_cast<std::size_t *> (block);
+  std::free (block);
+}
+
+/// Operation recorded by RecordingScheduler in single-bottleneck-datapoint
+struct Op
+{
+  uint32_t op;              //!< 0: Insert, 1: RemoveNext, 2: Remove
+  Scheduler::EventKey key;  //!< key of the inserted or removed event
+};
+
+/// The replayed events are never invoked, they all share one of these.
+class NullEvent : public EventImpl
+{
+protected:
+  virtual void Notify (void)
+  {
+  }
+};
+
+/**
+ * Read the operations of a trace and print a summary of the event mix.
+ * \param filename the trace file
+ * \returns the operations
+ */
+static std::vector<Op>
+ReadOps (std::string filename)
+{
+  ColumnarTraceReader reader (filename);
+  NS_ABORT_MSG_UNLESS (reader.HasSeries ("ops"), filename << " holds no scheduler operations");
+  std::vector<double> op = reader.GetColumn ("ops", "op");
+  std::vector<double> ts = reader.GetColumn ("ops", "ts");
+  std::vector<double> uid = reader.GetColumn ("ops", "uid");
+
+  std::vector<Op> ops (op.size ());
+  uint64_t count[3] = { 0, 0, 0 };
+  uint64_t now = 0;
+  uint64_t population = 0;
+  uint64_t peakPopulation = 0;
+  std::vector<uint64_t> delays;
+  for (size_t i = 0; i < ops.size (); i++)
+    {
+      ops[i].op = op[i];
+      ops[i].key.m_ts = ts[i];
+      ops[i].key.m_uid = uid[i];
+      ops[i].key.m_context = 0;
+      NS_ABORT_MSG_IF (ops[i].op > 2, "Bad operation in row " << i);
+      count[ops[i].op]++;
+      switch (ops[i].op)
+        {
+        case 0:
+          delays.push_back (ops[i].key.m_ts - now);
+          peakPopulation = std::max (peakPopulation, ++population);
+          break;
+        case 1:
+          now = ops[i].key.m_ts;
+          population--;
+          break;
+        case 2:
+          population--;
+          break;
+        }
+    }
+
+  std::sort (delays.begin (), delays.end ());
+  auto percentile = [&delays] (double p) {
+      return delays.empty () ? 0 : delays[(size_t) (p * (delays.size () - 1))] / 1e3;
+    };
+  std::cout << "trace: " << ops.size () << " operations, "
+            << count[0] << " inserts, " << count[1] << " events run, "
+            << count[2] << " cancels, peak population " << peakPopulation << std::endl;
+  std::cout << "insert delay (us): p10 " << percentile (0.1) << " p50 " << percentile (0.5)
+            << " p90 " << percentile (0.9) << " p99 " << percentile (0.99)
+            << " max " << percentile (1) << std::endl << std::endl;
+  return ops;
+}
+
+/**
+ * Replay the operations against a scheduler.
+ * \param factory the scheduler factory
+ * \param ops the operations
+ * \param [out] peakBytes peak memory allocated by the scheduler
+ * \returns the replay time in ns
+ */
+static double
+Replay (ObjectFactory factory, const std::vector<Op> &ops, std::size_t &peakBytes)
+{
+  NullEvent event;
+  Scheduler::Event ev;
+  ev.impl = &event;
+
+  std::size_t baseBytes = g_liveBytes;
+  g_peakBytes = baseBytes;
+  Ptr<Scheduler> scheduler = factory.Create<Scheduler> ();
+
+  auto start = std::chrono::steady_clock::now ();
+  for (const Op &op : ops)
+    {
+      ev.key = op.key;
+      switch (op.op)
+        {
+        case 0:
+          scheduler->Insert (ev);
+          break;
+        case 1:
+          {
+            Scheduler::Event next = scheduler->RemoveNext ();
+            NS_ABORT_MSG_UNLESS (next.key.m_uid == op.key.m_uid,
+                                 factory.GetTypeId ().GetName () << " ran event " << next.key.m_uid
+                                                                 << " instead of " << op.key.m_uid);
+            break;
+          }
+        case 2:
+          scheduler->Remove (ev);
+          break;
+        }
+    }
+  auto end = std::chrono::steady_clock::now ();
+
+  peakBytes = g_peakBytes - baseBytes;
+  while (!scheduler->IsEmpty ())
+    {
+      scheduler->RemoveNext ();
+    }
+  scheduler->Dispose ();
+  return std::chrono::duration<double, std::nano> (end - start).count ();
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string trace = "";
+  uint32_t runs = 3;
+
+  CommandLine cmd (__FILE__);
+  cmd.Usage ("Replay the scheduler operations recorded by\n"
+             "single-bottleneck-datapoint --schedulerTrace against every scheduler.");
+  cmd.AddValue ("trace", "scheduler trace written by single-bottleneck-datapoint", trace);
+  cmd.AddValue ("runs", "number of runs per scheduler, the fastest is reported", runs);
+  cmd.Parse (argc, argv);
+  NS_ABORT_MSG_IF (trace == "", "Missing --trace");
+  NS_ABORT_MSG_IF (runs == 0, "Need at least one run");
+
+  std::vector<Op> ops = ReadOps (trace);
+  uint64_t nEvents = std::count_if (ops.begin (), ops.end (), [] (const Op &op) { return op.op == 1; });
+  NS_ABORT_MSG_IF (nEvents == 0, "No event was run in " << trace);
+
+  std::vector<ObjectFactory> factories;
+  for (std::string name : { "ns3::MapScheduler", "ns3::HeapScheduler", "ns3::CalendarScheduler",
+                            "ns3::ListScheduler", "ns3::PriorityQueueScheduler",
+                            "ns3::TimingWheelScheduler" })
+    {
+      factories.push_back (ObjectFactory (name));
+    }
+
+  std::cout << std::left << std::setw (28) << "scheduler"
+            << std::setw (14) << "ns/event" << std::setw (14) << "ns/op" << "peak bytes" << std::endl;
+  for (const ObjectFactory &factory : factories)
+    {
+      double best = 0;
+      std::size_t peakBytes = 0;
+      for (uint32_t i = 0; i < runs; i++)
+        {
+          double ns = Replay (factory, ops, peakBytes);
+          best = (i == 0) ? ns : std::min (best, ns);
+        }
+      std::cout << std::left << std::setw (28) << factory.GetTypeId ().GetName ()
+                << std::setw (14) << best / nEvents << std::setw (14) << best / ops.size ()
+                << peakBytes << std::endl;
+    }
+  return 0;
+}